@@ -0,0 +1,67 @@
+/**
+ * @file Benchmark.h
+ * @brief Minimal benchmark harness shared by the runBenchmarks executable
+ *
+ * Each bench_*.cpp file registers its cases with WKL_BENCHMARK. The runner
+ * executes every registered case, or only those whose name contains the
+ * filter passed on the command line.
+ */
+
+#pragma once
+
+#include <Windows.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+struct BenchmarkCase {
+    const char* Name;
+    void (*Run)();
+};
+
+inline std::vector<BenchmarkCase>& BenchmarkRegistry() {
+    static std::vector<BenchmarkCase> registry;
+    return registry;
+}
+
+struct BenchmarkRegistrar {
+    BenchmarkRegistrar(const char* name, void (*run)()) {
+        BenchmarkRegistry().push_back({ name, run });
+    }
+};
+
+#define WKL_BENCHMARK(Name) \
+    static void Name(); \
+    static BenchmarkRegistrar Name##_Registrar(#Name, Name); \
+    static void Name()
+
+// Wall-clock stopwatch in seconds
+class BenchmarkTimer {
+public:
+    BenchmarkTimer() : start_(std::chrono::steady_clock::now()) {}
+
+    double Elapsed() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Prints one result line: operations per second and nanoseconds per operation
+inline void BenchmarkReport(const char* label, double operations, double seconds) {
+    printf("  %-48s %12.2f Mops/s %10.2f ns/op\n",
+           label, operations / seconds / 1e6, seconds * 1e9 / operations);
+}
+
+// Prints one result line for a byte-oriented case: gigabytes per second
+inline void BenchmarkReportBytes(const char* label, double bytes, double seconds) {
+    printf("  %-48s %12.2f GB/s\n", label, bytes / seconds / 1e9);
+}
+
+// Keeps the optimizer from discarding a computed value
+template <typename T>
+inline void BenchmarkKeep(const T& value) {
+    static volatile T sink;
+    sink = value;
+}
@@ -0,0 +1,149 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/AtomTable.h"
+
+namespace {
+
+// Stays within the allocation tracking table, so pool usage is exact
+const int kDevices = 16384;
+const int kManufacturers = 300;
+const int kEqualityPasses = 64;
+const int kAddsPerThread = 1 << 20;
+
+std::vector<std::vector<WCHAR>> ManufacturerNames() {
+    std::vector<std::vector<WCHAR>> names(kManufacturers);
+    for (int i = 0; i < kManufacturers; i++) {
+        std::string value = "Manufacturer Corporation " + std::to_string(i);
+        names[i].assign(value.begin(), value.end());
+    }
+    return names;
+}
+
+UNICODE_STRING MakeName(std::vector<WCHAR>& text) {
+    UNICODE_STRING string;
+    string.Buffer = text.data();
+    string.Length = (USHORT)(text.size() * sizeof(WCHAR));
+    string.MaximumLength = string.Length;
+    return string;
+}
+
+void ReportPool(const char* label, SIZE_T bytes) {
+    printf("  %-48s %12.1f KB pool\n", label, bytes / 1024.0);
+}
+
+}  // namespace
+
+// One manufacturer string per device, as DEVICE_NAME stores it
+WKL_BENCHMARK(AtomTable_DeviceStrings) {
+    std::vector<std::vector<WCHAR>> texts = ManufacturerNames();
+    std::vector<UNICODE_STRING> copies(kDevices);
+    std::vector<RTL_ATOM> atoms(kDevices);
+    PRTL_ATOM_TABLE table;
+    ULONG_PTR matches = 0;
+
+    InitHeap();
+
+    SIZE_T before = GetGlobalState()->CurrentBytesAllocated;
+    BenchmarkTimer duplicateTimer;
+    for (int i = 0; i < kDevices; i++) {
+        UNICODE_STRING name = MakeName(texts[i % kManufacturers]);
+        RtlDuplicateUnicodeString(RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE, &name, &copies[i]);
+    }
+    BenchmarkReport("RtlDuplicateUnicodeString per device", kDevices, duplicateTimer.Elapsed());
+    ReportPool("duplicated strings", GetGlobalState()->CurrentBytesAllocated - before);
+
+    before = GetGlobalState()->CurrentBytesAllocated;
+    if (!NT_SUCCESS(RtlCreateAtomTable(0, FALSE, &table))) {
+        CleanupHeap();
+        return;
+    }
+    BenchmarkTimer atomTimer;
+    for (int i = 0; i < kDevices; i++) {
+        UNICODE_STRING name = MakeName(texts[i % kManufacturers]);
+        if (!NT_SUCCESS(RtlAddAtomToAtomTable(table, &name, &atoms[i]))) {
+            atoms[i] = NULL;
+        }
+    }
+    BenchmarkReport("RtlAddAtomToAtomTable per device", kDevices, atomTimer.Elapsed());
+    ReportPool("atom table, buckets and strings", GetGlobalState()->CurrentBytesAllocated - before);
+
+    // Find every device of one manufacturer
+    UNICODE_STRING target = MakeName(texts[kManufacturers / 2]);
+    BenchmarkTimer equalTimer;
+    for (int pass = 0; pass < kEqualityPasses; pass++) {
+        for (int i = 0; i < kDevices; i++) {
+            matches += RtlEqualUnicodeString(&copies[i], &target, FALSE);
+        }
+    }
+    BenchmarkReport("RtlEqualUnicodeString against each device", (double)kDevices * kEqualityPasses,
+                    equalTimer.Elapsed());
+
+    RTL_ATOM targetAtom = atoms[kManufacturers / 2];
+    BenchmarkTimer pointerTimer;
+    for (int pass = 0; pass < kEqualityPasses; pass++) {
+        for (int i = 0; i < kDevices; i++) {
+            matches += atoms[i] == targetAtom;
+        }
+        BenchmarkKeep(matches);
+    }
+    BenchmarkReport("atom pointer comparison against each device", (double)kDevices * kEqualityPasses,
+                    pointerTimer.Elapsed());
+    BenchmarkKeep(matches);
+
+    for (int i = 0; i < kDevices; i++) {
+        FreeUnicodeString(&copies[i]);
+        RtlDeleteAtomFromAtomTable(table, atoms[i]);
+    }
+    RtlDestroyAtomTable(table);
+    CleanupHeap();
+}
+
+// Threads interning and releasing strings that are already in the table
+WKL_BENCHMARK(AtomTable_ConcurrentAdd) {
+    std::vector<std::vector<WCHAR>> texts = ManufacturerNames();
+    std::vector<RTL_ATOM> pinned(kManufacturers);
+    PRTL_ATOM_TABLE table;
+
+    InitHeap();
+    if (!NT_SUCCESS(RtlCreateAtomTable(0, FALSE, &table))) {
+        CleanupHeap();
+        return;
+    }
+    for (int i = 0; i < kManufacturers; i++) {
+        UNICODE_STRING name = MakeName(texts[i]);
+        if (!NT_SUCCESS(RtlAddAtomToAtomTable(table, &name, &pinned[i]))) {
+            pinned[i] = NULL;
+        }
+    }
+
+    for (int threads : { 1, 4 }) {
+        std::vector<std::thread> workers;
+        char label[96];
+
+        BenchmarkTimer timer;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (int i = 0; i < kAddsPerThread; i++) {
+                    UNICODE_STRING name = MakeName(texts[(i + t * 37) % kManufacturers]);
+                    RTL_ATOM atom;
+                    if (NT_SUCCESS(RtlAddAtomToAtomTable(table, &name, &atom))) {
+                        RtlDeleteAtomFromAtomTable(table, atom);
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        snprintf(label, sizeof(label), "add + delete existing atom, %d thread%s", threads, threads > 1 ? "s" : "");
+        BenchmarkReport(label, (double)kAddsPerThread * threads, timer.Elapsed());
+    }
+
+    for (int i = 0; i < kManufacturers; i++) {
+        RtlDeleteAtomFromAtomTable(table, pinned[i]);
+    }
+    RtlDestroyAtomTable(table);
+    CleanupHeap();
+}
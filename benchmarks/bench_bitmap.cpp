@@ -0,0 +1,130 @@
+#include <random>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/Bitmap.h"
+
+namespace {
+
+const ULONG kBitMapSize = 1u << 20;
+
+// Fills the bitmap with randomly placed used runs until roughly fillRatio of it is set
+void FillBitMap(PRTL_BITMAP bitMap, double fillRatio, std::mt19937& rng) {
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<ULONG> runLength(1, 64);
+
+    RtlClearAllBits(bitMap);
+    for (ULONG i = 0; i < bitMap->SizeOfBitMap;) {
+        ULONG len = runLength(rng);
+        if (len > bitMap->SizeOfBitMap - i) {
+            len = bitMap->SizeOfBitMap - i;
+        }
+        if (coin(rng) < fillRatio) {
+            RtlSetBits(bitMap, i, len);
+        }
+        i += len;
+    }
+}
+
+// Bit-at-a-time search, equivalent to scanning the old IsAllocated flags
+ULONG NaiveFindClearBits(PRTL_BITMAP bitMap, ULONG numberToFind, ULONG hint) {
+    ULONG run = 0;
+    for (ULONG i = hint; i < bitMap->SizeOfBitMap; i++) {
+        run = RtlTestBit(bitMap, i) ? 0 : run + 1;
+        if (run == numberToFind) {
+            return i + 1 - numberToFind;
+        }
+    }
+    return RTL_BITMAP_NOT_FOUND;
+}
+
+}  // namespace
+
+WKL_BENCHMARK(Bitmap_FindClearBits_1M) {
+    std::vector<ULONG> buffer(kBitMapSize / 32);
+    RTL_BITMAP bitMap;
+    RtlInitializeBitMap(&bitMap, buffer.data(), kBitMapSize);
+    std::mt19937 rng(1);
+
+    for (double fill : { 0.0, 0.5, 0.9, 0.99, 1.0 }) {
+        FillBitMap(&bitMap, fill, rng);
+        for (ULONG length : { 1u, 16u, 256u }) {
+            const int iterations = 2000;
+            ULONG found = 0;
+            char label[96];
+
+            BenchmarkTimer timer;
+            for (int i = 0; i < iterations; i++) {
+                found += RtlFindClearBits(&bitMap, length, (ULONG)rng() % kBitMapSize);
+            }
+            double fast = timer.Elapsed();
+
+            BenchmarkTimer naiveTimer;
+            for (int i = 0; i < iterations / 10; i++) {
+                found += NaiveFindClearBits(&bitMap, length, (ULONG)rng() % kBitMapSize);
+            }
+            double naive = naiveTimer.Elapsed();
+            BenchmarkKeep(found);
+
+            snprintf(label, sizeof(label), "fill=%.2f run=%lu", fill, (unsigned long)length);
+            BenchmarkReport(label, iterations, fast);
+            snprintf(label, sizeof(label), "fill=%.2f run=%lu (bit-at-a-time)", fill, (unsigned long)length);
+            BenchmarkReport(label, iterations / 10, naive);
+        }
+    }
+}
+
+WKL_BENCHMARK(Bitmap_FindClearBitsAndSet_Churn_1M) {
+    std::vector<ULONG> buffer(kBitMapSize / 32);
+    RTL_BITMAP bitMap;
+    RtlInitializeBitMap(&bitMap, buffer.data(), kBitMapSize);
+    std::mt19937 rng(2);
+
+    for (double fill : { 0.25, 0.75, 0.95 }) {
+        FillBitMap(&bitMap, fill, rng);
+        const int iterations = 100000;
+        ULONG hint = 0;
+        char label[96];
+
+        // Allocate-then-release keeps the fill ratio stable while exercising the hint
+        BenchmarkTimer timer;
+        for (int i = 0; i < iterations; i++) {
+            ULONG index = RtlFindClearBitsAndSet(&bitMap, 4, hint);
+            if (index != RTL_BITMAP_NOT_FOUND) {
+                RtlClearBits(&bitMap, index, 4);
+                hint = index + 4;
+            }
+        }
+        snprintf(label, sizeof(label), "fill=%.2f run=4", fill);
+        BenchmarkReport(label, iterations, timer.Elapsed());
+    }
+}
+
+WKL_BENCHMARK(Bitmap_Counting_1M) {
+    std::vector<ULONG> buffer(kBitMapSize / 32);
+    RTL_BITMAP bitMap;
+    RtlInitializeBitMap(&bitMap, buffer.data(), kBitMapSize);
+    std::mt19937 rng(3);
+
+    for (double fill : { 0.1, 0.5, 0.9 }) {
+        FillBitMap(&bitMap, fill, rng);
+        const int iterations = 200;
+        ULONG total = 0;
+        ULONG start = 0;
+        char label[96];
+
+        BenchmarkTimer countTimer;
+        for (int i = 0; i < iterations; i++) {
+            total += RtlNumberOfSetBits(&bitMap);
+        }
+        snprintf(label, sizeof(label), "RtlNumberOfSetBits fill=%.2f", fill);
+        BenchmarkReport(label, iterations, countTimer.Elapsed());
+
+        BenchmarkTimer longestTimer;
+        for (int i = 0; i < iterations; i++) {
+            total += RtlFindLongestRunClear(&bitMap, &start);
+        }
+        snprintf(label, sizeof(label), "RtlFindLongestRunClear fill=%.2f", fill);
+        BenchmarkReport(label, iterations, longestTimer.Elapsed());
+        BenchmarkKeep(total);
+    }
+}
@@ -0,0 +1,158 @@
+#include <atomic>
+#include <thread>
+#include "Benchmark.h"
+#include "../include/Dispatcher.h"
+
+namespace {
+
+const int kUncontendedPairs = 1 << 22;
+const int kRoundTrips = 1 << 14;
+const int kHandOffs = 1 << 12;
+const int kWaiters = 16;
+
+/* Two threads bounce a token through a pair of synchronization events */
+void PingPongEvents() {
+    KEVENT ping;
+    KEVENT pong;
+    KeInitializeEvent(&ping, SynchronizationEvent, FALSE);
+    KeInitializeEvent(&pong, SynchronizationEvent, FALSE);
+
+    BenchmarkTimer timer;
+    std::thread partner([&]() {
+        for (int i = 0; i < kRoundTrips; i++) {
+            KeWaitForSingleObject(&ping, Executive, KernelMode, FALSE, NULL);
+            KeSetEvent(&pong, IO_NO_INCREMENT, FALSE);
+        }
+    });
+    for (int i = 0; i < kRoundTrips; i++) {
+        KeSetEvent(&ping, IO_NO_INCREMENT, FALSE);
+        KeWaitForSingleObject(&pong, Executive, KernelMode, FALSE, NULL);
+    }
+    partner.join();
+    BenchmarkReport("KEVENT ping-pong round trip", kRoundTrips, timer.Elapsed());
+}
+
+/* Same hand-off through one semaphore per direction */
+void PingPongSemaphores() {
+    KSEMAPHORE ping;
+    KSEMAPHORE pong;
+    KeInitializeSemaphore(&ping, 0, 1);
+    KeInitializeSemaphore(&pong, 0, 1);
+
+    BenchmarkTimer timer;
+    std::thread partner([&]() {
+        for (int i = 0; i < kRoundTrips; i++) {
+            KeWaitForSingleObject(&ping, Executive, KernelMode, FALSE, NULL);
+            KeReleaseSemaphore(&pong, IO_NO_INCREMENT, 1, FALSE);
+        }
+    });
+    for (int i = 0; i < kRoundTrips; i++) {
+        KeReleaseSemaphore(&ping, IO_NO_INCREMENT, 1, FALSE);
+        KeWaitForSingleObject(&pong, Executive, KernelMode, FALSE, NULL);
+    }
+    partner.join();
+    BenchmarkReport("KSEMAPHORE ping-pong round trip", kRoundTrips, timer.Elapsed());
+}
+
+/* Baseline: the polling hand-off the events replace, a flag and a yield loop */
+void PingPongPolling() {
+    std::atomic<int> turn(0);
+
+    BenchmarkTimer timer;
+    std::thread partner([&]() {
+        for (int i = 0; i < kRoundTrips; i++) {
+            while (turn.load(std::memory_order_acquire) != 1) {
+                SwitchToThread();
+            }
+            turn.store(0, std::memory_order_release);
+        }
+    });
+    for (int i = 0; i < kRoundTrips; i++) {
+        turn.store(1, std::memory_order_release);
+        while (turn.load(std::memory_order_acquire) != 0) {
+            SwitchToThread();
+        }
+    }
+    partner.join();
+    BenchmarkReport("polling ping-pong round trip", kRoundTrips, timer.Elapsed());
+}
+
+/* One signal at a time through a synchronization event many threads wait on */
+void HandOffToManyWaiters() {
+    KEVENT work;
+    KSEMAPHORE done;
+    std::atomic<bool> stop(false);
+    std::atomic<int> exited(0);
+    std::thread waiters[kWaiters];
+    KeInitializeEvent(&work, SynchronizationEvent, FALSE);
+    KeInitializeSemaphore(&done, 0, kWaiters);
+
+    for (std::thread& waiter : waiters) {
+        waiter = std::thread([&]() {
+            for (;;) {
+                KeWaitForSingleObject(&work, Executive, KernelMode, FALSE, NULL);
+                if (stop.load(std::memory_order_acquire)) {
+                    break;
+                }
+                KeReleaseSemaphore(&done, IO_NO_INCREMENT, 1, FALSE);
+            }
+            exited.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    BenchmarkTimer timer;
+    for (int i = 0; i < kHandOffs; i++) {
+        KeSetEvent(&work, IO_NO_INCREMENT, FALSE);
+        KeWaitForSingleObject(&done, Executive, KernelMode, FALSE, NULL);
+    }
+    double elapsed = timer.Elapsed();
+
+    stop.store(true, std::memory_order_release);
+    while (exited.load(std::memory_order_acquire) < kWaiters) {
+        KeSetEvent(&work, IO_NO_INCREMENT, FALSE);
+        SwitchToThread();
+    }
+    for (std::thread& waiter : waiters) {
+        waiter.join();
+    }
+    BenchmarkReport("KEVENT hand-off, 16 waiters", kHandOffs, elapsed);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(Dispatcher_Uncontended) {
+    KEVENT event;
+    KSEMAPHORE semaphore;
+    LARGE_INTEGER zero;
+    LONG state = 0;
+
+    KeInitializeEvent(&event, NotificationEvent, FALSE);
+    KeInitializeSemaphore(&semaphore, 0, 1);
+    zero.QuadPart = 0;
+
+    BenchmarkTimer eventTimer;
+    for (int i = 0; i < kUncontendedPairs; i++) {
+        state += KeSetEvent(&event, IO_NO_INCREMENT, FALSE);
+        state += KeResetEvent(&event);
+    }
+    BenchmarkReport("KeSetEvent + KeResetEvent", kUncontendedPairs, eventTimer.Elapsed());
+
+    BenchmarkTimer semaphoreTimer;
+    for (int i = 0; i < kUncontendedPairs; i++) {
+        state += KeReleaseSemaphore(&semaphore, IO_NO_INCREMENT, 1, FALSE);
+        state += KeWaitForSingleObject(&semaphore, Executive, KernelMode, FALSE, &zero);
+    }
+    BenchmarkReport("KeReleaseSemaphore + KeWaitForSingleObject", kUncontendedPairs, semaphoreTimer.Elapsed());
+
+    BenchmarkKeep(state);
+}
+
+WKL_BENCHMARK(Dispatcher_SignalToWake) {
+    PingPongPolling();
+    PingPongEvents();
+    PingPongSemaphores();
+}
+
+WKL_BENCHMARK(Dispatcher_ManyWaiters) {
+    HandOffToManyWaiters();
+}
@@ -0,0 +1,150 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/Dpc.h"
+#include "../include/WorkQueue.h"
+
+namespace {
+
+const int kItems = 1 << 18;
+const int kRoundTrips = 1 << 13;
+
+std::atomic<ULONG_PTR> g_Executed(0);
+
+VOID CountDpc(PKDPC, PVOID, PVOID, PVOID) {
+    g_Executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+VOID CountWorkItem(PVOID) {
+    g_Executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+LONGLONG NowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct LatencyDpc {
+    KDPC Dpc;
+    std::atomic<LONGLONG> Total{0};
+    std::atomic<int> Done{0};
+};
+
+/* SystemArgument1 carries the insertion time */
+VOID MeasureDpc(PKDPC Dpc, PVOID, PVOID SystemArgument1, PVOID) {
+    LatencyDpc* latency = CONTAINING_RECORD(Dpc, LatencyDpc, Dpc);
+    latency->Total += NowNanoseconds() - (LONGLONG)(LONG_PTR)SystemArgument1;
+    latency->Done.store(1, std::memory_order_release);
+}
+
+void Throughput(ULONG inserters) {
+    KDPC_QUEUE dpcQueue;
+    std::vector<KDPC> dpcs(kItems);
+    std::vector<std::thread> threads;
+    char label[96];
+
+    if (KeInitializeDpcQueue(&dpcQueue, 0) != STATUS_SUCCESS) {
+        return;
+    }
+    for (auto& dpc : dpcs) {
+        KeInitializeDpc(&dpc, CountDpc, NULL);
+    }
+    g_Executed = 0;
+
+    BenchmarkTimer timer;
+    for (ULONG t = 0; t < inserters; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = (int)t; i < kItems; i += (int)inserters) {
+                KeInsertQueueDpc(&dpcQueue, &dpcs[i], NULL, NULL);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    KeFlushQueuedDpcs(&dpcQueue);
+    double seconds = timer.Elapsed();
+
+    BenchmarkKeep(g_Executed.load());
+    snprintf(label, sizeof(label), "%u inserters, KeInsertQueueDpc + run", inserters);
+    BenchmarkReport(label, (double)kItems, seconds);
+    KeRundownDpcQueue(&dpcQueue);
+}
+
+/* Inserts one DPC at a time and waits for it, optionally while another thread floods the queues */
+void Latency(bool loaded) {
+    KDPC_QUEUE dpcQueue;
+    LatencyDpc latency;
+    std::vector<KDPC> background(1024);
+    std::atomic<bool> stop(false);
+    std::thread flooder;
+
+    if (KeInitializeDpcQueue(&dpcQueue, 0) != STATUS_SUCCESS) {
+        return;
+    }
+    KeInitializeDpc(&latency.Dpc, MeasureDpc, NULL);
+    for (auto& dpc : background) {
+        KeInitializeDpc(&dpc, CountDpc, NULL);
+    }
+    if (loaded) {
+        flooder = std::thread([&]() {
+            for (size_t i = 0; !stop.load(std::memory_order_relaxed); i++) {
+                KeInsertQueueDpc(&dpcQueue, &background[i % background.size()], NULL, NULL);
+            }
+        });
+    }
+
+    for (int i = 0; i < kRoundTrips; i++) {
+        latency.Done.store(0, std::memory_order_relaxed);
+        KeInsertQueueDpc(&dpcQueue, &latency.Dpc, (PVOID)(LONG_PTR)NowNanoseconds(), NULL);
+        while (latency.Done.load(std::memory_order_acquire) == 0) {
+            SwitchToThread();
+        }
+    }
+
+    stop = true;
+    if (loaded) {
+        flooder.join();
+    }
+    // Reported per round trip: ns/op is the mean insert-to-run latency
+    BenchmarkReport(loaded ? "insert-to-run latency, flooded queues" : "insert-to-run latency, idle queues",
+                    kRoundTrips, (double)latency.Total.load() / 1e9);
+    KeRundownDpcQueue(&dpcQueue);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(Dpc_Throughput) {
+    Throughput(1);
+    Throughput(4);
+}
+
+WKL_BENCHMARK(Dpc_Latency) {
+    Latency(false);
+    Latency(true);
+}
+
+/* Baseline: the same items through a shared work queue */
+WKL_BENCHMARK(Dpc_WorkQueueBaseline) {
+    EX_WORK_QUEUE workQueue;
+    std::vector<WORK_QUEUE_ITEM> items(kItems);
+
+    if (ExInitializeWorkQueue(&workQueue, 0) != STATUS_SUCCESS) {
+        return;
+    }
+    g_Executed = 0;
+
+    BenchmarkTimer timer;
+    for (auto& item : items) {
+        ExInitializeWorkItem(&item, CountWorkItem, NULL);
+        ExQueueWorkItem(&workQueue, &item, DelayedWorkQueue);
+    }
+    ExFlushWorkQueue(&workQueue);
+    double seconds = timer.Elapsed();
+
+    BenchmarkKeep(g_Executed.load());
+    BenchmarkReport("1 inserter, ExQueueWorkItem + run", (double)kItems, seconds);
+    ExRundownWorkQueue(&workQueue);
+}
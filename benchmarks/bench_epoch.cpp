@@ -0,0 +1,153 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/Epoch.h"
+#include "../include/PushLock.h"
+
+namespace {
+
+const int kListLength = 64;
+const int kWalksPerReader = 1 << 15;
+
+struct Node {
+    LIST_ENTRY ListEntry;
+    ULONG Value;
+};
+
+enum class ReadMode { CriticalSection, PushLock, Epoch };
+
+struct SharedList {
+    LIST_ENTRY Head;
+    CRITICAL_SECTION CriticalSection;
+    EX_PUSH_LOCK PushLock;
+    EPOCH_DOMAIN Domain;
+};
+
+ULONG WalkList(PLIST_ENTRY head) {
+    ULONG sum = 0;
+    for (PLIST_ENTRY entry = ReadListFlinkRcu(head); entry != head; entry = ReadListFlinkRcu(entry)) {
+        sum += CONTAINING_RECORD(entry, Node, ListEntry)->Value;
+    }
+    return sum;
+}
+
+void RunReader(ReadMode mode, SharedList* list) {
+    ULONG sum = 0;
+    for (int i = 0; i < kWalksPerReader; i++) {
+        if (mode == ReadMode::CriticalSection) {
+            EnterCriticalSection(&list->CriticalSection);
+            sum += WalkList(&list->Head);
+            LeaveCriticalSection(&list->CriticalSection);
+        } else if (mode == ReadMode::PushLock) {
+            ExAcquirePushLockShared(&list->PushLock);
+            sum += WalkList(&list->Head);
+            ExReleasePushLockShared(&list->PushLock);
+        } else {
+            if (RtlEnterEpoch(&list->Domain) == STATUS_SUCCESS) {
+                sum += WalkList(&list->Head);
+                RtlLeaveEpoch(&list->Domain);
+            }
+        }
+    }
+    BenchmarkKeep(sum);
+    if (mode == ReadMode::Epoch) {
+        RtlUnregisterEpochThread(&list->Domain);
+    }
+}
+
+// Replaces the head node with a fresh one until the readers are done
+void RunWriter(ReadMode mode, SharedList* list, std::atomic<bool>* stop) {
+    ULONG value = 0;
+    while (!stop->load(std::memory_order_relaxed)) {
+        Node* node = (Node*)ExAllocatePoolTracked(NonPagedPool, sizeof(Node));
+        if (node == NULL) {
+            break;
+        }
+        node->Value = value++;
+
+        if (mode == ReadMode::CriticalSection) {
+            EnterCriticalSection(&list->CriticalSection);
+        } else {
+            ExAcquirePushLockExclusive(&list->PushLock);
+        }
+        PLIST_ENTRY victim = list->Head.Flink;
+        RemoveEntryListRcu(victim);
+        InsertTailListRcu(&list->Head, &node->ListEntry);
+        if (mode == ReadMode::CriticalSection) {
+            LeaveCriticalSection(&list->CriticalSection);
+        } else {
+            ExReleasePushLockExclusive(&list->PushLock);
+        }
+
+        if (mode == ReadMode::Epoch) {
+            RtlEpochDeferFree(&list->Domain, CONTAINING_RECORD(victim, Node, ListEntry));
+        } else {
+            ExFreePool(CONTAINING_RECORD(victim, Node, ListEntry));
+        }
+        SwitchToThread();
+    }
+    if (mode == ReadMode::Epoch) {
+        RtlUnregisterEpochThread(&list->Domain);
+    }
+}
+
+void RunConfiguration(ReadMode mode, int readers) {
+    SharedList list;
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> threads;
+    char label[96];
+
+    InitializeListHead(&list.Head);
+    InitializeCriticalSection(&list.CriticalSection);
+    ExInitializePushLock(&list.PushLock);
+    if (RtlInitializeEpochDomain(&list.Domain) != STATUS_SUCCESS) {
+        DeleteCriticalSection(&list.CriticalSection);
+        return;
+    }
+    for (int i = 0; i < kListLength; i++) {
+        Node* node = (Node*)ExAllocatePoolTracked(NonPagedPool, sizeof(Node));
+        if (node != NULL) {
+            node->Value = i;
+            InsertTailList(&list.Head, &node->ListEntry);
+        }
+    }
+
+    std::thread writer(RunWriter, mode, &list, &stop);
+    BenchmarkTimer timer;
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back(RunReader, mode, &list);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = timer.Elapsed();
+    stop = true;
+    writer.join();
+
+    const char* name = (mode == ReadMode::CriticalSection) ? "CRITICAL_SECTION"
+                     : (mode == ReadMode::PushLock) ? "EX_PUSH_LOCK"
+                     : "EPOCH_DOMAIN";
+    snprintf(label, sizeof(label), "%2d readers, 64-node walk %s", readers, name);
+    BenchmarkReport(label, (double)readers * kWalksPerReader, seconds);
+
+    RtlEpochFlush(&list.Domain);
+    while (!IsListEmpty(&list.Head)) {
+        ExFreePool(CONTAINING_RECORD(RemoveHeadList(&list.Head), Node, ListEntry));
+    }
+    RtlDeleteEpochDomain(&list.Domain);
+    DeleteCriticalSection(&list.CriticalSection);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(Epoch_ReadMostlyList) {
+    InitHeap();
+    SetErrorSuppression(TRUE);
+    for (int readers : { 1, 4, 16 }) {
+        RunConfiguration(ReadMode::CriticalSection, readers);
+        RunConfiguration(ReadMode::PushLock, readers);
+        RunConfiguration(ReadMode::Epoch, readers);
+    }
+    CleanupHeap();
+}
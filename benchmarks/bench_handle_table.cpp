@@ -0,0 +1,126 @@
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/HandleTable.h"
+#include "../include/LinkedList.h"
+
+namespace {
+
+const int kHandles = 4096;
+const int kLookupsPerThread = 1 << 22;
+const int kListLookups = 1 << 14;
+
+struct ListedObject {
+    LIST_ENTRY Link;
+    ULONG Id;
+};
+
+/* Looks up handles from several threads while an optional thread churns handles of its own */
+void Lookups(PHANDLE_TABLE table, const std::vector<HANDLE>& handles, int threads, bool churn, const char* label) {
+    std::atomic<bool> stop(false);
+    std::atomic<ULONG_PTR> found(0);
+    std::vector<std::thread> readers;
+    std::thread churner;
+
+    if (churn) {
+        churner = std::thread([&]() {
+            while (!stop.load(std::memory_order_relaxed)) {
+                HANDLE handle = ExCreateHandle(table, &stop);
+                ExDestroyHandle(table, handle);
+            }
+        });
+    }
+
+    BenchmarkTimer timer;
+    for (int t = 0; t < threads; t++) {
+        readers.emplace_back([&, t]() {
+            ULONG_PTR local = 0;
+            for (int i = 0; i < kLookupsPerThread; i++) {
+                local += (ULONG_PTR)ExMapHandleToPointer(table, handles[(i + t * 17) & (kHandles - 1)]);
+            }
+            found += local;
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    double seconds = timer.Elapsed();
+
+    stop = true;
+    if (churn) {
+        churner.join();
+    }
+    BenchmarkReport(label, (double)kLookupsPerThread * threads, seconds);
+    BenchmarkKeep(found.load());
+}
+
+}  // namespace
+
+WKL_BENCHMARK(HandleTable_Lookup) {
+    PHANDLE_TABLE table;
+    std::vector<HANDLE> handles(kHandles);
+
+    if (!NT_SUCCESS(ExCreateHandleTable(&table))) {
+        return;
+    }
+    for (int i = 0; i < kHandles; i++) {
+        handles[i] = ExCreateHandle(table, (PVOID)(ULONG_PTR)((i + 1) * 16));
+    }
+
+    Lookups(table, handles, 1, false, "ExMapHandleToPointer, 1 thread");
+    Lookups(table, handles, 4, false, "ExMapHandleToPointer, 4 threads");
+    Lookups(table, handles, 4, true, "ExMapHandleToPointer, 4 threads + churn");
+
+    ExDestroyHandleTable(table, NULL, NULL);
+}
+
+WKL_BENCHMARK(HandleTable_CreateDestroy) {
+    PHANDLE_TABLE table;
+    std::vector<HANDLE> handles(kHandles);
+    const int rounds = 256;
+
+    if (!NT_SUCCESS(ExCreateHandleTable(&table))) {
+        return;
+    }
+
+    BenchmarkTimer timer;
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < kHandles; i++) {
+            handles[i] = ExCreateHandle(table, &handles[i]);
+        }
+        for (int i = 0; i < kHandles; i++) {
+            ExDestroyHandle(table, handles[i]);
+        }
+    }
+    BenchmarkReport("ExCreateHandle + ExDestroyHandle", (double)kHandles * rounds, timer.Elapsed());
+
+    ExDestroyHandleTable(table, NULL, NULL);
+}
+
+/* Baseline: finding an object by id on a linked list of the same size */
+WKL_BENCHMARK(HandleTable_ListBaseline) {
+    std::vector<ListedObject> objects(kHandles);
+    LIST_ENTRY head;
+    ULONG_PTR found = 0;
+
+    InitializeListHead(&head);
+    for (int i = 0; i < kHandles; i++) {
+        objects[i].Id = i;
+        InsertTailList(&head, &objects[i].Link);
+    }
+
+    BenchmarkTimer timer;
+    for (int i = 0; i < kListLookups; i++) {
+        ULONG id = (ULONG)(i * 2654435761u) & (kHandles - 1);
+        for (PLIST_ENTRY entry = head.Flink; entry != &head; entry = entry->Flink) {
+            ListedObject* object = CONTAINING_RECORD(entry, ListedObject, Link);
+            if (object->Id == id) {
+                found += (ULONG_PTR)object;
+                break;
+            }
+        }
+    }
+    BenchmarkReport("LIST_ENTRY search by id", kListLookups, timer.Elapsed());
+    BenchmarkKeep(found);
+}
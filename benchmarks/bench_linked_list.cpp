@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/LinkedList.h"
+
+namespace {
+
+struct SortNode {
+    LIST_ENTRY ListEntry;
+    ULONG Key;
+};
+
+LONG CompareNodes(PLIST_ENTRY First, PLIST_ENTRY Second, PVOID Context) {
+    UNREFERENCED_PARAMETER(Context);
+    ULONG a = CONTAINING_RECORD(First, SortNode, ListEntry)->Key;
+    ULONG b = CONTAINING_RECORD(Second, SortNode, ListEntry)->Key;
+    return (a > b) - (a < b);
+}
+
+int CompareNodePointers(const void* First, const void* Second) {
+    ULONG a = CONTAINING_RECORD(*(PLIST_ENTRY const*)First, SortNode, ListEntry)->Key;
+    ULONG b = CONTAINING_RECORD(*(PLIST_ENTRY const*)Second, SortNode, ListEntry)->Key;
+    return (a > b) - (a < b);
+}
+
+// Builds a list whose link order is shuffled relative to memory order, as after real churn
+void BuildList(PLIST_ENTRY head, std::vector<SortNode>& nodes, std::mt19937& rng) {
+    std::vector<size_t> order(nodes.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+        nodes[i].Key = (ULONG)rng();
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+
+    InitializeListHead(head);
+    for (size_t index : order) {
+        InsertTailList(head, &nodes[index].ListEntry);
+    }
+}
+
+// The previous approach: copy entries to an array, qsort it, relink
+void SortViaArray(PLIST_ENTRY head, size_t count) {
+    PLIST_ENTRY* entries = (PLIST_ENTRY*)malloc(count * sizeof(PLIST_ENTRY));
+    size_t i = 0;
+    for (PLIST_ENTRY entry = head->Flink; entry != head; entry = entry->Flink) {
+        entries[i++] = entry;
+    }
+    qsort(entries, count, sizeof(PLIST_ENTRY), CompareNodePointers);
+    InitializeListHead(head);
+    for (i = 0; i < count; i++) {
+        InsertTailList(head, entries[i]);
+    }
+    free(entries);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(LinkedList_Sort_1M) {
+    const size_t count = 1000000;
+    std::vector<SortNode> nodes(count);
+    LIST_ENTRY head;
+    std::mt19937 rng(1);
+
+    BuildList(&head, nodes, rng);
+    BenchmarkTimer mergeTimer;
+    MergeSortList(&head, CompareNodes, nullptr);
+    BenchmarkReport("MergeSortList (random)", (double)count, mergeTimer.Elapsed());
+
+    BenchmarkTimer sortedTimer;
+    MergeSortList(&head, CompareNodes, nullptr);
+    BenchmarkReport("MergeSortList (already sorted)", (double)count, sortedTimer.Elapsed());
+
+    BuildList(&head, nodes, rng);
+    BenchmarkTimer arrayTimer;
+    SortViaArray(&head, count);
+    BenchmarkReport("copy to array + qsort + relink (random)", (double)count, arrayTimer.Elapsed());
+}
+
+WKL_BENCHMARK(LinkedList_MergeSorted_1M) {
+    const size_t count = 500000;
+    std::vector<SortNode> first(count), second(count);
+    LIST_ENTRY firstHead, secondHead;
+    std::mt19937 rng(2);
+
+    BuildList(&firstHead, first, rng);
+    BuildList(&secondHead, second, rng);
+    MergeSortList(&firstHead, CompareNodes, nullptr);
+    MergeSortList(&secondHead, CompareNodes, nullptr);
+
+    BenchmarkTimer timer;
+    MergeSortedLists(&firstHead, &secondHead, CompareNodes, nullptr);
+    BenchmarkReport("MergeSortedLists 2 x 500K", (double)(2 * count), timer.Elapsed());
+}
@@ -0,0 +1,15 @@
+#include <cstring>
+#include "Benchmark.h"
+
+int main(int argc, char** argv) {
+    const char* filter = (argc > 1) ? argv[1] : nullptr;
+
+    for (const BenchmarkCase& benchmark : BenchmarkRegistry()) {
+        if (filter != nullptr && strstr(benchmark.Name, filter) == nullptr) {
+            continue;
+        }
+        printf("%s\n", benchmark.Name);
+        benchmark.Run();
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/PushLock.h"
+
+namespace {
+
+const int kOperationsPerThread = 1 << 18;
+const int kRegistrySize = 16;
+
+// Stand-in for a read-mostly registry: readers sum it, writers bump every entry
+struct Registry {
+    volatile LONG Entries[kRegistrySize];
+};
+
+enum class LockKind { CriticalSection, PushLock, CacheAwarePushLock };
+
+struct SharedState {
+    Registry Data;
+    CRITICAL_SECTION CriticalSection;
+    EX_PUSH_LOCK PushLock;
+    EX_PUSH_LOCK_CACHE_AWARE CacheAware;
+};
+
+LONG ReadRegistry(const Registry& registry) {
+    LONG sum = 0;
+    for (int i = 0; i < kRegistrySize; i++) {
+        sum += registry.Entries[i];
+    }
+    return sum;
+}
+
+void WriteRegistry(Registry& registry) {
+    for (int i = 0; i < kRegistrySize; i++) {
+        registry.Entries[i] = registry.Entries[i] + 1;
+    }
+}
+
+void RunThread(LockKind kind, SharedState* state, int writePercent, int seed) {
+    ULONG random = 0x9E3779B9u * (ULONG)(seed + 1);
+    LONG sum = 0;
+
+    for (int i = 0; i < kOperationsPerThread; i++) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        bool write = (int)(random % 100) < writePercent;
+
+        if (kind == LockKind::CriticalSection) {
+            EnterCriticalSection(&state->CriticalSection);
+            if (write) {
+                WriteRegistry(state->Data);
+            } else {
+                sum += ReadRegistry(state->Data);
+            }
+            LeaveCriticalSection(&state->CriticalSection);
+        } else if (kind == LockKind::PushLock) {
+            if (write) {
+                ExAcquirePushLockExclusive(&state->PushLock);
+                WriteRegistry(state->Data);
+                ExReleasePushLockExclusive(&state->PushLock);
+            } else {
+                ExAcquirePushLockShared(&state->PushLock);
+                sum += ReadRegistry(state->Data);
+                ExReleasePushLockShared(&state->PushLock);
+            }
+        } else {
+            if (write) {
+                ExAcquireCacheAwarePushLockExclusive(&state->CacheAware);
+                WriteRegistry(state->Data);
+                ExReleaseCacheAwarePushLockExclusive(&state->CacheAware);
+            } else {
+                PEX_PUSH_LOCK slot = ExAcquireCacheAwarePushLockShared(&state->CacheAware);
+                sum += ReadRegistry(state->Data);
+                ExReleaseCacheAwarePushLockShared(slot);
+            }
+        }
+    }
+    BenchmarkKeep(sum);
+}
+
+void RunConfiguration(LockKind kind, int threads, int writePercent) {
+    SharedState state = {};
+    std::vector<std::thread> workers;
+    char label[96];
+
+    InitializeCriticalSection(&state.CriticalSection);
+    ExInitializePushLock(&state.PushLock);
+    if (ExInitializeCacheAwarePushLock(&state.CacheAware, 0) != STATUS_SUCCESS) {
+        DeleteCriticalSection(&state.CriticalSection);
+        return;
+    }
+
+    BenchmarkTimer timer;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back(RunThread, kind, &state, writePercent, t);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = timer.Elapsed();
+
+    const char* name = (kind == LockKind::CriticalSection) ? "CRITICAL_SECTION"
+                     : (kind == LockKind::PushLock) ? "EX_PUSH_LOCK"
+                     : "EX_PUSH_LOCK_CACHE_AWARE";
+    snprintf(label, sizeof(label), "%2d threads %d/%d %s", threads, 100 - writePercent, writePercent, name);
+    BenchmarkReport(label, (double)threads * kOperationsPerThread, seconds);
+
+    ExDeleteCacheAwarePushLock(&state.CacheAware);
+    DeleteCriticalSection(&state.CriticalSection);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(PushLock_ReadMostly) {
+    InitHeap();
+    for (int writePercent : { 1, 10 }) {
+        for (int threads : { 1, 4, 16 }) {
+            RunConfiguration(LockKind::CriticalSection, threads, writePercent);
+            RunConfiguration(LockKind::PushLock, threads, writePercent);
+            RunConfiguration(LockKind::CacheAwarePushLock, threads, writePercent);
+        }
+    }
+    CleanupHeap();
+}
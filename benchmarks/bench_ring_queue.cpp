@@ -0,0 +1,151 @@
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/LinkedList.h"
+#include "../include/RingQueue.h"
+
+namespace {
+
+const ULONG_PTR kTotalItems = 1 << 20;
+const ULONG kBatchSize = 32;
+
+// The existing pattern: a LIST_ENTRY queue under a lock with one node per item
+struct LockedQueue {
+    CRITICAL_SECTION Lock;
+    LIST_ENTRY Head;
+};
+
+struct LockedNode {
+    LIST_ENTRY ListEntry;
+    PVOID Item;
+};
+
+enum class Mode { RingSingle, RingBatch, LockedList };
+
+void RunProducer(Mode mode, PRING_QUEUE ring, LockedQueue* locked, ULONG_PTR first, ULONG_PTR count) {
+    if (mode == Mode::RingSingle) {
+        for (ULONG_PTR i = 0; i < count; i++) {
+            RtlPushRingQueue(ring, (PVOID)(first + i), INFINITE);
+        }
+    } else if (mode == Mode::RingBatch) {
+        PVOID batch[kBatchSize];
+        ULONG_PTR i = 0;
+        while (i < count) {
+            ULONG n = (ULONG)((count - i < kBatchSize) ? count - i : kBatchSize);
+            for (ULONG j = 0; j < n; j++) {
+                batch[j] = (PVOID)(first + i + j);
+            }
+            ULONG pushed = RtlTryPushRingQueueBatch(ring, batch, n);
+            if (pushed == 0) {
+                RtlPushRingQueue(ring, batch[0], INFINITE);
+                pushed = 1;
+            }
+            i += pushed;
+        }
+    } else {
+        for (ULONG_PTR i = 0; i < count; i++) {
+            LockedNode* node = (LockedNode*)malloc(sizeof(LockedNode));
+            node->Item = (PVOID)(first + i);
+            EnterCriticalSection(&locked->Lock);
+            InsertTailList(&locked->Head, &node->ListEntry);
+            LeaveCriticalSection(&locked->Lock);
+        }
+    }
+}
+
+void RunConsumer(Mode mode, PRING_QUEUE ring, LockedQueue* locked, std::atomic<ULONG_PTR>* remaining, ULONG_PTR* sum) {
+    PVOID batch[kBatchSize];
+    ULONG_PTR localSum = 0;
+
+    while ((LONG_PTR)remaining->load(std::memory_order_relaxed) > 0) {
+        ULONG n = 0;
+        if (mode == Mode::RingSingle) {
+            n = (RtlPopRingQueue(ring, &batch[0], 1) == STATUS_SUCCESS) ? 1 : 0;
+        } else if (mode == Mode::RingBatch) {
+            n = RtlTryPopRingQueueBatch(ring, batch, kBatchSize);
+            if (n == 0) {
+                n = (RtlPopRingQueue(ring, &batch[0], 1) == STATUS_SUCCESS) ? 1 : 0;
+            }
+        } else {
+            LockedNode* node = NULL;
+            EnterCriticalSection(&locked->Lock);
+            if (!IsListEmpty(&locked->Head)) {
+                node = CONTAINING_RECORD(RemoveHeadList(&locked->Head), LockedNode, ListEntry);
+            }
+            LeaveCriticalSection(&locked->Lock);
+            if (node == NULL) {
+                SwitchToThread();
+                continue;
+            }
+            batch[0] = node->Item;
+            free(node);
+            n = 1;
+        }
+        for (ULONG i = 0; i < n; i++) {
+            localSum += (ULONG_PTR)batch[i];
+        }
+        remaining->fetch_sub(n, std::memory_order_relaxed);
+    }
+    *sum += localSum;
+}
+
+void RunConfiguration(Mode mode, int producers, int consumers) {
+    RING_QUEUE ring;
+    LockedQueue locked;
+    std::atomic<ULONG_PTR> remaining(kTotalItems);
+    std::vector<ULONG_PTR> sums(consumers, 0);
+    std::vector<std::thread> threads;
+    char label[96];
+
+    if (RtlInitializeRingQueue(&ring, 1024) != STATUS_SUCCESS) {
+        return;
+    }
+    InitializeCriticalSection(&locked.Lock);
+    InitializeListHead(&locked.Head);
+
+    BenchmarkTimer timer;
+    for (int p = 0; p < producers; p++) {
+        ULONG_PTR share = kTotalItems / producers;
+        ULONG_PTR first = p * share + 1;
+        if (p == producers - 1) {
+            share = kTotalItems - p * share;
+        }
+        threads.emplace_back(RunProducer, mode, &ring, &locked, first, share);
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back(RunConsumer, mode, &ring, &locked, &remaining, &sums[c]);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = timer.Elapsed();
+
+    ULONG_PTR total = 0;
+    for (ULONG_PTR sum : sums) {
+        total += sum;
+    }
+    BenchmarkKeep(total);
+
+    const char* name = (mode == Mode::RingSingle) ? "RING_QUEUE push/pop"
+                     : (mode == Mode::RingBatch) ? "RING_QUEUE batch of 32"
+                     : "LIST_ENTRY + CRITICAL_SECTION";
+    snprintf(label, sizeof(label), "%dP%dC %s", producers, consumers, name);
+    BenchmarkReport(label, (double)kTotalItems, seconds);
+
+    DeleteCriticalSection(&locked.Lock);
+    RtlDeleteRingQueue(&ring);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(RingQueue_Throughput) {
+    InitHeap();
+    for (int threads : { 1, 4, 16 }) {
+        RunConfiguration(Mode::RingSingle, threads, threads);
+        RunConfiguration(Mode::RingBatch, threads, threads);
+        RunConfiguration(Mode::LockedList, threads, threads);
+    }
+    CleanupHeap();
+}
@@ -0,0 +1,75 @@
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/Rundown.h"
+
+namespace {
+
+const int kPairsPerThread = 1 << 20;
+
+void RunPlain(PEX_RUNDOWN_REF runRef) {
+    ULONG acquired = 0;
+    for (int i = 0; i < kPairsPerThread; i++) {
+        if (ExAcquireRundownProtection(runRef)) {
+            acquired++;
+            ExReleaseRundownProtection(runRef);
+        }
+    }
+    BenchmarkKeep(acquired);
+}
+
+void RunCacheAware(PEX_RUNDOWN_REF_CACHE_AWARE runRef) {
+    ULONG acquired = 0;
+    for (int i = 0; i < kPairsPerThread; i++) {
+        PEX_RUNDOWN_REF slot = ExAcquireRundownProtectionCacheAware(runRef);
+        if (slot != NULL) {
+            acquired++;
+            ExReleaseRundownProtectionCacheAware(slot);
+        }
+    }
+    BenchmarkKeep(acquired);
+}
+
+void RunConfiguration(bool cacheAware, int threads) {
+    EX_RUNDOWN_REF plain;
+    EX_RUNDOWN_REF_CACHE_AWARE perCpu;
+    std::vector<std::thread> workers;
+    char label[96];
+
+    ExInitializeRundownProtection(&plain);
+    if (ExInitializeRundownProtectionCacheAware(&perCpu, 0) != STATUS_SUCCESS) {
+        return;
+    }
+
+    BenchmarkTimer timer;
+    for (int t = 0; t < threads; t++) {
+        if (cacheAware) {
+            workers.emplace_back(RunCacheAware, &perCpu);
+        } else {
+            workers.emplace_back(RunPlain, &plain);
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = timer.Elapsed();
+
+    snprintf(label, sizeof(label), "%2d threads %s",
+             threads, cacheAware ? "EX_RUNDOWN_REF_CACHE_AWARE" : "EX_RUNDOWN_REF");
+    BenchmarkReport(label, (double)threads * kPairsPerThread, seconds);
+
+    ExWaitForRundownProtectionRelease(&plain);
+    ExWaitForRundownProtectionReleaseCacheAware(&perCpu);
+    ExFreeRundownProtectionCacheAware(&perCpu);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(Rundown_AcquireRelease) {
+    InitHeap();
+    for (int threads : { 1, 4, 16 }) {
+        RunConfiguration(false, threads);
+        RunConfiguration(true, threads);
+    }
+    CleanupHeap();
+}
@@ -0,0 +1,49 @@
+#include <thread>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/ShardedCounter.h"
+
+namespace {
+
+const int kIncrementsPerThread = 1 << 20;
+
+void RunConfiguration(bool sharded, int threads) {
+    static SHARDED_COUNTER shardedCounter;
+    static volatile LONG64 singleCounter;
+    std::vector<std::thread> workers;
+    char label[96];
+
+    RtlInitializeShardedCounter(&shardedCounter);
+    singleCounter = 0;
+
+    BenchmarkTimer timer;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([sharded]() {
+            for (int i = 0; i < kIncrementsPerThread; i++) {
+                if (sharded) {
+                    RtlIncrementShardedCounter(&shardedCounter);
+                } else {
+                    InterlockedIncrement64(&singleCounter);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = timer.Elapsed();
+
+    BenchmarkKeep(sharded ? RtlReadShardedCounter(&shardedCounter) : singleCounter);
+    snprintf(label, sizeof(label), "%2d threads %s", threads,
+             sharded ? "SHARDED_COUNTER" : "InterlockedIncrement64");
+    BenchmarkReport(label, (double)threads * kIncrementsPerThread, seconds);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(ShardedCounter_Increment) {
+    for (int threads : { 1, 2, 4, 8, 16, 32 }) {
+        RunConfiguration(false, threads);
+        RunConfiguration(true, threads);
+    }
+}
@@ -0,0 +1,108 @@
+#include <vector>
+#include "Benchmark.h"
+#include "../include/Timer.h"
+
+namespace {
+
+const int kWheelTimers = 1 << 20;
+const int kListTimers = 1 << 14;
+
+/* Due times spread over ten minutes so that nothing expires while measuring */
+LARGE_INTEGER SpreadDueTime(int i) {
+    LARGE_INTEGER DueTime;
+    DueTime.QuadPart = -(LONGLONG)(1000 + ((ULONG)i * 2654435761u) % 600000) * 10000;
+    return DueTime;
+}
+
+struct ListTimer {
+    LIST_ENTRY Link;
+    ULONGLONG DueTime;
+};
+
+VOID CountDpc(PKDPC, PVOID DeferredContext, PVOID, PVOID) {
+    (*(ULONG_PTR*)DeferredContext)++;
+}
+
+}  // namespace
+
+WKL_BENCHMARK(Timer_ArmCancel) {
+    KTIMER_TABLE table;
+    std::vector<KTIMER> timers(kWheelTimers);
+
+    if (!NT_SUCCESS(KeInitializeTimerTable(&table))) {
+        return;
+    }
+    for (int i = 0; i < kWheelTimers; i++) {
+        KeInitializeTimer(&timers[i], &table);
+    }
+
+    BenchmarkTimer armTimer;
+    for (int i = 0; i < kWheelTimers; i++) {
+        KeSetTimer(&timers[i], SpreadDueTime(i), NULL);
+    }
+    BenchmarkReport("KeSetTimer, 1M armed", kWheelTimers, armTimer.Elapsed());
+
+    BenchmarkTimer rearmTimer;
+    for (int i = 0; i < kWheelTimers; i++) {
+        KeSetTimer(&timers[i], SpreadDueTime(i + 1), NULL);
+    }
+    BenchmarkReport("KeSetTimer re-arm, 1M armed", kWheelTimers, rearmTimer.Elapsed());
+
+    BenchmarkTimer cancelTimer;
+    for (int i = 0; i < kWheelTimers; i++) {
+        KeCancelTimer(&timers[i]);
+    }
+    BenchmarkReport("KeCancelTimer, 1M armed", kWheelTimers, cancelTimer.Elapsed());
+
+    KeDeleteTimerTable(&table);
+}
+
+WKL_BENCHMARK(Timer_Expire) {
+    KTIMER_TABLE table;
+    std::vector<KTIMER> timers(kWheelTimers);
+    ULONG_PTR fired = 0;
+    ULONGLONG lastDue = 0;
+    KDPC dpc;
+
+    if (!NT_SUCCESS(KeInitializeTimerTable(&table))) {
+        return;
+    }
+    KeInitializeDpc(&dpc, CountDpc, &fired);
+    for (int i = 0; i < kWheelTimers; i++) {
+        KeInitializeTimer(&timers[i], &table);
+        KeSetTimer(&timers[i], SpreadDueTime(i), &dpc);
+        if (timers[i].DueTime > lastDue) {
+            lastDue = timers[i].DueTime;
+        }
+    }
+
+    // Drive the wheel through all ten minutes at once instead of waiting
+    BenchmarkTimer timer;
+    KiExpireTimers(&table, lastDue);
+    BenchmarkReport("expire + DPC, 1M timers over 10 min", kWheelTimers, timer.Elapsed());
+    BenchmarkKeep(fired);
+
+    KeDeleteTimerTable(&table);
+}
+
+/* Baseline: the deadline-sorted LIST_ENTRY the wheel replaces */
+WKL_BENCHMARK(Timer_SortedListBaseline) {
+    std::vector<ListTimer> timers(kListTimers);
+    LIST_ENTRY head;
+    ULONGLONG now = GetTickCount64();
+
+    InitializeListHead(&head);
+
+    BenchmarkTimer timer;
+    for (int i = 0; i < kListTimers; i++) {
+        PLIST_ENTRY entry = head.Blink;
+
+        timers[i].DueTime = now - SpreadDueTime(i).QuadPart / 10000;
+        while (entry != &head && CONTAINING_RECORD(entry, ListTimer, Link)->DueTime > timers[i].DueTime) {
+            entry = entry->Blink;
+        }
+        InsertHeadList(entry, &timers[i].Link);
+    }
+    BenchmarkReport("sorted LIST_ENTRY insert, 16K armed", kListTimers, timer.Elapsed());
+    BenchmarkKeep(head.Flink);
+}
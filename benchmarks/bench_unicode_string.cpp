@@ -0,0 +1,550 @@
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/UnicodeString.h"
+
+namespace {
+
+const int kBytesPerLength = 64 << 20;
+
+UNICODE_STRING MakeString(std::vector<WCHAR>& text) {
+    UNICODE_STRING string;
+    string.Buffer = text.data();
+    string.Length = (USHORT)(text.size() * sizeof(WCHAR));
+    string.MaximumLength = string.Length;
+    return string;
+}
+
+// The char-by-char loop the vectorized comparison replaces
+LONG ScalarCompare(PCUNICODE_STRING string1, PCUNICODE_STRING string2, BOOLEAN caseInSensitive) {
+    USHORT length = string1->Length < string2->Length ? string1->Length : string2->Length;
+    for (USHORT i = 0; i < length / sizeof(WCHAR); i++) {
+        WCHAR char1 = string1->Buffer[i];
+        WCHAR char2 = string2->Buffer[i];
+        if (caseInSensitive) {
+            char1 = RtlUpcaseUnicodeChar(char1);
+            char2 = RtlUpcaseUnicodeChar(char2);
+        }
+        if (char1 != char2) {
+            return (LONG)char1 - (LONG)char2;
+        }
+    }
+    return (LONG)string1->Length - (LONG)string2->Length;
+}
+
+// Compares two equal strings (the worst case: every code unit is examined)
+void CompareAtLength(size_t length, bool ascii, BOOLEAN caseInSensitive) {
+    std::vector<WCHAR> text1(length);
+    std::vector<WCHAR> text2(length);
+    const int iterations = (int)(kBytesPerLength / (length * sizeof(WCHAR)));
+    LONG sum = 0;
+    char label[96];
+
+    for (size_t i = 0; i < length; i++) {
+        text1[i] = ascii ? (WCHAR)(L'a' + i % 26) : (WCHAR)(0x0430 + i % 32);
+        text2[i] = caseInSensitive ? RtlUpcaseUnicodeChar(text1[i]) : text1[i];
+    }
+    UNICODE_STRING string1 = MakeString(text1);
+    UNICODE_STRING string2 = MakeString(text2);
+
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; i++) {
+        sum += RtlCompareUnicodeString(&string1, &string2, caseInSensitive);
+        BenchmarkKeep(string1.Buffer);
+    }
+    double fast = timer.Elapsed();
+
+    BenchmarkTimer scalarTimer;
+    for (int i = 0; i < iterations; i++) {
+        sum += ScalarCompare(&string1, &string2, caseInSensitive);
+        BenchmarkKeep(string1.Buffer);
+    }
+    double scalar = scalarTimer.Elapsed();
+    BenchmarkKeep(sum);
+
+    snprintf(label, sizeof(label), "%s %s, %zu chars",
+             ascii ? "ASCII" : "Cyrillic", caseInSensitive ? "case-insensitive" : "case-sensitive", length);
+    BenchmarkReport(label, iterations, fast);
+    snprintf(label, sizeof(label), "%s %s, %zu chars (scalar)",
+             ascii ? "ASCII" : "Cyrillic", caseInSensitive ? "case-insensitive" : "case-sensitive", length);
+    BenchmarkReport(label, iterations, scalar);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(UnicodeString_Compare) {
+    for (BOOLEAN caseInSensitive : { FALSE, TRUE }) {
+        for (size_t length : { 8, 32, 128, 1024 }) {
+            CompareAtLength(length, true, caseInSensitive);
+        }
+    }
+}
+
+// Upper-cased non-ASCII text takes the case-table fallback in every lane
+WKL_BENCHMARK(UnicodeString_Compare_NonAscii) {
+    for (size_t length : { 32, 1024 }) {
+        CompareAtLength(length, false, FALSE);
+        CompareAtLength(length, false, TRUE);
+    }
+}
+
+namespace {
+
+// Upper-cases a 4 KB device string repeatedly; nonAsciiEvery = 0 means pure ASCII
+void UpcaseThroughput(size_t nonAsciiEvery, const char* name) {
+    const size_t length = 2048;
+    const int iterations = kBytesPerLength / (int)(length * sizeof(WCHAR));
+    std::vector<WCHAR> text(length);
+    std::vector<WCHAR> upper(length);
+    char label[96];
+
+    for (size_t i = 0; i < length; i++) {
+        bool wide = nonAsciiEvery != 0 && i % nonAsciiEvery == 0;
+        text[i] = wide ? (WCHAR)(0x0430 + i % 32) : (WCHAR)(L' ' + i % 95);
+    }
+    UNICODE_STRING source = MakeString(text);
+    UNICODE_STRING dest = MakeString(upper);
+
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; i++) {
+        RtlUpcaseUnicodeString(&dest, &source, FALSE);
+        BenchmarkKeep(upper[i % length]);
+    }
+    double fast = timer.Elapsed();
+
+    BenchmarkTimer scalarTimer;
+    for (int i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < length; j++) {
+            upper[j] = RtlUpcaseUnicodeChar(text[j]);
+        }
+        BenchmarkKeep(upper[i % length]);
+    }
+    double scalar = scalarTimer.Elapsed();
+
+    snprintf(label, sizeof(label), "RtlUpcaseUnicodeString, %s", name);
+    BenchmarkReportBytes(label, (double)iterations * length * sizeof(WCHAR), fast);
+    snprintf(label, sizeof(label), "RtlUpcaseUnicodeChar loop, %s", name);
+    BenchmarkReportBytes(label, (double)iterations * length * sizeof(WCHAR), scalar);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(UnicodeString_Upcase) {
+    UpcaseThroughput(0, "ASCII");
+    UpcaseThroughput(64, "1/64 Cyrillic");
+    UpcaseThroughput(4, "1/4 Cyrillic");
+    UpcaseThroughput(1, "all Cyrillic");
+}
+
+namespace {
+
+// The ad hoc pattern being replaced: upcase into a pool buffer, then hash
+ULONG UpcaseThenHash(PCUNICODE_STRING string) {
+    UNICODE_STRING upper;
+    ULONG hash = 0;
+    if (NT_SUCCESS(RtlUpcaseUnicodeString(&upper, string, TRUE))) {
+        for (USHORT i = 0; i < upper.Length / sizeof(WCHAR); i++) {
+            hash = hash * 65599 + upper.Buffer[i];
+        }
+        FreeUnicodeString(&upper);
+    }
+    return hash;
+}
+
+void HashAtLength(size_t length) {
+    const int iterations = (int)(kBytesPerLength / 4 / (length * sizeof(WCHAR)));
+    std::vector<WCHAR> text(length);
+    ULONG sum = 0;
+    char label[96];
+
+    for (size_t i = 0; i < length; i++) {
+        text[i] = (WCHAR)(L'A' + i % 26 + (i % 3 == 0 ? 32 : 0));
+    }
+    UNICODE_STRING string = MakeString(text);
+
+    struct { const char* Name; ULONG Algorithm; BOOLEAN CaseInSensitive; } const modes[] = {
+        { "X65599", HASH_STRING_ALGORITHM_X65599, FALSE },
+        { "X65599 case-insensitive", HASH_STRING_ALGORITHM_X65599, TRUE },
+        { "FAST", HASH_STRING_ALGORITHM_FAST, FALSE },
+        { "FAST case-insensitive", HASH_STRING_ALGORITHM_FAST, TRUE },
+    };
+    for (const auto& mode : modes) {
+        BenchmarkTimer timer;
+        for (int i = 0; i < iterations; i++) {
+            ULONG hash;
+            RtlHashUnicodeString(&string, mode.CaseInSensitive, mode.Algorithm, &hash);
+            sum += hash;
+            BenchmarkKeep(string.Buffer);
+        }
+        snprintf(label, sizeof(label), "%s, %zu chars", mode.Name, length);
+        BenchmarkReport(label, iterations, timer.Elapsed());
+    }
+
+    BenchmarkTimer baselineTimer;
+    for (int i = 0; i < iterations / 4; i++) {
+        sum += UpcaseThenHash(&string);
+    }
+    snprintf(label, sizeof(label), "upcase copy + scalar X65599, %zu chars", length);
+    BenchmarkReport(label, iterations / 4, baselineTimer.Elapsed());
+    BenchmarkKeep(sum);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(UnicodeString_Hash) {
+    for (size_t length : { 16, 64, 256, 4096 }) {
+        HashAtLength(length);
+    }
+}
+
+WKL_BENCHMARK(UnicodeString_BuildPath) {
+    const int iterations = 1 << 20;
+    UNICODE_STRING prefix = RTL_CONSTANT_STRING(L"\\Device\\HarddiskVolume");
+    UNICODE_STRING suffix = RTL_CONSTANT_STRING(L"\\Windows\\System32\\drivers");
+    ULONG_PTR sum = 0;
+    // Read through volatile pointers so the compiler cannot fold the copies away
+    PCUNICODE_STRING volatile prefixPointer = &prefix;
+    PCUNICODE_STRING volatile suffixPointer = &suffix;
+
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; i++) {
+        DECLARE_UNICODE_STRING_SIZE(path, 64);
+        RtlCopyUnicodeString(&path, prefixPointer);
+        RtlAppendUnicodeToString(&path, L"3");
+        RtlAppendUnicodeStringToString(&path, suffixPointer);
+        sum += path.Length + path_buffer[i % 8];
+    }
+    BenchmarkReport("stack buffer, copy + 2 appends", iterations, timer.Elapsed());
+
+    // Baseline: a pool allocation per step, as with RtlDuplicateUnicodeString
+    BenchmarkTimer duplicateTimer;
+    for (int i = 0; i < iterations / 4; i++) {
+        UNICODE_STRING copy;
+        UNICODE_STRING joined;
+        WCHAR digit[] = L"3";
+        if (!NT_SUCCESS(RtlDuplicateUnicodeString(0, &prefix, &copy))) {
+            break;
+        }
+        joined.MaximumLength = (USHORT)(copy.Length + sizeof(WCHAR) + suffix.Length);
+        joined.Length = 0;
+        joined.Buffer = (PWSTR)ExAllocatePoolTracked(PagedPool, joined.MaximumLength);
+        if (joined.Buffer != NULL) {
+            RtlCopyMemory(joined.Buffer, copy.Buffer, copy.Length);
+            RtlCopyMemory(joined.Buffer + copy.Length / sizeof(WCHAR), digit, sizeof(WCHAR));
+            RtlCopyMemory(joined.Buffer + copy.Length / sizeof(WCHAR) + 1, suffix.Buffer, suffix.Length);
+            joined.Length = joined.MaximumLength;
+            sum += joined.Length;
+            FreeUnicodeString(&joined);
+        }
+        FreeUnicodeString(&copy);
+    }
+    BenchmarkReport("RtlDuplicateUnicodeString + pool concatenation", iterations / 4, duplicateTimer.Elapsed());
+    BenchmarkKeep(sum);
+}
+
+namespace {
+
+const char* const kSampleWords[] = {
+    "config", "\xD0\xB4\xD0\xB0\xD0\xBD\xD0\xBD\xD1\x8B\xD0\xB5",          // Cyrillic
+    "\xE8\xA8\xAD\xE5\xAE\x9A\xE6\x96\x87\xE4\xBB\xB6",                      // CJK
+};
+
+// Builds about 4 KB of space-separated words, kind selecting kSampleWords
+std::string SampleText(int kind) {
+    std::string text;
+    while (text.size() < 4096) {
+        text += kind == 0 ? "/var/lib/device/" : kSampleWords[kind];
+        text += ' ';
+    }
+    return text;
+}
+
+// The one-sequence-at-a-time decoder the vector paths are measured against
+SIZE_T ScalarUtf8ToUtf16(const std::string& utf8, PWSTR destination) {
+    SIZE_T written = 0;
+    for (SIZE_T index = 0; index < utf8.size();) {
+        ULONG codePoint;
+        index += RtlpDecodeUTF8((const UCHAR*)utf8.data() + index, utf8.size() - index, &codePoint);
+        if (codePoint == RTLP_INVALID_CODE_POINT) {
+            codePoint = 0xFFFD;
+        }
+        if (codePoint >= 0x10000) {
+            destination[written++] = (WCHAR)(0xD800 + ((codePoint - 0x10000) >> 10));
+            codePoint = 0xDC00 + (codePoint & 0x3FF);
+        }
+        destination[written++] = (WCHAR)codePoint;
+    }
+    return written;
+}
+
+void Utf8Throughput(int kind, const char* name) {
+    std::string utf8 = SampleText(kind);
+    std::vector<WCHAR> units(utf8.size());
+    std::string back(utf8.size(), '\0');
+    const int iterations = (int)(kBytesPerLength / utf8.size());
+    ULONG unitBytes = 0;
+    ULONG written = 0;
+    char label[96];
+
+    BenchmarkTimer timer;
+    for (int i = 0; i < iterations; i++) {
+        RtlUTF8ToUnicodeN(units.data(), (ULONG)(units.size() * sizeof(WCHAR)), &unitBytes,
+                          utf8.data(), (ULONG)utf8.size());
+        BenchmarkKeep(units[i % units.size()]);
+    }
+    snprintf(label, sizeof(label), "RtlUTF8ToUnicodeN, %s", name);
+    BenchmarkReportBytes(label, (double)iterations * utf8.size(), timer.Elapsed());
+
+    BenchmarkTimer scalarTimer;
+    for (int i = 0; i < iterations; i++) {
+        BenchmarkKeep(ScalarUtf8ToUtf16(utf8, units.data()));
+    }
+    snprintf(label, sizeof(label), "scalar UTF-8 decode, %s", name);
+    BenchmarkReportBytes(label, (double)iterations * utf8.size(), scalarTimer.Elapsed());
+
+    BenchmarkTimer encodeTimer;
+    for (int i = 0; i < iterations; i++) {
+        RtlUnicodeToUTF8N(&back[0], (ULONG)back.size(), &written, units.data(), unitBytes);
+        BenchmarkKeep(back[i % back.size()]);
+    }
+    snprintf(label, sizeof(label), "RtlUnicodeToUTF8N, %s", name);
+    BenchmarkReportBytes(label, (double)iterations * utf8.size(), encodeTimer.Elapsed());
+}
+
+}  // namespace
+
+// Throughput is in bytes of UTF-8 in both directions
+WKL_BENCHMARK(UnicodeString_Utf8) {
+    Utf8Throughput(0, "ASCII paths");
+    Utf8Throughput(1, "Cyrillic words");
+    Utf8Throughput(2, "CJK words");
+}
+
+namespace {
+
+const int kShortStrings = 1 << 20;
+
+// The pattern being replaced: a pool buffer widened one byte at a time
+NTSTATUS WidenByteByByte(PUNICODE_STRING destination, PCANSI_STRING source) {
+    destination->Buffer = (PWSTR)ExAllocatePoolTracked(PagedPool, (source->Length + 1) * sizeof(WCHAR));
+    if (destination->Buffer == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+    for (USHORT i = 0; i < source->Length; i++) {
+        destination->Buffer[i] = (WCHAR)(UCHAR)source->Buffer[i];
+    }
+    destination->Buffer[source->Length] = UNICODE_NULL;
+    destination->Length = (USHORT)(source->Length * sizeof(WCHAR));
+    destination->MaximumLength = (USHORT)(destination->Length + sizeof(WCHAR));
+    return STATUS_SUCCESS;
+}
+
+}  // namespace
+
+// A million Latin-1 names of 8 to 47 bytes, converted one by one
+WKL_BENCHMARK(UnicodeString_Ansi) {
+    std::vector<char> text;
+    std::vector<ANSI_STRING> strings(kShortStrings);
+    std::vector<size_t> offsets(kShortStrings);
+    double bytes = 0;
+    ULONG_PTR sum = 0;
+
+    for (int i = 0; i < kShortStrings; i++) {
+        USHORT length = (USHORT)(8 + (unsigned)i * 7919 % 40);
+        offsets[i] = text.size();
+        for (USHORT j = 0; j < length; j++) {
+            text.push_back((char)(j % 13 == 5 ? 0xE9 : 'a' + (i + j) % 26));
+        }
+        text.push_back('\0');
+        strings[i].Length = length;
+        strings[i].MaximumLength = (USHORT)(length + 1);
+        bytes += length;
+    }
+    for (int i = 0; i < kShortStrings; i++) {
+        strings[i].Buffer = text.data() + offsets[i];
+    }
+
+    BenchmarkTimer timer;
+    for (const ANSI_STRING& ansi : strings) {
+        DECLARE_UNICODE_STRING_SIZE(name, 64);
+        RtlAnsiStringToUnicodeString(&name, &ansi, FALSE);
+        sum += name.Length + name_buffer[3];
+    }
+    double callerBuffer = timer.Elapsed();
+    BenchmarkReport("RtlAnsiStringToUnicodeString, caller buffer", kShortStrings, callerBuffer);
+    BenchmarkReportBytes("RtlAnsiStringToUnicodeString, caller buffer", bytes, callerBuffer);
+
+    BenchmarkTimer allocateTimer;
+    for (const ANSI_STRING& ansi : strings) {
+        UNICODE_STRING name;
+        if (NT_SUCCESS(RtlAnsiStringToUnicodeString(&name, &ansi, TRUE))) {
+            sum += name.Length;
+            FreeUnicodeString(&name);
+        }
+    }
+    BenchmarkReport("RtlAnsiStringToUnicodeString, allocated", kShortStrings, allocateTimer.Elapsed());
+
+    BenchmarkTimer baselineTimer;
+    for (const ANSI_STRING& ansi : strings) {
+        UNICODE_STRING name;
+        if (NT_SUCCESS(WidenByteByByte(&name, &ansi))) {
+            sum += name.Length;
+            FreeUnicodeString(&name);
+        }
+    }
+    BenchmarkReport("byte-by-byte widen into pool buffer", kShortStrings, baselineTimer.Elapsed());
+
+    BenchmarkTimer narrowTimer;
+    for (const ANSI_STRING& ansi : strings) {
+        DECLARE_UNICODE_STRING_SIZE(name, 64);
+        CHAR narrowed[64];
+        ANSI_STRING back = { 0, sizeof(narrowed), narrowed };
+        RtlAnsiStringToUnicodeString(&name, &ansi, FALSE);
+        RtlUnicodeStringToAnsiString(&back, &name, FALSE);
+        sum += back.Length + (UCHAR)narrowed[3];
+    }
+    BenchmarkReport("widen + narrow back, caller buffers", kShortStrings, narrowTimer.Elapsed());
+    BenchmarkKeep(sum);
+}
+
+namespace {
+
+// The one-code-unit-at-a-time loop the vectorized length scan replaces
+SIZE_T ScalarLength(PCWSTR string) {
+    SIZE_T length = 0;
+    while (string[length] != UNICODE_NULL) {
+        length++;
+    }
+    return length;
+}
+
+}  // namespace
+
+// Null-terminated strings of typical name lengths, one RtlInitUnicodeString each
+WKL_BENCHMARK(UnicodeString_InitUnicodeString) {
+    for (size_t length : { 8, 16, 32, 64, 256 }) {
+        const int iterations = (int)(kBytesPerLength / (length * sizeof(WCHAR)));
+        std::vector<WCHAR> text(length + 1);
+        SIZE_T sum = 0;
+        char label[96];
+
+        for (size_t i = 0; i < length; i++) {
+            text[i] = (WCHAR)(L'a' + i % 26);
+        }
+        text[length] = UNICODE_NULL;
+        // Read through a volatile so the scan cannot be hoisted out of the loop
+        PCWSTR volatile source = text.data();
+
+        BenchmarkTimer timer;
+        for (int i = 0; i < iterations; i++) {
+            UNICODE_STRING string;
+            RtlInitUnicodeString(&string, source);
+            sum += string.Length;
+        }
+        double fast = timer.Elapsed();
+
+        BenchmarkTimer scalarTimer;
+        for (int i = 0; i < iterations; i++) {
+            sum += ScalarLength(source) * sizeof(WCHAR);
+        }
+        double scalar = scalarTimer.Elapsed();
+        BenchmarkKeep(sum);
+
+        snprintf(label, sizeof(label), "RtlInitUnicodeString, %zu chars", length);
+        BenchmarkReport(label, iterations, fast);
+        snprintf(label, sizeof(label), "RtlInitUnicodeString, %zu chars (scalar)", length);
+        BenchmarkReport(label, iterations, scalar);
+    }
+}
+
+namespace {
+
+// The string fields DevicesList fills for each device
+struct PooledDeviceStrings {
+    UNICODE_STRING Manufacturer;
+    UNICODE_STRING Product;
+    UNICODE_STRING SerialNumber;
+};
+
+struct InlineDeviceStrings {
+    INLINE_UNICODE_STRING Manufacturer;
+    INLINE_UNICODE_STRING Product;
+    INLINE_UNICODE_STRING SerialNumber;
+};
+
+// Stays within the allocation tracking table, so every allocation is counted
+const int kDevices = 4096;
+
+LONG64 PoolAllocations() {
+    return RtlReadShardedCounter(&GetGlobalState()->AllocationCount);
+}
+
+}  // namespace
+
+// Creating and freeing the strings of DevicesList devices
+WKL_BENCHMARK(UnicodeString_InlineDeviceStrings) {
+    const char* manufacturers[] = { "Sony", "Apple", "Microsoft", "Logitech" };
+    const char* products[] = { "Walkman", "iPhone", "Surface", "MX Master 3S Wireless Mouse" };
+    std::vector<std::vector<WCHAR>> texts(kDevices * 3);
+    std::vector<PooledDeviceStrings> pooled(kDevices);
+    std::vector<InlineDeviceStrings> inlined(kDevices);
+
+    for (int i = 0; i < kDevices; i++) {
+        std::string serial = "SN" + std::to_string(100000 + i);
+        texts[i * 3].assign(manufacturers[i % 4], manufacturers[i % 4] + strlen(manufacturers[i % 4]));
+        texts[i * 3 + 1].assign(products[i % 4], products[i % 4] + strlen(products[i % 4]));
+        texts[i * 3 + 2].assign(serial.begin(), serial.end());
+    }
+
+    InitHeap();
+
+    LONG64 before = PoolAllocations();
+    BenchmarkTimer pooledTimer;
+    for (int i = 0; i < kDevices; i++) {
+        UNICODE_STRING manufacturer = MakeString(texts[i * 3]);
+        UNICODE_STRING product = MakeString(texts[i * 3 + 1]);
+        UNICODE_STRING serial = MakeString(texts[i * 3 + 2]);
+        RtlDuplicateUnicodeString(RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE, &manufacturer, &pooled[i].Manufacturer);
+        RtlDuplicateUnicodeString(RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE, &product, &pooled[i].Product);
+        RtlDuplicateUnicodeString(RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE, &serial, &pooled[i].SerialNumber);
+    }
+    double pooledCreate = pooledTimer.Elapsed();
+    LONG64 pooledAllocations = PoolAllocations() - before;
+
+    BenchmarkTimer pooledFreeTimer;
+    for (int i = 0; i < kDevices; i++) {
+        FreeUnicodeString(&pooled[i].Manufacturer);
+        FreeUnicodeString(&pooled[i].Product);
+        FreeUnicodeString(&pooled[i].SerialNumber);
+    }
+    double pooledFree = pooledFreeTimer.Elapsed();
+
+    before = PoolAllocations();
+    BenchmarkTimer inlineTimer;
+    for (int i = 0; i < kDevices; i++) {
+        UNICODE_STRING manufacturer = MakeString(texts[i * 3]);
+        UNICODE_STRING product = MakeString(texts[i * 3 + 1]);
+        UNICODE_STRING serial = MakeString(texts[i * 3 + 2]);
+        RtlDuplicateInlineUnicodeString(&manufacturer, &inlined[i].Manufacturer);
+        RtlDuplicateInlineUnicodeString(&product, &inlined[i].Product);
+        RtlDuplicateInlineUnicodeString(&serial, &inlined[i].SerialNumber);
+    }
+    double inlineCreate = inlineTimer.Elapsed();
+    LONG64 inlineAllocations = PoolAllocations() - before;
+
+    BenchmarkTimer inlineFreeTimer;
+    for (int i = 0; i < kDevices; i++) {
+        RtlFreeInlineUnicodeString(&inlined[i].Manufacturer);
+        RtlFreeInlineUnicodeString(&inlined[i].Product);
+        RtlFreeInlineUnicodeString(&inlined[i].SerialNumber);
+    }
+    double inlineFree = inlineFreeTimer.Elapsed();
+
+    BenchmarkReport("RtlDuplicateUnicodeString, 3 strings per device", kDevices, pooledCreate);
+    BenchmarkReport("FreeUnicodeString, 3 strings per device", kDevices, pooledFree);
+    printf("  %-48s %12.2f allocations/device\n", "RtlDuplicateUnicodeString", (double)pooledAllocations / kDevices);
+    BenchmarkReport("RtlDuplicateInlineUnicodeString, 3 per device", kDevices, inlineCreate);
+    BenchmarkReport("RtlFreeInlineUnicodeString, 3 per device", kDevices, inlineFree);
+    printf("  %-48s %12.2f allocations/device\n", "RtlDuplicateInlineUnicodeString", (double)inlineAllocations / kDevices);
+    CleanupHeap();
+}
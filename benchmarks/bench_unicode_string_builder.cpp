@@ -0,0 +1,161 @@
+#include <string>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/UnicodeStringBuilder.h"
+
+namespace {
+
+const int kNames = 4096;
+const int kLongStrings = 16;
+const int kLongPieces = 4000;   // 8 code units each, near UNICODE_STRING_MAX_CHARS
+
+LONG64 PoolAllocations() {
+    return RtlReadShardedCounter(&GetGlobalState()->AllocationCount);
+}
+
+// What building a name without a builder costs: a new exactly-sized copy of
+// everything so far for each piece appended
+NTSTATUS ConcatByDuplicate(PUNICODE_STRING String, PCUNICODE_STRING Piece) {
+    UNICODE_STRING Result;
+    ULONG const Length = (ULONG)String->Length + Piece->Length;
+
+    if (String->Buffer == NULL) {
+        return RtlDuplicateUnicodeString(RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE, Piece, String);
+    }
+    if (Length > UNICODE_STRING_MAX_BYTES - sizeof(WCHAR)) {
+        return STATUS_NAME_TOO_LONG;
+    }
+    Result.Buffer = (PWSTR)ExAllocatePoolTracked(PagedPool, Length + sizeof(WCHAR));
+    if (Result.Buffer == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+    Result.Length = (USHORT)Length;
+    Result.MaximumLength = (USHORT)(Length + sizeof(WCHAR));
+    memcpy(Result.Buffer, String->Buffer, String->Length);
+    memcpy((PUCHAR)Result.Buffer + String->Length, Piece->Buffer, Piece->Length);
+    Result.Buffer[Length / sizeof(WCHAR)] = UNICODE_NULL;
+    FreeUnicodeString(String);
+    *String = Result;
+    return STATUS_SUCCESS;
+}
+
+UNICODE_STRING MakeString(std::vector<WCHAR>& text) {
+    UNICODE_STRING string;
+    string.Buffer = text.data();
+    string.Length = (USHORT)(text.size() * sizeof(WCHAR));
+    string.MaximumLength = string.Length;
+    return string;
+}
+
+std::vector<WCHAR> Widen(const std::string& value) {
+    return std::vector<WCHAR>(value.begin(), value.end());
+}
+
+}  // namespace
+
+// Device path + serial number + suffix, as DEVICE_NAME fields are assembled
+WKL_BENCHMARK(UnicodeStringBuilder_CompositeNames) {
+    std::vector<WCHAR> path = Widen("\\Device\\USB\\VID_045E&PID_07A5");
+    std::vector<WCHAR> separator = Widen("\\");
+    std::vector<WCHAR> suffix = Widen("\\Interface0");
+    std::vector<std::vector<WCHAR>> serials(kNames);
+    USHORT totalLength = 0;
+
+    for (int i = 0; i < kNames; i++) {
+        serials[i] = Widen("SN" + std::to_string(100000 + i));
+    }
+
+    InitHeap();
+
+    LONG64 before = PoolAllocations();
+    BenchmarkTimer duplicateTimer;
+    for (int i = 0; i < kNames; i++) {
+        UNICODE_STRING pieces[] = { MakeString(path), MakeString(separator), MakeString(serials[i]),
+                                    MakeString(suffix) };
+        UNICODE_STRING name = { 0 };
+        for (const UNICODE_STRING& piece : pieces) {
+            ConcatByDuplicate(&name, &piece);
+        }
+        totalLength += name.Length;
+        FreeUnicodeString(&name);
+    }
+    double duplicateTime = duplicateTimer.Elapsed();
+    LONG64 duplicateAllocations = PoolAllocations() - before;
+
+    before = PoolAllocations();
+    BenchmarkTimer builderTimer;
+    for (int i = 0; i < kNames; i++) {
+        UNICODE_STRING serial = MakeString(serials[i]);
+        UNICODE_STRING devicePath = MakeString(path);
+        UNICODE_STRING_BUILDER builder;
+        UNICODE_STRING name;
+
+        RtlInitializeUnicodeStringBuilder(&builder);
+        RtlAppendUnicodeStringToBuilder(&builder, &devicePath);
+        RtlAppendUnicodeCharToBuilder(&builder, L'\\');
+        RtlAppendUnicodeStringToBuilder(&builder, &serial);
+        RtlAppendUnicodeToBuilder(&builder, L"\\Interface0");
+        RtlFinishUnicodeStringBuilder(&builder, &name);
+        totalLength += name.Length;
+        FreeUnicodeString(&name);
+    }
+    double builderTime = builderTimer.Elapsed();
+    LONG64 builderAllocations = PoolAllocations() - before;
+    BenchmarkKeep(totalLength);
+
+    BenchmarkReport("duplicate + copy per piece, 4 pieces per name", kNames, duplicateTime);
+    BenchmarkReport("UNICODE_STRING_BUILDER, 4 pieces per name", kNames, builderTime);
+    printf("  %-48s %12.2f allocations/name\n", "duplicate + copy per piece", (double)duplicateAllocations / kNames);
+    printf("  %-48s %12.2f allocations/name\n", "UNICODE_STRING_BUILDER", (double)builderAllocations / kNames);
+
+    CleanupHeap();
+}
+
+// Thousands of short pieces: recopying is quadratic, the builder linear
+WKL_BENCHMARK(UnicodeStringBuilder_LongString) {
+    std::vector<WCHAR> piece = Widen("Segment\\");
+    UNICODE_STRING pieceString = MakeString(piece);
+    USHORT totalLength = 0;
+
+    InitHeap();
+
+    LONG64 before = PoolAllocations();
+    BenchmarkTimer duplicateTimer;
+    for (int n = 0; n < kLongStrings; n++) {
+        UNICODE_STRING text = { 0 };
+        for (int i = 0; i < kLongPieces; i++) {
+            ConcatByDuplicate(&text, &pieceString);
+        }
+        totalLength += text.Length;
+        FreeUnicodeString(&text);
+    }
+    double duplicateTime = duplicateTimer.Elapsed();
+    LONG64 duplicateAllocations = PoolAllocations() - before;
+
+    before = PoolAllocations();
+    BenchmarkTimer builderTimer;
+    for (int n = 0; n < kLongStrings; n++) {
+        UNICODE_STRING_BUILDER builder;
+        UNICODE_STRING text;
+
+        RtlInitializeUnicodeStringBuilder(&builder);
+        for (int i = 0; i < kLongPieces; i++) {
+            RtlAppendUnicodeStringToBuilder(&builder, &pieceString);
+        }
+        RtlFinishUnicodeStringBuilder(&builder, &text);
+        totalLength += text.Length;
+        FreeUnicodeString(&text);
+    }
+    double builderTime = builderTimer.Elapsed();
+    LONG64 builderAllocations = PoolAllocations() - before;
+    BenchmarkKeep(totalLength);
+
+    BenchmarkReport("duplicate + copy per piece, 32000-char string", kLongStrings, duplicateTime);
+    BenchmarkReport("UNICODE_STRING_BUILDER, 32000-char string", kLongStrings, builderTime);
+    printf("  %-48s %12.2f allocations/string\n", "duplicate + copy per piece",
+           (double)duplicateAllocations / kLongStrings);
+    printf("  %-48s %12.2f allocations/string\n", "UNICODE_STRING_BUILDER",
+           (double)builderAllocations / kLongStrings);
+
+    CleanupHeap();
+}
@@ -0,0 +1,97 @@
+#include <atomic>
+#include <vector>
+#include "Benchmark.h"
+#include "../include/WorkQueue.h"
+
+namespace {
+
+const int kExternalItems = 1 << 18;
+const ULONG_PTR kFanOutDepth = 17;
+
+std::atomic<ULONG_PTR> g_Executed(0);
+
+VOID TinyRoutine(PVOID Parameter) {
+    g_Executed.fetch_add((ULONG_PTR)Parameter, std::memory_order_relaxed);
+}
+
+PEX_WORK_QUEUE g_FanOutQueue;
+
+// Each node queues two children, so one root produces 2^(depth + 1) - 1 tiny
+// items. IoObject carries the depth so that Context can carry the item itself,
+// which the routine frees before queuing its children.
+VOID FanOutRoutine(PVOID IoObject, PVOID Context) {
+    ULONG_PTR depth = (ULONG_PTR)IoObject;
+
+    IoFreeWorkItem((PIO_WORKITEM)Context);
+    g_Executed.fetch_add(1, std::memory_order_relaxed);
+    if (depth > 0) {
+        for (int child = 0; child < 2; child++) {
+            PIO_WORKITEM item = IoAllocateWorkItem(g_FanOutQueue, (PVOID)(depth - 1));
+            if (item != NULL) {
+                IoQueueWorkItem(item, FanOutRoutine, DelayedWorkQueue, item);
+            }
+        }
+    }
+}
+
+void RunExternal(ULONG workers) {
+    EX_WORK_QUEUE workQueue;
+    std::vector<WORK_QUEUE_ITEM> items(kExternalItems);
+    char label[96];
+
+    if (ExInitializeWorkQueue(&workQueue, workers) != STATUS_SUCCESS) {
+        return;
+    }
+    g_Executed = 0;
+
+    BenchmarkTimer timer;
+    for (auto& item : items) {
+        ExInitializeWorkItem(&item, TinyRoutine, (PVOID)1);
+        ExQueueWorkItem(&workQueue, &item, DelayedWorkQueue);
+    }
+    ExFlushWorkQueue(&workQueue);
+    double seconds = timer.Elapsed();
+
+    BenchmarkKeep(g_Executed.load());
+    snprintf(label, sizeof(label), "%u workers, external ExQueueWorkItem", workers);
+    BenchmarkReport(label, (double)kExternalItems, seconds);
+    ExRundownWorkQueue(&workQueue);
+}
+
+void RunFanOut(ULONG workers) {
+    EX_WORK_QUEUE workQueue;
+    char label[96];
+
+    if (ExInitializeWorkQueue(&workQueue, workers) != STATUS_SUCCESS) {
+        return;
+    }
+    g_Executed = 0;
+
+    g_FanOutQueue = &workQueue;
+
+    BenchmarkTimer timer;
+    PIO_WORKITEM root = IoAllocateWorkItem(&workQueue, (PVOID)kFanOutDepth);
+    if (root == NULL) {
+        ExRundownWorkQueue(&workQueue);
+        return;
+    }
+    IoQueueWorkItem(root, FanOutRoutine, DelayedWorkQueue, root);
+    ExFlushWorkQueue(&workQueue);
+    double seconds = timer.Elapsed();
+
+    BenchmarkKeep(g_Executed.load());
+    snprintf(label, sizeof(label), "%u workers, nested IoQueueWorkItem", workers);
+    BenchmarkReport(label, (double)g_Executed.load(), seconds);
+    ExRundownWorkQueue(&workQueue);
+}
+
+}  // namespace
+
+WKL_BENCHMARK(WorkQueue_TinyItems) {
+    InitHeap();
+    for (ULONG workers : { 1u, 2u, 4u, 8u }) {
+        RunExternal(workers);
+        RunFanOut(workers);
+    }
+    CleanupHeap();
+}
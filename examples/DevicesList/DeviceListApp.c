@@ -21,6 +21,10 @@ int main(void)
 {
 	InitHeap();
 	InitializeListHead(&gDeviceList);
+	if (!NT_SUCCESS(InitializeDeviceObjectType())) {
+		printf("Failed to create the device object type\n");
+		return -1;
+	}
 	
 	// Use our new CreateDevice helper function instead of manual allocation
 	PDEVICE_NAME device = CreateDevice(L"Sony", L"Walkman", L"SN12345");
@@ -29,10 +33,11 @@ int main(void)
 
 	// Check for allocation failures
 	if (!device || !device1 || !device2) {
-		// Free any successfully allocated devices that aren't owned by a list
+		// Release the devices that were created
 		if (device) FreeDevice(device);
 		if (device1) FreeDevice(device1);
 		if (device2) FreeDevice(device2);
+		DeleteDeviceObjectType();
 		printf("Memory allocation failed\n");
 		return -1;
 	}
@@ -41,8 +46,11 @@ int main(void)
 	InsertDeviceListEx(&gDeviceList, device1);
 	InsertDeviceListEx(&gDeviceList, device2);
 	
-	// At this point, the list owns these devices, so don't call FreeDevice()
-	// directly on these pointers anymore
+	// The list took its own references, so release ours; the devices stay
+	// alive until they are removed from the list as well
+	FreeDevice(device);
+	FreeDevice(device1);
+	FreeDevice(device2);
 	
     /* Debugging Tool: Uncomment to test memory leak detection
      * This intentionally creates a memory leak to verify that
@@ -51,8 +59,10 @@ int main(void)
     // CreateMemoryLeak();
 
 	// dump linked list entries
-	PLIST_ENTRY currentPointer = gDeviceList.Flink;
-	while (currentPointer != &gDeviceList)
+	LIST_ITERATOR iterator;
+	PLIST_ENTRY currentPointer;
+	InitializeListIterator(&iterator, &gDeviceList);
+	while ((currentPointer = ListIteratorNext(&iterator)) != NULL)
 	{
 		PDEVICE_LIST_ENTRY listEntry = CONTAINING_RECORD(currentPointer, DEVICE_LIST_ENTRY, ListEntry);
 		PDEVICE_NAME pdeviceName = listEntry->pDevName;
@@ -60,17 +70,15 @@ int main(void)
 		// Print all available information for each device using the library's DumpUnicodeString
 		printf("Device Information:\n");
 		printf("Manufacturer: ");
-		DumpUnicodeString(&pdeviceName->Manufacturer, "Manufacturer");
+		DumpUnicodeString(pdeviceName->Manufacturer, "Manufacturer");
 		printf("Product: ");
-		DumpUnicodeString(&pdeviceName->Product, "Product");
+		DumpUnicodeString(&pdeviceName->Product.String, "Product");
 		printf("Serial Number: ");
-		DumpUnicodeString(&pdeviceName->SerialNumber, "SerialNumber");
+		DumpUnicodeString(&pdeviceName->SerialNumber.String, "SerialNumber");
 		printf("\n");
-
-		currentPointer = currentPointer->Flink;
 	}
 
-	// Clean up the whole list - using our new ownership-aware mechanism
+	// Clean up the whole list; removing the last reference frees each device
 	while (!IsListEmpty(&gDeviceList)) {
 		PLIST_ENTRY entry = gDeviceList.Flink;
 		PDEVICE_LIST_ENTRY listEntry = CONTAINING_RECORD(entry, DEVICE_LIST_ENTRY, ListEntry);
@@ -79,6 +87,9 @@ int main(void)
 		RemoveAndFreeDevice(&gDeviceList, listEntry->pDevName);
 	}
 
+    // Reports devices that were never released, then frees the type
+    DeleteDeviceObjectType();
+
     // Print memory leak report at the end
     printf("\nChecking for memory leaks...\n");
     PrintMemoryLeaks();
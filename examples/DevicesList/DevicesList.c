@@ -1,44 +1,69 @@
 #include "DevicesList.h"
 
 LIST_ENTRY gDeviceList = {0};
+POBJECT_TYPE gDeviceObjectType = NULL;
+PRTL_ATOM_TABLE gDeviceStringTable = NULL;
 
-static VOID CleanupFailedDevice(
-    PDEVICE_NAME device,
-    BOOLEAN cleanManufacturer,
-    BOOLEAN cleanProduct,
-    BOOLEAN cleanSerial)
+// Runs when the last reference to a device is dropped
+static VOID DeleteDevice(PVOID object)
 {
-    if (cleanManufacturer && device->Manufacturer.Buffer) {
-        FreeUnicodeString(&device->Manufacturer);
+    PDEVICE_NAME device = (PDEVICE_NAME)object;
+
+    FreeUnicodeString(&device->usGuid);
+    FreeUnicodeString(&device->usDeviceType);
+    FreeUnicodeString(&device->usDeviceHardwareId);
+    FreeUnicodeString(&device->usDevicePropertyDriverKeyName);
+    if (device->Manufacturer) {
+        RtlDeleteAtomFromAtomTable(gDeviceStringTable, device->Manufacturer);
     }
-    
-    if (cleanProduct && device->Product.Buffer) {
-        FreeUnicodeString(&device->Product);
+    RtlFreeInlineUnicodeString(&device->Product);
+    RtlFreeInlineUnicodeString(&device->SerialNumber);
+}
+
+NTSTATUS InitializeDeviceObjectType(VOID)
+{
+    OBJECT_TYPE_INITIALIZER initializer;
+    NTSTATUS status;
+
+    // Devices of one manufacturer share a single copy of its name
+    status = RtlCreateAtomTable(0, FALSE, &gDeviceStringTable);
+    if (!NT_SUCCESS(status)) {
+        return status;
     }
-    
-    if (cleanSerial && device->SerialNumber.Buffer) {
-        FreeUnicodeString(&device->SerialNumber);
+
+    RtlZeroMemory(&initializer, sizeof(initializer));
+    initializer.PoolType = PagedPool;
+    initializer.PoolTag = DEVICE_POOL_TAG;
+    initializer.DeleteProcedure = DeleteDevice;
+
+    status = ObCreateObjectType("Device", &initializer, &gDeviceObjectType);
+    if (!NT_SUCCESS(status)) {
+        RtlDestroyAtomTable(gDeviceStringTable);
+        gDeviceStringTable = NULL;
+    }
+    return status;
+}
+
+VOID DeleteDeviceObjectType(VOID)
+{
+    if (gDeviceObjectType) {
+        ObDeleteObjectType(gDeviceObjectType);
+        gDeviceObjectType = NULL;
+    }
+    if (gDeviceStringTable) {
+        RtlDestroyAtomTable(gDeviceStringTable);
+        gDeviceStringTable = NULL;
     }
-    ExFreePool(device);
 }
 
 PDEVICE_NAME CreateDevice(PCWSTR manufacturer, PCWSTR product, PCWSTR serialNumber)
 {
-    // Use tracked allocation
-    PDEVICE_NAME device = ExAllocatePoolTracked(PagedPool, sizeof(DEVICE_NAME));
-    if (!device) {
+    // Devices are zero-filled objects of gDeviceObjectType with one reference
+    PDEVICE_NAME device = NULL;
+    NTSTATUS status = ObCreateObject(gDeviceObjectType, sizeof(DEVICE_NAME), (PVOID*)&device);
+    if (!NT_SUCCESS(status)) {
         return NULL;
     }
-
-    RtlZeroMemory(device, sizeof(DEVICE_NAME));
-    
-    // Initialize ownership flag - device not yet owned by any list
-    device->OwnedByList = FALSE;
-    
-    BOOLEAN hasManufacturer = FALSE;
-    BOOLEAN hasProduct = FALSE;
-    BOOLEAN hasSerial = FALSE;
-    NTSTATUS status = STATUS_SUCCESS;
     
     // Initialize the required fields
     if (manufacturer) {
@@ -47,15 +72,10 @@ PDEVICE_NAME CreateDevice(PCWSTR manufacturer, PCWSTR product, PCWSTR serialNumb
         if (!NT_SUCCESS(status)) {
             goto Cleanup;
         }
-        status = RtlDuplicateUnicodeString(
-            RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE,
-            &tempString,
-            &device->Manufacturer
-        );
+        status = RtlAddAtomToAtomTable(gDeviceStringTable, &tempString, &device->Manufacturer);
         if (!NT_SUCCESS(status)) {
             goto Cleanup;
         }
-        hasManufacturer = TRUE;
     }
     
     if (product) {
@@ -64,15 +84,10 @@ PDEVICE_NAME CreateDevice(PCWSTR manufacturer, PCWSTR product, PCWSTR serialNumb
         if (!NT_SUCCESS(status)) {
             goto Cleanup;
         }
-        status = RtlDuplicateUnicodeString(
-            RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE,
-            &tempString,
-            &device->Product
-        );
+        status = RtlDuplicateInlineUnicodeString(&tempString, &device->Product);
         if (!NT_SUCCESS(status)) {
             goto Cleanup;
         }
-        hasProduct = TRUE;
     }
     
     if (serialNumber) {
@@ -81,21 +96,17 @@ PDEVICE_NAME CreateDevice(PCWSTR manufacturer, PCWSTR product, PCWSTR serialNumb
         if (!NT_SUCCESS(status)) {
             goto Cleanup;
         }
-        status = RtlDuplicateUnicodeString(
-            RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE,
-            &tempString,
-            &device->SerialNumber
-        );
+        status = RtlDuplicateInlineUnicodeString(&tempString, &device->SerialNumber);
         if (!NT_SUCCESS(status)) {
             goto Cleanup;
         }
-        hasSerial = TRUE;
     }
     
     return device;
     
 Cleanup:
-    CleanupFailedDevice(device, hasManufacturer, hasProduct, hasSerial);
+    // The delete procedure frees whichever strings were already set
+    ObDereferenceObject(device);
     return NULL;
 }
 
@@ -105,17 +116,8 @@ VOID FreeDevice(PDEVICE_NAME device)
         return;
     }
     
-    // Free the strings
-    FreeUnicodeString(&device->usGuid);
-    FreeUnicodeString(&device->usDeviceType);
-    FreeUnicodeString(&device->usDeviceHardwareId);
-    FreeUnicodeString(&device->usDevicePropertyDriverKeyName);
-    FreeUnicodeString(&device->Manufacturer);
-    FreeUnicodeString(&device->Product);
-    FreeUnicodeString(&device->SerialNumber);
-    
-    // Free the device
-    ExFreePool(device);
+    // Drop the caller's reference; lists holding the device keep it alive
+    ObDereferenceObject(device);
 }
 
 VOID RemoveAndFreeDevice(PLIST_ENTRY pListHead, PDEVICE_NAME pDevName)
@@ -132,8 +134,8 @@ VOID RemoveAndFreeDevice(PLIST_ENTRY pListHead, PDEVICE_NAME pDevName)
             // Remove the entry from the list
             RemoveEntryList(pEntry);
             
-            // Free the device
-            FreeDevice(pDevName);
+            // Drop the reference the list held
+            ObDereferenceObject(pDevName);
             
             // Free the list entry
             ExFreePool(pListEntry);
@@ -157,14 +159,12 @@ NTSTATUS InsertDeviceListEx(__in PLIST_ENTRY pListHead, __in PDEVICE_NAME pDevNa
         return STATUS_NO_MEMORY;
     }
     
-    // Initialize the list entry
+    // The list holds its own reference to the device
+    ObReferenceObject(pDevName);
     pListEntry->pDevName = pDevName;
     
     // Insert the entry into the list
     InsertTailList(pListHead, &pListEntry->ListEntry);
     
-    // Mark the device as owned by a list
-    pDevName->OwnedByList = TRUE;
-    
     return STATUS_SUCCESS;
 }
@@ -5,13 +5,19 @@
 #undef WIN32_NO_STATUS
 #include <ntstatus.h>
 #include <stdio.h>
+#include "WinKernelLite/AtomTable.h"
 #include "WinKernelLite/KernelHeapAlloc.h"
 #include "WinKernelLite/LinkedList.h"
+#include "WinKernelLite/Object.h"
 #include "WinKernelLite/UnicodeString.h"
 
 #define DebugPrint(x) printf x
 
 extern LIST_ENTRY gDeviceList;
+extern POBJECT_TYPE gDeviceObjectType;
+extern PRTL_ATOM_TABLE gDeviceStringTable;
+
+#define DEVICE_POOL_TAG 'veDL'
 
 typedef struct _DEVICE_NAME
 {
@@ -22,12 +28,9 @@ typedef struct _DEVICE_NAME
 	UNICODE_STRING usDevicePropertyDriverKeyName;
 
 	// USB specific fields
-	UNICODE_STRING Manufacturer;
-	UNICODE_STRING Product;
-	UNICODE_STRING SerialNumber;
-
-	// Flag to track if device is owned by a list
-	BOOLEAN OwnedByList;
+	RTL_ATOM Manufacturer; // Interned in gDeviceStringTable; shared by every device of the manufacturer
+	INLINE_UNICODE_STRING Product; // Short names are stored in the device itself
+	INLINE_UNICODE_STRING SerialNumber;
 
 } DEVICE_NAME, * PDEVICE_NAME;
 
@@ -40,9 +43,26 @@ typedef struct
 
 // Function declarations - only declarations, no definitions
 
+/**
+ * @brief Creates the object type devices are allocated as and the atom table
+ * their manufacturer names are interned in
+ * 
+ * @return NTSTATUS STATUS_SUCCESS if successful, appropriate error code otherwise
+ */
+NTSTATUS InitializeDeviceObjectType(VOID);
+
+/**
+ * @brief Frees the device object type, reporting devices that were never
+ * released, and the atom table
+ */
+VOID DeleteDeviceObjectType(VOID);
+
 /**
  * @brief Creates a new device with the specified attributes
  * 
+ * The device is a reference-counted object; the caller owns the one
+ * reference it is returned with and drops it with FreeDevice.
+ * 
  * @param manufacturer Wide character string for the device manufacturer
  * @param product Wide character string for the product name
  * @param serialNumber Wide character string for the serial number
@@ -51,23 +71,29 @@ typedef struct
 PDEVICE_NAME CreateDevice(PCWSTR manufacturer, PCWSTR product, PCWSTR serialNumber);
 
 /**
- * @brief Frees all resources associated with a device
+ * @brief Releases the caller's reference to a device
+ * 
+ * The device and its strings are freed once every list holding it has
+ * removed it as well.
  * 
- * @param device Pointer to the device to be freed
+ * @param device Pointer to the device to be released
  */
 VOID FreeDevice(PDEVICE_NAME device);
 
 /**
- * @brief Removes a device from a list and frees all associated resources
+ * @brief Removes a device from a list and drops the list's reference to it
  * 
  * @param pListHead Pointer to the head of the list containing the device
- * @param pDevName Pointer to the device to be removed and freed
+ * @param pDevName Pointer to the device to be removed
  */
 VOID RemoveAndFreeDevice(PLIST_ENTRY pListHead, PDEVICE_NAME pDevName);
 
 /**
  * @brief Inserts a device into a list
  * 
+ * The list takes its own reference, so a device may be in several lists and
+ * the caller may release its reference at any time.
+ * 
  * @param pListHead Pointer to the head of the list where the device will be inserted
  * @param pDevName Pointer to the device to be inserted
  * @return NTSTATUS STATUS_SUCCESS if successful, appropriate error code otherwise
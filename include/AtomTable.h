@@ -0,0 +1,466 @@
+/**
+ * @file AtomTable.h
+ * @brief Interned, reference-counted Unicode strings modeled on RTL atom tables
+ *
+ * An RTL_ATOM_TABLE keeps one immutable copy of each distinct string added to
+ * it. RtlAddAtomToAtomTable returns that copy as an RTL_ATOM, a pointer to a
+ * UNICODE_STRING owned by the table, and takes a reference on it; adding an
+ * equal string again returns the same pointer. Two atoms of one table are
+ * therefore equal exactly when their strings are, and comparing them is a
+ * pointer comparison. Records that repeat a few hundred distinct names share
+ * one copy of each instead of duplicating it per record.
+ *
+ * Unlike Windows atoms, which are 16-bit values, an atom here is the string
+ * itself, so there are no integer atoms and no handle to translate. An atom
+ * stays valid until its last reference is dropped with
+ * RtlDeleteAtomFromAtomTable; the string must not be modified.
+ *
+ * Strings are hashed with HASH_STRING_ALGORITHM_FAST into a power-of-two
+ * number of buckets, each with its own push lock. Lookups take the bucket
+ * lock shared, so any number of threads look up strings in parallel; adding a
+ * new string and freeing an unreferenced one take it exclusive.
+ *
+ * An entry whose reference count has dropped to zero is dead. It stays on its
+ * bucket until the thread that dropped the last reference unlinks it, but
+ * lookups skip it and adding its string again inserts a new entry. A dead
+ * entry is never revived, so exactly one thread frees each entry.
+ */
+
+#ifndef WINKERNEL_ATOMTABLE_H_
+#define WINKERNEL_ATOMTABLE_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "NtStatus.h"
+#include "PushLock.h"
+#include "ShardedCounter.h"
+#include "UnicodeString.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Buckets of a table created with NumberOfBuckets 0 */
+#define RTL_ATOM_TABLE_DEFAULT_BUCKETS  256
+
+/* Upper bound on the number of buckets */
+#define RTL_ATOM_TABLE_MAX_BUCKETS      (1UL << 20)
+
+/**
+ * @brief An interned string; equal atoms of one table have equal strings
+ */
+typedef PCUNICODE_STRING RTL_ATOM, *PRTL_ATOM;
+
+/**
+ * @brief One interned string
+ */
+typedef struct _RTL_ATOM_TABLE_ENTRY {
+    struct _RTL_ATOM_TABLE_ENTRY* HashLink;     /**< Next entry of the bucket */
+    volatile LONG ReferenceCount;               /**< References held by callers; 0 once the entry is dead */
+    ULONG Hash;                                 /**< Hash of Name, folded if the table ignores case */
+    UNICODE_STRING Name;                        /**< The atom; Buffer points at NameBuffer */
+    WCHAR NameBuffer[1];                        /**< Name followed by a null terminator */
+} RTL_ATOM_TABLE_ENTRY, *PRTL_ATOM_TABLE_ENTRY;
+
+/**
+ * @brief Hash chain and the lock that protects it
+ */
+typedef struct _RTL_ATOM_TABLE_BUCKET {
+    EX_PUSH_LOCK Lock;                          /**< Shared to search, exclusive to link or unlink */
+    PRTL_ATOM_TABLE_ENTRY First;                /**< Most recently added entry */
+} RTL_ATOM_TABLE_BUCKET, *PRTL_ATOM_TABLE_BUCKET;
+
+/**
+ * @brief Atom table
+ */
+typedef struct _RTL_ATOM_TABLE {
+    PRTL_ATOM_TABLE_BUCKET Buckets;             /**< BucketMask + 1 buckets, allocated from the pool */
+    ULONG BucketMask;
+    BOOLEAN CaseInSensitive;                    /**< Strings differing only in case share an atom */
+    SHARDED_COUNTER AtomCount;                  /**< Live and dead entries still linked */
+    PVOID Allocation;                           /**< Pool block holding this cache-aligned table */
+} RTL_ATOM_TABLE, *PRTL_ATOM_TABLE;
+
+/* Returns the entry an atom is the name of */
+#define RTLP_ATOM_TABLE_ENTRY(Atom) \
+    CONTAINING_RECORD((Atom), RTL_ATOM_TABLE_ENTRY, Name)
+
+/*
+ * Takes a reference on an entry unless it is dead. A dead entry's count stays
+ * at zero, so a lookup racing with the final release cannot bring it back.
+ */
+static __forceinline
+BOOLEAN
+RtlpReferenceLiveAtom(
+    _Inout_ PRTL_ATOM_TABLE_ENTRY Entry
+)
+{
+    LONG Count = ReadNoFence(&Entry->ReferenceCount);
+
+    while (Count != 0) {
+        LONG Observed = InterlockedCompareExchange(&Entry->ReferenceCount, Count + 1, Count);
+        if (Observed == Count) {
+            return TRUE;
+        }
+        Count = Observed;
+    }
+    return FALSE;
+}
+
+/*
+ * Searches a bucket for a live entry with the given name and references it.
+ * The caller holds the bucket lock, shared or exclusive.
+ */
+static __forceinline
+PRTL_ATOM_TABLE_ENTRY
+RtlpFindAtom(
+    _In_ PRTL_ATOM_TABLE AtomTable,
+    _In_ PRTL_ATOM_TABLE_BUCKET Bucket,
+    _In_ PCUNICODE_STRING AtomName,
+    _In_ ULONG Hash
+)
+{
+    PRTL_ATOM_TABLE_ENTRY Entry;
+
+    for (Entry = Bucket->First; Entry != NULL; Entry = Entry->HashLink) {
+        if (Entry->Hash == Hash &&
+            RtlEqualUnicodeString(&Entry->Name, AtomName, AtomTable->CaseInSensitive) &&
+            RtlpReferenceLiveAtom(Entry)) {
+            return Entry;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Validates a name and returns its bucket and hash.
+ */
+static __forceinline
+NTSTATUS
+RtlpHashAtomName(
+    _In_ PRTL_ATOM_TABLE AtomTable,
+    _In_ PCUNICODE_STRING AtomName,
+    _Out_ PRTL_ATOM_TABLE_BUCKET* Bucket,
+    _Out_ PULONG Hash
+)
+{
+    NTSTATUS Status;
+
+    if (AtomName->Length > UNICODE_STRING_MAX_BYTES - sizeof(WCHAR)) {
+        return STATUS_NAME_TOO_LONG;
+    }
+    if (AtomName->Length != 0 && AtomName->Buffer == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Status = RtlHashUnicodeString(AtomName, AtomTable->CaseInSensitive, HASH_STRING_ALGORITHM_FAST, Hash);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+    *Bucket = &AtomTable->Buckets[*Hash & AtomTable->BucketMask];
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Creates an empty atom table
+ *
+ * @param[in] NumberOfBuckets Hash buckets, rounded up to a power of two; 0
+ *            for RTL_ATOM_TABLE_DEFAULT_BUCKETS
+ * @param[in] CaseInSensitive TRUE to give strings that differ only in case
+ *            the same atom; the atom keeps the case of the first string added
+ * @param[out] AtomTable Receives the table
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER or STATUS_INSUFFICIENT_RESOURCES
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+RtlCreateAtomTable(
+    _In_ ULONG NumberOfBuckets,
+    _In_ BOOLEAN CaseInSensitive,
+    _Out_ PRTL_ATOM_TABLE* AtomTable
+)
+{
+    PRTL_ATOM_TABLE NewTable;
+    PVOID Allocation;
+    ULONG BucketCount = 1;
+    ULONG i;
+
+    if (AtomTable == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+    *AtomTable = NULL;
+
+    if (NumberOfBuckets == 0) {
+        NumberOfBuckets = RTL_ATOM_TABLE_DEFAULT_BUCKETS;
+    }
+    if (NumberOfBuckets > RTL_ATOM_TABLE_MAX_BUCKETS) {
+        return STATUS_INVALID_PARAMETER;
+    }
+    while (BucketCount < NumberOfBuckets) {
+        BucketCount <<= 1;
+    }
+
+    NewTable = (PRTL_ATOM_TABLE)ExAllocateCacheAlignedPoolTracked(NonPagedPoolCacheAligned, sizeof(RTL_ATOM_TABLE),
+                                                                  &Allocation);
+    if (NewTable == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+    NewTable->Allocation = Allocation;
+    NewTable->Buckets = (PRTL_ATOM_TABLE_BUCKET)ExAllocatePoolTracked(NonPagedPool,
+                                                                     BucketCount * sizeof(RTL_ATOM_TABLE_BUCKET));
+    if (NewTable->Buckets == NULL) {
+        ExFreePool(Allocation);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    for (i = 0; i < BucketCount; i++) {
+        ExInitializePushLock(&NewTable->Buckets[i].Lock);
+        NewTable->Buckets[i].First = NULL;
+    }
+    NewTable->BucketMask = BucketCount - 1;
+    NewTable->CaseInSensitive = CaseInSensitive;
+    RtlInitializeShardedCounter(&NewTable->AtomCount);
+
+    *AtomTable = NewTable;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Frees an atom table and every string in it
+ *
+ * No other thread may use the table, and atoms from it that are still
+ * referenced become invalid.
+ *
+ * @param[in] AtomTable Table created by RtlCreateAtomTable
+ */
+static __forceinline
+VOID
+RtlDestroyAtomTable(
+    _In_ PRTL_ATOM_TABLE AtomTable
+)
+{
+    ULONG i;
+
+    for (i = 0; i <= AtomTable->BucketMask; i++) {
+        PRTL_ATOM_TABLE_ENTRY Entry = AtomTable->Buckets[i].First;
+
+        while (Entry != NULL) {
+            PRTL_ATOM_TABLE_ENTRY Next = Entry->HashLink;
+            ExFreePool(Entry);
+            Entry = Next;
+        }
+    }
+
+    ExFreePool(AtomTable->Buckets);
+    ExFreePool(AtomTable->Allocation);
+}
+
+/**
+ * @brief Interns a string and takes a reference on its atom
+ *
+ * If the table holds an equal string, its atom is returned; otherwise a copy
+ * of AtomName is added. Each successful call must be balanced by a call to
+ * RtlDeleteAtomFromAtomTable.
+ *
+ * @param[in,out] AtomTable Table to add the string to
+ * @param[in] AtomName String to intern; may be empty
+ * @param[out] Atom Receives the atom, a null-terminated string owned by the table
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER, STATUS_NAME_TOO_LONG if
+ *         the string and its terminator exceed UNICODE_STRING_MAX_BYTES, or
+ *         STATUS_NO_MEMORY
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+RtlAddAtomToAtomTable(
+    _Inout_ PRTL_ATOM_TABLE AtomTable,
+    _In_ PCUNICODE_STRING AtomName,
+    _Out_ PRTL_ATOM Atom
+)
+{
+    PRTL_ATOM_TABLE_BUCKET Bucket;
+    PRTL_ATOM_TABLE_ENTRY Entry;
+    PRTL_ATOM_TABLE_ENTRY Existing;
+    ULONG Hash;
+    NTSTATUS Status;
+
+    if (AtomTable == NULL || AtomName == NULL || Atom == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+    *Atom = NULL;
+
+    Status = RtlpHashAtomName(AtomTable, AtomName, &Bucket, &Hash);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    // Most adds find the string already interned
+    ExAcquirePushLockShared(&Bucket->Lock);
+    Existing = RtlpFindAtom(AtomTable, Bucket, AtomName, Hash);
+    ExReleasePushLockShared(&Bucket->Lock);
+    if (Existing != NULL) {
+        *Atom = &Existing->Name;
+        return STATUS_SUCCESS;
+    }
+
+    // Copy the string before taking the lock exclusive
+    Entry = (PRTL_ATOM_TABLE_ENTRY)ExAllocatePoolTracked(
+        PagedPool, FIELD_OFFSET(RTL_ATOM_TABLE_ENTRY, NameBuffer) + AtomName->Length + sizeof(WCHAR));
+    if (Entry == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+    Entry->ReferenceCount = 1;
+    Entry->Hash = Hash;
+    Entry->Name.Buffer = Entry->NameBuffer;
+    Entry->Name.Length = AtomName->Length;
+    Entry->Name.MaximumLength = (USHORT)(AtomName->Length + sizeof(WCHAR));
+    if (AtomName->Length != 0) {
+        RtlCopyMemory(Entry->NameBuffer, AtomName->Buffer, AtomName->Length);
+    }
+    Entry->NameBuffer[AtomName->Length / sizeof(WCHAR)] = UNICODE_NULL;
+
+    ExAcquirePushLockExclusive(&Bucket->Lock);
+    // Another thread may have added the string since the shared search
+    Existing = RtlpFindAtom(AtomTable, Bucket, AtomName, Hash);
+    if (Existing == NULL) {
+        Entry->HashLink = Bucket->First;
+        Bucket->First = Entry;
+    }
+    ExReleasePushLockExclusive(&Bucket->Lock);
+
+    if (Existing != NULL) {
+        ExFreePool(Entry);
+        Entry = Existing;
+    } else {
+        RtlIncrementShardedCounter(&AtomTable->AtomCount);
+    }
+
+    *Atom = &Entry->Name;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Finds the atom of a string already in the table and references it
+ *
+ * @param[in] AtomTable Table to search
+ * @param[in] AtomName String to look for
+ * @param[out] Atom Receives the atom; release it with RtlDeleteAtomFromAtomTable
+ * @return STATUS_SUCCESS, STATUS_OBJECT_NAME_NOT_FOUND, STATUS_INVALID_PARAMETER
+ *         or STATUS_NAME_TOO_LONG
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+RtlLookupAtomInAtomTable(
+    _In_ PRTL_ATOM_TABLE AtomTable,
+    _In_ PCUNICODE_STRING AtomName,
+    _Out_ PRTL_ATOM Atom
+)
+{
+    PRTL_ATOM_TABLE_BUCKET Bucket;
+    PRTL_ATOM_TABLE_ENTRY Entry;
+    ULONG Hash;
+    NTSTATUS Status;
+
+    if (AtomTable == NULL || AtomName == NULL || Atom == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+    *Atom = NULL;
+
+    Status = RtlpHashAtomName(AtomTable, AtomName, &Bucket, &Hash);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    ExAcquirePushLockShared(&Bucket->Lock);
+    Entry = RtlpFindAtom(AtomTable, Bucket, AtomName, Hash);
+    ExReleasePushLockShared(&Bucket->Lock);
+    if (Entry == NULL) {
+        return STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+
+    *Atom = &Entry->Name;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Takes another reference on an atom the caller already holds
+ *
+ * Lets a second owner share an atom without looking its string up again.
+ *
+ * @param[in] Atom Referenced atom
+ * @return Atom
+ */
+static __forceinline
+RTL_ATOM
+RtlReferenceAtom(
+    _In_ RTL_ATOM Atom
+)
+{
+    InterlockedIncrement(&RTLP_ATOM_TABLE_ENTRY(Atom)->ReferenceCount);
+    return Atom;
+}
+
+/**
+ * @brief Drops a reference on an atom, freeing its string with the last one
+ *
+ * @param[in,out] AtomTable Table the atom belongs to
+ * @param[in] Atom Atom returned by RtlAddAtomToAtomTable,
+ *            RtlLookupAtomInAtomTable or RtlReferenceAtom
+ * @return STATUS_SUCCESS, or STATUS_INVALID_PARAMETER for a NULL argument
+ */
+static __forceinline
+NTSTATUS
+RtlDeleteAtomFromAtomTable(
+    _Inout_ PRTL_ATOM_TABLE AtomTable,
+    _In_ RTL_ATOM Atom
+)
+{
+    PRTL_ATOM_TABLE_ENTRY Entry;
+    PRTL_ATOM_TABLE_BUCKET Bucket;
+    PRTL_ATOM_TABLE_ENTRY* Link;
+
+    if (AtomTable == NULL || Atom == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Entry = RTLP_ATOM_TABLE_ENTRY(Atom);
+    if (InterlockedDecrement(&Entry->ReferenceCount) != 0) {
+        return STATUS_SUCCESS;
+    }
+
+    // The entry is dead and this thread alone may unlink it
+    Bucket = &AtomTable->Buckets[Entry->Hash & AtomTable->BucketMask];
+    ExAcquirePushLockExclusive(&Bucket->Lock);
+    Link = &Bucket->First;
+    while (*Link != Entry) {
+        Link = &(*Link)->HashLink;
+    }
+    *Link = Entry->HashLink;
+    ExReleasePushLockExclusive(&Bucket->Lock);
+
+    RtlAddShardedCounter(&AtomTable->AtomCount, -1);
+    ExFreePool(Entry);
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Returns the number of distinct strings in the table
+ *
+ * @param[in] AtomTable Table to query
+ * @return Interned strings; approximate while atoms are being added or deleted
+ */
+static __forceinline
+ULONG
+RtlQueryAtomCount(
+    _In_ PRTL_ATOM_TABLE AtomTable
+)
+{
+    return (ULONG)RtlReadShardedCounter(&AtomTable->AtomCount);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_ATOMTABLE_H_ */
@@ -0,0 +1,704 @@
+/**
+ * @file Bitmap.h
+ * @brief Windows kernel-style RTL_BITMAP implementation
+ *
+ * This header provides the RtlXxxBits family of routines used by the Windows
+ * kernel to manage allocation bitmaps (IDs, slots, pages and so on).
+ *
+ * The bitmap storage is an array of ULONGs owned by the caller; bit N lives in
+ * Buffer[N / 32] at position N % 32, exactly as in the kernel. Searches walk the
+ * buffer 64 bits at a time and use bit-scan/population-count instructions to
+ * handle partially filled words. When the translation unit is compiled with
+ * AVX2 enabled (/arch:AVX2 or -mavx2), runs of completely free or completely
+ * used words are skipped 256 bits at a time.
+ */
+
+#ifndef WINKERNEL_BITMAP_H_
+#define WINKERNEL_BITMAP_H_
+
+#include <Windows.h>
+#include <intrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bitmap header compatible with the Windows kernel definition
+ */
+typedef struct _RTL_BITMAP {
+    ULONG SizeOfBitMap;   /**< Number of bits in the bitmap */
+    PULONG Buffer;        /**< Caller-supplied storage, (SizeOfBitMap + 31) / 32 ULONGs */
+} RTL_BITMAP, *PRTL_BITMAP;
+
+/* Returned by the search routines when no suitable run exists */
+#define RTL_BITMAP_NOT_FOUND ((ULONG)0xFFFFFFFF)
+
+/*
+ * Internal helpers. The search routines operate on 64-bit words assembled
+ * from pairs of ULONGs, so the caller's buffer only needs ULONG alignment.
+ */
+
+static __forceinline
+ULONG
+RtlpBitMapUlongCount(
+    _In_ const RTL_BITMAP* BitMapHeader
+)
+{
+    return (BitMapHeader->SizeOfBitMap + 31) / 32;
+}
+
+static __forceinline
+ULONG64
+RtlpBitMapReadWord(
+    _In_ const RTL_BITMAP* BitMapHeader,
+    _In_ ULONG WordIndex
+)
+{
+    ULONG const UlongCount = RtlpBitMapUlongCount(BitMapHeader);
+    ULONG const Low = WordIndex * 2;
+    ULONG64 Value = BitMapHeader->Buffer[Low];
+
+    if (Low + 1 < UlongCount) {
+        Value |= (ULONG64)BitMapHeader->Buffer[Low + 1] << 32;
+    }
+    return Value;
+}
+
+/* Index of the lowest set bit; Value must be non-zero */
+static __forceinline
+ULONG
+RtlpBitMapLowestSetBit(
+    _In_ ULONG64 Value
+)
+{
+    unsigned long Index;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanForward64(&Index, Value);
+#else
+    if (_BitScanForward(&Index, (ULONG)Value) == 0) {
+        _BitScanForward(&Index, (ULONG)(Value >> 32));
+        Index += 32;
+    }
+#endif
+    return (ULONG)Index;
+}
+
+/* Index of the highest set bit; Value must be non-zero */
+static __forceinline
+ULONG
+RtlpBitMapHighestSetBit(
+    _In_ ULONG64 Value
+)
+{
+    unsigned long Index;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanReverse64(&Index, Value);
+#else
+    if (_BitScanReverse(&Index, (ULONG)(Value >> 32)) != 0) {
+        Index += 32;
+    } else {
+        _BitScanReverse(&Index, (ULONG)Value);
+    }
+#endif
+    return (ULONG)Index;
+}
+
+static __forceinline
+ULONG
+RtlpBitMapPopCount(
+    _In_ ULONG64 Value
+)
+{
+#if defined(_M_X64) && (defined(__AVX__) || defined(__POPCNT__))
+    // POPCNT is guaranteed on every AVX-capable CPU
+    return (ULONG)__popcnt64(Value);
+#else
+    Value = Value - ((Value >> 1) & 0x5555555555555555ULL);
+    Value = (Value & 0x3333333333333333ULL) + ((Value >> 2) & 0x3333333333333333ULL);
+    Value = (Value + (Value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (ULONG)((Value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Mask of the bits of word WordIndex that fall inside [Start, End) */
+static __forceinline
+ULONG64
+RtlpBitMapRangeMask(
+    _In_ ULONG WordIndex,
+    _In_ ULONG Start,
+    _In_ ULONG End
+)
+{
+    ULONG64 const Base = (ULONG64)WordIndex * 64;
+    ULONG64 Mask = ~0ULL;
+
+    if (Start > Base) {
+        Mask &= ~0ULL << (Start - Base);
+    }
+    if (End < Base + 64) {
+        Mask &= (End > Base) ? ~0ULL >> (64 - (End - Base)) : 0;
+    }
+    return Mask;
+}
+
+/*
+ * Returns the number of bits, starting at word WordIndex, that are all clear
+ * (ClearRun != FALSE) or all set (ClearRun == FALSE). Whole 256-bit blocks are
+ * examined with AVX2 when available, and only blocks lying entirely before
+ * Limit are consumed. Scanning stops once at least MaxBits have been skipped.
+ */
+static __forceinline
+ULONG
+RtlpBitMapSkipUniformBlocks(
+    _In_ const RTL_BITMAP* BitMapHeader,
+    _In_ ULONG WordIndex,
+    _In_ ULONG Limit,
+    _In_ BOOLEAN ClearRun,
+    _In_ ULONG MaxBits
+)
+{
+#if defined(__AVX2__)
+    __m256i const Ones = _mm256_set1_epi32(-1);
+    ULONG64 Bit = (ULONG64)WordIndex * 64;
+    ULONG Skipped = 0;
+
+    while (Skipped < MaxBits && Bit + 256 <= Limit) {
+        __m256i const Block = _mm256_loadu_si256((const __m256i*)(BitMapHeader->Buffer + Bit / 32));
+        int const Uniform = ClearRun ? _mm256_testz_si256(Block, Block) : _mm256_testc_si256(Block, Ones);
+        if (!Uniform) {
+            break;
+        }
+        Bit += 256;
+        Skipped += 256;
+    }
+    return Skipped;
+#else
+    UNREFERENCED_PARAMETER(BitMapHeader);
+    UNREFERENCED_PARAMETER(WordIndex);
+    UNREFERENCED_PARAMETER(Limit);
+    UNREFERENCED_PARAMETER(ClearRun);
+    UNREFERENCED_PARAMETER(MaxBits);
+    return 0;
+#endif
+}
+
+/*
+ * Finds the lowest index of NumberToFind consecutive clear bits that lie
+ * entirely inside [Start, End). NumberToFind must be non-zero.
+ */
+static __forceinline
+ULONG
+RtlpBitMapFindClearRun(
+    _In_ const RTL_BITMAP* BitMapHeader,
+    _In_ ULONG NumberToFind,
+    _In_ ULONG Start,
+    _In_ ULONG End
+)
+{
+    ULONG WordIndex;
+    ULONG const LastWord = (End + 63) / 64;
+    ULONG RunStart = 0;
+    ULONG RunLength = 0;
+
+    if (Start >= End || End - Start < NumberToFind) {
+        return RTL_BITMAP_NOT_FOUND;
+    }
+
+    for (WordIndex = Start / 64; WordIndex < LastWord; WordIndex++) {
+        ULONG const Base = WordIndex * 64;
+        ULONG64 Clear = ~RtlpBitMapReadWord(BitMapHeader, WordIndex);
+
+        // Only the first and last words can straddle the range
+        if (Base < Start || End - Base < 64) {
+            Clear &= RtlpBitMapRangeMask(WordIndex, Start, End);
+        }
+
+        if (Clear == 0) {
+            // Fully used; skip any following used blocks wholesale
+            RunLength = 0;
+            WordIndex += RtlpBitMapSkipUniformBlocks(BitMapHeader, WordIndex + 1, End, FALSE, MAXDWORD) / 64;
+            continue;
+        }
+
+        if (Clear == ~0ULL) {
+            ULONG Skipped;
+            if (RunLength == 0) {
+                RunStart = Base;
+            }
+            RunLength += 64;
+            if (RunLength >= NumberToFind) {
+                return RunStart;
+            }
+            // Long request: extend the run over following free blocks
+            Skipped = RtlpBitMapSkipUniformBlocks(BitMapHeader, WordIndex + 1, End, TRUE, NumberToFind - RunLength);
+            RunLength += Skipped;
+            WordIndex += Skipped / 64;
+            if (RunLength >= NumberToFind) {
+                return RunStart;
+            }
+            continue;
+        }
+
+        // Continue a run carried over from the previous word
+        if (RunLength != 0) {
+            ULONG const Leading = RtlpBitMapLowestSetBit(~Clear);
+            if (RunLength + Leading >= NumberToFind) {
+                return RunStart;
+            }
+        }
+
+        // Look for a run that fits entirely inside this word
+        if (NumberToFind <= 64) {
+            ULONG64 Candidates = Clear;
+            ULONG Covered = 1;
+            while (Covered < NumberToFind && Candidates != 0) {
+                ULONG const Shift = (Covered < NumberToFind - Covered) ? Covered : NumberToFind - Covered;
+                Candidates &= Candidates >> Shift;
+                Covered += Shift;
+            }
+            if (Candidates != 0) {
+                return Base + RtlpBitMapLowestSetBit(Candidates);
+            }
+        }
+
+        // Start a new run from the free bits at the top of the word
+        RunLength = (Clear >> 63) ? 63 - RtlpBitMapHighestSetBit(~Clear) : 0;
+        RunStart = Base + 64 - RunLength;
+    }
+
+    return RTL_BITMAP_NOT_FOUND;
+}
+
+/**
+ * @brief Initializes the header of a bitmap
+ *
+ * The bitmap contents are not modified; use RtlClearAllBits or RtlSetAllBits
+ * to give them a defined state.
+ *
+ * @param[out] BitMapHeader Pointer to the RTL_BITMAP to initialize
+ * @param[in] BitMapBuffer Caller-allocated storage of at least (SizeOfBitMap + 31) / 32 ULONGs
+ * @param[in] SizeOfBitMap Number of bits in the bitmap
+ */
+static __forceinline
+void
+RtlInitializeBitMap(
+    _Out_ PRTL_BITMAP BitMapHeader,
+    _In_ __drv_aliasesMem PULONG BitMapBuffer,
+    _In_ ULONG SizeOfBitMap
+)
+{
+    BitMapHeader->SizeOfBitMap = SizeOfBitMap;
+    BitMapHeader->Buffer = BitMapBuffer;
+}
+
+/**
+ * @brief Clears every bit in the bitmap
+ *
+ * @param[in,out] BitMapHeader Pointer to an initialized RTL_BITMAP
+ */
+static __forceinline
+void
+RtlClearAllBits(
+    _Inout_ PRTL_BITMAP BitMapHeader
+)
+{
+    RtlZeroMemory(BitMapHeader->Buffer, RtlpBitMapUlongCount(BitMapHeader) * sizeof(ULONG));
+}
+
+/**
+ * @brief Sets every bit in the bitmap
+ *
+ * @param[in,out] BitMapHeader Pointer to an initialized RTL_BITMAP
+ */
+static __forceinline
+void
+RtlSetAllBits(
+    _Inout_ PRTL_BITMAP BitMapHeader
+)
+{
+    RtlFillMemory(BitMapHeader->Buffer, RtlpBitMapUlongCount(BitMapHeader) * sizeof(ULONG), 0xFF);
+}
+
+/**
+ * @brief Returns the state of a single bit
+ *
+ * @param[in] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @param[in] BitNumber Zero-based index of the bit, must be less than SizeOfBitMap
+ * @return TRUE if the bit is set, FALSE otherwise
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+RtlTestBit(
+    _In_ const RTL_BITMAP* BitMapHeader,
+    _In_ ULONG BitNumber
+)
+{
+    return (BOOLEAN)((BitMapHeader->Buffer[BitNumber / 32] >> (BitNumber % 32)) & 1);
+}
+
+/**
+ * @brief Sets a contiguous range of bits
+ *
+ * @param[in,out] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @param[in] StartingIndex Index of the first bit to set
+ * @param[in] NumberToSet Number of bits to set
+ * @note The range must lie within the bitmap
+ */
+static __forceinline
+void
+RtlSetBits(
+    _Inout_ PRTL_BITMAP BitMapHeader,
+    _In_ ULONG StartingIndex,
+    _In_ ULONG NumberToSet
+)
+{
+    PULONG Word = BitMapHeader->Buffer + StartingIndex / 32;
+    ULONG const Offset = StartingIndex % 32;
+
+    if (NumberToSet == 0) {
+        return;
+    }
+
+    // Range contained in a single ULONG
+    if (Offset + NumberToSet <= 32) {
+        *Word |= (0xFFFFFFFFUL >> (32 - NumberToSet)) << Offset;
+        return;
+    }
+
+    if (Offset != 0) {
+        *Word++ |= 0xFFFFFFFFUL << Offset;
+        NumberToSet -= 32 - Offset;
+    }
+
+    RtlFillMemory(Word, (NumberToSet / 32) * sizeof(ULONG), 0xFF);
+    Word += NumberToSet / 32;
+
+    if (NumberToSet % 32 != 0) {
+        *Word |= 0xFFFFFFFFUL >> (32 - NumberToSet % 32);
+    }
+}
+
+/**
+ * @brief Clears a contiguous range of bits
+ *
+ * @param[in,out] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @param[in] StartingIndex Index of the first bit to clear
+ * @param[in] NumberToClear Number of bits to clear
+ * @note The range must lie within the bitmap
+ */
+static __forceinline
+void
+RtlClearBits(
+    _Inout_ PRTL_BITMAP BitMapHeader,
+    _In_ ULONG StartingIndex,
+    _In_ ULONG NumberToClear
+)
+{
+    PULONG Word = BitMapHeader->Buffer + StartingIndex / 32;
+    ULONG const Offset = StartingIndex % 32;
+
+    if (NumberToClear == 0) {
+        return;
+    }
+
+    // Range contained in a single ULONG
+    if (Offset + NumberToClear <= 32) {
+        *Word &= ~((0xFFFFFFFFUL >> (32 - NumberToClear)) << Offset);
+        return;
+    }
+
+    if (Offset != 0) {
+        *Word++ &= ~(0xFFFFFFFFUL << Offset);
+        NumberToClear -= 32 - Offset;
+    }
+
+    RtlZeroMemory(Word, (NumberToClear / 32) * sizeof(ULONG));
+    Word += NumberToClear / 32;
+
+    if (NumberToClear % 32 != 0) {
+        *Word &= ~(0xFFFFFFFFUL >> (32 - NumberToClear % 32));
+    }
+}
+
+/**
+ * @brief Checks whether every bit in a range is clear
+ *
+ * @param[in] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @param[in] StartingIndex Index of the first bit to check
+ * @param[in] Length Number of bits to check
+ * @return TRUE if the range lies within the bitmap and all of its bits are clear
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+RtlAreBitsClear(
+    _In_ const RTL_BITMAP* BitMapHeader,
+    _In_ ULONG StartingIndex,
+    _In_ ULONG Length
+)
+{
+    if (Length == 0 || StartingIndex >= BitMapHeader->SizeOfBitMap ||
+        Length > BitMapHeader->SizeOfBitMap - StartingIndex) {
+        return FALSE;
+    }
+    return (BOOLEAN)(RtlpBitMapFindClearRun(BitMapHeader, Length, StartingIndex, StartingIndex + Length) == StartingIndex);
+}
+
+/**
+ * @brief Checks whether every bit in a range is set
+ *
+ * @param[in] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @param[in] StartingIndex Index of the first bit to check
+ * @param[in] Length Number of bits to check
+ * @return TRUE if the range lies within the bitmap and all of its bits are set
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+RtlAreBitsSet(
+    _In_ const RTL_BITMAP* BitMapHeader,
+    _In_ ULONG StartingIndex,
+    _In_ ULONG Length
+)
+{
+    ULONG WordIndex;
+    ULONG const End = StartingIndex + Length;
+
+    if (Length == 0 || StartingIndex >= BitMapHeader->SizeOfBitMap ||
+        Length > BitMapHeader->SizeOfBitMap - StartingIndex) {
+        return FALSE;
+    }
+
+    for (WordIndex = StartingIndex / 64; WordIndex < (End + 63) / 64; WordIndex++) {
+        if (~RtlpBitMapReadWord(BitMapHeader, WordIndex) & RtlpBitMapRangeMask(WordIndex, StartingIndex, End)) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Counts the set bits in the bitmap
+ *
+ * @param[in] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @return Number of bits that are set
+ */
+_Must_inspect_result_
+static __forceinline
+ULONG
+RtlNumberOfSetBits(
+    _In_ const RTL_BITMAP* BitMapHeader
+)
+{
+    ULONG const FullUlongs = BitMapHeader->SizeOfBitMap / 32;
+    ULONG const Remainder = BitMapHeader->SizeOfBitMap % 32;
+    const ULONG* const Buffer = BitMapHeader->Buffer;
+    ULONG Index;
+    ULONG Count = 0;
+
+    for (Index = 0; Index + 2 <= FullUlongs; Index += 2) {
+        Count += RtlpBitMapPopCount(Buffer[Index] | ((ULONG64)Buffer[Index + 1] << 32));
+    }
+    if (Index < FullUlongs) {
+        Count += RtlpBitMapPopCount(Buffer[Index++]);
+    }
+    // Ignore the bits past the end of the bitmap in the last ULONG
+    if (Remainder != 0) {
+        Count += RtlpBitMapPopCount(Buffer[Index] & ((1UL << Remainder) - 1));
+    }
+    return Count;
+}
+
+/**
+ * @brief Counts the clear bits in the bitmap
+ *
+ * @param[in] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @return Number of bits that are clear
+ */
+_Must_inspect_result_
+static __forceinline
+ULONG
+RtlNumberOfClearBits(
+    _In_ const RTL_BITMAP* BitMapHeader
+)
+{
+    return BitMapHeader->SizeOfBitMap - RtlNumberOfSetBits(BitMapHeader);
+}
+
+/**
+ * @brief Searches for a run of clear bits
+ *
+ * The search starts at HintIndex and wraps around to the beginning of the
+ * bitmap, so the first run at or after the hint is preferred.
+ *
+ * @param[in] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @param[in] NumberToFind Length of the run to find
+ * @param[in] HintIndex Index at which to begin the search
+ * @return Index of the first bit of the run, or RTL_BITMAP_NOT_FOUND (0xFFFFFFFF)
+ */
+_Must_inspect_result_
+static __forceinline
+ULONG
+RtlFindClearBits(
+    _In_ const RTL_BITMAP* BitMapHeader,
+    _In_ ULONG NumberToFind,
+    _In_ ULONG HintIndex
+)
+{
+    ULONG const Size = BitMapHeader->SizeOfBitMap;
+    ULONG Index;
+
+    if (NumberToFind > Size) {
+        return RTL_BITMAP_NOT_FOUND;
+    }
+    if (HintIndex >= Size) {
+        HintIndex = 0;
+    }
+    // Matches the kernel: a zero-length request returns the hint rounded down to a byte
+    if (NumberToFind == 0) {
+        return HintIndex & ~7UL;
+    }
+
+    Index = RtlpBitMapFindClearRun(BitMapHeader, NumberToFind, HintIndex, Size);
+    if (Index == RTL_BITMAP_NOT_FOUND && HintIndex != 0) {
+        // Wrap around; the second pass may overlap the hint by NumberToFind - 1 bits
+        ULONG const End = (HintIndex > Size - (NumberToFind - 1)) ? Size : HintIndex + NumberToFind - 1;
+        Index = RtlpBitMapFindClearRun(BitMapHeader, NumberToFind, 0, End);
+    }
+    return Index;
+}
+
+/**
+ * @brief Searches for a run of clear bits and sets them
+ *
+ * @param[in,out] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @param[in] NumberToFind Length of the run to find
+ * @param[in] HintIndex Index at which to begin the search
+ * @return Index of the first bit of the run, or RTL_BITMAP_NOT_FOUND (0xFFFFFFFF)
+ * @note Not atomic; callers sharing a bitmap between threads must serialize access
+ */
+_Must_inspect_result_
+static __forceinline
+ULONG
+RtlFindClearBitsAndSet(
+    _Inout_ PRTL_BITMAP BitMapHeader,
+    _In_ ULONG NumberToFind,
+    _In_ ULONG HintIndex
+)
+{
+    ULONG const Index = RtlFindClearBits(BitMapHeader, NumberToFind, HintIndex);
+
+    if (Index != RTL_BITMAP_NOT_FOUND) {
+        RtlSetBits(BitMapHeader, Index, NumberToFind);
+    }
+    return Index;
+}
+
+/**
+ * @brief Finds the longest run of clear bits in the bitmap
+ *
+ * @param[in] BitMapHeader Pointer to an initialized RTL_BITMAP
+ * @param[out] StartingIndex Receives the index of the first bit of the run
+ * @return Length of the run, or 0 if every bit is set (StartingIndex is then 0)
+ * @note If several runs share the maximum length, the lowest one is returned
+ */
+static __forceinline
+ULONG
+RtlFindLongestRunClear(
+    _In_ const RTL_BITMAP* BitMapHeader,
+    _Out_ PULONG StartingIndex
+)
+{
+    ULONG const Size = BitMapHeader->SizeOfBitMap;
+    ULONG const WordCount = (Size + 63) / 64;
+    ULONG WordIndex;
+    ULONG RunStart = 0;
+    ULONG RunLength = 0;
+    ULONG BestStart = 0;
+    ULONG BestLength = 0;
+
+    for (WordIndex = 0; WordIndex < WordCount; WordIndex++) {
+        ULONG const Base = WordIndex * 64;
+        ULONG64 Clear;
+        ULONG Position;
+
+        Clear = ~RtlpBitMapReadWord(BitMapHeader, WordIndex);
+        if (Size - Base < 64) {
+            Clear &= RtlpBitMapRangeMask(WordIndex, 0, Size);
+        }
+
+        if (Clear == ~0ULL) {
+            ULONG Skipped;
+            if (RunLength == 0) {
+                RunStart = Base;
+            }
+            Skipped = RtlpBitMapSkipUniformBlocks(BitMapHeader, WordIndex + 1, Size, TRUE, MAXDWORD);
+            RunLength += 64 + Skipped;
+            WordIndex += Skipped / 64;
+            continue;
+        }
+
+        // Close the run carried over from the previous word
+        Position = RtlpBitMapLowestSetBit(~Clear);
+        if (RunLength != 0 || Position != 0) {
+            if (RunLength == 0) {
+                RunStart = Base;
+            }
+            RunLength += Position;
+            if (RunLength > BestLength) {
+                BestLength = RunLength;
+                BestStart = RunStart;
+            }
+        }
+        RunLength = 0;
+
+        if (Clear == 0) {
+            // Fully used; skip any following used blocks wholesale
+            WordIndex += RtlpBitMapSkipUniformBlocks(BitMapHeader, WordIndex + 1, Size, FALSE, MAXDWORD) / 64;
+            continue;
+        }
+
+        // Walk the remaining runs inside the word
+        while (Position < 64) {
+            ULONG64 const Remaining = Clear >> Position;
+            ULONG Length;
+
+            if (Remaining == 0) {
+                break;
+            }
+            Position += RtlpBitMapLowestSetBit(Remaining);
+            Length = (~(Clear >> Position) == 0) ? 64 - Position : RtlpBitMapLowestSetBit(~(Clear >> Position));
+
+            if (Position + Length == 64) {
+                // Run reaches the top of the word and may continue into the next one
+                RunStart = Base + Position;
+                RunLength = Length;
+                break;
+            }
+            if (Length > BestLength) {
+                BestLength = Length;
+                BestStart = Base + Position;
+            }
+            Position += Length;
+        }
+    }
+
+    if (RunLength > BestLength) {
+        BestLength = RunLength;
+        BestStart = RunStart;
+    }
+
+    *StartingIndex = BestStart;
+    return BestLength;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_BITMAP_H_ */
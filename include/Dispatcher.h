@@ -0,0 +1,760 @@
+/**
+ * @file Dispatcher.h
+ * @brief Dispatcher objects (KEVENT, KSEMAPHORE) and the KeWaitFor* routines
+ *
+ * Every dispatcher object starts with a DISPATCHER_HEADER holding its signal
+ * state, a count of registered waiters and a list of wait blocks. Signaling
+ * and consuming the state are single interlocked operations on SignalState,
+ * so setting, resetting or releasing an object that nobody waits on never
+ * enters the OS.
+ *
+ * A waiter first tries to satisfy the wait directly, then spins for
+ * DISPATCHER_SPIN_COUNT rounds. After that it links one KWAIT_BLOCK into the
+ * wait list of each object and sleeps with WaitOnAddress on a wake counter
+ * that lives on its own stack. A signaler that finds registered waiters bumps
+ * the wake counters of as many of them, oldest first, as the signal can
+ * satisfy: one for a synchronization event or timer, the release count for a
+ * semaphore, and all of them for a notification object. WaitAll waiters are
+ * woken without counting against that budget, since they may be unable to
+ * consume the signal.
+ *
+ * A woken waiter may still leave without consuming the signal it was woken
+ * for: it times out, another of its objects satisfies it first, or two
+ * signals picked the same waiter. So every waiter, once unlinked, hands off
+ * any signal still left on its objects by waking one more waiter there. A
+ * waiter that loses the race for the state to a thread that never slept
+ * goes back to sleep; the signal was consumed, so nothing is lost.
+ *
+ * Waits are not alertable and there are no APCs; Alertable and WaitMode are
+ * accepted for source compatibility and ignored.
+ */
+
+#ifndef WINKERNEL_DISPATCHER_H_
+#define WINKERNEL_DISPATCHER_H_
+
+#include <Windows.h>
+#include "LinkedList.h"
+#include "NtStatus.h"
+
+#if defined(_MSC_VER)
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of failed attempts a wait spins through before sleeping */
+#define DISPATCHER_SPIN_COUNT 64
+
+/* Number of waiters a signal wakes after dropping the wait list lock */
+#define DISPATCHER_WAKE_BATCH 8
+
+/* Wake budget of a signal that every waiter may consume, as for notification objects */
+#define DISPATCHER_WAKE_ALL MAXLONG
+
+/* Number of wait blocks a wait provides itself; more need a WaitBlockArray */
+#define THREAD_WAIT_OBJECTS 3
+
+#ifndef MAXIMUM_WAIT_OBJECTS
+#define MAXIMUM_WAIT_OBJECTS 64
+#endif
+
+/* Priority boost argument of the signal routines; accepted and ignored */
+#define IO_NO_INCREMENT 0
+
+typedef LONG KPRIORITY;
+typedef CCHAR KPROCESSOR_MODE;
+
+typedef enum _MODE {
+    KernelMode,
+    UserMode,
+    MaximumMode
+} MODE;
+
+typedef enum _EVENT_TYPE {
+    NotificationEvent,      /**< Stays signaled until reset; releases every waiter */
+    SynchronizationEvent    /**< Auto-reset; each signal releases one waiter */
+} EVENT_TYPE;
+
+typedef enum _WAIT_TYPE {
+    WaitAll,
+    WaitAny
+} WAIT_TYPE;
+
+typedef enum _KWAIT_REASON {
+    Executive = 0,
+    UserRequest = 6,
+    MaximumWaitReason = 37
+} KWAIT_REASON;
+
+/**
+ * @brief Dispatcher object types, numbered as in the kernel
+ */
+typedef enum _KOBJECTS {
+    EventNotificationObject = 0,
+    EventSynchronizationObject = 1,
+    SemaphoreObject = 5,
+    TimerNotificationObject = 8,
+    TimerSynchronizationObject = 9
+} KOBJECTS;
+
+/**
+ * @brief Common header of every dispatcher object
+ */
+typedef struct _DISPATCHER_HEADER {
+    UCHAR Type;                     /**< One of KOBJECTS */
+    volatile LONG SignalState;      /**< Positive while signaled; the count for semaphores */
+    volatile LONG WaiterCount;      /**< Number of wait blocks in WaitListHead */
+    volatile LONG WaitListLock;     /**< Spin lock protecting WaitListHead */
+    LIST_ENTRY WaitListHead;        /**< KWAIT_BLOCK entries of sleeping waiters */
+} DISPATCHER_HEADER, *PDISPATCHER_HEADER;
+
+/**
+ * @brief Event object
+ */
+typedef struct _KEVENT {
+    DISPATCHER_HEADER Header;
+} KEVENT, *PKEVENT, *PRKEVENT;
+
+/**
+ * @brief Counting semaphore object
+ */
+typedef struct _KSEMAPHORE {
+    DISPATCHER_HEADER Header;
+    LONG Limit;                     /**< Largest count the semaphore may reach */
+} KSEMAPHORE, *PKSEMAPHORE, *PRKSEMAPHORE;
+
+/*
+ * Per-wait state shared by all wait blocks of one wait. Signalers increment
+ * WakeCount and wake the address; the waiter sleeps on it.
+ */
+typedef struct _KWAIT_CONTEXT {
+    volatile LONG WakeCount;
+} KWAIT_CONTEXT, *PKWAIT_CONTEXT;
+
+/**
+ * @brief Links one waiting thread into the wait list of one object
+ */
+typedef struct _KWAIT_BLOCK {
+    LIST_ENTRY WaitListEntry;
+    PKWAIT_CONTEXT Context;
+    PDISPATCHER_HEADER Object;
+    USHORT WaitKey;                 /**< Index of Object in the wait's object array */
+    UCHAR WaitType;                 /**< WaitAny or WaitAll */
+} KWAIT_BLOCK, *PKWAIT_BLOCK;
+
+static __forceinline
+VOID
+KiInitializeDispatcherHeader(
+    _Out_ PDISPATCHER_HEADER Header,
+    _In_ UCHAR Type,
+    _In_ LONG SignalState
+)
+{
+    Header->Type = Type;
+    Header->SignalState = SignalState;
+    Header->WaiterCount = 0;
+    Header->WaitListLock = 0;
+    InitializeListHead(&Header->WaitListHead);
+}
+
+static __forceinline
+VOID
+KiAcquireWaitListLock(
+    _Inout_ PDISPATCHER_HEADER Header
+)
+{
+    ULONG Spin = 0;
+
+    while (InterlockedExchange(&Header->WaitListLock, 1) != 0) {
+        while (ReadNoFence(&Header->WaitListLock) != 0) {
+            /* The holder may have been preempted; give it the processor */
+            if (++Spin % DISPATCHER_SPIN_COUNT == 0) {
+                SwitchToThread();
+            } else {
+                YieldProcessor();
+            }
+        }
+    }
+}
+
+static __forceinline
+VOID
+KiReleaseWaitListLock(
+    _Inout_ PDISPATCHER_HEADER Header
+)
+{
+    WriteRelease(&Header->WaitListLock, 0);
+}
+
+/*
+ * Wakes the oldest threads registered on the object, up to Budget WaitAny
+ * waiters plus every WaitAll waiter met on the way. The full barrier orders
+ * the caller's state change before the waiter check; a waiter increments
+ * WaiterCount before it re-checks the state, so either it sees the new state
+ * or it is counted here.
+ *
+ * The wake counters are bumped under the wait list lock, but the wake calls
+ * are made after releasing it where possible: a woken waiter immediately
+ * takes the lock to unlink itself and would otherwise spin on it. Once the
+ * lock is dropped a waiter may already have returned, which is harmless
+ * because waking an address never dereferences it.
+ */
+static __forceinline
+VOID
+KiWakeWaiters(
+    _Inout_ PDISPATCHER_HEADER Header,
+    _In_ LONG Budget
+)
+{
+    PVOID Addresses[DISPATCHER_WAKE_BATCH];
+    ULONG Batched = 0;
+    PLIST_ENTRY Entry;
+    ULONG i;
+
+    MemoryBarrier();
+    if (ReadNoFence(&Header->WaiterCount) == 0) {
+        return;
+    }
+
+    KiAcquireWaitListLock(Header);
+    for (Entry = Header->WaitListHead.Flink;
+         Entry != &Header->WaitListHead && Budget > 0;
+         Entry = Entry->Flink) {
+        PKWAIT_BLOCK WaitBlock = CONTAINING_RECORD(Entry, KWAIT_BLOCK, WaitListEntry);
+
+        if (WaitBlock->WaitType == WaitAny) {
+            Budget--;
+        }
+        InterlockedIncrement(&WaitBlock->Context->WakeCount);
+        if (Batched < DISPATCHER_WAKE_BATCH) {
+            Addresses[Batched++] = (PVOID)&WaitBlock->Context->WakeCount;
+        } else {
+            WakeByAddressSingle((PVOID)&WaitBlock->Context->WakeCount);
+        }
+    }
+    KiReleaseWaitListLock(Header);
+
+    for (i = 0; i < Batched; i++) {
+        WakeByAddressSingle(Addresses[i]);
+    }
+}
+
+static __forceinline
+BOOLEAN
+KiIsObjectSignaled(
+    _In_ PDISPATCHER_HEADER Header
+)
+{
+    return ReadAcquire(&Header->SignalState) > 0;
+}
+
+/*
+ * Number of waiters one signal of the object can satisfy: synchronization
+ * objects are consumed by the first waiter, notification objects by none.
+ * A semaphore can satisfy as many waiters as its count.
+ */
+static __forceinline
+LONG
+KiSignalWakeBudget(
+    _In_ PDISPATCHER_HEADER Header
+)
+{
+    switch (Header->Type) {
+    case EventSynchronizationObject:
+    case TimerSynchronizationObject:
+        return 1;
+
+    case SemaphoreObject:
+        return ReadNoFence(&Header->SignalState);
+
+    default:
+        return DISPATCHER_WAKE_ALL;
+    }
+}
+
+/*
+ * Satisfies a wait on one object if it is signaled, consuming the signal
+ * for synchronization events and timers and one unit of count for semaphores.
+ */
+static __forceinline
+BOOLEAN
+KiTryAcquireObject(
+    _Inout_ PDISPATCHER_HEADER Header
+)
+{
+    LONG State;
+
+    switch (Header->Type) {
+    case EventSynchronizationObject:
+    case TimerSynchronizationObject:
+        return ReadNoFence(&Header->SignalState) > 0 &&
+               InterlockedCompareExchange(&Header->SignalState, 0, 1) == 1;
+
+    case SemaphoreObject:
+        State = ReadNoFence(&Header->SignalState);
+        while (State > 0) {
+            LONG Observed = InterlockedCompareExchange(&Header->SignalState, State - 1, State);
+            if (Observed == State) {
+                return TRUE;
+            }
+            State = Observed;
+        }
+        return FALSE;
+
+    default:
+        return KiIsObjectSignaled(Header);
+    }
+}
+
+/* Gives back what KiTryAcquireObject consumed */
+static __forceinline
+VOID
+KiUndoAcquireObject(
+    _Inout_ PDISPATCHER_HEADER Header
+)
+{
+    switch (Header->Type) {
+    case EventSynchronizationObject:
+    case TimerSynchronizationObject:
+        InterlockedExchange(&Header->SignalState, 1);
+        KiWakeWaiters(Header, 1);
+        break;
+
+    case SemaphoreObject:
+        InterlockedIncrement(&Header->SignalState);
+        KiWakeWaiters(Header, 1);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*
+ * Tries to satisfy the whole wait once. For WaitAny *Index receives the
+ * index of the object that satisfied it. For WaitAll every object must be
+ * signaled; the objects are consumed in order and rolled back if one of them
+ * was taken by another thread in between.
+ */
+static __forceinline
+BOOLEAN
+KiTrySatisfyWait(
+    _In_ ULONG Count,
+    _In_reads_(Count) PDISPATCHER_HEADER Objects[],
+    _In_ WAIT_TYPE WaitType,
+    _Out_ PULONG Index
+)
+{
+    ULONG i;
+
+    *Index = 0;
+
+    if (WaitType == WaitAny) {
+        for (i = 0; i < Count; i++) {
+            if (KiTryAcquireObject(Objects[i])) {
+                *Index = i;
+                return TRUE;
+            }
+        }
+        return FALSE;
+    }
+
+    for (i = 0; i < Count; i++) {
+        if (!KiIsObjectSignaled(Objects[i])) {
+            return FALSE;
+        }
+    }
+    for (i = 0; i < Count; i++) {
+        if (!KiTryAcquireObject(Objects[i])) {
+            while (i-- > 0) {
+                KiUndoAcquireObject(Objects[i]);
+            }
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Converts a kernel-style timeout into a GetTickCount64 deadline. NULL waits
+ * forever (*Infinite is set); a negative value is relative and a positive
+ * value is an absolute system time, both in 100-nanosecond units.
+ */
+static __forceinline
+VOID
+KiComputeWaitDeadline(
+    _In_opt_ PLARGE_INTEGER Timeout,
+    _Out_ PBOOLEAN Infinite,
+    _Out_ PULONGLONG Deadline
+)
+{
+    LONGLONG Interval;
+
+    *Infinite = (Timeout == NULL);
+    *Deadline = 0;
+    if (Timeout == NULL) {
+        return;
+    }
+
+    if (Timeout->QuadPart < 0) {
+        Interval = -Timeout->QuadPart;
+    } else {
+        FILETIME Now;
+        LARGE_INTEGER SystemTime;
+
+        GetSystemTimeAsFileTime(&Now);
+        SystemTime.LowPart = Now.dwLowDateTime;
+        SystemTime.HighPart = (LONG)Now.dwHighDateTime;
+        Interval = Timeout->QuadPart - SystemTime.QuadPart;
+        if (Interval < 0) {
+            Interval = 0;
+        }
+    }
+
+    /* Round up so that a wait never ends before the requested interval */
+    *Deadline = GetTickCount64() + (ULONGLONG)((Interval + 9999) / 10000);
+}
+
+/**
+ * @brief Initializes an event
+ *
+ * @param[out] Event Pointer to the event
+ * @param[in] Type NotificationEvent or SynchronizationEvent
+ * @param[in] State TRUE to start signaled
+ */
+static __forceinline
+VOID
+KeInitializeEvent(
+    _Out_ PRKEVENT Event,
+    _In_ EVENT_TYPE Type,
+    _In_ BOOLEAN State
+)
+{
+    KiInitializeDispatcherHeader(&Event->Header,
+                                 (UCHAR)(Type == NotificationEvent ? EventNotificationObject
+                                                                   : EventSynchronizationObject),
+                                 State ? 1 : 0);
+}
+
+/**
+ * @brief Sets an event to the signaled state
+ *
+ * A notification event releases every waiter and stays signaled. A
+ * synchronization event releases one waiter, which resets it. Setting an
+ * event nobody waits on is one interlocked operation, or none if it is
+ * already signaled.
+ *
+ * @param[in,out] Event Pointer to the event
+ * @param[in] Increment Priority boost; ignored
+ * @param[in] Wait Kernel hint that a wait follows; ignored
+ * @return Previous state, nonzero if the event was signaled
+ */
+static __forceinline
+LONG
+KeSetEvent(
+    _Inout_ PRKEVENT Event,
+    _In_ KPRIORITY Increment,
+    _In_ BOOLEAN Wait
+)
+{
+    LONG Previous;
+
+    UNREFERENCED_PARAMETER(Increment);
+    UNREFERENCED_PARAMETER(Wait);
+
+    if (ReadNoFence(&Event->Header.SignalState) != 0) {
+        return 1;
+    }
+
+    Previous = InterlockedExchange(&Event->Header.SignalState, 1);
+    KiWakeWaiters(&Event->Header, KiSignalWakeBudget(&Event->Header));
+    return Previous;
+}
+
+/**
+ * @brief Sets an event to the not-signaled state
+ *
+ * @param[in,out] Event Pointer to the event
+ * @return Previous state, nonzero if the event was signaled
+ */
+static __forceinline
+LONG
+KeResetEvent(
+    _Inout_ PRKEVENT Event
+)
+{
+    return InterlockedExchange(&Event->Header.SignalState, 0);
+}
+
+/**
+ * @brief Sets an event to the not-signaled state without reporting the old one
+ *
+ * @param[in,out] Event Pointer to the event
+ */
+static __forceinline
+VOID
+KeClearEvent(
+    _Inout_ PRKEVENT Event
+)
+{
+    WriteRelease(&Event->Header.SignalState, 0);
+}
+
+/**
+ * @brief Returns the current state of an event
+ *
+ * @param[in] Event Pointer to the event
+ * @return Nonzero if the event is signaled
+ */
+static __forceinline
+LONG
+KeReadStateEvent(
+    _In_ PRKEVENT Event
+)
+{
+    return ReadAcquire(&Event->Header.SignalState);
+}
+
+/**
+ * @brief Initializes a semaphore
+ *
+ * @param[out] Semaphore Pointer to the semaphore
+ * @param[in] Count Initial count
+ * @param[in] Limit Largest count the semaphore may reach
+ */
+static __forceinline
+VOID
+KeInitializeSemaphore(
+    _Out_ PRKSEMAPHORE Semaphore,
+    _In_ LONG Count,
+    _In_ LONG Limit
+)
+{
+    KiInitializeDispatcherHeader(&Semaphore->Header, SemaphoreObject, Count);
+    Semaphore->Limit = Limit;
+}
+
+/**
+ * @brief Adds to the count of a semaphore, releasing up to that many waiters
+ *
+ * The kernel raises an exception when the count would pass the limit; here
+ * the count is left unchanged and -1 is returned instead.
+ *
+ * @param[in,out] Semaphore Pointer to the semaphore
+ * @param[in] Increment Priority boost; ignored
+ * @param[in] Adjustment Amount to add; must be positive
+ * @param[in] Wait Kernel hint that a wait follows; ignored
+ * @return Previous count, or -1 if the release would exceed the limit
+ */
+static __forceinline
+LONG
+KeReleaseSemaphore(
+    _Inout_ PRKSEMAPHORE Semaphore,
+    _In_ KPRIORITY Increment,
+    _In_ LONG Adjustment,
+    _In_ BOOLEAN Wait
+)
+{
+    LONG State = ReadNoFence(&Semaphore->Header.SignalState);
+
+    UNREFERENCED_PARAMETER(Increment);
+    UNREFERENCED_PARAMETER(Wait);
+
+    for (;;) {
+        LONG Observed;
+
+        if (Adjustment <= 0 || State > Semaphore->Limit - Adjustment) {
+            return -1;
+        }
+        Observed = InterlockedCompareExchange(&Semaphore->Header.SignalState, State + Adjustment, State);
+        if (Observed == State) {
+            break;
+        }
+        State = Observed;
+    }
+
+    KiWakeWaiters(&Semaphore->Header, Adjustment);
+    return State;
+}
+
+/**
+ * @brief Returns the current count of a semaphore
+ *
+ * @param[in] Semaphore Pointer to the semaphore
+ * @return Current count
+ */
+static __forceinline
+LONG
+KeReadStateSemaphore(
+    _In_ PRKSEMAPHORE Semaphore
+)
+{
+    return ReadAcquire(&Semaphore->Header.SignalState);
+}
+
+/**
+ * @brief Waits until any or all of a set of dispatcher objects are signaled
+ *
+ * Satisfying the wait consumes the signal of a synchronization event and one
+ * unit of count of a semaphore. With WaitAll the objects must be distinct
+ * and are acquired together or not at all.
+ *
+ * @param[in] Count Number of objects, 1 to MAXIMUM_WAIT_OBJECTS
+ * @param[in] Object Array of pointers to KEVENT or KSEMAPHORE objects
+ * @param[in] WaitType WaitAny or WaitAll
+ * @param[in] WaitReason Reason for the wait; ignored
+ * @param[in] WaitMode KernelMode or UserMode; ignored
+ * @param[in] Alertable Must be FALSE; waits are never alerted
+ * @param[in] Timeout NULL to wait forever, zero to poll, negative for a
+ *            relative and positive for an absolute time, in 100ns units
+ * @param[out] WaitBlockArray Storage for Count wait blocks; required when
+ *             Count exceeds THREAD_WAIT_OBJECTS, otherwise may be NULL
+ * @return STATUS_WAIT_0 plus the index of the satisfying object for WaitAny,
+ *         STATUS_SUCCESS for WaitAll, STATUS_TIMEOUT if the timeout expired,
+ *         or STATUS_INVALID_PARAMETER
+ */
+static __forceinline
+NTSTATUS
+KeWaitForMultipleObjects(
+    _In_ ULONG Count,
+    _In_reads_(Count) PVOID Object[],
+    _In_ WAIT_TYPE WaitType,
+    _In_ KWAIT_REASON WaitReason,
+    _In_ KPROCESSOR_MODE WaitMode,
+    _In_ BOOLEAN Alertable,
+    _In_opt_ PLARGE_INTEGER Timeout,
+    _Out_writes_opt_(Count) PKWAIT_BLOCK WaitBlockArray
+)
+{
+    PDISPATCHER_HEADER* Objects = (PDISPATCHER_HEADER*)Object;
+    KWAIT_BLOCK LocalWaitBlocks[THREAD_WAIT_OBJECTS];
+    KWAIT_CONTEXT Context;
+    NTSTATUS Status;
+    BOOLEAN Infinite;
+    ULONGLONG Deadline;
+    ULONG Index;
+    ULONG Spin;
+    ULONG i;
+
+    UNREFERENCED_PARAMETER(WaitReason);
+    UNREFERENCED_PARAMETER(WaitMode);
+    UNREFERENCED_PARAMETER(Alertable);
+
+    if (Count == 0 || Count > MAXIMUM_WAIT_OBJECTS || Object == NULL ||
+        (WaitType != WaitAny && WaitType != WaitAll)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+    if (WaitBlockArray == NULL) {
+        if (Count > THREAD_WAIT_OBJECTS) {
+            return STATUS_INVALID_PARAMETER;
+        }
+        WaitBlockArray = LocalWaitBlocks;
+    }
+
+    if (KiTrySatisfyWait(Count, Objects, WaitType, &Index)) {
+        return WaitType == WaitAny ? STATUS_WAIT_0 + (NTSTATUS)Index : STATUS_SUCCESS;
+    }
+    if (Timeout != NULL && Timeout->QuadPart == 0) {
+        return STATUS_TIMEOUT;
+    }
+
+    KiComputeWaitDeadline(Timeout, &Infinite, &Deadline);
+
+    for (Spin = 0; Spin < DISPATCHER_SPIN_COUNT; Spin++) {
+        YieldProcessor();
+        if (KiTrySatisfyWait(Count, Objects, WaitType, &Index)) {
+            return WaitType == WaitAny ? STATUS_WAIT_0 + (NTSTATUS)Index : STATUS_SUCCESS;
+        }
+    }
+
+    /* Register on every object; the interlocked increment publishes the registration */
+    Context.WakeCount = 0;
+    for (i = 0; i < Count; i++) {
+        PKWAIT_BLOCK WaitBlock = &WaitBlockArray[i];
+
+        WaitBlock->Context = &Context;
+        WaitBlock->Object = Objects[i];
+        WaitBlock->WaitKey = (USHORT)i;
+        WaitBlock->WaitType = (UCHAR)WaitType;
+        KiAcquireWaitListLock(Objects[i]);
+        InsertTailList(&Objects[i]->WaitListHead, &WaitBlock->WaitListEntry);
+        KiReleaseWaitListLock(Objects[i]);
+        InterlockedIncrement(&Objects[i]->WaiterCount);
+    }
+
+    for (;;) {
+        LONG Snapshot = ReadAcquire(&Context.WakeCount);
+        DWORD Remaining = INFINITE;
+
+        if (KiTrySatisfyWait(Count, Objects, WaitType, &Index)) {
+            Status = WaitType == WaitAny ? STATUS_WAIT_0 + (NTSTATUS)Index : STATUS_SUCCESS;
+            break;
+        }
+
+        if (!Infinite) {
+            ULONGLONG Now = GetTickCount64();
+            if (Now >= Deadline) {
+                Status = STATUS_TIMEOUT;
+                break;
+            }
+            Remaining = (DWORD)(Deadline - Now);
+        }
+
+        WaitOnAddress(&Context.WakeCount, &Snapshot, sizeof(Snapshot), Remaining);
+    }
+
+    for (i = 0; i < Count; i++) {
+        PKWAIT_BLOCK WaitBlock = &WaitBlockArray[i];
+
+        InterlockedDecrement(&Objects[i]->WaiterCount);
+        KiAcquireWaitListLock(Objects[i]);
+        RemoveEntryList(&WaitBlock->WaitListEntry);
+        KiReleaseWaitListLock(Objects[i]);
+
+        /*
+         * A signal this wait was woken for but did not consume would
+         * otherwise strand the waiters behind it. Checked after unlinking, so
+         * a signaler that picked this wait block did so before the check.
+         */
+        if (KiIsObjectSignaled(Objects[i])) {
+            LONG Budget = KiSignalWakeBudget(Objects[i]);
+            if (Budget != DISPATCHER_WAKE_ALL) {
+                KiWakeWaiters(Objects[i], Budget);
+            }
+        }
+    }
+
+    return Status;
+}
+
+/**
+ * @brief Waits until a dispatcher object is signaled
+ *
+ * @param[in] Object Pointer to a KEVENT or KSEMAPHORE
+ * @param[in] WaitReason Reason for the wait; ignored
+ * @param[in] WaitMode KernelMode or UserMode; ignored
+ * @param[in] Alertable Must be FALSE; waits are never alerted
+ * @param[in] Timeout NULL to wait forever, zero to poll, negative for a
+ *            relative and positive for an absolute time, in 100ns units
+ * @return STATUS_SUCCESS, STATUS_TIMEOUT or STATUS_INVALID_PARAMETER
+ */
+static __forceinline
+NTSTATUS
+KeWaitForSingleObject(
+    _In_ PVOID Object,
+    _In_ KWAIT_REASON WaitReason,
+    _In_ KPROCESSOR_MODE WaitMode,
+    _In_ BOOLEAN Alertable,
+    _In_opt_ PLARGE_INTEGER Timeout
+)
+{
+    return KeWaitForMultipleObjects(1, &Object, WaitAny, WaitReason, WaitMode, Alertable, Timeout, NULL);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_DISPATCHER_H_ */
@@ -0,0 +1,485 @@
+/**
+ * @file Dpc.h
+ * @brief Deferred procedure calls (KDPC) run from per-processor queues
+ *
+ * A KDPC is embedded by the caller in its own structure and queued with
+ * KeInsertQueueDpc, which never allocates. A KDPC_QUEUE keeps one KDPC_DATA
+ * per processor, each on its own cache lines and drained by its own worker
+ * thread, affinitized to that processor when there is one per processor. A
+ * DPC goes to the queue of the processor the inserting thread runs on unless
+ * KeSetTargetProcessorDpc chose one, so insertion and execution normally stay
+ * on one processor and the queues do not share cache lines.
+ *
+ * Each queue is two lock-free stacks: a push is one compare-exchange, and the
+ * worker takes a whole stack with one exchange and reverses it to run the
+ * DPCs in insertion order. HighImportance DPCs use the second stack, which
+ * the worker drains first. A DPC that is already queued is not queued again;
+ * its DpcData field records the queue it is on until the worker takes it off
+ * to run it, so the DPC may be queued again from its own routine.
+ *
+ * An idle worker spins for KDPC_SPIN_COUNT rounds and then sleeps with
+ * WaitOnAddress; an insertion wakes it only if it is asleep.
+ *
+ * Unlike the kernel, which has one DPC queue per processor system-wide, a
+ * caller creates and owns each KDPC_QUEUE and passes it to KeInsertQueueDpc.
+ * DPC routines run on ordinary threads and may block.
+ */
+
+#ifndef WINKERNEL_DPC_H_
+#define WINKERNEL_DPC_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "NtStatus.h"
+
+#if defined(_MSC_VER)
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Rounds an idle worker checks its queue before it sleeps */
+#define KDPC_SPIN_COUNT 64
+
+/* Upper bound on the number of per-processor queues */
+#define KDPC_MAX_PROCESSORS 256
+
+/* Number of a DPC that runs on the processor it is queued from */
+#define KDPC_CURRENT_PROCESSOR ((USHORT)0xFFFF)
+
+typedef enum _KDPC_IMPORTANCE {
+    LowImportance,
+    MediumImportance,
+    HighImportance,         /**< Runs before the DPCs queued at other importances */
+    MediumHighImportance
+} KDPC_IMPORTANCE;
+
+struct _KDPC;
+
+typedef VOID (*PKDEFERRED_ROUTINE)(
+    _In_ struct _KDPC* Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2
+);
+
+/**
+ * @brief Deferred procedure call, embedded by the caller
+ */
+typedef struct _KDPC {
+    UCHAR Importance;                   /**< One of KDPC_IMPORTANCE */
+    USHORT Number;                      /**< Target processor, or KDPC_CURRENT_PROCESSOR */
+    SINGLE_LIST_ENTRY DpcListEntry;     /**< Link in a queue while queued */
+    PKDEFERRED_ROUTINE DeferredRoutine;
+    PVOID DeferredContext;
+    PVOID SystemArgument1;              /**< Set by KeInsertQueueDpc */
+    PVOID SystemArgument2;              /**< Set by KeInsertQueueDpc */
+    PVOID volatile DpcData;             /**< Queue the DPC is on, NULL while not queued */
+} KDPC, *PKDPC, *PRKDPC;
+
+struct _KDPC_QUEUE;
+
+/**
+ * @brief DPC queue of one processor and the state of its worker
+ *
+ * Inserters write the list heads and IdleSignal; the worker writes Idle and
+ * Completed, so the two groups live on separate cache lines.
+ */
+typedef struct _KDPC_DATA {
+    DECLSPEC_CACHEALIGN PSINGLE_LIST_ENTRY volatile DpcListHead;    /**< Medium and low importance */
+    PSINGLE_LIST_ENTRY volatile UrgentListHead;                     /**< High importance */
+    volatile LONG64 Inserted;                   /**< DPCs queued here */
+    volatile LONG IdleSignal;                   /**< Bumped to wake a sleeping worker */
+    DECLSPEC_CACHEALIGN volatile LONG Idle;     /**< Set while the worker is about to sleep or asleep */
+    volatile LONG64 Completed;                  /**< DPCs run from this queue */
+    struct _KDPC_QUEUE* DpcQueue;               /**< Owning queue */
+    HANDLE Thread;                              /**< Worker thread */
+} KDPC_DATA, *PKDPC_DATA;
+
+/**
+ * @brief Set of per-processor DPC queues
+ */
+typedef struct _KDPC_QUEUE {
+    PKDPC_DATA Processors;              /**< ProcessorCount queues, cache aligned */
+    PVOID ProcessorsAllocation;         /**< Pool block holding Processors */
+    ULONG ProcessorCount;
+    volatile LONG FlushWaiters;         /**< Threads inside KeFlushQueuedDpcs */
+    volatile LONG Terminating;          /**< Set by KeRundownDpcQueue */
+} KDPC_QUEUE, *PKDPC_QUEUE;
+
+/**
+ * @brief Initializes a DPC
+ *
+ * The DPC runs on the processor it is queued from, at medium importance,
+ * until KeSetTargetProcessorDpc or KeSetImportanceDpc change that.
+ *
+ * @param[out] Dpc Pointer to the DPC
+ * @param[in] DeferredRoutine Routine to run
+ * @param[in] DeferredContext Passed to DeferredRoutine
+ */
+static __forceinline
+VOID
+KeInitializeDpc(
+    _Out_ PRKDPC Dpc,
+    _In_ PKDEFERRED_ROUTINE DeferredRoutine,
+    _In_opt_ PVOID DeferredContext
+)
+{
+    Dpc->Importance = MediumImportance;
+    Dpc->Number = KDPC_CURRENT_PROCESSOR;
+    Dpc->DpcListEntry.Next = NULL;
+    Dpc->DeferredRoutine = DeferredRoutine;
+    Dpc->DeferredContext = DeferredContext;
+    Dpc->SystemArgument1 = NULL;
+    Dpc->SystemArgument2 = NULL;
+    Dpc->DpcData = NULL;
+}
+
+/**
+ * @brief Sets the processor whose queue a DPC is inserted into
+ *
+ * A number past the last queue wraps around.
+ *
+ * @param[in,out] Dpc Pointer to a DPC that is not queued
+ * @param[in] Number Zero-based processor number
+ */
+static __forceinline
+VOID
+KeSetTargetProcessorDpc(
+    _Inout_ PRKDPC Dpc,
+    _In_ CCHAR Number
+)
+{
+    Dpc->Number = (USHORT)(UCHAR)Number;
+}
+
+/**
+ * @brief Sets the importance of a DPC
+ *
+ * @param[in,out] Dpc Pointer to a DPC that is not queued
+ * @param[in] Importance HighImportance DPCs run ahead of the others
+ */
+static __forceinline
+VOID
+KeSetImportanceDpc(
+    _Inout_ PRKDPC Dpc,
+    _In_ KDPC_IMPORTANCE Importance
+)
+{
+    Dpc->Importance = (UCHAR)Importance;
+}
+
+static __forceinline
+VOID
+KiPushDpcList(
+    _Inout_ PSINGLE_LIST_ENTRY volatile* ListHead,
+    _Inout_ PSINGLE_LIST_ENTRY Entry
+)
+{
+    PSINGLE_LIST_ENTRY Head = (PSINGLE_LIST_ENTRY)ReadPointerNoFence((PVOID volatile*)ListHead);
+
+    for (;;) {
+        PSINGLE_LIST_ENTRY Observed;
+
+        Entry->Next = Head;
+        Observed = (PSINGLE_LIST_ENTRY)InterlockedCompareExchangePointer((PVOID volatile*)ListHead, Entry, Head);
+        if (Observed == Head) {
+            return;
+        }
+        Head = Observed;
+    }
+}
+
+/*
+ * Takes a whole stack and returns its entries oldest first.
+ */
+static __forceinline
+PSINGLE_LIST_ENTRY
+KiTakeDpcList(
+    _Inout_ PSINGLE_LIST_ENTRY volatile* ListHead
+)
+{
+    PSINGLE_LIST_ENTRY Entry;
+    PSINGLE_LIST_ENTRY Reversed = NULL;
+
+    if (ReadPointerNoFence((PVOID volatile*)ListHead) == NULL) {
+        return NULL;
+    }
+
+    Entry = (PSINGLE_LIST_ENTRY)InterlockedExchangePointer((PVOID volatile*)ListHead, NULL);
+    while (Entry != NULL) {
+        PSINGLE_LIST_ENTRY Next = Entry->Next;
+        Entry->Next = Reversed;
+        Reversed = Entry;
+        Entry = Next;
+    }
+    return Reversed;
+}
+
+/*
+ * Runs a list taken by KiTakeDpcList. The arguments are read and DpcData is
+ * cleared before the routine runs, so the routine may queue its DPC again.
+ */
+static __forceinline
+LONG64
+KiRunDpcList(
+    _In_opt_ PSINGLE_LIST_ENTRY Entry
+)
+{
+    LONG64 Count = 0;
+
+    while (Entry != NULL) {
+        PKDPC Dpc = CONTAINING_RECORD(Entry, KDPC, DpcListEntry);
+        PKDEFERRED_ROUTINE Routine = Dpc->DeferredRoutine;
+        PVOID Context = Dpc->DeferredContext;
+        PVOID SystemArgument1 = Dpc->SystemArgument1;
+        PVOID SystemArgument2 = Dpc->SystemArgument2;
+
+        Entry = Entry->Next;
+        WritePointerRelease(&Dpc->DpcData, NULL);
+
+        Routine(Dpc, Context, SystemArgument1, SystemArgument2);
+        Count++;
+    }
+    return Count;
+}
+
+static
+DWORD
+WINAPI
+KiDpcWorkerThread(
+    _In_ LPVOID Parameter
+)
+{
+    PKDPC_DATA DpcData = (PKDPC_DATA)Parameter;
+    PKDPC_QUEUE DpcQueue = DpcData->DpcQueue;
+    ULONG Spin = 0;
+
+    for (;;) {
+        PSINGLE_LIST_ENTRY Urgent = KiTakeDpcList(&DpcData->UrgentListHead);
+        PSINGLE_LIST_ENTRY Normal = KiTakeDpcList(&DpcData->DpcListHead);
+        LONG64 Ran;
+        LONG Signal;
+
+        if (Urgent != NULL || Normal != NULL) {
+            Ran = KiRunDpcList(Urgent);
+            Ran += KiRunDpcList(Normal);
+
+            // The full barrier of the add orders it before the waiter check;
+            // a flusher registers before it reads Completed
+            InterlockedExchangeAdd64(&DpcData->Completed, Ran);
+            if (ReadNoFence(&DpcQueue->FlushWaiters) != 0) {
+                WakeByAddressAll((PVOID)&DpcData->Completed);
+            }
+            Spin = 0;
+            continue;
+        }
+
+        if (ReadAcquire(&DpcQueue->Terminating)) {
+            break;
+        }
+        if (++Spin < KDPC_SPIN_COUNT) {
+            YieldProcessor();
+            continue;
+        }
+
+        // Announce the sleep before the final check; an inserter pushes before
+        // it reads Idle, so either the check sees its DPC or it sees Idle set
+        Signal = ReadNoFence(&DpcData->IdleSignal);
+        InterlockedExchange(&DpcData->Idle, TRUE);
+        if (ReadPointerNoFence((PVOID volatile*)&DpcData->DpcListHead) == NULL &&
+            ReadPointerNoFence((PVOID volatile*)&DpcData->UrgentListHead) == NULL &&
+            !ReadAcquire(&DpcQueue->Terminating)) {
+            WaitOnAddress(&DpcData->IdleSignal, &Signal, sizeof(LONG), INFINITE);
+        }
+        WriteRelease(&DpcData->Idle, FALSE);
+        Spin = 0;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Queues a DPC to run on a worker of a DPC queue
+ *
+ * Does nothing if the DPC is already queued. Never allocates; the common
+ * case is one compare-exchange on DpcData and one on the queue head.
+ *
+ * @param[in,out] DpcQueue Queue created by KeInitializeDpcQueue
+ * @param[in,out] Dpc Initialized DPC
+ * @param[in] SystemArgument1 Passed to the routine
+ * @param[in] SystemArgument2 Passed to the routine
+ * @return TRUE if the DPC was queued, FALSE if it already was
+ */
+static __forceinline
+BOOLEAN
+KeInsertQueueDpc(
+    _Inout_ PKDPC_QUEUE DpcQueue,
+    _Inout_ PRKDPC Dpc,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2
+)
+{
+    ULONG Number = (Dpc->Number == KDPC_CURRENT_PROCESSOR) ? GetCurrentProcessorNumber() : Dpc->Number;
+    PKDPC_DATA DpcData = &DpcQueue->Processors[Number % DpcQueue->ProcessorCount];
+
+    if (ReadPointerNoFence(&Dpc->DpcData) != NULL ||
+        InterlockedCompareExchangePointer(&Dpc->DpcData, DpcData, NULL) != NULL) {
+        return FALSE;
+    }
+
+    Dpc->SystemArgument1 = SystemArgument1;
+    Dpc->SystemArgument2 = SystemArgument2;
+    InterlockedIncrement64(&DpcData->Inserted);
+    KiPushDpcList(Dpc->Importance == HighImportance ? &DpcData->UrgentListHead : &DpcData->DpcListHead,
+                  &Dpc->DpcListEntry);
+
+    if (ReadNoFence(&DpcData->Idle)) {
+        InterlockedIncrement(&DpcData->IdleSignal);
+        WakeByAddressSingle((PVOID)&DpcData->IdleSignal);
+    }
+    return TRUE;
+}
+
+/**
+ * @brief Waits until every DPC queued before the call has run
+ *
+ * DPCs those DPCs queue are not waited for.
+ *
+ * @param[in,out] DpcQueue Queue created by KeInitializeDpcQueue
+ * @note Must not be called from a DPC routine
+ */
+static __forceinline
+VOID
+KeFlushQueuedDpcs(
+    _Inout_ PKDPC_QUEUE DpcQueue
+)
+{
+    ULONG Index;
+
+    InterlockedIncrement(&DpcQueue->FlushWaiters);
+    for (Index = 0; Index < DpcQueue->ProcessorCount; Index++) {
+        PKDPC_DATA DpcData = &DpcQueue->Processors[Index];
+        LONG64 Target = ReadAcquire64(&DpcData->Inserted);
+
+        for (;;) {
+            LONG64 Completed = ReadAcquire64(&DpcData->Completed);
+            if (Completed >= Target) {
+                break;
+            }
+            WaitOnAddress(&DpcData->Completed, &Completed, sizeof(LONG64), INFINITE);
+        }
+    }
+    InterlockedDecrement(&DpcQueue->FlushWaiters);
+}
+
+/*
+ * Stops the first StartedWorkers workers and frees the queues. Shared by
+ * rundown and the failure path of initialization.
+ */
+static __forceinline
+VOID
+KiDestroyDpcQueue(
+    _Inout_ PKDPC_QUEUE DpcQueue,
+    _In_ ULONG StartedWorkers
+)
+{
+    ULONG Index;
+
+    WriteRelease(&DpcQueue->Terminating, TRUE);
+    for (Index = 0; Index < StartedWorkers; Index++) {
+        PKDPC_DATA DpcData = &DpcQueue->Processors[Index];
+        InterlockedIncrement(&DpcData->IdleSignal);
+        WakeByAddressSingle((PVOID)&DpcData->IdleSignal);
+    }
+
+    for (Index = 0; Index < StartedWorkers; Index++) {
+        WaitForSingleObject(DpcQueue->Processors[Index].Thread, INFINITE);
+        CloseHandle(DpcQueue->Processors[Index].Thread);
+    }
+
+    FREE_POOL(DpcQueue->ProcessorsAllocation);
+    DpcQueue->Processors = NULL;
+    DpcQueue->ProcessorCount = 0;
+}
+
+/**
+ * @brief Creates per-processor DPC queues and starts their workers
+ *
+ * @param[out] DpcQueue Pointer to the queue to initialize
+ * @param[in] ProcessorCount Number of queues, or 0 for one per processor
+ * @return STATUS_SUCCESS, STATUS_NO_MEMORY if an allocation failed, or
+ *         STATUS_INSUFFICIENT_RESOURCES if a thread could not be created
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+KeInitializeDpcQueue(
+    _Out_ PKDPC_QUEUE DpcQueue,
+    _In_ ULONG ProcessorCount
+)
+{
+    SYSTEM_INFO SystemInfo;
+    ULONG Index;
+
+    RtlZeroMemory(DpcQueue, sizeof(*DpcQueue));
+
+    GetSystemInfo(&SystemInfo);
+    if (ProcessorCount == 0) {
+        ProcessorCount = SystemInfo.dwNumberOfProcessors;
+    }
+    if (ProcessorCount > KDPC_MAX_PROCESSORS) {
+        ProcessorCount = KDPC_MAX_PROCESSORS;
+    }
+
+    DpcQueue->Processors = (PKDPC_DATA)ExAllocateCacheAlignedPoolTracked(
+        NonPagedPoolCacheAligned, (SIZE_T)ProcessorCount * sizeof(KDPC_DATA), &DpcQueue->ProcessorsAllocation);
+    if (DpcQueue->Processors == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+    RtlZeroMemory(DpcQueue->Processors, (SIZE_T)ProcessorCount * sizeof(KDPC_DATA));
+    DpcQueue->ProcessorCount = ProcessorCount;
+
+    for (Index = 0; Index < ProcessorCount; Index++) {
+        PKDPC_DATA DpcData = &DpcQueue->Processors[Index];
+
+        DpcData->DpcQueue = DpcQueue;
+        DpcData->Thread = CreateThread(NULL, 0, KiDpcWorkerThread, DpcData, 0, NULL);
+        if (DpcData->Thread == NULL) {
+            KiDestroyDpcQueue(DpcQueue, Index);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        // With one queue per processor, keep each worker on its processor
+        if (ProcessorCount == SystemInfo.dwNumberOfProcessors && Index < sizeof(DWORD_PTR) * 8) {
+            SetThreadAffinityMask(DpcData->Thread, (DWORD_PTR)1 << Index);
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Runs every queued DPC, stops the workers and frees the queues
+ *
+ * @param[in,out] DpcQueue Pointer to an initialized DPC queue
+ * @note Must not be called from a DPC routine. No DPC may be inserted
+ *       once this has been called.
+ */
+static __forceinline
+VOID
+KeRundownDpcQueue(
+    _Inout_ PKDPC_QUEUE DpcQueue
+)
+{
+    KeFlushQueuedDpcs(DpcQueue);
+    KiDestroyDpcQueue(DpcQueue, DpcQueue->ProcessorCount);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_DPC_H_ */
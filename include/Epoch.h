@@ -0,0 +1,537 @@
+/**
+ * @file Epoch.h
+ * @brief Epoch-based reclamation for lock-free readers, with RCU-style LIST_ENTRY helpers
+ *
+ * Readers that walk a shared structure without a lock cannot tell a writer
+ * when they are done with a node, so a writer that unlinks a node must not
+ * free it straight away. An EPOCH_DOMAIN tracks a global epoch and, for each
+ * registered thread, the epoch it observed when it entered its current read
+ * section. A node unlinked by a writer is handed to RtlEpochDeferFree, which
+ * tags it with the current epoch and frees it only after the global epoch
+ * has advanced twice. The epoch only advances when every thread inside a
+ * read section has observed the current one, so by then no reader can still
+ * hold a pointer to the node.
+ *
+ * Entering and leaving a read section touch only the calling thread's own
+ * record: no lock, no shared counter. Writers pay for reclamation: once
+ * EPOCH_RECLAIM_THRESHOLD frees have been deferred, each further deferred
+ * free tries to advance the epoch until some of them have been released.
+ *
+ * The InsertHeadListRcu, InsertTailListRcu and RemoveEntryListRcu helpers
+ * update a LIST_ENTRY list so that a concurrent reader walking it forward with
+ * ReadListFlinkRcu always sees a well-formed list. Writers must still be
+ * serialized among themselves, for example with a push lock; readers only
+ * need RtlEnterEpoch and RtlLeaveEpoch. Blink is not safe to follow from a
+ * read section.
+ *
+ * Each thread is registered with a domain on its first RtlEnterEpoch and
+ * keeps its record until RtlUnregisterEpochThread, after which the record can
+ * be reused by another thread. Records are freed by RtlDeleteEpochDomain.
+ */
+
+#ifndef WINKERNEL_EPOCH_H_
+#define WINKERNEL_EPOCH_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "LinkedList.h"
+#include "NtStatus.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Deferred frees before automatic reclamation starts */
+#define EPOCH_RECLAIM_THRESHOLD 64
+
+/* Low bit of EPOCH_PARTICIPANT::Epoch: the thread is inside a read section */
+#define EPOCH_ACTIVE ((LONG64)1)
+
+typedef VOID (*PEPOCH_FREE_ROUTINE)(
+    _In_ PVOID Block
+);
+
+/* Size of a thread record; records are padded so that no two share a cache line */
+#define EPOCH_PARTICIPANT_SIZE 64
+
+/**
+ * @brief Per-thread record of a domain
+ *
+ * Epoch is written by the owning thread on every read section and read by
+ * threads trying to advance the global epoch.
+ */
+typedef struct _EPOCH_PARTICIPANT {
+    volatile LONG64 Epoch;                          /**< Observed epoch shifted left by one, plus EPOCH_ACTIVE; 0 when outside */
+    ULONG Nesting;                                  /**< Read section depth, owner only */
+    volatile LONG InUse;                            /**< Owned by a registered thread */
+    struct _EPOCH_PARTICIPANT* volatile Next;       /**< Next record of the domain; never unlinked */
+    UCHAR Pad[EPOCH_PARTICIPANT_SIZE - sizeof(LONG64) - 2 * sizeof(ULONG) - sizeof(PVOID)];
+} EPOCH_PARTICIPANT, *PEPOCH_PARTICIPANT;
+
+/**
+ * @brief Block waiting for its grace period to end
+ */
+typedef struct _EPOCH_DEFERRED_FREE {
+    LIST_ENTRY ListEntry;               /**< Link in EPOCH_DOMAIN::DeferredList */
+    PVOID Block;                        /**< Block to free */
+    PEPOCH_FREE_ROUTINE FreeRoutine;    /**< Routine that frees Block */
+    LONG64 Epoch;                       /**< Global epoch when Block was retired */
+} EPOCH_DEFERRED_FREE, *PEPOCH_DEFERRED_FREE;
+
+/**
+ * @brief Reclamation domain shared by the readers and writers of one or more structures
+ */
+typedef struct _EPOCH_DOMAIN {
+    DECLSPEC_CACHEALIGN volatile LONG64 GlobalEpoch;        /**< Current epoch, starting at 1 */
+    DECLSPEC_CACHEALIGN PEPOCH_PARTICIPANT volatile Participants;   /**< Singly linked records */
+    DWORD TlsIndex;                                         /**< Maps a thread to its record */
+    CRITICAL_SECTION DeferredLock;                          /**< Protects the fields below */
+    LIST_ENTRY DeferredList;                                /**< EPOCH_DEFERRED_FREE, oldest first */
+    ULONG DeferredCount;                                    /**< Entries on DeferredList */
+    ULONG DeferredSinceReclaim;                             /**< Deferred frees since a reclaim last freed anything */
+} EPOCH_DOMAIN, *PEPOCH_DOMAIN;
+
+/**
+ * @brief Initializes a reclamation domain
+ *
+ * @param[out] Domain Pointer to the domain
+ * @return STATUS_SUCCESS, or STATUS_INSUFFICIENT_RESOURCES if no TLS slot is available
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+RtlInitializeEpochDomain(
+    _Out_ PEPOCH_DOMAIN Domain
+)
+{
+    Domain->TlsIndex = TlsAlloc();
+    if (Domain->TlsIndex == TLS_OUT_OF_INDEXES) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Domain->GlobalEpoch = 1;
+    Domain->Participants = NULL;
+    InitializeCriticalSection(&Domain->DeferredLock);
+    InitializeListHead(&Domain->DeferredList);
+    Domain->DeferredCount = 0;
+    Domain->DeferredSinceReclaim = 0;
+    return STATUS_SUCCESS;
+}
+
+/*
+ * Finds a free record or allocates a new one and binds it to the calling
+ * thread.
+ */
+static __forceinline
+PEPOCH_PARTICIPANT
+RtlpRegisterEpochThread(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    PEPOCH_PARTICIPANT Participant;
+
+    for (Participant = (PEPOCH_PARTICIPANT)ReadPointerAcquire((PVOID volatile*)&Domain->Participants);
+         Participant != NULL;
+         Participant = Participant->Next) {
+        if (ReadNoFence(&Participant->InUse) == 0 &&
+            InterlockedCompareExchange(&Participant->InUse, 1, 0) == 0) {
+            break;
+        }
+    }
+
+    if (Participant == NULL) {
+        PEPOCH_PARTICIPANT Head;
+
+        Participant = (PEPOCH_PARTICIPANT)ExAllocatePoolTracked(NonPagedPool, sizeof(EPOCH_PARTICIPANT));
+        if (Participant == NULL) {
+            return NULL;
+        }
+        Participant->Epoch = 0;
+        Participant->Nesting = 0;
+        Participant->InUse = 1;
+        do {
+            Head = (PEPOCH_PARTICIPANT)ReadPointerAcquire((PVOID volatile*)&Domain->Participants);
+            Participant->Next = Head;
+        } while (InterlockedCompareExchangePointer((PVOID volatile*)&Domain->Participants, Participant, Head) != Head);
+    }
+
+    TlsSetValue(Domain->TlsIndex, Participant);
+    return Participant;
+}
+
+/**
+ * @brief Enters a read section
+ *
+ * Nodes reachable from the protected structures stay valid until the
+ * matching RtlLeaveEpoch. Read sections may nest. The first call on a thread
+ * registers it with the domain.
+ *
+ * @param[in,out] Domain Pointer to the domain
+ * @return STATUS_SUCCESS, or STATUS_NO_MEMORY if the thread could not be registered
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+RtlEnterEpoch(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    PEPOCH_PARTICIPANT Participant = (PEPOCH_PARTICIPANT)TlsGetValue(Domain->TlsIndex);
+
+    if (Participant == NULL) {
+        Participant = RtlpRegisterEpochThread(Domain);
+        if (Participant == NULL) {
+            return STATUS_NO_MEMORY;
+        }
+    }
+
+    if (Participant->Nesting++ == 0) {
+        WriteNoFence64(&Participant->Epoch, (ReadNoFence64(&Domain->GlobalEpoch) << 1) | EPOCH_ACTIVE);
+        // The announcement must be visible before any shared pointer is loaded
+        MemoryBarrier();
+    }
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Leaves a read section entered with RtlEnterEpoch
+ *
+ * @param[in,out] Domain Pointer to the domain
+ */
+static __forceinline
+VOID
+RtlLeaveEpoch(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    PEPOCH_PARTICIPANT Participant = (PEPOCH_PARTICIPANT)TlsGetValue(Domain->TlsIndex);
+
+    if (--Participant->Nesting == 0) {
+        WriteRelease64(&Participant->Epoch, 0);
+    }
+}
+
+/**
+ * @brief Releases the calling thread's record so another thread can reuse it
+ *
+ * Call before a thread that used the domain exits. The thread must not be
+ * inside a read section.
+ *
+ * @param[in,out] Domain Pointer to the domain
+ */
+static __forceinline
+VOID
+RtlUnregisterEpochThread(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    PEPOCH_PARTICIPANT Participant = (PEPOCH_PARTICIPANT)TlsGetValue(Domain->TlsIndex);
+
+    if (Participant != NULL) {
+        TlsSetValue(Domain->TlsIndex, NULL);
+        WriteRelease(&Participant->InUse, 0);
+    }
+}
+
+/*
+ * Advances the global epoch if every thread inside a read section has
+ * observed the current one. Returns the global epoch after the attempt.
+ */
+static __forceinline
+LONG64
+RtlpTryAdvanceEpoch(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    LONG64 Current = ReadAcquire64(&Domain->GlobalEpoch);
+    PEPOCH_PARTICIPANT Participant;
+
+    MemoryBarrier();
+    for (Participant = (PEPOCH_PARTICIPANT)ReadPointerAcquire((PVOID volatile*)&Domain->Participants);
+         Participant != NULL;
+         Participant = Participant->Next) {
+        LONG64 Observed = ReadAcquire64(&Participant->Epoch);
+        if ((Observed & EPOCH_ACTIVE) != 0 && (Observed >> 1) != Current) {
+            return Current;
+        }
+    }
+
+    InterlockedCompareExchange64(&Domain->GlobalEpoch, Current + 1, Current);
+    return ReadAcquire64(&Domain->GlobalEpoch);
+}
+
+/**
+ * @brief Frees every deferred block whose grace period has ended
+ *
+ * Tries to advance the epoch first. Never waits for readers, so it may be
+ * called from inside a read section.
+ *
+ * @param[in,out] Domain Pointer to the domain
+ * @return Number of blocks freed
+ */
+static __forceinline
+ULONG
+RtlEpochReclaim(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    LONG64 Epoch = RtlpTryAdvanceEpoch(Domain);
+    LIST_ENTRY Expired;
+    ULONG Freed = 0;
+
+    InitializeListHead(&Expired);
+
+    EnterCriticalSection(&Domain->DeferredLock);
+    // Entries are in epoch order, so the expired ones form a prefix
+    while (!IsListEmpty(&Domain->DeferredList)) {
+        PEPOCH_DEFERRED_FREE Deferred = CONTAINING_RECORD(Domain->DeferredList.Flink, EPOCH_DEFERRED_FREE, ListEntry);
+        if (Deferred->Epoch > Epoch - 2) {
+            break;
+        }
+        RemoveEntryList(&Deferred->ListEntry);
+        InsertTailList(&Expired, &Deferred->ListEntry);
+        Domain->DeferredCount--;
+    }
+    // Until something expires, every deferred free retries the reclaim
+    if (!IsListEmpty(&Expired)) {
+        Domain->DeferredSinceReclaim = 0;
+    }
+    LeaveCriticalSection(&Domain->DeferredLock);
+
+    while (!IsListEmpty(&Expired)) {
+        PEPOCH_DEFERRED_FREE Deferred = CONTAINING_RECORD(RemoveHeadList(&Expired), EPOCH_DEFERRED_FREE, ListEntry);
+        Deferred->FreeRoutine(Deferred->Block);
+        ExFreePool(Deferred);
+        Freed++;
+    }
+    return Freed;
+}
+
+/**
+ * @brief Waits until every read section that was active at the time of the call has ended
+ *
+ * Must not be called from inside a read section of the same domain.
+ *
+ * @param[in,out] Domain Pointer to the domain
+ */
+static __forceinline
+VOID
+RtlEpochSynchronize(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    LONG64 Target = ReadAcquire64(&Domain->GlobalEpoch) + 2;
+
+    while (RtlpTryAdvanceEpoch(Domain) < Target) {
+        SwitchToThread();
+    }
+}
+
+static __forceinline
+VOID
+RtlpEpochFreePool(
+    _In_ PVOID Block
+)
+{
+    ExFreePool(Block);
+}
+
+/**
+ * @brief Frees a block with a routine once no reader can still reference it
+ *
+ * The block must already be unreachable for new readers. If the bookkeeping
+ * record cannot be allocated, the call waits for a grace period and frees the
+ * block before returning, so it must then not be inside a read section.
+ *
+ * @param[in,out] Domain Pointer to the domain
+ * @param[in] Block Block to free
+ * @param[in] FreeRoutine Routine that frees Block
+ */
+static __forceinline
+VOID
+RtlEpochDeferFreeEx(
+    _Inout_ PEPOCH_DOMAIN Domain,
+    _In_ __drv_aliasesMem PVOID Block,
+    _In_ PEPOCH_FREE_ROUTINE FreeRoutine
+)
+{
+    PEPOCH_DEFERRED_FREE Deferred;
+    BOOLEAN Reclaim;
+
+    Deferred = (PEPOCH_DEFERRED_FREE)ExAllocatePoolTracked(NonPagedPool, sizeof(EPOCH_DEFERRED_FREE));
+    if (Deferred == NULL) {
+        RtlEpochSynchronize(Domain);
+        FreeRoutine(Block);
+        return;
+    }
+    Deferred->Block = Block;
+    Deferred->FreeRoutine = FreeRoutine;
+
+    // Order the caller's unlink before the epoch read below
+    MemoryBarrier();
+
+    EnterCriticalSection(&Domain->DeferredLock);
+    Deferred->Epoch = ReadAcquire64(&Domain->GlobalEpoch);
+    InsertTailList(&Domain->DeferredList, &Deferred->ListEntry);
+    Domain->DeferredCount++;
+    Reclaim = (++Domain->DeferredSinceReclaim >= EPOCH_RECLAIM_THRESHOLD);
+    LeaveCriticalSection(&Domain->DeferredLock);
+
+    if (Reclaim) {
+        RtlEpochReclaim(Domain);
+    }
+}
+
+/**
+ * @brief Frees a pool block with ExFreePool once no reader can still reference it
+ *
+ * @param[in,out] Domain Pointer to the domain
+ * @param[in] Block Pool block to free
+ */
+static __forceinline
+VOID
+RtlEpochDeferFree(
+    _Inout_ PEPOCH_DOMAIN Domain,
+    _In_ __drv_aliasesMem PVOID Block
+)
+{
+    RtlEpochDeferFreeEx(Domain, Block, RtlpEpochFreePool);
+}
+
+/**
+ * @brief Waits for a grace period and frees every block deferred before the call
+ *
+ * Must not be called from inside a read section of the same domain.
+ *
+ * @param[in,out] Domain Pointer to the domain
+ */
+static __forceinline
+VOID
+RtlEpochFlush(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    RtlEpochSynchronize(Domain);
+    RtlEpochReclaim(Domain);
+}
+
+/**
+ * @brief Frees all deferred blocks and thread records of a domain
+ *
+ * No thread may be inside a read section or use the domain afterwards.
+ *
+ * @param[in,out] Domain Pointer to the domain
+ */
+static __forceinline
+VOID
+RtlDeleteEpochDomain(
+    _Inout_ PEPOCH_DOMAIN Domain
+)
+{
+    PEPOCH_PARTICIPANT Participant = Domain->Participants;
+
+    while (!IsListEmpty(&Domain->DeferredList)) {
+        PEPOCH_DEFERRED_FREE Deferred = CONTAINING_RECORD(RemoveHeadList(&Domain->DeferredList), EPOCH_DEFERRED_FREE, ListEntry);
+        Deferred->FreeRoutine(Deferred->Block);
+        ExFreePool(Deferred);
+    }
+    Domain->DeferredCount = 0;
+
+    while (Participant != NULL) {
+        PEPOCH_PARTICIPANT Next = Participant->Next;
+        ExFreePool(Participant);
+        Participant = Next;
+    }
+    Domain->Participants = NULL;
+
+    DeleteCriticalSection(&Domain->DeferredLock);
+    TlsFree(Domain->TlsIndex);
+}
+
+/**
+ * @brief Reads the forward link of an entry from inside a read section
+ *
+ * @param[in] Entry Entry of a list updated only with the *Rcu helpers
+ * @return The next entry, which is fully initialized
+ */
+static __forceinline
+PLIST_ENTRY
+ReadListFlinkRcu(
+    _In_ PLIST_ENTRY Entry
+)
+{
+    return (PLIST_ENTRY)ReadPointerAcquire((PVOID volatile*)&Entry->Flink);
+}
+
+/**
+ * @brief Inserts an entry at the head of a list that readers walk concurrently
+ *
+ * The entry is fully linked before it is published with a release store.
+ * Writers must be serialized by the caller.
+ *
+ * @param[in,out] ListHead Pointer to the list head
+ * @param[out] Entry Entry to insert
+ */
+static __forceinline
+VOID
+InsertHeadListRcu(
+    _Inout_ PLIST_ENTRY ListHead,
+    _Out_ __drv_aliasesMem PLIST_ENTRY Entry
+)
+{
+    PLIST_ENTRY Flink = ListHead->Flink;
+
+    Entry->Flink = Flink;
+    Entry->Blink = ListHead;
+    Flink->Blink = Entry;
+    WritePointerRelease((PVOID volatile*)&ListHead->Flink, Entry);
+}
+
+/**
+ * @brief Inserts an entry at the tail of a list that readers walk concurrently
+ *
+ * @param[in,out] ListHead Pointer to the list head
+ * @param[out] Entry Entry to insert
+ */
+static __forceinline
+VOID
+InsertTailListRcu(
+    _Inout_ PLIST_ENTRY ListHead,
+    _Out_ __drv_aliasesMem PLIST_ENTRY Entry
+)
+{
+    PLIST_ENTRY Blink = ListHead->Blink;
+
+    Entry->Flink = ListHead;
+    Entry->Blink = Blink;
+    WritePointerRelease((PVOID volatile*)&Blink->Flink, Entry);
+    ListHead->Blink = Entry;
+}
+
+/**
+ * @brief Unlinks an entry from a list that readers walk concurrently
+ *
+ * The entry's own links are left intact so that a reader standing on it can
+ * continue its walk. The entry must not be reused or freed until a grace
+ * period has passed, typically by handing it to RtlEpochDeferFree.
+ *
+ * @param[in] Entry Entry to unlink
+ */
+static __forceinline
+VOID
+RemoveEntryListRcu(
+    _In_ PLIST_ENTRY Entry
+)
+{
+    PLIST_ENTRY Flink = Entry->Flink;
+    PLIST_ENTRY Blink = Entry->Blink;
+
+    WritePointerRelease((PVOID volatile*)&Blink->Flink, Flink);
+    Flink->Blink = Blink;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_EPOCH_H_ */
@@ -0,0 +1,614 @@
+/**
+ * @file HandleTable.h
+ * @brief Multi-level handle tables modeled on ExCreateHandleTable
+ *
+ * A HANDLE_TABLE maps small integer handles to caller pointers. Entries live
+ * in pages of HANDLE_TABLE_ENTRIES_PER_PAGE; a fixed directory in the table
+ * points to pages of page pointers, which point to the entry pages. Pages are
+ * only ever added while the table exists, so a lookup is three dependent
+ * loads plus two loads of the entry, with no lock and no interlocked
+ * operation.
+ *
+ * A handle value carries the entry index shifted past two always-zero tag
+ * bits, as kernel handles do, and the low HANDLE_GENERATION_BITS of the
+ * entry's generation. Closing a handle advances the generation, so a stale
+ * handle whose entry has been reused no longer resolves. The generation bits
+ * wrap, so a handle that is used after its entry has been reused
+ * 2^HANDLE_GENERATION_BITS times resolves again; the check catches ordinary
+ * use-after-close, not adversarial guessing.
+ *
+ * Free entries are kept on HANDLE_TABLE_FREE_LISTS lock-free lists, one per
+ * group of processors, so threads creating and closing handles on different
+ * processors do not contend for one list head. An empty list steals from the
+ * others before the table grows by a page.
+ *
+ * The table stores pointers but does not manage what they point to. When
+ * handles are closed while other threads look them up, keep the object alive
+ * until those lookups are done, for instance by looking up inside an epoch
+ * (Epoch.h) and deferring the final dereference of the object.
+ */
+
+#ifndef WINKERNEL_HANDLETABLE_H_
+#define WINKERNEL_HANDLETABLE_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "NtStatus.h"
+#include "PushLock.h"
+#include "ShardedCounter.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HANDLE_TAG_BITS         2
+#define HANDLE_INDEX_BITS       22
+#define HANDLE_GENERATION_BITS  8
+
+#define HANDLE_INDEX_MASK       ((1UL << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATION_MASK  ((1UL << HANDLE_GENERATION_BITS) - 1)
+
+/* Entries per entry page and pointers per page of page pointers */
+#define HANDLE_TABLE_ENTRIES_PER_PAGE   512
+#define HANDLE_TABLE_POINTERS_PER_PAGE  512
+
+/* Directory slots; together the three levels cover every index */
+#define HANDLE_TABLE_DIRECTORY_SIZE \
+    ((1UL << HANDLE_INDEX_BITS) / (HANDLE_TABLE_ENTRIES_PER_PAGE * HANDLE_TABLE_POINTERS_PER_PAGE))
+
+/* Number of free lists; a power of two */
+#define HANDLE_TABLE_FREE_LISTS 16
+
+/* Spacing of the free lists */
+#define HANDLE_TABLE_CACHE_LINE 64
+
+C_ASSERT(HANDLE_TAG_BITS + HANDLE_INDEX_BITS + HANDLE_GENERATION_BITS == 32);
+C_ASSERT((HANDLE_TABLE_FREE_LISTS & (HANDLE_TABLE_FREE_LISTS - 1)) == 0);
+
+/**
+ * @brief One slot of a handle table
+ */
+typedef struct _HANDLE_TABLE_ENTRY {
+    PVOID volatile Object;              /**< Caller pointer, NULL while the entry is free */
+    volatile LONG Generation;           /**< Advanced each time the entry's handle is closed */
+    volatile ULONG NextFreeTableEntry;  /**< Index of the next free entry while on a free list */
+} HANDLE_TABLE_ENTRY, *PHANDLE_TABLE_ENTRY;
+
+/**
+ * @brief Head of one free list, padded so that no two share a cache line
+ *
+ * The low 32 bits are the index of the first free entry, 0 for an empty
+ * list; the high 32 bits count updates so a compare-exchange cannot succeed
+ * against a head that was popped and pushed back in between.
+ */
+typedef struct _HANDLE_TABLE_FREE_LIST {
+    volatile LONG64 Head;
+    UCHAR Pad[HANDLE_TABLE_CACHE_LINE - sizeof(LONG64)];
+} HANDLE_TABLE_FREE_LIST, *PHANDLE_TABLE_FREE_LIST;
+
+/**
+ * @brief Handle table
+ */
+typedef struct _HANDLE_TABLE {
+    HANDLE_TABLE_FREE_LIST FreeLists[HANDLE_TABLE_FREE_LISTS];
+    PHANDLE_TABLE_ENTRY* volatile Directory[HANDLE_TABLE_DIRECTORY_SIZE];  /**< Pages of entry page pointers */
+    volatile ULONG NextIndexNeedingPool;    /**< First index without an entry page */
+    EX_PUSH_LOCK ExpansionLock;             /**< Serializes adding pages */
+    SHARDED_COUNTER HandleCount;            /**< Open handles */
+    PVOID Allocation;                       /**< Pool block holding this cache-aligned table */
+} HANDLE_TABLE, *PHANDLE_TABLE;
+
+/**
+ * @brief Callback for ExEnumHandleTable
+ *
+ * @return TRUE to stop the enumeration at this handle
+ */
+typedef BOOLEAN (*PEX_ENUM_HANDLE_CALLBACK)(
+    _In_ PHANDLE_TABLE HandleTable,
+    _In_ HANDLE Handle,
+    _In_ PVOID Object,
+    _In_opt_ PVOID Context
+);
+
+/**
+ * @brief Callback for ExDestroyHandleTable, called for each handle still open
+ */
+typedef VOID (*PEX_DESTROY_HANDLE_ROUTINE)(
+    _In_ HANDLE Handle,
+    _In_ PVOID Object,
+    _In_opt_ PVOID Context
+);
+
+static __forceinline
+HANDLE
+ExpEncodeHandle(
+    _In_ ULONG Index,
+    _In_ LONG Generation
+)
+{
+    ULONG Value = (((ULONG)Generation & HANDLE_GENERATION_MASK) << (HANDLE_INDEX_BITS + HANDLE_TAG_BITS)) |
+                  (Index << HANDLE_TAG_BITS);
+
+    return (HANDLE)(ULONG_PTR)Value;
+}
+
+/*
+ * Splits a handle into index and generation. Fails for values with tag bits
+ * set or bits above the 32 a handle uses, and for index 0, which is never
+ * handed out so that no handle is NULL.
+ */
+static __forceinline
+BOOLEAN
+ExpDecodeHandle(
+    _In_ HANDLE Handle,
+    _Out_ PULONG Index,
+    _Out_ PULONG Generation
+)
+{
+    ULONG_PTR Value = (ULONG_PTR)Handle;
+
+    *Index = (ULONG)(Value >> HANDLE_TAG_BITS) & HANDLE_INDEX_MASK;
+    *Generation = (ULONG)(Value >> (HANDLE_INDEX_BITS + HANDLE_TAG_BITS)) & HANDLE_GENERATION_MASK;
+
+    return (Value & ((1UL << HANDLE_TAG_BITS) - 1)) == 0 &&
+           (Value >> 16 >> 16) == 0 &&
+           *Index != 0;
+}
+
+/*
+ * Returns the entry for an index, or NULL if its page has not been added.
+ */
+static __forceinline
+PHANDLE_TABLE_ENTRY
+ExpLookupHandleTableEntry(
+    _In_ PHANDLE_TABLE HandleTable,
+    _In_ ULONG Index
+)
+{
+    PHANDLE_TABLE_ENTRY* Pointers;
+    PHANDLE_TABLE_ENTRY Page;
+
+    Pointers = (PHANDLE_TABLE_ENTRY*)ReadPointerAcquire(
+        (PVOID volatile*)&HandleTable->Directory[Index / (HANDLE_TABLE_ENTRIES_PER_PAGE * HANDLE_TABLE_POINTERS_PER_PAGE)]);
+    if (Pointers == NULL) {
+        return NULL;
+    }
+
+    Page = (PHANDLE_TABLE_ENTRY)ReadPointerAcquire(
+        (PVOID volatile*)&Pointers[(Index / HANDLE_TABLE_ENTRIES_PER_PAGE) % HANDLE_TABLE_POINTERS_PER_PAGE]);
+    if (Page == NULL) {
+        return NULL;
+    }
+
+    return &Page[Index % HANDLE_TABLE_ENTRIES_PER_PAGE];
+}
+
+static __forceinline
+PHANDLE_TABLE_FREE_LIST
+ExpCurrentFreeList(
+    _In_ PHANDLE_TABLE HandleTable
+)
+{
+    return &HandleTable->FreeLists[GetCurrentProcessorNumber() & (HANDLE_TABLE_FREE_LISTS - 1)];
+}
+
+/*
+ * Pushes the chain First..Last, already linked through NextFreeTableEntry,
+ * onto a free list.
+ */
+static __forceinline
+VOID
+ExpPushFreeEntries(
+    _In_ PHANDLE_TABLE HandleTable,
+    _Inout_ PHANDLE_TABLE_FREE_LIST FreeList,
+    _In_ ULONG First,
+    _In_ ULONG Last
+)
+{
+    PHANDLE_TABLE_ENTRY LastEntry = ExpLookupHandleTableEntry(HandleTable, Last);
+    LONG64 Head = ReadNoFence64(&FreeList->Head);
+
+    for (;;) {
+        LONG64 NewHead = (LONG64)(((ULONG64)Head & 0xFFFFFFFF00000000ULL) + 0x100000000ULL) | First;
+        LONG64 Observed;
+
+        WriteNoFence((volatile LONG*)&LastEntry->NextFreeTableEntry, (LONG)(ULONG)Head);
+        Observed = InterlockedCompareExchange64(&FreeList->Head, NewHead, Head);
+        if (Observed == Head) {
+            return;
+        }
+        Head = Observed;
+    }
+}
+
+/*
+ * Pops a free index from one list, or returns 0 if the list is empty.
+ */
+static __forceinline
+ULONG
+ExpPopFreeEntry(
+    _In_ PHANDLE_TABLE HandleTable,
+    _Inout_ PHANDLE_TABLE_FREE_LIST FreeList
+)
+{
+    LONG64 Head = ReadAcquire64(&FreeList->Head);
+
+    for (;;) {
+        ULONG Index = (ULONG)Head;
+        ULONG Next;
+        LONG64 NewHead;
+        LONG64 Observed;
+
+        if (Index == 0) {
+            return 0;
+        }
+
+        // The entry may be taken by another thread before the exchange; its
+        // page stays mapped and the update count makes the exchange fail
+        Next = (ULONG)ReadNoFence((volatile LONG*)&ExpLookupHandleTableEntry(HandleTable, Index)->NextFreeTableEntry);
+        NewHead = (LONG64)(((ULONG64)Head & 0xFFFFFFFF00000000ULL) + 0x100000000ULL) | Next;
+        Observed = InterlockedCompareExchange64(&FreeList->Head, NewHead, Head);
+        if (Observed == Head) {
+            return Index;
+        }
+        Head = Observed;
+    }
+}
+
+/*
+ * Adds one entry page, returns its first usable index to the caller and puts
+ * the rest on FreeList. Returns 0 when the table is full or out of memory.
+ */
+static __forceinline
+ULONG
+ExpAllocateHandleTableEntryPage(
+    _Inout_ PHANDLE_TABLE HandleTable,
+    _Inout_ PHANDLE_TABLE_FREE_LIST FreeList
+)
+{
+    ULONG Base = HandleTable->NextIndexNeedingPool;
+    ULONG DirectoryIndex = Base / (HANDLE_TABLE_ENTRIES_PER_PAGE * HANDLE_TABLE_POINTERS_PER_PAGE);
+    PHANDLE_TABLE_ENTRY* Pointers;
+    PHANDLE_TABLE_ENTRY Page;
+    ULONG First;
+    ULONG i;
+
+    if (Base > HANDLE_INDEX_MASK) {
+        return 0;
+    }
+
+    Pointers = HandleTable->Directory[DirectoryIndex];
+    if (Pointers == NULL) {
+        Pointers = (PHANDLE_TABLE_ENTRY*)ExAllocatePoolTracked(NonPagedPool,
+                                                               HANDLE_TABLE_POINTERS_PER_PAGE * sizeof(PHANDLE_TABLE_ENTRY));
+        if (Pointers == NULL) {
+            return 0;
+        }
+        RtlZeroMemory(Pointers, HANDLE_TABLE_POINTERS_PER_PAGE * sizeof(PHANDLE_TABLE_ENTRY));
+        WritePointerRelease((PVOID volatile*)&HandleTable->Directory[DirectoryIndex], Pointers);
+    }
+
+    Page = (PHANDLE_TABLE_ENTRY)ExAllocatePoolTracked(NonPagedPool,
+                                                      HANDLE_TABLE_ENTRIES_PER_PAGE * sizeof(HANDLE_TABLE_ENTRY));
+    if (Page == NULL) {
+        return 0;
+    }
+
+    // Index 0 is never handed out, so no handle value is NULL
+    First = (Base == 0) ? 1 : Base;
+    for (i = 0; i < HANDLE_TABLE_ENTRIES_PER_PAGE; i++) {
+        Page[i].Object = NULL;
+        Page[i].Generation = 0;
+        Page[i].NextFreeTableEntry = Base + i + 1;
+    }
+
+    WritePointerRelease((PVOID volatile*)&Pointers[(Base / HANDLE_TABLE_ENTRIES_PER_PAGE) % HANDLE_TABLE_POINTERS_PER_PAGE],
+                        Page);
+    WriteRelease((volatile LONG*)&HandleTable->NextIndexNeedingPool, (LONG)(Base + HANDLE_TABLE_ENTRIES_PER_PAGE));
+
+    ExpPushFreeEntries(HandleTable, FreeList, First + 1, Base + HANDLE_TABLE_ENTRIES_PER_PAGE - 1);
+    return First;
+}
+
+/**
+ * @brief Creates an empty handle table
+ *
+ * @param[out] HandleTable Receives the table
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER or STATUS_INSUFFICIENT_RESOURCES
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+ExCreateHandleTable(
+    _Out_ PHANDLE_TABLE* HandleTable
+)
+{
+    PHANDLE_TABLE NewTable;
+    PVOID Allocation;
+
+    if (HandleTable == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    NewTable = (PHANDLE_TABLE)ExAllocateCacheAlignedPoolTracked(NonPagedPoolCacheAligned, sizeof(HANDLE_TABLE),
+                                                                &Allocation);
+    if (NewTable == NULL) {
+        *HandleTable = NULL;
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(NewTable, sizeof(HANDLE_TABLE));
+    NewTable->Allocation = Allocation;
+    ExInitializePushLock(&NewTable->ExpansionLock);
+    RtlInitializeShardedCounter(&NewTable->HandleCount);
+
+    *HandleTable = NewTable;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Frees a handle table, reporting each handle still open
+ *
+ * No other thread may use the table.
+ *
+ * @param[in] HandleTable Table created by ExCreateHandleTable
+ * @param[in] DestroyHandleProcedure Optional callback for each open handle
+ * @param[in] Context Passed to DestroyHandleProcedure
+ */
+static __forceinline
+VOID
+ExDestroyHandleTable(
+    _In_ PHANDLE_TABLE HandleTable,
+    _In_opt_ PEX_DESTROY_HANDLE_ROUTINE DestroyHandleProcedure,
+    _In_opt_ PVOID Context
+)
+{
+    ULONG DirectoryIndex;
+    ULONG PointerIndex;
+    ULONG i;
+
+    for (DirectoryIndex = 0; DirectoryIndex < HANDLE_TABLE_DIRECTORY_SIZE; DirectoryIndex++) {
+        PHANDLE_TABLE_ENTRY* Pointers = HandleTable->Directory[DirectoryIndex];
+
+        if (Pointers == NULL) {
+            continue;
+        }
+        for (PointerIndex = 0; PointerIndex < HANDLE_TABLE_POINTERS_PER_PAGE; PointerIndex++) {
+            PHANDLE_TABLE_ENTRY Page = Pointers[PointerIndex];
+            ULONG Base = (DirectoryIndex * HANDLE_TABLE_POINTERS_PER_PAGE + PointerIndex) * HANDLE_TABLE_ENTRIES_PER_PAGE;
+
+            if (Page == NULL) {
+                continue;
+            }
+            if (DestroyHandleProcedure != NULL) {
+                for (i = 0; i < HANDLE_TABLE_ENTRIES_PER_PAGE; i++) {
+                    if (Page[i].Object != NULL) {
+                        DestroyHandleProcedure(ExpEncodeHandle(Base + i, Page[i].Generation), Page[i].Object, Context);
+                    }
+                }
+            }
+            ExFreePool(Page);
+        }
+        ExFreePool(Pointers);
+    }
+
+    ExFreePool(HandleTable->Allocation);
+}
+
+/**
+ * @brief Creates a handle for a pointer
+ *
+ * @param[in,out] HandleTable Table to add the handle to
+ * @param[in] Object Pointer the handle maps to; must not be NULL
+ * @return The new handle, or NULL if Object is NULL, the table is full or
+ *         memory for a new page could not be allocated
+ */
+_Must_inspect_result_
+static __forceinline
+HANDLE
+ExCreateHandle(
+    _Inout_ PHANDLE_TABLE HandleTable,
+    _In_ PVOID Object
+)
+{
+    PHANDLE_TABLE_FREE_LIST FreeList;
+    PHANDLE_TABLE_ENTRY Entry;
+    ULONG Index;
+    ULONG i;
+
+    if (Object == NULL) {
+        return NULL;
+    }
+
+    FreeList = ExpCurrentFreeList(HandleTable);
+    Index = ExpPopFreeEntry(HandleTable, FreeList);
+
+    for (i = 1; Index == 0 && i < HANDLE_TABLE_FREE_LISTS; i++) {
+        PHANDLE_TABLE_FREE_LIST Victim = &HandleTable->FreeLists[((ULONG)(FreeList - HandleTable->FreeLists) + i) &
+                                                                 (HANDLE_TABLE_FREE_LISTS - 1)];
+        Index = ExpPopFreeEntry(HandleTable, Victim);
+    }
+
+    if (Index == 0) {
+        ExAcquirePushLockExclusive(&HandleTable->ExpansionLock);
+        // Another creator may have added a page while this one waited
+        Index = ExpPopFreeEntry(HandleTable, FreeList);
+        if (Index == 0) {
+            Index = ExpAllocateHandleTableEntryPage(HandleTable, FreeList);
+        }
+        ExReleasePushLockExclusive(&HandleTable->ExpansionLock);
+        if (Index == 0) {
+            return NULL;
+        }
+    }
+
+    Entry = ExpLookupHandleTableEntry(HandleTable, Index);
+    WritePointerRelease(&Entry->Object, Object);
+    RtlIncrementShardedCounter(&HandleTable->HandleCount);
+
+    return ExpEncodeHandle(Index, ReadNoFence(&Entry->Generation));
+}
+
+/**
+ * @brief Returns the pointer a handle maps to
+ *
+ * Takes no lock and performs no interlocked operation. Unlike the kernel's
+ * ExMapHandleToPointer the entry is not locked; the result is the pointer
+ * the handle mapped to at some point during the call.
+ *
+ * @param[in] HandleTable Table the handle was created in
+ * @param[in] Handle Handle to look up
+ * @return The pointer, or NULL if the handle is invalid, closed or stale
+ */
+static __forceinline
+PVOID
+ExMapHandleToPointer(
+    _In_ PHANDLE_TABLE HandleTable,
+    _In_ HANDLE Handle
+)
+{
+    PHANDLE_TABLE_ENTRY Entry;
+    PVOID Object;
+    ULONG Index;
+    ULONG Generation;
+
+    if (!ExpDecodeHandle(Handle, &Index, &Generation)) {
+        return NULL;
+    }
+
+    Entry = ExpLookupHandleTableEntry(HandleTable, Index);
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    // The generation is read after the pointer: a pointer stored for a later
+    // use of the entry is only visible once the close that advanced the
+    // generation is, so the check below rejects it
+    Object = ReadPointerAcquire(&Entry->Object);
+    if (((ULONG)ReadAcquire(&Entry->Generation) & HANDLE_GENERATION_MASK) != Generation) {
+        return NULL;
+    }
+    return Object;
+}
+
+/**
+ * @brief Closes a handle and returns its entry to a free list
+ *
+ * Exactly one of several threads closing the same handle succeeds.
+ *
+ * @param[in,out] HandleTable Table the handle was created in
+ * @param[in] Handle Handle to close
+ * @return The pointer the handle mapped to, or NULL if the handle was
+ *         invalid, already closed or stale
+ */
+static __forceinline
+PVOID
+ExDestroyHandle(
+    _Inout_ PHANDLE_TABLE HandleTable,
+    _In_ HANDLE Handle
+)
+{
+    PHANDLE_TABLE_ENTRY Entry;
+    PVOID Object;
+    ULONG Index;
+    ULONG Generation;
+    LONG Current;
+
+    if (!ExpDecodeHandle(Handle, &Index, &Generation)) {
+        return NULL;
+    }
+
+    Entry = ExpLookupHandleTableEntry(HandleTable, Index);
+    if (Entry == NULL) {
+        return NULL;
+    }
+
+    // Advancing the generation is what closes the handle; only one closer can
+    // move it away from the value the handle carries
+    Current = ReadAcquire(&Entry->Generation);
+    for (;;) {
+        LONG Observed;
+
+        if (((ULONG)Current & HANDLE_GENERATION_MASK) != Generation ||
+            ReadPointerAcquire(&Entry->Object) == NULL) {
+            return NULL;
+        }
+        Observed = InterlockedCompareExchange(&Entry->Generation, Current + 1, Current);
+        if (Observed == Current) {
+            break;
+        }
+        Current = Observed;
+    }
+
+    Object = ReadPointerNoFence(&Entry->Object);
+    WritePointerRelease(&Entry->Object, NULL);
+    RtlAddShardedCounter(&HandleTable->HandleCount, -1);
+
+    ExpPushFreeEntries(HandleTable, ExpCurrentFreeList(HandleTable), Index, Index);
+    return Object;
+}
+
+/**
+ * @brief Calls a routine for each open handle
+ *
+ * Handles created or closed while the enumeration runs may or may not be
+ * reported.
+ *
+ * @param[in] HandleTable Table to enumerate
+ * @param[in] EnumHandleProcedure Callback; returns TRUE to stop
+ * @param[in] Context Passed to EnumHandleProcedure
+ * @param[out] Handle Optional; receives the handle the enumeration stopped at
+ * @return TRUE if the callback stopped the enumeration, FALSE otherwise
+ */
+static __forceinline
+BOOLEAN
+ExEnumHandleTable(
+    _In_ PHANDLE_TABLE HandleTable,
+    _In_ PEX_ENUM_HANDLE_CALLBACK EnumHandleProcedure,
+    _In_opt_ PVOID Context,
+    _Out_opt_ PHANDLE Handle
+)
+{
+    ULONG Limit = (ULONG)ReadAcquire((volatile LONG*)&HandleTable->NextIndexNeedingPool);
+    ULONG Index;
+
+    for (Index = 1; Index < Limit; Index++) {
+        PHANDLE_TABLE_ENTRY Entry = ExpLookupHandleTableEntry(HandleTable, Index);
+        PVOID Object = ReadPointerAcquire(&Entry->Object);
+        HANDLE Current;
+
+        if (Object == NULL) {
+            continue;
+        }
+
+        Current = ExpEncodeHandle(Index, ReadAcquire(&Entry->Generation));
+        if (EnumHandleProcedure(HandleTable, Current, Object, Context)) {
+            if (Handle != NULL) {
+                *Handle = Current;
+            }
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Returns the number of open handles
+ *
+ * @param[in] HandleTable Table to query
+ * @return Open handles; approximate while handles are being created or closed
+ */
+static __forceinline
+ULONG
+ExQueryHandleCount(
+    _In_ PHANDLE_TABLE HandleTable
+)
+{
+    return (ULONG)RtlReadShardedCounter(&HandleTable->HandleCount);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_HANDLETABLE_H_ */
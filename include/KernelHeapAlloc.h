@@ -3,6 +3,8 @@
 
 #include <Windows.h>
 #include <stdio.h>
+#include "Bitmap.h"
+#include "ShardedCounter.h"
 
 /* Pool type definitions */
 
@@ -32,20 +34,24 @@ typedef struct _MEMORY_TRACKING_ENTRY {
     SIZE_T Size;            /* Size of allocation */
     const char* FileName;    /* Source file name */
     int LineNumber;         /* Line number in source file */
+    ULONG Tag;              /* Pool tag, or 0 for untagged allocations */
     BOOL IsAllocated;       /* Is this entry still allocated? */
 } MEMORY_TRACKING_ENTRY;
 
 /* Global state structure */
 typedef struct _GLOBAL_STATE {
     MEMORY_TRACKING_ENTRY MemoryAllocations[MAX_ALLOCATIONS];
-    SIZE_T AllocationCount;
-    SIZE_T TotalBytesAllocated;
+    ULONG AllocationBitMapBuffer[(MAX_ALLOCATIONS + 31) / 32];
+    RTL_BITMAP AllocationBitMap; /* Set bit = MemoryAllocations slot in use */
+    SHARDED_COUNTER AllocationCount;     /* Updated outside MemoryTrackingLock; read with RtlReadShardedCounter */
+    SHARDED_COUNTER TotalBytesAllocated; /* Updated outside MemoryTrackingLock; read with RtlReadShardedCounter */
     SIZE_T CurrentBytesAllocated;
     SIZE_T PeakBytesAllocated;
     HANDLE HeapHandle;
     CRITICAL_SECTION MemoryTrackingLock;
     BOOL SuppressErrors;      /* Control error message output */
     BOOL TrackingTableFull;   /* Indicate if tracking table is full */
+    PVOID Allocation;         /* HeapAlloc block holding this cache-aligned state */
 } GLOBAL_STATE;
 
 /* Function declarations */
@@ -57,12 +63,16 @@ __forceinline GLOBAL_STATE* GetGlobalState(void);
 __forceinline BOOL InitHeap(void);
 __forceinline void CleanupHeap(void);
 __forceinline void TrackAllocation(PVOID Address, SIZE_T Size, const char* FileName, int LineNumber);
+__forceinline void TrackAllocationWithTag(PVOID Address, SIZE_T Size, ULONG Tag, const char* FileName, int LineNumber);
 __forceinline BOOL UntrackAllocation(PVOID Address);
 __forceinline PVOID ExAllocatePoolWithTracking(POOL_TYPE PoolType, SIZE_T NumberOfBytes, const char* FileName, int LineNumber);
+__forceinline PVOID ExAllocatePoolWithTagTracking(POOL_TYPE PoolType, SIZE_T NumberOfBytes, ULONG Tag, const char* FileName, int LineNumber);
 __forceinline PVOID ExAllocatePool(POOL_TYPE PoolType, SIZE_T NumberOfBytes);
+__forceinline PVOID ExAllocateCacheAlignedPoolWithTracking(POOL_TYPE PoolType, SIZE_T NumberOfBytes, PVOID* Allocation, const char* FileName, int LineNumber);
 __forceinline void _ExFreePoolWithTracking(PVOID pointer, const char* FileName, int LineNumber);
 __forceinline void ExFreePool(PVOID pointer);
 __forceinline void PrintMemoryLeaks(void);
+__forceinline void ExQueryPoolTagUsage(ULONG Tag, SIZE_T* Allocations, SIZE_T* Bytes);
 __forceinline void SetErrorSuppression(BOOL suppress);
 __forceinline BOOL GetErrorSuppression(void);
 
@@ -80,9 +90,14 @@ static GLOBAL_STATE* g_State = NULL;
 /* Global state accessor */
 __forceinline GLOBAL_STATE* GetGlobalState(void) {
     if (g_State == NULL) {
-        GLOBAL_STATE* temp = (GLOBAL_STATE*)HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(GLOBAL_STATE));
-        if (temp != NULL) {
+        // The sharded counters need cache alignment, HeapAlloc gives 16 bytes
+        PVOID block = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(GLOBAL_STATE) + SYSTEM_CACHE_ALIGNMENT_SIZE - 1);
+        if (block != NULL) {
+            GLOBAL_STATE* temp = (GLOBAL_STATE*)(((ULONG_PTR)block + SYSTEM_CACHE_ALIGNMENT_SIZE - 1) &
+                                                 ~(ULONG_PTR)(SYSTEM_CACHE_ALIGNMENT_SIZE - 1));
+            temp->Allocation = block;
             InitializeCriticalSection(&temp->MemoryTrackingLock);
+            RtlInitializeBitMap(&temp->AllocationBitMap, temp->AllocationBitMapBuffer, MAX_ALLOCATIONS);
             temp->HeapHandle = GetProcessHeap();
             g_State = temp;
         }
@@ -97,8 +112,9 @@ __forceinline BOOL InitHeap(void) {
     }
     
     ZeroMemory(state->MemoryAllocations, sizeof(state->MemoryAllocations));
-    state->AllocationCount = 0;
-    state->TotalBytesAllocated = 0;
+    RtlClearAllBits(&state->AllocationBitMap);
+    RtlInitializeShardedCounter(&state->AllocationCount);
+    RtlInitializeShardedCounter(&state->TotalBytesAllocated);
     state->CurrentBytesAllocated = 0;
     state->PeakBytesAllocated = 0;
     state->SuppressErrors = FALSE;
@@ -111,37 +127,45 @@ __forceinline void CleanupHeap(void) {
     GLOBAL_STATE* state = GetGlobalState();
     if (state) {
         DeleteCriticalSection(&state->MemoryTrackingLock);
-        HeapFree(GetProcessHeap(), 0, state);
+        HeapFree(GetProcessHeap(), 0, state->Allocation);
         g_State = NULL;
     }
 }
 
 __forceinline void TrackAllocation(PVOID Address, SIZE_T Size, const char* FileName, int LineNumber) {
+    TrackAllocationWithTag(Address, Size, 0, FileName, LineNumber);
+}
+
+__forceinline void TrackAllocationWithTag(PVOID Address, SIZE_T Size, ULONG Tag, const char* FileName, int LineNumber) {
     GLOBAL_STATE* state;
-    SIZE_T i;
+    ULONG i;
     
     state = GetGlobalState();
     if (!state) return;
     
     EnterCriticalSection(&state->MemoryTrackingLock);
     
-    for (i = 0; i < MAX_ALLOCATIONS; i++) {
-        if (state->MemoryAllocations[i].Address == NULL || !state->MemoryAllocations[i].IsAllocated) {
-            state->MemoryAllocations[i].Address = Address;
-            state->MemoryAllocations[i].Size = Size;
-            state->MemoryAllocations[i].FileName = FileName;
-            state->MemoryAllocations[i].LineNumber = LineNumber;
-            state->MemoryAllocations[i].IsAllocated = TRUE;
-            
-            state->AllocationCount++;
-            state->TotalBytesAllocated += Size;
-            state->CurrentBytesAllocated += Size;
-            if (state->CurrentBytesAllocated > state->PeakBytesAllocated)
-                state->PeakBytesAllocated = state->CurrentBytesAllocated;
-            
-            LeaveCriticalSection(&state->MemoryTrackingLock);
-            return;
-        }    }
+    // Free slots are tracked in a bitmap so the search is word-at-a-time
+    i = RtlFindClearBitsAndSet(&state->AllocationBitMap, 1, 0);
+    if (i != RTL_BITMAP_NOT_FOUND) {
+        state->MemoryAllocations[i].Address = Address;
+        state->MemoryAllocations[i].Size = Size;
+        state->MemoryAllocations[i].FileName = FileName;
+        state->MemoryAllocations[i].LineNumber = LineNumber;
+        state->MemoryAllocations[i].Tag = Tag;
+        state->MemoryAllocations[i].IsAllocated = TRUE;
+        
+        // Current and peak must move together, so they stay under the lock
+        state->CurrentBytesAllocated += Size;
+        if (state->CurrentBytesAllocated > state->PeakBytesAllocated)
+            state->PeakBytesAllocated = state->CurrentBytesAllocated;
+        
+        LeaveCriticalSection(&state->MemoryTrackingLock);
+        
+        RtlIncrementShardedCounter(&state->AllocationCount);
+        RtlAddShardedCounter(&state->TotalBytesAllocated, (LONG64)Size);
+        return;
+    }
     
     state->TrackingTableFull = TRUE;
     if (!state->SuppressErrors) {
@@ -165,6 +189,7 @@ __forceinline BOOL UntrackAllocation(PVOID Address) {
     for (i = 0; i < MAX_ALLOCATIONS; i++) {
         if (state->MemoryAllocations[i].Address == Address && state->MemoryAllocations[i].IsAllocated) {
             state->MemoryAllocations[i].IsAllocated = FALSE;
+            RtlClearBits(&state->AllocationBitMap, (ULONG)i, 1);
             state->CurrentBytesAllocated -= state->MemoryAllocations[i].Size;
             found = TRUE;
             break;
@@ -176,9 +201,12 @@ __forceinline BOOL UntrackAllocation(PVOID Address) {
 }
 
 __forceinline PVOID ExAllocatePoolWithTracking(POOL_TYPE PoolType, SIZE_T NumberOfBytes, const char* FileName, int LineNumber) {
+    return ExAllocatePoolWithTagTracking(PoolType, NumberOfBytes, 0, FileName, LineNumber);
+}
+
+__forceinline PVOID ExAllocatePoolWithTagTracking(POOL_TYPE PoolType, SIZE_T NumberOfBytes, ULONG Tag, const char* FileName, int LineNumber) {
     GLOBAL_STATE* state;
     BOOL hasTrackingSlot = FALSE;
-    SIZE_T i;
     PVOID ptr;
     
     state = GetGlobalState();
@@ -187,13 +215,7 @@ __forceinline PVOID ExAllocatePoolWithTracking(POOL_TYPE PoolType, SIZE_T Number
     // Only check for tracking slots if the table isn't already full
     if (!state->TrackingTableFull) {
         EnterCriticalSection(&state->MemoryTrackingLock);
-        
-        for (i = 0; i < MAX_ALLOCATIONS; i++) {
-            if (state->MemoryAllocations[i].Address == NULL || !state->MemoryAllocations[i].IsAllocated) {
-                hasTrackingSlot = TRUE;
-                break;
-            }
-        }
+        hasTrackingSlot = RtlFindClearBits(&state->AllocationBitMap, 1, 0) != RTL_BITMAP_NOT_FOUND;
         LeaveCriticalSection(&state->MemoryTrackingLock);
         
         if (!hasTrackingSlot) {
@@ -218,7 +240,7 @@ __forceinline PVOID ExAllocatePoolWithTracking(POOL_TYPE PoolType, SIZE_T Number
     
     if (hasTrackingSlot) {
         // Only track if we have a slot available
-        TrackAllocation(ptr, NumberOfBytes, FileName, LineNumber);
+        TrackAllocationWithTag(ptr, NumberOfBytes, Tag, FileName, LineNumber);
     }
     
     return ptr;
@@ -228,6 +250,29 @@ __forceinline PVOID ExAllocatePool(POOL_TYPE PoolType, SIZE_T NumberOfBytes) {
     return ExAllocatePoolWithTracking(PoolType, NumberOfBytes, "Unknown", 0);
 }
 
+/*
+ * HeapAlloc only aligns blocks to 16 bytes, too little for structures laid
+ * out with DECLSPEC_CACHEALIGN. This over-allocates by a cache line and
+ * returns the first cache-aligned address in the block; *Allocation receives
+ * the block itself, which is what must be freed.
+ */
+__forceinline PVOID ExAllocateCacheAlignedPoolWithTracking(POOL_TYPE PoolType, SIZE_T NumberOfBytes, PVOID* Allocation, const char* FileName, int LineNumber) {
+    PVOID ptr;
+
+    *Allocation = NULL;
+    if (NumberOfBytes > (SIZE_T)-1 - (SYSTEM_CACHE_ALIGNMENT_SIZE - 1)) {
+        return NULL;
+    }
+
+    ptr = ExAllocatePoolWithTracking(PoolType, NumberOfBytes + SYSTEM_CACHE_ALIGNMENT_SIZE - 1, FileName, LineNumber);
+    if (ptr == NULL) {
+        return NULL;
+    }
+
+    *Allocation = ptr;
+    return (PVOID)(((ULONG_PTR)ptr + SYSTEM_CACHE_ALIGNMENT_SIZE - 1) & ~(ULONG_PTR)(SYSTEM_CACHE_ALIGNMENT_SIZE - 1));
+}
+
 __forceinline void _ExFreePoolWithTracking(PVOID pointer, const char* FileName, int LineNumber) {
     GLOBAL_STATE* state;
     BOOL found;
@@ -251,12 +296,25 @@ __forceinline void ExFreePool(PVOID pointer) {
     _ExFreePoolWithTracking(pointer, "Unknown", 0);
 }
 
+/* Renders a pool tag as its four characters, low byte first, or "----" for untagged */
+__forceinline const char* FormatPoolTag(ULONG Tag, char Text[5]) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        char c = (char)((Tag >> (8 * i)) & 0xFF);
+        Text[i] = (Tag == 0) ? '-' : ((c >= 0x20 && c < 0x7F) ? c : '.');
+    }
+    Text[4] = '\0';
+    return Text;
+}
+
 __forceinline void PrintMemoryLeaks(void) {
     GLOBAL_STATE* state;
     BOOL foundLeaks;
     SIZE_T leakCount;
     SIZE_T leakBytes;
     SIZE_T i;
+    char tagText[5];
     
     state = GetGlobalState();
     if (!state) return;
@@ -272,14 +330,15 @@ __forceinline void PrintMemoryLeaks(void) {
     for (i = 0; i < MAX_ALLOCATIONS; i++) {
         if (state->MemoryAllocations[i].IsAllocated && state->MemoryAllocations[i].Address != NULL) {
             if (!foundLeaks) {
-                printf("Address       | Size     | Allocation Location\n");
-                printf("------------- | -------- | ------------------\n");
+                printf("Address       | Size     | Tag  | Allocation Location\n");
+                printf("------------- | -------- | ---- | ------------------\n");
                 foundLeaks = TRUE;
             }
             
-            printf("%p | %8d | %s:%d\n", 
+            printf("%p | %8d | %s | %s:%d\n", 
                 state->MemoryAllocations[i].Address,
                 (int)state->MemoryAllocations[i].Size,
+                FormatPoolTag(state->MemoryAllocations[i].Tag, tagText),
                 state->MemoryAllocations[i].FileName,
                 state->MemoryAllocations[i].LineNumber);
                 
@@ -295,14 +354,41 @@ __forceinline void PrintMemoryLeaks(void) {
     }
     
     printf("Memory usage statistics:\n");
-    printf("  Total allocations: %d\n", (int)state->AllocationCount);
-    printf("  Total bytes allocated: %d\n", (int)state->TotalBytesAllocated);
+    printf("  Total allocations: %d\n", (int)RtlReadShardedCounter(&state->AllocationCount));
+    printf("  Total bytes allocated: %d\n", (int)RtlReadShardedCounter(&state->TotalBytesAllocated));
     printf("  Peak bytes allocated: %d\n", (int)state->PeakBytesAllocated);
     printf("===========================\n");
     
     LeaveCriticalSection(&state->MemoryTrackingLock);
 }
 
+/*
+ * Sums the live allocations made with a given pool tag. This walks the whole
+ * tracking table under the lock, so it is meant for diagnostics and tests,
+ * not for hot paths.
+ */
+__forceinline void ExQueryPoolTagUsage(ULONG Tag, SIZE_T* Allocations, SIZE_T* Bytes) {
+    GLOBAL_STATE* state;
+    SIZE_T count = 0;
+    SIZE_T bytes = 0;
+    SIZE_T i;
+
+    state = GetGlobalState();
+    if (state) {
+        EnterCriticalSection(&state->MemoryTrackingLock);
+        for (i = 0; i < MAX_ALLOCATIONS; i++) {
+            if (state->MemoryAllocations[i].IsAllocated && state->MemoryAllocations[i].Tag == Tag) {
+                count++;
+                bytes += state->MemoryAllocations[i].Size;
+            }
+        }
+        LeaveCriticalSection(&state->MemoryTrackingLock);
+    }
+
+    if (Allocations) *Allocations = count;
+    if (Bytes) *Bytes = bytes;
+}
+
 /* Error suppression control functions */
 __forceinline void SetErrorSuppression(BOOL suppress) {
     GLOBAL_STATE* state = GetGlobalState();
@@ -323,6 +409,15 @@ __forceinline BOOL GetErrorSuppression(void) {
 #define ExAllocatePoolTracked(PoolType, NumberOfBytes) \
     ExAllocatePoolWithTracking(PoolType, NumberOfBytes, __FILE__, __LINE__)
 
+#define ExAllocateCacheAlignedPoolTracked(PoolType, NumberOfBytes, Allocation) \
+    ExAllocateCacheAlignedPoolWithTracking(PoolType, NumberOfBytes, Allocation, __FILE__, __LINE__)
+
+#define ExAllocatePoolWithTag(PoolType, NumberOfBytes, Tag) \
+    ExAllocatePoolWithTagTracking(PoolType, NumberOfBytes, Tag, __FILE__, __LINE__)
+
+#define ExFreePoolWithTag(pointer, Tag) \
+    _ExFreePoolWithTracking(pointer, __FILE__, __LINE__)
+
 #define ExFreePoolTracked(pointer) \
     _ExFreePoolWithTracking(pointer, __FILE__, __LINE__)
 
@@ -173,7 +173,8 @@ InsertHeadList(
  *
  * @param[in,out] ListHead Pointer to the head of the first list
  * @param[in,out] ListToAppend Pointer to the head of the list to be appended
- * @note After this operation, ListToAppend should not be used without re-initialization
+ * @note After this operation, ListToAppend should not be used without re-initialization.
+ *       Use SpliceListTail to move the entries and keep ListToAppend usable.
  */
 static __forceinline
 void
@@ -203,6 +204,425 @@ AppendTailList(
     }
 }
 
+/**
+ * @brief Moves every entry of one list to the tail of another
+ *
+ * Unlike AppendTailList, the source list is re-initialized and can be used
+ * again immediately. Runs in O(1) regardless of the number of entries moved.
+ *
+ * @param[in,out] ListHead Pointer to the head of the destination list
+ * @param[in,out] ListToMove Pointer to the head of the list whose entries are moved
+ * @note ListToMove is left as a valid empty list
+ */
+static __forceinline
+void
+SpliceListTail(
+    _Inout_ PLIST_ENTRY ListHead,
+    _Inout_ PLIST_ENTRY ListToMove
+)
+{
+    if (ListToMove->Flink == ListToMove) {
+        return;
+    }
+
+    AppendTailList(ListHead, ListToMove);
+    ListToMove->Flink = ListToMove->Blink = ListToMove;
+}
+
+/**
+ * @brief Moves every entry of one list to the head of another
+ *
+ * The moved entries keep their order and end up in front of the existing
+ * entries of ListHead. Runs in O(1).
+ *
+ * @param[in,out] ListHead Pointer to the head of the destination list
+ * @param[in,out] ListToMove Pointer to the head of the list whose entries are moved
+ * @note ListToMove is left as a valid empty list
+ */
+static __forceinline
+void
+SpliceListHead(
+    _Inout_ PLIST_ENTRY ListHead,
+    _Inout_ PLIST_ENTRY ListToMove
+)
+{
+    if (ListToMove->Flink == ListToMove) {
+        return;
+    }
+
+    {
+        PLIST_ENTRY const FirstNew = ListToMove->Flink;
+        PLIST_ENTRY const LastNew = ListToMove->Blink;
+        PLIST_ENTRY const FirstOld = ListHead->Flink;
+
+        ListHead->Flink = FirstNew;
+        FirstNew->Blink = ListHead;
+        LastNew->Flink = FirstOld;
+        FirstOld->Blink = LastNew;
+    }
+
+    ListToMove->Flink = ListToMove->Blink = ListToMove;
+}
+
+/**
+ * @brief Unlinks a contiguous run of entries from its list
+ *
+ * The entries from First to Last (inclusive, following Flink) are removed
+ * from the list that contains them. Their internal links are preserved, so
+ * the run can be inserted elsewhere with MoveListRangeTail/MoveListRangeHead
+ * or walked from First to Last. Runs in O(1).
+ *
+ * @param[in,out] First Pointer to the first entry of the run
+ * @param[in,out] Last Pointer to the last entry of the run (may equal First)
+ * @note First and Last must belong to the same list, Last must not precede
+ *       First, and the run must not include the list head
+ */
+static __forceinline
+void
+RemoveListRange(
+    _Inout_ PLIST_ENTRY First,
+    _Inout_ PLIST_ENTRY Last
+)
+{
+    PLIST_ENTRY const Before = First->Blink;
+    PLIST_ENTRY const After = Last->Flink;
+
+    Before->Flink = After;
+    After->Blink = Before;
+}
+
+/**
+ * @brief Moves a contiguous run of entries to the tail of a list
+ *
+ * Removes the entries from First to Last (inclusive) from their current list
+ * and appends them, in order, to ListHead. Runs in O(1).
+ *
+ * @param[in,out] ListHead Pointer to the head of the destination list
+ * @param[in,out] First Pointer to the first entry of the run
+ * @param[in,out] Last Pointer to the last entry of the run (may equal First)
+ * @note The same restrictions as RemoveListRange apply; ListHead may be the
+ *       list the run is taken from as long as it is not part of the run
+ */
+static __forceinline
+void
+MoveListRangeTail(
+    _Inout_ PLIST_ENTRY ListHead,
+    _Inout_ PLIST_ENTRY First,
+    _Inout_ PLIST_ENTRY Last
+)
+{
+    RemoveListRange(First, Last);
+
+    {
+        PLIST_ENTRY const Blink = ListHead->Blink;
+
+        Blink->Flink = First;
+        First->Blink = Blink;
+        Last->Flink = ListHead;
+        ListHead->Blink = Last;
+    }
+}
+
+/**
+ * @brief Moves a contiguous run of entries to the head of a list
+ *
+ * Removes the entries from First to Last (inclusive) from their current list
+ * and inserts them, in order, at the front of ListHead. Runs in O(1).
+ *
+ * @param[in,out] ListHead Pointer to the head of the destination list
+ * @param[in,out] First Pointer to the first entry of the run
+ * @param[in,out] Last Pointer to the last entry of the run (may equal First)
+ * @note The same restrictions as MoveListRangeTail apply
+ */
+static __forceinline
+void
+MoveListRangeHead(
+    _Inout_ PLIST_ENTRY ListHead,
+    _Inout_ PLIST_ENTRY First,
+    _Inout_ PLIST_ENTRY Last
+)
+{
+    RemoveListRange(First, Last);
+
+    {
+        PLIST_ENTRY const Flink = ListHead->Flink;
+
+        ListHead->Flink = First;
+        First->Blink = ListHead;
+        Last->Flink = Flink;
+        Flink->Blink = Last;
+    }
+}
+
+/**
+ * @brief Splits a list in two at the given entry
+ *
+ * Entry and every entry after it are moved, in order, to NewListHead, which
+ * is initialized by this function. The entries before Entry stay in ListHead.
+ * Passing ListHead itself as Entry leaves NewListHead empty. Runs in O(1).
+ *
+ * @param[in,out] ListHead Pointer to the head of the list to split
+ * @param[in,out] Entry Pointer to the first entry to move (an entry of ListHead, or ListHead)
+ * @param[out] NewListHead Pointer to the LIST_ENTRY that receives the tail of the list
+ */
+static __forceinline
+void
+SplitListAtEntry(
+    _Inout_ PLIST_ENTRY ListHead,
+    _Inout_ PLIST_ENTRY Entry,
+    _Out_ PLIST_ENTRY NewListHead
+)
+{
+    if (Entry == ListHead) {
+        NewListHead->Flink = NewListHead->Blink = NewListHead;
+        return;
+    }
+
+    {
+        PLIST_ENTRY const Last = ListHead->Blink;
+        PLIST_ENTRY const Before = Entry->Blink;
+
+        // Close the original list before Entry
+        Before->Flink = ListHead;
+        ListHead->Blink = Before;
+
+        // Hang Entry..Last off the new head
+        NewListHead->Flink = Entry;
+        Entry->Blink = NewListHead;
+        NewListHead->Blink = Last;
+        Last->Flink = NewListHead;
+    }
+}
 
+/**
+ * @brief Cursor for a forward walk over a list that prefetches ahead
+ *
+ * A plain Flink walk stalls on every node: the address of the next entry is
+ * only known once the current one has been loaded. The iterator reads the
+ * next link as soon as an entry is handed out and issues a prefetch for it,
+ * so the miss on the following node overlaps with the caller's work on the
+ * current one. The next link is captured before the entry is returned, which
+ * also makes it safe to remove (and free) the returned entry during the walk.
+ */
+typedef struct _LIST_ITERATOR {
+    PLIST_ENTRY ListHead;   /**< Sentinel of the list being walked */
+    PLIST_ENTRY Next;       /**< Entry returned by the next call to ListIteratorNext */
+} LIST_ITERATOR, *PLIST_ITERATOR;
+
+/**
+ * @brief Positions an iterator before the first entry of a list
+ *
+ * @param[out] Iterator Pointer to the iterator to initialize
+ * @param[in] ListHead Pointer to the head of the list to walk
+ */
+static __forceinline
+void
+InitializeListIterator(
+    _Out_ PLIST_ITERATOR Iterator,
+    _In_ PLIST_ENTRY ListHead
+)
+{
+    Iterator->ListHead = ListHead;
+    Iterator->Next = ListHead->Flink;
+    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Iterator->Next);
+}
+
+/**
+ * @brief Returns the next entry of the walk and prefetches the one after it
+ *
+ * @param[in,out] Iterator Pointer to an iterator set up by InitializeListIterator
+ * @return The next entry, or NULL once the walk is back at the list head
+ * @note Entries inserted directly after the returned entry during the walk
+ *       are not visited
+ */
+static __forceinline
+PLIST_ENTRY
+ListIteratorNext(
+    _Inout_ PLIST_ITERATOR Iterator
+)
+{
+    PLIST_ENTRY const Entry = Iterator->Next;
+
+    if (Entry == Iterator->ListHead) {
+        return NULL;
+    }
+
+    Iterator->Next = Entry->Flink;
+    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Iterator->Next);
+    return Entry;
+}
+
+/**
+ * @brief Comparison callback used by the list sorting routines
+ *
+ * @param[in] First Pointer to the first LIST_ENTRY to compare
+ * @param[in] Second Pointer to the second LIST_ENTRY to compare
+ * @param[in] Context Caller-supplied context passed through unchanged
+ * @return Negative if First sorts before Second, zero if they are equal,
+ *         positive if First sorts after Second
+ */
+typedef LONG (*PLIST_ENTRY_COMPARE_ROUTINE)(
+    _In_ PLIST_ENTRY First,
+    _In_ PLIST_ENTRY Second,
+    _In_opt_ PVOID Context
+);
+
+/**
+ * @brief Merges two sorted NULL-terminated Flink chains (internal helper)
+ *
+ * Entries from Older are taken first when the comparison reports equality,
+ * which keeps the merge stable. Blink pointers are not maintained.
+ *
+ * @return Head of the merged chain
+ */
+static __forceinline
+PLIST_ENTRY
+RtlpMergeListChains(
+    _In_opt_ PLIST_ENTRY Older,
+    _In_opt_ PLIST_ENTRY Newer,
+    _In_ PLIST_ENTRY_COMPARE_ROUTINE CompareRoutine,
+    _In_opt_ PVOID Context
+)
+{
+    LIST_ENTRY Head;
+    PLIST_ENTRY Tail = &Head;
+
+    while (Older != NULL && Newer != NULL) {
+        if (CompareRoutine(Older, Newer, Context) <= 0) {
+            Tail->Flink = Older;
+            Older = Older->Flink;
+        } else {
+            Tail->Flink = Newer;
+            Newer = Newer->Flink;
+        }
+        Tail = Tail->Flink;
+    }
+    Tail->Flink = (Older != NULL) ? Older : Newer;
+    return Head.Flink;
+}
+
+/**
+ * @brief Links a NULL-terminated Flink chain back into a circular list (internal helper)
+ *
+ * Rebuilds every Blink pointer and closes the circle through ListHead.
+ */
+static __forceinline
+void
+RtlpRelinkListChain(
+    _Inout_ PLIST_ENTRY ListHead,
+    _In_opt_ PLIST_ENTRY Chain
+)
+{
+    PLIST_ENTRY Previous = ListHead;
 
+    while (Chain != NULL) {
+        Previous->Flink = Chain;
+        Chain->Blink = Previous;
+        Previous = Chain;
+        Chain = Chain->Flink;
+    }
+    Previous->Flink = ListHead;
+    ListHead->Blink = Previous;
+}
 
+/**
+ * @brief Sorts a list in place using a stable bottom-up merge sort
+ *
+ * Runs in O(n log n) comparisons and performs no memory allocation: sorted
+ * runs of 1, 2, 4, ... entries are kept in a fixed array of bins on the stack
+ * and merged by relinking Flink pointers. Blink pointers are rebuilt in a
+ * single final pass. Entries that compare equal keep their original order.
+ *
+ * @param[in,out] ListHead Pointer to the head of the list to sort
+ * @param[in] CompareRoutine Callback that orders two entries
+ * @param[in] Context Optional value passed to every CompareRoutine call
+ */
+static __forceinline
+void
+MergeSortList(
+    _Inout_ PLIST_ENTRY ListHead,
+    _In_ PLIST_ENTRY_COMPARE_ROUTINE CompareRoutine,
+    _In_opt_ PVOID Context
+)
+{
+    // Bin i holds a sorted chain of exactly 2^i entries, or NULL
+    PLIST_ENTRY Bins[sizeof(SIZE_T) * 8] = { 0 };
+    PLIST_ENTRY Entry;
+    PLIST_ENTRY Sorted = NULL;
+    ULONG Index;
+
+    // Lists of zero or one entry are already sorted
+    if (ListHead->Flink == ListHead->Blink) {
+        return;
+    }
+
+    // Detach the entries as a NULL-terminated chain
+    Entry = ListHead->Flink;
+    ListHead->Blink->Flink = NULL;
+
+    while (Entry != NULL) {
+        PLIST_ENTRY Carry = Entry;
+        Entry = Entry->Flink;
+        Carry->Flink = NULL;
+
+        // Bins hold older entries than Carry, so they go first to stay stable
+        for (Index = 0; Bins[Index] != NULL; Index++) {
+            Carry = RtlpMergeListChains(Bins[Index], Carry, CompareRoutine, Context);
+            Bins[Index] = NULL;
+        }
+        Bins[Index] = Carry;
+    }
+
+    // Higher bins hold older entries
+    for (Index = 0; Index < sizeof(Bins) / sizeof(Bins[0]); Index++) {
+        if (Bins[Index] != NULL) {
+            Sorted = (Sorted == NULL) ? Bins[Index] : RtlpMergeListChains(Bins[Index], Sorted, CompareRoutine, Context);
+        }
+    }
+
+    RtlpRelinkListChain(ListHead, Sorted);
+}
+
+/**
+ * @brief Merges two sorted lists into one
+ *
+ * Moves every entry of ListToMerge into ListHead so that the result is sorted.
+ * Both lists must already be sorted by CompareRoutine. Runs in O(n + m) and
+ * performs no memory allocation. When entries compare equal, those from
+ * ListHead come first.
+ *
+ * @param[in,out] ListHead Pointer to the head of the list that receives the result
+ * @param[in,out] ListToMerge Pointer to the head of the list to merge in
+ * @param[in] CompareRoutine Callback that orders two entries
+ * @param[in] Context Optional value passed to every CompareRoutine call
+ * @note ListToMerge is left as a valid empty list
+ */
+static __forceinline
+void
+MergeSortedLists(
+    _Inout_ PLIST_ENTRY ListHead,
+    _Inout_ PLIST_ENTRY ListToMerge,
+    _In_ PLIST_ENTRY_COMPARE_ROUTINE CompareRoutine,
+    _In_opt_ PVOID Context
+)
+{
+    PLIST_ENTRY First;
+    PLIST_ENTRY Second;
+
+    if (ListToMerge->Flink == ListToMerge) {
+        return;
+    }
+
+    if (ListHead->Flink == ListHead) {
+        First = NULL;
+    } else {
+        First = ListHead->Flink;
+        ListHead->Blink->Flink = NULL;
+    }
+
+    Second = ListToMerge->Flink;
+    ListToMerge->Blink->Flink = NULL;
+    ListToMerge->Flink = ListToMerge->Blink = ListToMerge;
+
+    RtlpRelinkListChain(ListHead, RtlpMergeListChains(First, Second, CompareRoutine, Context));
+}
@@ -0,0 +1,193 @@
+/**
+ * @file Lookaside.h
+ * @brief Windows kernel-style lookaside lists for fixed-size allocations
+ *
+ * A lookaside list keeps a bounded cache of freed blocks of one size on an
+ * interlocked singly linked list (SLIST). Allocation pops a cached block and
+ * only falls back to the pool when the cache is empty; freeing pushes the
+ * block back unless the cache already holds Depth blocks. Both paths are
+ * lock-free, which makes the list a good fit for objects that are allocated
+ * and freed at high rates, such as work items.
+ *
+ * Blocks must be at least sizeof(SLIST_ENTRY) bytes; the first bytes of a
+ * cached block are used as the link.
+ */
+
+#ifndef WINKERNEL_LOOKASIDE_H_
+#define WINKERNEL_LOOKASIDE_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Depth used when the caller passes 0 */
+#define LOOKASIDE_DEFAULT_DEPTH 256
+
+typedef PVOID (*PALLOCATE_FUNCTION)(
+    _In_ POOL_TYPE PoolType,
+    _In_ SIZE_T NumberOfBytes,
+    _In_ ULONG Tag
+);
+
+typedef VOID (*PFREE_FUNCTION)(
+    _In_ PVOID Buffer
+);
+
+/**
+ * @brief Lookaside list header modeled on NPAGED_LOOKASIDE_LIST
+ *
+ * As in the kernel, the statistics counters are updated without interlocked
+ * operations and are only approximate under concurrency.
+ */
+typedef struct _NPAGED_LOOKASIDE_LIST {
+    SLIST_HEADER ListHead;          /**< Cached free blocks */
+    USHORT Depth;                   /**< Maximum number of cached blocks */
+    POOL_TYPE Type;                 /**< Pool passed to Allocate */
+    ULONG Tag;                      /**< Tag passed to Allocate */
+    SIZE_T Size;                    /**< Size of every block in bytes */
+    PALLOCATE_FUNCTION Allocate;    /**< Called when the cache is empty */
+    PFREE_FUNCTION Free;            /**< Called when the cache is full, and on delete */
+    ULONG TotalAllocates;           /**< Number of allocation requests */
+    ULONG AllocateMisses;           /**< Allocation requests that went to the pool */
+    ULONG TotalFrees;               /**< Number of free requests */
+    ULONG FreeMisses;               /**< Free requests that went to the pool */
+} NPAGED_LOOKASIDE_LIST, *PNPAGED_LOOKASIDE_LIST;
+
+/*
+ * Default pool callbacks, used when the caller does not supply its own.
+ */
+static __forceinline
+PVOID
+ExpLookasideAllocate(
+    _In_ POOL_TYPE PoolType,
+    _In_ SIZE_T NumberOfBytes,
+    _In_ ULONG Tag
+)
+{
+    return ExAllocatePoolWithTag(PoolType, NumberOfBytes, Tag);
+}
+
+static __forceinline
+VOID
+ExpLookasideFree(
+    _In_ PVOID Buffer
+)
+{
+    ExFreePool(Buffer);
+}
+
+/**
+ * @brief Initializes a lookaside list
+ *
+ * @param[out] Lookaside Pointer to the list header to initialize
+ * @param[in] Allocate Optional allocation callback; NULL uses the tracked pool
+ * @param[in] Free Optional free callback; NULL uses ExFreePool
+ * @param[in] Flags Reserved, must be 0
+ * @param[in] Size Size of each block in bytes; rounded up to sizeof(SLIST_ENTRY)
+ * @param[in] Tag Pool tag passed to Allocate
+ * @param[in] Depth Maximum number of cached blocks, or 0 for LOOKASIDE_DEFAULT_DEPTH
+ */
+static __forceinline
+VOID
+ExInitializeNPagedLookasideList(
+    _Out_ PNPAGED_LOOKASIDE_LIST Lookaside,
+    _In_opt_ PALLOCATE_FUNCTION Allocate,
+    _In_opt_ PFREE_FUNCTION Free,
+    _In_ ULONG Flags,
+    _In_ SIZE_T Size,
+    _In_ ULONG Tag,
+    _In_ USHORT Depth
+)
+{
+    UNREFERENCED_PARAMETER(Flags);
+
+    InitializeSListHead(&Lookaside->ListHead);
+    Lookaside->Depth = (Depth != 0) ? Depth : LOOKASIDE_DEFAULT_DEPTH;
+    Lookaside->Type = NonPagedPool;
+    Lookaside->Tag = Tag;
+    Lookaside->Size = (Size < sizeof(SLIST_ENTRY)) ? sizeof(SLIST_ENTRY) : Size;
+    Lookaside->Allocate = (Allocate != NULL) ? Allocate : ExpLookasideAllocate;
+    Lookaside->Free = (Free != NULL) ? Free : ExpLookasideFree;
+    Lookaside->TotalAllocates = 0;
+    Lookaside->AllocateMisses = 0;
+    Lookaside->TotalFrees = 0;
+    Lookaside->FreeMisses = 0;
+}
+
+/**
+ * @brief Frees every cached block of a lookaside list
+ *
+ * Blocks currently handed out are not affected and must be freed with the
+ * list's Free callback (or ExFreePool for the default) by their owners.
+ *
+ * @param[in,out] Lookaside Pointer to the list header
+ */
+static __forceinline
+VOID
+ExDeleteNPagedLookasideList(
+    _Inout_ PNPAGED_LOOKASIDE_LIST Lookaside
+)
+{
+    PSLIST_ENTRY Entry = InterlockedFlushSList(&Lookaside->ListHead);
+
+    while (Entry != NULL) {
+        PSLIST_ENTRY Next = Entry->Next;
+        Lookaside->Free(Entry);
+        Entry = Next;
+    }
+}
+
+/**
+ * @brief Allocates a block from a lookaside list
+ *
+ * @param[in,out] Lookaside Pointer to the list header
+ * @return Pointer to a block of Lookaside->Size bytes, or NULL if the pool is exhausted
+ */
+_Must_inspect_result_
+static __forceinline
+PVOID
+ExAllocateFromNPagedLookasideList(
+    _Inout_ PNPAGED_LOOKASIDE_LIST Lookaside
+)
+{
+    PVOID Entry;
+
+    Lookaside->TotalAllocates++;
+    Entry = InterlockedPopEntrySList(&Lookaside->ListHead);
+    if (Entry == NULL) {
+        Lookaside->AllocateMisses++;
+        Entry = Lookaside->Allocate(Lookaside->Type, Lookaside->Size, Lookaside->Tag);
+    }
+    return Entry;
+}
+
+/**
+ * @brief Returns a block to a lookaside list
+ *
+ * @param[in,out] Lookaside Pointer to the list header
+ * @param[in] Entry Block previously returned by ExAllocateFromNPagedLookasideList
+ */
+static __forceinline
+VOID
+ExFreeToNPagedLookasideList(
+    _Inout_ PNPAGED_LOOKASIDE_LIST Lookaside,
+    _In_ __drv_aliasesMem PVOID Entry
+)
+{
+    Lookaside->TotalFrees++;
+    if (QueryDepthSList(&Lookaside->ListHead) >= Lookaside->Depth) {
+        Lookaside->FreeMisses++;
+        Lookaside->Free(Entry);
+    } else {
+        InterlockedPushEntrySList(&Lookaside->ListHead, (PSLIST_ENTRY)Entry);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_LOOKASIDE_H_ */
@@ -0,0 +1,65 @@
+/**
+ * @file NtStatus.h
+ * @brief NTSTATUS type and the status codes returned by WinKernelLite routines
+ *
+ * Each code is only defined when the including translation unit has not
+ * already pulled in <ntstatus.h>, so the library can be mixed with the
+ * platform headers (WIN32_NO_STATUS + <ntstatus.h>) without redefinitions.
+ */
+
+#ifndef WINKERNEL_NTSTATUS_H_
+#define WINKERNEL_NTSTATUS_H_
+
+#include <Windows.h>
+
+typedef LONG NTSTATUS;
+
+#ifndef STATUS_SUCCESS
+#define STATUS_SUCCESS ((NTSTATUS)0x00000000L)
+#endif
+
+#ifndef STATUS_WAIT_0
+#define STATUS_WAIT_0 ((NTSTATUS)0x00000000L)
+#endif
+
+#ifndef STATUS_TIMEOUT
+#define STATUS_TIMEOUT ((NTSTATUS)0x00000102L)
+#endif
+
+#ifndef STATUS_SOME_NOT_MAPPED
+#define STATUS_SOME_NOT_MAPPED ((NTSTATUS)0x00000107L)
+#endif
+
+#ifndef STATUS_BUFFER_OVERFLOW
+#define STATUS_BUFFER_OVERFLOW ((NTSTATUS)0x80000005L)
+#endif
+
+#ifndef STATUS_INVALID_PARAMETER
+#define STATUS_INVALID_PARAMETER ((NTSTATUS)0xC000000DL)
+#endif
+
+#ifndef STATUS_NO_MEMORY
+#define STATUS_NO_MEMORY ((NTSTATUS)0xC0000017L)
+#endif
+
+#ifndef STATUS_BUFFER_TOO_SMALL
+#define STATUS_BUFFER_TOO_SMALL ((NTSTATUS)0xC0000023L)
+#endif
+
+#ifndef STATUS_OBJECT_NAME_NOT_FOUND
+#define STATUS_OBJECT_NAME_NOT_FOUND ((NTSTATUS)0xC0000034L)
+#endif
+
+#ifndef STATUS_INSUFFICIENT_RESOURCES
+#define STATUS_INSUFFICIENT_RESOURCES ((NTSTATUS)0xC000009AL)
+#endif
+
+#ifndef STATUS_NAME_TOO_LONG
+#define STATUS_NAME_TOO_LONG ((NTSTATUS)0xC0000106L)
+#endif
+
+#ifndef NT_SUCCESS
+#define NT_SUCCESS(Status) (((NTSTATUS)(Status)) >= 0)
+#endif
+
+#endif  /* WINKERNEL_NTSTATUS_H_ */
@@ -0,0 +1,462 @@
+/**
+ * @file Object.h
+ * @brief Reference-counted objects modeled on the object manager (Ob*)
+ *
+ * Every object is allocated behind an OBJECT_HEADER that holds its pointer
+ * count and its OBJECT_TYPE. ObCreateObject returns the object with one
+ * reference; every holder (a list, a thread, a pending request) takes its own
+ * reference with ObReferenceObject and drops it with ObDereferenceObject. The
+ * last dereference runs the type's delete procedure and frees the memory, so
+ * no holder needs to know whether another one still uses the object.
+ *
+ * Reference and dereference are one interlocked operation on the header.
+ * When the last reference may be dropped on a hot path, or while the caller
+ * holds a lock the delete procedure would need, ObDereferenceObjectDeferDelete
+ * pushes the object onto a lock-free list of its type instead of deleting it
+ * inline. The list is drained by a work item on the type's work queue, or by
+ * ObFlushDeferredDeletes when the type has no queue.
+ *
+ * Each type keeps a list of its live objects and counts them, and allocates
+ * its objects with its pool tag, so leaks are reported both per type
+ * (ObPrintObjectLeaks) and in the allocator's leak report.
+ */
+
+#ifndef WINKERNEL_OBJECT_H_
+#define WINKERNEL_OBJECT_H_
+
+#include <Windows.h>
+#include <stdio.h>
+#include "KernelHeapAlloc.h"
+#include "LinkedList.h"
+#include "NtStatus.h"
+#include "PushLock.h"
+#include "WorkQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct _OBJECT_TYPE;
+
+/**
+ * @brief Type-specific cleanup run before the memory of an object is freed
+ *
+ * Receives the object body. It must release whatever the object owns but
+ * not the object itself.
+ */
+typedef VOID (*OB_DELETE_METHOD)(
+    _In_ PVOID Object
+);
+
+/**
+ * @brief Header placed in front of every object body
+ */
+typedef struct _OBJECT_HEADER {
+    SLIST_ENTRY DeferredDeleteEntry;    /**< Link on the type's deferred delete list */
+    volatile LONG64 PointerCount;       /**< Outstanding references */
+    struct _OBJECT_TYPE* Type;          /**< Type of the object */
+    LIST_ENTRY TypeListEntry;           /**< Link on the type's list of live objects */
+    ULONGLONG Body;                     /**< Start of the object body */
+} OBJECT_HEADER, *POBJECT_HEADER;
+
+#define OBJECT_TO_OBJECT_HEADER(Object) \
+    CONTAINING_RECORD((Object), OBJECT_HEADER, Body)
+
+/**
+ * @brief Parameters of ObCreateObjectType
+ */
+typedef struct _OBJECT_TYPE_INITIALIZER {
+    POOL_TYPE PoolType;                 /**< Pool objects are allocated from */
+    ULONG PoolTag;                      /**< Tag objects are allocated with */
+    OB_DELETE_METHOD DeleteProcedure;   /**< Optional cleanup for each object */
+    PEX_WORK_QUEUE DeferredDeleteQueue; /**< Optional queue that runs deferred deletes */
+} OBJECT_TYPE_INITIALIZER, *POBJECT_TYPE_INITIALIZER;
+
+/**
+ * @brief A class of objects sharing a delete procedure, pool tag and statistics
+ */
+typedef struct _OBJECT_TYPE {
+    SLIST_HEADER DeferredDeleteList;            /**< Objects whose last reference was dropped deferred */
+    volatile LONG DeferredDeleteQueued;         /**< DeferredDeleteItem is queued and has not started */
+    WORK_QUEUE_ITEM DeferredDeleteItem;         /**< Drains DeferredDeleteList on TypeInfo.DeferredDeleteQueue */
+    EX_PUSH_LOCK ObjectListLock;                /**< Protects ObjectListHead and the counts */
+    LIST_ENTRY ObjectListHead;                  /**< Live objects of this type */
+    volatile LONG TotalNumberOfObjects;         /**< Live objects */
+    LONG HighWaterNumberOfObjects;              /**< Largest TotalNumberOfObjects seen */
+    const char* Name;                           /**< Type name used in reports */
+    OBJECT_TYPE_INITIALIZER TypeInfo;
+} OBJECT_TYPE, *POBJECT_TYPE;
+
+/*
+ * Runs the delete procedure, unlinks the object from its type and frees it.
+ */
+static __forceinline
+VOID
+ObpDeleteObject(
+    _In_ POBJECT_HEADER ObjectHeader
+)
+{
+    POBJECT_TYPE ObjectType = ObjectHeader->Type;
+
+    if (ObjectType->TypeInfo.DeleteProcedure != NULL) {
+        ObjectType->TypeInfo.DeleteProcedure(&ObjectHeader->Body);
+    }
+
+    ExAcquirePushLockExclusive(&ObjectType->ObjectListLock);
+    RemoveEntryList(&ObjectHeader->TypeListEntry);
+    ObjectType->TotalNumberOfObjects--;
+    ExReleasePushLockExclusive(&ObjectType->ObjectListLock);
+
+    ExFreePoolWithTag(ObjectHeader, ObjectType->TypeInfo.PoolTag);
+}
+
+/*
+ * Deletes every object on the type's deferred delete list, including those
+ * pushed while the list is being drained.
+ */
+static __forceinline
+VOID
+ObpProcessDeferredDeletes(
+    _Inout_ POBJECT_TYPE ObjectType
+)
+{
+    PSLIST_ENTRY Entry;
+
+    while ((Entry = InterlockedFlushSList(&ObjectType->DeferredDeleteList)) != NULL) {
+        while (Entry != NULL) {
+            POBJECT_HEADER ObjectHeader = CONTAINING_RECORD(Entry, OBJECT_HEADER, DeferredDeleteEntry);
+
+            Entry = Entry->Next;
+            ObpDeleteObject(ObjectHeader);
+        }
+    }
+}
+
+static __forceinline
+VOID
+ObpDeferredDeleteWorker(
+    _In_ PVOID Parameter
+)
+{
+    POBJECT_TYPE ObjectType = (POBJECT_TYPE)Parameter;
+
+    // Clear the flag first, so an object pushed after the drain queues the item again
+    InterlockedExchange(&ObjectType->DeferredDeleteQueued, 0);
+    ObpProcessDeferredDeletes(ObjectType);
+}
+
+/**
+ * @brief Creates an object type
+ *
+ * @param[in] TypeName Name used in leak reports; must outlive the type
+ * @param[in] ObjectTypeInitializer Pool, tag, delete procedure and deferred delete queue
+ * @param[out] ObjectType Receives the new type
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER or STATUS_INSUFFICIENT_RESOURCES
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+ObCreateObjectType(
+    _In_ const char* TypeName,
+    _In_ const OBJECT_TYPE_INITIALIZER* ObjectTypeInitializer,
+    _Out_ POBJECT_TYPE* ObjectType
+)
+{
+    POBJECT_TYPE NewType;
+
+    if (ObjectType == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+    *ObjectType = NULL;
+    if (TypeName == NULL || ObjectTypeInitializer == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    NewType = (POBJECT_TYPE)ExAllocatePoolTracked(NonPagedPool, sizeof(OBJECT_TYPE));
+    if (NewType == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(NewType, sizeof(OBJECT_TYPE));
+    InitializeSListHead(&NewType->DeferredDeleteList);
+    ExInitializeWorkItem(&NewType->DeferredDeleteItem, ObpDeferredDeleteWorker, NewType);
+    ExInitializePushLock(&NewType->ObjectListLock);
+    InitializeListHead(&NewType->ObjectListHead);
+    NewType->Name = TypeName;
+    NewType->TypeInfo = *ObjectTypeInitializer;
+
+    *ObjectType = NewType;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Prints the live objects of a type
+ *
+ * @param[in] ObjectType Type to report on
+ * @return Number of live objects
+ */
+static __forceinline
+ULONG
+ObPrintObjectLeaks(
+    _In_ POBJECT_TYPE ObjectType
+)
+{
+    PLIST_ENTRY Entry;
+    ULONG Count = 0;
+    char TagText[5];
+
+    ExAcquirePushLockShared(&ObjectType->ObjectListLock);
+
+    printf("\n=== OBJECT LEAK REPORT: %s (tag %s) ===\n",
+           ObjectType->Name, FormatPoolTag(ObjectType->TypeInfo.PoolTag, TagText));
+    for (Entry = ObjectType->ObjectListHead.Flink; Entry != &ObjectType->ObjectListHead; Entry = Entry->Flink) {
+        POBJECT_HEADER ObjectHeader = CONTAINING_RECORD(Entry, OBJECT_HEADER, TypeListEntry);
+
+        if (Count == 0) {
+            printf("Object        | References\n");
+            printf("------------- | ----------\n");
+        }
+        printf("%p | %10lld\n", (PVOID)&ObjectHeader->Body, (long long)ReadNoFence64(&ObjectHeader->PointerCount));
+        Count++;
+    }
+    if (Count == 0) {
+        printf("No live objects.\n");
+    } else {
+        printf("\nTotal: %lu live objects\n", (unsigned long)Count);
+    }
+    printf("Peak live objects: %ld\n", (long)ObjectType->HighWaterNumberOfObjects);
+
+    ExReleasePushLockShared(&ObjectType->ObjectListLock);
+    return Count;
+}
+
+/**
+ * @brief Deletes pending deferred objects and frees an object type
+ *
+ * Waits for the type's deferred delete queue to go idle, so it must not be
+ * called from one of that queue's workers. Objects still alive are reported
+ * (unless errors are suppressed) and left allocated; they must not be
+ * dereferenced afterwards.
+ *
+ * @param[in] ObjectType Type created by ObCreateObjectType
+ * @return Number of objects that were still alive
+ */
+static __forceinline
+ULONG
+ObDeleteObjectType(
+    _In_ POBJECT_TYPE ObjectType
+)
+{
+    ULONG Leaked;
+
+    if (ObjectType->TypeInfo.DeferredDeleteQueue != NULL) {
+        ExFlushWorkQueue(ObjectType->TypeInfo.DeferredDeleteQueue);
+    }
+    ObpProcessDeferredDeletes(ObjectType);
+
+    Leaked = (ULONG)ObjectType->TotalNumberOfObjects;
+    if (Leaked != 0 && !GetErrorSuppression()) {
+        ObPrintObjectLeaks(ObjectType);
+    }
+
+    ExFreePool(ObjectType);
+    return Leaked;
+}
+
+/**
+ * @brief Allocates an object of a type with one reference
+ *
+ * Use the ObCreateObject macro, which records the caller's location.
+ *
+ * @param[in] ObjectType Type of the new object
+ * @param[in] ObjectBodySize Size of the object body in bytes
+ * @param[out] Object Receives the zero-filled object body
+ * @param[in] FileName Allocation site recorded by the allocator
+ * @param[in] LineNumber Allocation site recorded by the allocator
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER or STATUS_INSUFFICIENT_RESOURCES
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+ObCreateObjectWithTracking(
+    _In_ POBJECT_TYPE ObjectType,
+    _In_ SIZE_T ObjectBodySize,
+    _Out_ PVOID* Object,
+    _In_ const char* FileName,
+    _In_ int LineNumber
+)
+{
+    POBJECT_HEADER ObjectHeader;
+    SIZE_T Size = FIELD_OFFSET(OBJECT_HEADER, Body) + ObjectBodySize;
+
+    if (Object == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+    *Object = NULL;
+    if (ObjectType == NULL || Size < ObjectBodySize) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    ObjectHeader = (POBJECT_HEADER)ExAllocatePoolWithTagTracking(ObjectType->TypeInfo.PoolType, Size,
+                                                                ObjectType->TypeInfo.PoolTag,
+                                                                FileName, LineNumber);
+    if (ObjectHeader == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(ObjectHeader, Size);
+    ObjectHeader->PointerCount = 1;
+    ObjectHeader->Type = ObjectType;
+
+    ExAcquirePushLockExclusive(&ObjectType->ObjectListLock);
+    InsertTailList(&ObjectType->ObjectListHead, &ObjectHeader->TypeListEntry);
+    ObjectType->TotalNumberOfObjects++;
+    if (ObjectType->TotalNumberOfObjects > ObjectType->HighWaterNumberOfObjects) {
+        ObjectType->HighWaterNumberOfObjects = ObjectType->TotalNumberOfObjects;
+    }
+    ExReleasePushLockExclusive(&ObjectType->ObjectListLock);
+
+    *Object = &ObjectHeader->Body;
+    return STATUS_SUCCESS;
+}
+
+#define ObCreateObject(ObjectType, ObjectBodySize, Object) \
+    ObCreateObjectWithTracking(ObjectType, ObjectBodySize, Object, __FILE__, __LINE__)
+
+/**
+ * @brief Returns the type of an object
+ *
+ * @param[in] Object Object body
+ * @return Type the object was created with
+ */
+static __forceinline
+POBJECT_TYPE
+ObGetObjectType(
+    _In_ PVOID Object
+)
+{
+    return OBJECT_TO_OBJECT_HEADER(Object)->Type;
+}
+
+/**
+ * @brief Adds a reference to an object
+ *
+ * The caller must already hold a reference, directly or through a structure
+ * that holds one and cannot drop it meanwhile.
+ *
+ * @param[in] Object Object body
+ * @return New reference count
+ */
+static __forceinline
+LONG64
+ObReferenceObject(
+    _In_ PVOID Object
+)
+{
+    return InterlockedIncrement64(&OBJECT_TO_OBJECT_HEADER(Object)->PointerCount);
+}
+
+/**
+ * @brief Adds a reference unless the object is already being deleted
+ *
+ * For lookups that find the object through a structure that does not hold a
+ * reference of its own, such as a cache the delete procedure unlinks it from.
+ *
+ * @param[in] Object Object body
+ * @return TRUE if a reference was taken, FALSE if the count had reached zero
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+ObReferenceObjectSafe(
+    _In_ PVOID Object
+)
+{
+    POBJECT_HEADER ObjectHeader = OBJECT_TO_OBJECT_HEADER(Object);
+    LONG64 Count = ReadNoFence64(&ObjectHeader->PointerCount);
+
+    while (Count > 0) {
+        LONG64 Observed = InterlockedCompareExchange64(&ObjectHeader->PointerCount, Count + 1, Count);
+        if (Observed == Count) {
+            return TRUE;
+        }
+        Count = Observed;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief Drops a reference, deleting the object inline if it was the last
+ *
+ * @param[in] Object Object body
+ * @return New reference count
+ */
+static __forceinline
+LONG64
+ObDereferenceObject(
+    _In_ PVOID Object
+)
+{
+    POBJECT_HEADER ObjectHeader = OBJECT_TO_OBJECT_HEADER(Object);
+    LONG64 Count = InterlockedDecrement64(&ObjectHeader->PointerCount);
+
+    if (Count == 0) {
+        ObpDeleteObject(ObjectHeader);
+    }
+    return Count;
+}
+
+/**
+ * @brief Drops a reference, queuing the delete if it was the last
+ *
+ * The delete procedure runs later on the type's deferred delete queue, or in
+ * ObFlushDeferredDeletes when the type has none. The caller pays one
+ * interlocked decrement and, for the last reference, one lock-free push.
+ *
+ * @param[in] Object Object body
+ * @return New reference count
+ */
+static __forceinline
+LONG64
+ObDereferenceObjectDeferDelete(
+    _In_ PVOID Object
+)
+{
+    POBJECT_HEADER ObjectHeader = OBJECT_TO_OBJECT_HEADER(Object);
+    POBJECT_TYPE ObjectType;
+    LONG64 Count = InterlockedDecrement64(&ObjectHeader->PointerCount);
+
+    if (Count != 0) {
+        return Count;
+    }
+
+    ObjectType = ObjectHeader->Type;
+    InterlockedPushEntrySList(&ObjectType->DeferredDeleteList, &ObjectHeader->DeferredDeleteEntry);
+
+    if (ObjectType->TypeInfo.DeferredDeleteQueue != NULL &&
+        ReadNoFence(&ObjectType->DeferredDeleteQueued) == 0 &&
+        InterlockedCompareExchange(&ObjectType->DeferredDeleteQueued, 1, 0) == 0) {
+        ExQueueWorkItem(ObjectType->TypeInfo.DeferredDeleteQueue, &ObjectType->DeferredDeleteItem, DelayedWorkQueue);
+    }
+    return 0;
+}
+
+/**
+ * @brief Deletes, on the calling thread, every object of a type waiting for a deferred delete
+ *
+ * @param[in,out] ObjectType Type whose deferred deletes are run
+ */
+static __forceinline
+VOID
+ObFlushDeferredDeletes(
+    _Inout_ POBJECT_TYPE ObjectType
+)
+{
+    ObpProcessDeferredDeletes(ObjectType);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_OBJECT_H_ */
@@ -0,0 +1,427 @@
+/**
+ * @file PushLock.h
+ * @brief Pointer-sized reader/writer locks modeled on EX_PUSH_LOCK
+ *
+ * An EX_PUSH_LOCK is a single pointer-sized word: an exclusive bit, a waiting
+ * bit, a writer-waiting bit and a count of shared owners. Uncontended acquire
+ * and release are one compare-exchange each and never enter the OS. A
+ * contended acquire spins for EX_PUSH_LOCK_SPIN_COUNT rounds and then sleeps
+ * with WaitOnAddress on the lock word; a release wakes sleepers only when the
+ * waiting bit says there are any.
+ *
+ * Writers are preferred: once an exclusive acquirer has gone to sleep, new
+ * shared acquirers wait behind it instead of keeping the lock shared
+ * indefinitely. As a consequence shared acquisition is not recursive; a thread
+ * that already owns the lock shared must not acquire it shared again.
+ *
+ * For read-mostly data that is hit from many processors at once, the
+ * EX_PUSH_LOCK_CACHE_AWARE variant keeps one push lock per processor on its
+ * own cache line. Readers take only the lock of the processor they run on,
+ * so they do not contend for a shared cache line; writers take all of them.
+ */
+
+#ifndef WINKERNEL_PUSHLOCK_H_
+#define WINKERNEL_PUSHLOCK_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "NtStatus.h"
+
+#if defined(_MSC_VER)
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of failed attempts an acquire spins through before sleeping */
+#define EX_PUSH_LOCK_SPIN_COUNT 64
+
+#define EX_PUSH_LOCK_LOCK           ((ULONG_PTR)0x1)   /* Owned exclusive */
+#define EX_PUSH_LOCK_WAITING        ((ULONG_PTR)0x2)   /* Some thread sleeps on the lock */
+#define EX_PUSH_LOCK_WRITER_WAITING ((ULONG_PTR)0x4)   /* An exclusive acquirer sleeps; hold off new readers */
+#define EX_PUSH_LOCK_SHARE_INC      ((ULONG_PTR)0x8)   /* One shared owner */
+#define EX_PUSH_LOCK_SHARE_MASK     (~(ULONG_PTR)0x7)
+
+/**
+ * @brief Reader/writer lock the size of a pointer
+ */
+typedef struct _EX_PUSH_LOCK {
+    union {
+        volatile ULONG_PTR Value;   /**< Flag bits and shared owner count */
+        PVOID volatile Ptr;         /**< Same word, for the pointer-sized interlocked operations */
+    };
+} EX_PUSH_LOCK, *PEX_PUSH_LOCK;
+
+/* Spacing of the per-processor locks of a cache-aware push lock */
+#define EX_PUSH_LOCK_CACHE_LINE 64
+
+/* Upper bound on the number of per-processor locks */
+#define EX_PUSH_LOCK_CACHE_AWARE_MAX_SLOTS 64
+
+/**
+ * @brief One per-processor lock, padded so that no two share a cache line
+ */
+typedef struct _EX_PUSH_LOCK_CACHE_AWARE_PADDED {
+    EX_PUSH_LOCK Lock;
+    UCHAR Pad[EX_PUSH_LOCK_CACHE_LINE - sizeof(EX_PUSH_LOCK)];
+} EX_PUSH_LOCK_CACHE_AWARE_PADDED, *PEX_PUSH_LOCK_CACHE_AWARE_PADDED;
+
+/**
+ * @brief Push lock split into per-processor locks for read scaling
+ */
+typedef struct _EX_PUSH_LOCK_CACHE_AWARE {
+    PEX_PUSH_LOCK_CACHE_AWARE_PADDED Slots;     /**< SlotCount locks, cache aligned in the pool */
+    PVOID SlotsAllocation;                      /**< Pool block holding Slots */
+    ULONG SlotCount;
+} EX_PUSH_LOCK_CACHE_AWARE, *PEX_PUSH_LOCK_CACHE_AWARE;
+
+/**
+ * @brief Initializes a push lock to the released state
+ *
+ * @param[out] PushLock Pointer to the lock
+ */
+static __forceinline
+VOID
+ExInitializePushLock(
+    _Out_ PEX_PUSH_LOCK PushLock
+)
+{
+    PushLock->Value = 0;
+}
+
+static __forceinline
+ULONG_PTR
+ExpReadPushLock(
+    _In_ PEX_PUSH_LOCK PushLock
+)
+{
+    return (ULONG_PTR)ReadPointerAcquire(&PushLock->Ptr);
+}
+
+static __forceinline
+BOOLEAN
+ExpUpdatePushLock(
+    _Inout_ PEX_PUSH_LOCK PushLock,
+    _In_ ULONG_PTR OldValue,
+    _In_ ULONG_PTR NewValue
+)
+{
+    return InterlockedCompareExchangePointer(&PushLock->Ptr, (PVOID)NewValue, (PVOID)OldValue) == (PVOID)OldValue;
+}
+
+/*
+ * Marks the lock as having a sleeper and sleeps until the lock word changes.
+ * If the word has already moved on from Value the call returns at once and
+ * the caller re-examines the lock.
+ */
+static __forceinline
+VOID
+ExpWaitForPushLock(
+    _Inout_ PEX_PUSH_LOCK PushLock,
+    _In_ ULONG_PTR Value,
+    _In_ ULONG_PTR Flags
+)
+{
+    ULONG_PTR NewValue = Value | EX_PUSH_LOCK_WAITING | Flags;
+
+    if (NewValue == Value || ExpUpdatePushLock(PushLock, Value, NewValue)) {
+        WaitOnAddress((volatile VOID*)&PushLock->Value, &NewValue, sizeof(NewValue), INFINITE);
+    }
+}
+
+/**
+ * @brief Attempts to acquire a push lock exclusive without waiting
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ * @return TRUE if the lock was acquired, FALSE if it is owned
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+ExTryAcquirePushLockExclusive(
+    _Inout_ PEX_PUSH_LOCK PushLock
+)
+{
+    ULONG_PTR Value = ExpReadPushLock(PushLock);
+
+    if ((Value & (EX_PUSH_LOCK_LOCK | EX_PUSH_LOCK_SHARE_MASK)) != 0) {
+        return FALSE;
+    }
+    return ExpUpdatePushLock(PushLock, Value, (Value | EX_PUSH_LOCK_LOCK) & ~EX_PUSH_LOCK_WRITER_WAITING);
+}
+
+/**
+ * @brief Attempts to acquire a push lock shared without waiting
+ *
+ * Fails while the lock is owned exclusive or an exclusive acquirer is waiting.
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ * @return TRUE if the lock was acquired, FALSE otherwise
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+ExTryAcquirePushLockShared(
+    _Inout_ PEX_PUSH_LOCK PushLock
+)
+{
+    ULONG_PTR Value = ExpReadPushLock(PushLock);
+
+    if ((Value & (EX_PUSH_LOCK_LOCK | EX_PUSH_LOCK_WRITER_WAITING)) != 0) {
+        return FALSE;
+    }
+    return ExpUpdatePushLock(PushLock, Value, Value + EX_PUSH_LOCK_SHARE_INC);
+}
+
+/**
+ * @brief Acquires a push lock exclusive, waiting if necessary
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ */
+static __forceinline
+VOID
+ExAcquirePushLockExclusive(
+    _Inout_ PEX_PUSH_LOCK PushLock
+)
+{
+    ULONG Spin = 0;
+
+    for (;;) {
+        ULONG_PTR Value = ExpReadPushLock(PushLock);
+
+        if ((Value & (EX_PUSH_LOCK_LOCK | EX_PUSH_LOCK_SHARE_MASK)) == 0) {
+            // The acquirer that set WRITER_WAITING may be another thread; if so
+            // it sets the bit again when it next goes to sleep
+            if (ExpUpdatePushLock(PushLock, Value, (Value | EX_PUSH_LOCK_LOCK) & ~EX_PUSH_LOCK_WRITER_WAITING)) {
+                return;
+            }
+        } else if (Spin < EX_PUSH_LOCK_SPIN_COUNT) {
+            Spin++;
+            YieldProcessor();
+        } else {
+            ExpWaitForPushLock(PushLock, Value, EX_PUSH_LOCK_WRITER_WAITING);
+            Spin = 0;
+        }
+    }
+}
+
+/**
+ * @brief Acquires a push lock shared, waiting if necessary
+ *
+ * @param[in,out] PushLock Pointer to the lock; must not already be owned by the caller
+ */
+static __forceinline
+VOID
+ExAcquirePushLockShared(
+    _Inout_ PEX_PUSH_LOCK PushLock
+)
+{
+    ULONG Spin = 0;
+
+    for (;;) {
+        ULONG_PTR Value = ExpReadPushLock(PushLock);
+
+        if ((Value & (EX_PUSH_LOCK_LOCK | EX_PUSH_LOCK_WRITER_WAITING)) == 0) {
+            if (ExpUpdatePushLock(PushLock, Value, Value + EX_PUSH_LOCK_SHARE_INC)) {
+                return;
+            }
+        } else if (Spin < EX_PUSH_LOCK_SPIN_COUNT) {
+            Spin++;
+            YieldProcessor();
+        } else {
+            ExpWaitForPushLock(PushLock, Value, 0);
+            Spin = 0;
+        }
+    }
+}
+
+/**
+ * @brief Releases a push lock owned exclusive by the caller
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ */
+static __forceinline
+VOID
+ExReleasePushLockExclusive(
+    _Inout_ PEX_PUSH_LOCK PushLock
+)
+{
+    ULONG_PTR Value;
+
+    do {
+        Value = ExpReadPushLock(PushLock);
+    } while (!ExpUpdatePushLock(PushLock, Value, Value & ~(EX_PUSH_LOCK_LOCK | EX_PUSH_LOCK_WAITING)));
+
+    if ((Value & EX_PUSH_LOCK_WAITING) != 0) {
+        WakeByAddressAll((PVOID)&PushLock->Value);
+    }
+}
+
+/**
+ * @brief Releases one shared ownership of a push lock
+ *
+ * Sleepers are woken only by the release of the last shared owner.
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ */
+static __forceinline
+VOID
+ExReleasePushLockShared(
+    _Inout_ PEX_PUSH_LOCK PushLock
+)
+{
+    ULONG_PTR Value;
+    ULONG_PTR NewValue;
+
+    do {
+        Value = ExpReadPushLock(PushLock);
+        NewValue = Value - EX_PUSH_LOCK_SHARE_INC;
+        if ((NewValue & EX_PUSH_LOCK_SHARE_MASK) == 0) {
+            NewValue &= ~EX_PUSH_LOCK_WAITING;
+        }
+    } while (!ExpUpdatePushLock(PushLock, Value, NewValue));
+
+    if ((Value & EX_PUSH_LOCK_WAITING) != 0 && (NewValue & EX_PUSH_LOCK_WAITING) == 0) {
+        WakeByAddressAll((PVOID)&PushLock->Value);
+    }
+}
+
+/**
+ * @brief Initializes a cache-aware push lock
+ *
+ * @param[out] PushLock Pointer to the lock
+ * @param[in] SlotCount Number of per-processor locks, or 0 for one per processor;
+ *                      capped at EX_PUSH_LOCK_CACHE_AWARE_MAX_SLOTS
+ * @return STATUS_SUCCESS or STATUS_NO_MEMORY
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+ExInitializeCacheAwarePushLock(
+    _Out_ PEX_PUSH_LOCK_CACHE_AWARE PushLock,
+    _In_ ULONG SlotCount
+)
+{
+    ULONG Index;
+
+    if (SlotCount == 0) {
+        SYSTEM_INFO SystemInfo;
+        GetSystemInfo(&SystemInfo);
+        SlotCount = SystemInfo.dwNumberOfProcessors;
+    }
+    if (SlotCount > EX_PUSH_LOCK_CACHE_AWARE_MAX_SLOTS) {
+        SlotCount = EX_PUSH_LOCK_CACHE_AWARE_MAX_SLOTS;
+    }
+
+    PushLock->Slots = (PEX_PUSH_LOCK_CACHE_AWARE_PADDED)ExAllocateCacheAlignedPoolTracked(
+        NonPagedPoolCacheAligned, (SIZE_T)SlotCount * sizeof(EX_PUSH_LOCK_CACHE_AWARE_PADDED),
+        &PushLock->SlotsAllocation);
+    if (PushLock->Slots == NULL) {
+        PushLock->SlotCount = 0;
+        return STATUS_NO_MEMORY;
+    }
+
+    for (Index = 0; Index < SlotCount; Index++) {
+        ExInitializePushLock(&PushLock->Slots[Index].Lock);
+    }
+    PushLock->SlotCount = SlotCount;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Frees a cache-aware push lock; it must not be owned
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ */
+static __forceinline
+VOID
+ExDeleteCacheAwarePushLock(
+    _Inout_ PEX_PUSH_LOCK_CACHE_AWARE PushLock
+)
+{
+    FREE_POOL(PushLock->SlotsAllocation);
+    PushLock->Slots = NULL;
+    PushLock->SlotCount = 0;
+}
+
+/**
+ * @brief Acquires a cache-aware push lock shared
+ *
+ * Only the lock of the current processor is taken. The thread may migrate
+ * before it releases, so the lock that was taken is returned and must be
+ * passed to ExReleaseCacheAwarePushLockShared.
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ * @return The per-processor lock that is now owned shared
+ */
+static __forceinline
+PEX_PUSH_LOCK
+ExAcquireCacheAwarePushLockShared(
+    _Inout_ PEX_PUSH_LOCK_CACHE_AWARE PushLock
+)
+{
+    PEX_PUSH_LOCK Slot = &PushLock->Slots[GetCurrentProcessorNumber() % PushLock->SlotCount].Lock;
+
+    ExAcquirePushLockShared(Slot);
+    return Slot;
+}
+
+/**
+ * @brief Releases a shared ownership taken by ExAcquireCacheAwarePushLockShared
+ *
+ * @param[in,out] Slot Lock returned by the matching acquire
+ */
+static __forceinline
+VOID
+ExReleaseCacheAwarePushLockShared(
+    _Inout_ PEX_PUSH_LOCK Slot
+)
+{
+    ExReleasePushLockShared(Slot);
+}
+
+/**
+ * @brief Acquires a cache-aware push lock exclusive
+ *
+ * Takes every per-processor lock, always in the same order.
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ */
+static __forceinline
+VOID
+ExAcquireCacheAwarePushLockExclusive(
+    _Inout_ PEX_PUSH_LOCK_CACHE_AWARE PushLock
+)
+{
+    ULONG Index;
+
+    for (Index = 0; Index < PushLock->SlotCount; Index++) {
+        ExAcquirePushLockExclusive(&PushLock->Slots[Index].Lock);
+    }
+}
+
+/**
+ * @brief Releases a cache-aware push lock owned exclusive by the caller
+ *
+ * @param[in,out] PushLock Pointer to the lock
+ */
+static __forceinline
+VOID
+ExReleaseCacheAwarePushLockExclusive(
+    _Inout_ PEX_PUSH_LOCK_CACHE_AWARE PushLock
+)
+{
+    ULONG Index = PushLock->SlotCount;
+
+    while (Index-- > 0) {
+        ExReleasePushLockExclusive(&PushLock->Slots[Index].Lock);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_PUSHLOCK_H_ */
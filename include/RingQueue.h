@@ -0,0 +1,487 @@
+/**
+ * @file RingQueue.h
+ * @brief Bounded lock-free multi-producer/multi-consumer ring queue
+ *
+ * RING_QUEUE passes pointer-sized work items between threads without a lock
+ * and without allocating per item. It follows Dmitry Vyukov's bounded MPMC
+ * design: every slot carries a sequence number that tells producers and
+ * consumers whether the slot is free or full for the current lap, so a push
+ * or pop is one compare-exchange on the enqueue or dequeue position plus one
+ * release store on the slot.
+ *
+ * The enqueue position, the dequeue position and the read-mostly fields each
+ * sit on their own cache line, so producers and consumers do not invalidate
+ * each other's lines on every operation.
+ *
+ * RtlPushRingQueue and RtlPopRingQueue block when the queue is full or empty.
+ * They spin briefly, yield once, and then sleep with WaitOnAddress on a wake
+ * count. The positions cannot be waited on: a position moves when a slot is
+ * claimed, before the slot is published, so a sleeper could snapshot the new
+ * position, miss the unpublished item and then sleep through its wake. A wake
+ * count only changes after a slot is published, and the non-blocking
+ * operations bump it and wake sleepers only when a waiter count says there
+ * are any.
+ */
+
+#ifndef WINKERNEL_RINGQUEUE_H_
+#define WINKERNEL_RINGQUEUE_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "NtStatus.h"
+
+#if defined(_MSC_VER)
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of failed attempts a blocking operation spins through before sleeping */
+#define RING_QUEUE_SPIN_COUNT 128
+
+/**
+ * @brief One slot of a ring queue
+ */
+typedef struct _RING_QUEUE_SLOT {
+    volatile LONG64 Sequence;   /**< Position the slot is ready for: pos when free, pos + 1 when full */
+    PVOID Item;                 /**< Stored item, valid while the slot is full */
+} RING_QUEUE_SLOT, *PRING_QUEUE_SLOT;
+
+/**
+ * @brief Bounded MPMC ring queue
+ */
+typedef struct _RING_QUEUE {
+    DECLSPEC_CACHEALIGN volatile LONG64 EnqueuePosition;   /**< Next position to be claimed by a producer */
+    DECLSPEC_CACHEALIGN volatile LONG64 DequeuePosition;   /**< Next position to be claimed by a consumer */
+    DECLSPEC_CACHEALIGN PRING_QUEUE_SLOT Slots;            /**< Capacity slots, allocated from the pool */
+    LONG64 Mask;                                           /**< Capacity - 1 */
+    volatile LONG PushWaiters;                             /**< Producers sleeping on a full queue */
+    volatile LONG PopWaiters;                              /**< Consumers sleeping on an empty queue */
+    volatile LONG PushWakeCount;                           /**< Bumped after a pop frees a slot while producers wait */
+    volatile LONG PopWakeCount;                            /**< Bumped after a push fills a slot while consumers wait */
+} RING_QUEUE, *PRING_QUEUE;
+
+/**
+ * @brief Initializes an empty ring queue
+ *
+ * @param[out] Queue Pointer to the queue to initialize
+ * @param[in] Capacity Number of slots; must be a power of two and at least 2
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER for a bad capacity, or
+ *         STATUS_NO_MEMORY if the slot array could not be allocated
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+RtlInitializeRingQueue(
+    _Out_ PRING_QUEUE Queue,
+    _In_ ULONG Capacity
+)
+{
+    ULONG Index;
+
+    RtlZeroMemory(Queue, sizeof(*Queue));
+
+    if (Capacity < 2 || (Capacity & (Capacity - 1)) != 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Queue->Slots = (PRING_QUEUE_SLOT)ExAllocatePoolTracked(NonPagedPool, (SIZE_T)Capacity * sizeof(RING_QUEUE_SLOT));
+    if (Queue->Slots == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+
+    for (Index = 0; Index < Capacity; Index++) {
+        Queue->Slots[Index].Sequence = Index;
+        Queue->Slots[Index].Item = NULL;
+    }
+    Queue->Mask = (LONG64)Capacity - 1;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Frees the slot array of a ring queue
+ *
+ * Items still in the queue are dropped. No other thread may be using the queue.
+ *
+ * @param[in,out] Queue Pointer to the queue
+ */
+static __forceinline
+void
+RtlDeleteRingQueue(
+    _Inout_ PRING_QUEUE Queue
+)
+{
+    FREE_POOL(Queue->Slots);
+    Queue->Mask = 0;
+}
+
+/*
+ * Called after the caller has published its slots. If Waiters says there are
+ * sleepers, bumps WakeCount and wakes the threads sleeping on it. The full
+ * barrier orders the publication before the waiter check, so a thread that
+ * registers as a waiter either sees the published slot when it re-checks the
+ * queue or is counted here; in that case its WakeCount snapshot is either
+ * older than the bump, and its sleep returns at once, or newer, and its
+ * re-check sees the slot.
+ */
+static __forceinline
+void
+RtlpRingQueueWake(
+    _In_ volatile LONG* Waiters,
+    _Inout_ volatile LONG* WakeCount
+)
+{
+    MemoryBarrier();
+    if (ReadNoFence(Waiters) != 0) {
+        InterlockedIncrement(WakeCount);
+        WakeByAddressAll((PVOID)WakeCount);
+    }
+}
+
+/*
+ * Sleeps on a wake count until it moves away from Snapshot or the deadline
+ * passes. Returns FALSE once the deadline has passed.
+ */
+static __forceinline
+BOOLEAN
+RtlpRingQueueSleep(
+    _In_ volatile LONG* WakeCount,
+    _In_ LONG Snapshot,
+    _In_ DWORD Timeout,
+    _In_ ULONGLONG Deadline
+)
+{
+    DWORD Remaining = INFINITE;
+
+    if (Timeout != INFINITE) {
+        ULONGLONG Now = GetTickCount64();
+        if (Now >= Deadline) {
+            return FALSE;
+        }
+        Remaining = (DWORD)(Deadline - Now);
+    }
+
+    WaitOnAddress(WakeCount, &Snapshot, sizeof(Snapshot), Remaining);
+    return TRUE;
+}
+
+/**
+ * @brief Adds an item to the queue if there is room
+ *
+ * @param[in,out] Queue Pointer to the queue
+ * @param[in] Item Item to add; any pointer value, including NULL
+ * @return TRUE if the item was added, FALSE if the queue was full
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+RtlTryPushRingQueue(
+    _Inout_ PRING_QUEUE Queue,
+    _In_opt_ PVOID Item
+)
+{
+    LONG64 Position = ReadNoFence64(&Queue->EnqueuePosition);
+    PRING_QUEUE_SLOT Slot;
+
+    for (;;) {
+        LONG64 Difference;
+
+        Slot = &Queue->Slots[Position & Queue->Mask];
+        Difference = ReadAcquire64(&Slot->Sequence) - Position;
+
+        if (Difference == 0) {
+            LONG64 Observed = InterlockedCompareExchange64(&Queue->EnqueuePosition, Position + 1, Position);
+            if (Observed == Position) {
+                break;
+            }
+            Position = Observed;
+        } else if (Difference < 0) {
+            // The slot still holds the item from the previous lap
+            return FALSE;
+        } else {
+            Position = ReadNoFence64(&Queue->EnqueuePosition);
+        }
+    }
+
+    Slot->Item = Item;
+    WriteRelease64(&Slot->Sequence, Position + 1);
+    RtlpRingQueueWake(&Queue->PopWaiters, &Queue->PopWakeCount);
+    return TRUE;
+}
+
+/**
+ * @brief Removes the oldest item from the queue if there is one
+ *
+ * @param[in,out] Queue Pointer to the queue
+ * @param[out] Item Receives the removed item
+ * @return TRUE if an item was removed, FALSE if the queue was empty
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+RtlTryPopRingQueue(
+    _Inout_ PRING_QUEUE Queue,
+    _Out_ PVOID* Item
+)
+{
+    LONG64 Position = ReadNoFence64(&Queue->DequeuePosition);
+    PRING_QUEUE_SLOT Slot;
+
+    for (;;) {
+        LONG64 Difference;
+
+        Slot = &Queue->Slots[Position & Queue->Mask];
+        Difference = ReadAcquire64(&Slot->Sequence) - (Position + 1);
+
+        if (Difference == 0) {
+            LONG64 Observed = InterlockedCompareExchange64(&Queue->DequeuePosition, Position + 1, Position);
+            if (Observed == Position) {
+                break;
+            }
+            Position = Observed;
+        } else if (Difference < 0) {
+            // The slot has not been filled for this lap yet
+            return FALSE;
+        } else {
+            Position = ReadNoFence64(&Queue->DequeuePosition);
+        }
+    }
+
+    *Item = Slot->Item;
+    WriteRelease64(&Slot->Sequence, Position + Queue->Mask + 1);
+    RtlpRingQueueWake(&Queue->PushWaiters, &Queue->PushWakeCount);
+    return TRUE;
+}
+
+/**
+ * @brief Adds up to Count items with a single position update
+ *
+ * Claims the longest run of consecutive free slots, up to Count, in one
+ * compare-exchange, so a batch costs about as much contention as one push.
+ * Items are added in array order.
+ *
+ * @param[in,out] Queue Pointer to the queue
+ * @param[in] Items Array of items to add
+ * @param[in] Count Number of items in the array
+ * @return Number of items added, from the start of the array; 0 if the queue was full
+ */
+static __forceinline
+ULONG
+RtlTryPushRingQueueBatch(
+    _Inout_ PRING_QUEUE Queue,
+    _In_reads_(Count) PVOID const* Items,
+    _In_ ULONG Count
+)
+{
+    LONG64 Position = ReadNoFence64(&Queue->EnqueuePosition);
+    ULONG Claimed;
+    ULONG Index;
+
+    if (Count == 0) {
+        return 0;
+    }
+
+    for (;;) {
+        LONG64 Observed;
+
+        Claimed = 0;
+        while (Claimed < Count &&
+               ReadAcquire64(&Queue->Slots[(Position + Claimed) & Queue->Mask].Sequence) == Position + (LONG64)Claimed) {
+            Claimed++;
+        }
+
+        if (Claimed == 0) {
+            if (ReadAcquire64(&Queue->Slots[Position & Queue->Mask].Sequence) < Position) {
+                return 0;
+            }
+            Position = ReadNoFence64(&Queue->EnqueuePosition);
+            continue;
+        }
+
+        Observed = InterlockedCompareExchange64(&Queue->EnqueuePosition, Position + Claimed, Position);
+        if (Observed == Position) {
+            break;
+        }
+        Position = Observed;
+    }
+
+    for (Index = 0; Index < Claimed; Index++) {
+        PRING_QUEUE_SLOT Slot = &Queue->Slots[(Position + Index) & Queue->Mask];
+        Slot->Item = Items[Index];
+        WriteRelease64(&Slot->Sequence, Position + Index + 1);
+    }
+
+    RtlpRingQueueWake(&Queue->PopWaiters, &Queue->PopWakeCount);
+    return Claimed;
+}
+
+/**
+ * @brief Removes up to MaxCount items with a single position update
+ *
+ * Claims the longest run of consecutive full slots, up to MaxCount, in one
+ * compare-exchange. Items are returned oldest first.
+ *
+ * @param[in,out] Queue Pointer to the queue
+ * @param[out] Items Array that receives the removed items
+ * @param[in] MaxCount Capacity of the Items array
+ * @return Number of items removed; 0 if the queue was empty
+ */
+static __forceinline
+ULONG
+RtlTryPopRingQueueBatch(
+    _Inout_ PRING_QUEUE Queue,
+    _Out_writes_(MaxCount) PVOID* Items,
+    _In_ ULONG MaxCount
+)
+{
+    LONG64 Position = ReadNoFence64(&Queue->DequeuePosition);
+    ULONG Claimed;
+    ULONG Index;
+
+    if (MaxCount == 0) {
+        return 0;
+    }
+
+    for (;;) {
+        LONG64 Observed;
+
+        Claimed = 0;
+        while (Claimed < MaxCount &&
+               ReadAcquire64(&Queue->Slots[(Position + Claimed) & Queue->Mask].Sequence) == Position + (LONG64)Claimed + 1) {
+            Claimed++;
+        }
+
+        if (Claimed == 0) {
+            if (ReadAcquire64(&Queue->Slots[Position & Queue->Mask].Sequence) < Position + 1) {
+                return 0;
+            }
+            Position = ReadNoFence64(&Queue->DequeuePosition);
+            continue;
+        }
+
+        Observed = InterlockedCompareExchange64(&Queue->DequeuePosition, Position + Claimed, Position);
+        if (Observed == Position) {
+            break;
+        }
+        Position = Observed;
+    }
+
+    for (Index = 0; Index < Claimed; Index++) {
+        PRING_QUEUE_SLOT Slot = &Queue->Slots[(Position + Index) & Queue->Mask];
+        Items[Index] = Slot->Item;
+        WriteRelease64(&Slot->Sequence, Position + Index + Queue->Mask + 1);
+    }
+
+    RtlpRingQueueWake(&Queue->PushWaiters, &Queue->PushWakeCount);
+    return Claimed;
+}
+
+/**
+ * @brief Adds an item, waiting for room if the queue is full
+ *
+ * @param[in,out] Queue Pointer to the queue
+ * @param[in] Item Item to add
+ * @param[in] Timeout Maximum time to wait in milliseconds, or INFINITE
+ * @return STATUS_SUCCESS if the item was added, STATUS_TIMEOUT otherwise
+ */
+static __forceinline
+NTSTATUS
+RtlPushRingQueue(
+    _Inout_ PRING_QUEUE Queue,
+    _In_opt_ PVOID Item,
+    _In_ DWORD Timeout
+)
+{
+    ULONGLONG Deadline = (Timeout == INFINITE) ? 0 : GetTickCount64() + Timeout;
+    ULONG Spin;
+
+    for (;;) {
+        LONG Snapshot;
+        BOOLEAN Pushed;
+
+        for (Spin = 0; Spin < RING_QUEUE_SPIN_COUNT; Spin++) {
+            if (RtlTryPushRingQueue(Queue, Item)) {
+                return STATUS_SUCCESS;
+            }
+            YieldProcessor();
+        }
+
+        // Give the other side a chance to run before paying for a sleep and wake
+        SwitchToThread();
+        if (RtlTryPushRingQueue(Queue, Item)) {
+            return STATUS_SUCCESS;
+        }
+
+        InterlockedIncrement(&Queue->PushWaiters);
+        Snapshot = ReadAcquire(&Queue->PushWakeCount);
+        Pushed = RtlTryPushRingQueue(Queue, Item);
+        if (!Pushed && !RtlpRingQueueSleep(&Queue->PushWakeCount, Snapshot, Timeout, Deadline)) {
+            InterlockedDecrement(&Queue->PushWaiters);
+            return STATUS_TIMEOUT;
+        }
+        InterlockedDecrement(&Queue->PushWaiters);
+
+        if (Pushed) {
+            return STATUS_SUCCESS;
+        }
+    }
+}
+
+/**
+ * @brief Removes the oldest item, waiting for one if the queue is empty
+ *
+ * @param[in,out] Queue Pointer to the queue
+ * @param[out] Item Receives the removed item
+ * @param[in] Timeout Maximum time to wait in milliseconds, or INFINITE
+ * @return STATUS_SUCCESS if an item was removed, STATUS_TIMEOUT otherwise
+ */
+static __forceinline
+NTSTATUS
+RtlPopRingQueue(
+    _Inout_ PRING_QUEUE Queue,
+    _Out_ PVOID* Item,
+    _In_ DWORD Timeout
+)
+{
+    ULONGLONG Deadline = (Timeout == INFINITE) ? 0 : GetTickCount64() + Timeout;
+    ULONG Spin;
+
+    for (;;) {
+        LONG Snapshot;
+        BOOLEAN Popped;
+
+        for (Spin = 0; Spin < RING_QUEUE_SPIN_COUNT; Spin++) {
+            if (RtlTryPopRingQueue(Queue, Item)) {
+                return STATUS_SUCCESS;
+            }
+            YieldProcessor();
+        }
+
+        // Give the other side a chance to run before paying for a sleep and wake
+        SwitchToThread();
+        if (RtlTryPopRingQueue(Queue, Item)) {
+            return STATUS_SUCCESS;
+        }
+
+        InterlockedIncrement(&Queue->PopWaiters);
+        Snapshot = ReadAcquire(&Queue->PopWakeCount);
+        Popped = RtlTryPopRingQueue(Queue, Item);
+        if (!Popped && !RtlpRingQueueSleep(&Queue->PopWakeCount, Snapshot, Timeout, Deadline)) {
+            InterlockedDecrement(&Queue->PopWaiters);
+            return STATUS_TIMEOUT;
+        }
+        InterlockedDecrement(&Queue->PopWaiters);
+
+        if (Popped) {
+            return STATUS_SUCCESS;
+        }
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_RINGQUEUE_H_ */
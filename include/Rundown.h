@@ -0,0 +1,408 @@
+/**
+ * @file Rundown.h
+ * @brief Rundown protection modeled on EX_RUNDOWN_REF
+ *
+ * Rundown protection lets many threads use a shared object without a lock
+ * while still allowing one thread to tear it down safely. Users bracket each
+ * access with ExAcquireRundownProtection and ExReleaseRundownProtection; the
+ * acquire fails once teardown has started. The tearing-down thread calls
+ * ExWaitForRundownProtectionRelease, which blocks new acquires and waits for
+ * the existing ones to be released, after which the object can be freed.
+ *
+ * An EX_RUNDOWN_REF is a single pointer-sized word holding a reference count
+ * and an active bit, so acquire and release are one compare-exchange each.
+ * The waiter sleeps with WaitOnAddress on the word and is woken by the
+ * release that drops the count to zero.
+ *
+ * When acquire/release pairs are very frequent on many processors, the single
+ * word bounces between caches. EX_RUNDOWN_REF_CACHE_AWARE keeps one reference
+ * per processor, each on its own cache line; an acquire touches only the line
+ * of the processor it runs on, and rundown waits for every one of them.
+ */
+
+#ifndef WINKERNEL_RUNDOWN_H_
+#define WINKERNEL_RUNDOWN_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "NtStatus.h"
+
+#if defined(_MSC_VER)
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EX_RUNDOWN_ACTIVE       ((ULONG_PTR)0x1)   /* Rundown has started; acquires fail */
+#define EX_RUNDOWN_COUNT_SHIFT  1
+#define EX_RUNDOWN_COUNT_INC    ((ULONG_PTR)1 << EX_RUNDOWN_COUNT_SHIFT)
+
+/**
+ * @brief Rundown reference the size of a pointer
+ */
+typedef struct _EX_RUNDOWN_REF {
+    union {
+        volatile ULONG_PTR Count;   /**< Reference count shifted by EX_RUNDOWN_COUNT_SHIFT, plus EX_RUNDOWN_ACTIVE */
+        PVOID volatile Ptr;         /**< Same word, for the pointer-sized interlocked operations */
+    };
+} EX_RUNDOWN_REF, *PEX_RUNDOWN_REF;
+
+/* Spacing of the per-processor references of a cache-aware rundown reference */
+#define EX_RUNDOWN_REF_CACHE_LINE 64
+
+/* Upper bound on the number of per-processor references */
+#define EX_RUNDOWN_REF_CACHE_AWARE_MAX_SLOTS 64
+
+/**
+ * @brief One per-processor reference, padded so that no two share a cache line
+ */
+typedef struct _EX_RUNDOWN_REF_CACHE_AWARE_PADDED {
+    EX_RUNDOWN_REF RunRef;
+    UCHAR Pad[EX_RUNDOWN_REF_CACHE_LINE - sizeof(EX_RUNDOWN_REF)];
+} EX_RUNDOWN_REF_CACHE_AWARE_PADDED, *PEX_RUNDOWN_REF_CACHE_AWARE_PADDED;
+
+/**
+ * @brief Rundown reference split across processors
+ */
+typedef struct _EX_RUNDOWN_REF_CACHE_AWARE {
+    PEX_RUNDOWN_REF_CACHE_AWARE_PADDED RunRefs;     /**< Number references, cache aligned in the pool */
+    PVOID RunRefsAllocation;                        /**< Pool block holding RunRefs */
+    ULONG Number;
+} EX_RUNDOWN_REF_CACHE_AWARE, *PEX_RUNDOWN_REF_CACHE_AWARE;
+
+static __forceinline
+ULONG_PTR
+ExpReadRundownRef(
+    _In_ PEX_RUNDOWN_REF RunRef
+)
+{
+    return (ULONG_PTR)ReadPointerAcquire(&RunRef->Ptr);
+}
+
+static __forceinline
+BOOLEAN
+ExpUpdateRundownRef(
+    _Inout_ PEX_RUNDOWN_REF RunRef,
+    _In_ ULONG_PTR OldValue,
+    _In_ ULONG_PTR NewValue
+)
+{
+    return InterlockedCompareExchangePointer(&RunRef->Ptr, (PVOID)NewValue, (PVOID)OldValue) == (PVOID)OldValue;
+}
+
+/*
+ * Sets the active bit so that later acquires fail. The references already
+ * held are left in place for the caller to wait on.
+ */
+static __forceinline
+VOID
+ExpBeginRundown(
+    _Inout_ PEX_RUNDOWN_REF RunRef
+)
+{
+    ULONG_PTR Value;
+
+    do {
+        Value = ExpReadRundownRef(RunRef);
+    } while ((Value & EX_RUNDOWN_ACTIVE) == 0 &&
+             !ExpUpdateRundownRef(RunRef, Value, Value | EX_RUNDOWN_ACTIVE));
+}
+
+/**
+ * @brief Initializes a rundown reference with no references and rundown not started
+ *
+ * @param[out] RunRef Pointer to the rundown reference
+ */
+static __forceinline
+VOID
+ExInitializeRundownProtection(
+    _Out_ PEX_RUNDOWN_REF RunRef
+)
+{
+    RunRef->Count = 0;
+}
+
+/**
+ * @brief Makes a rundown reference usable again after ExWaitForRundownProtectionRelease
+ *
+ * @param[out] RunRef Pointer to the rundown reference
+ */
+static __forceinline
+VOID
+ExReInitializeRundownProtection(
+    _Out_ PEX_RUNDOWN_REF RunRef
+)
+{
+    WritePointerRelease(&RunRef->Ptr, NULL);
+}
+
+/**
+ * @brief Acquires Count references unless rundown has started
+ *
+ * @param[in,out] RunRef Pointer to the rundown reference
+ * @param[in] Count Number of references to acquire
+ * @return TRUE if the references were acquired, FALSE if rundown has started
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+ExAcquireRundownProtectionEx(
+    _Inout_ PEX_RUNDOWN_REF RunRef,
+    _In_ ULONG Count
+)
+{
+    for (;;) {
+        ULONG_PTR Value = ExpReadRundownRef(RunRef);
+
+        if ((Value & EX_RUNDOWN_ACTIVE) != 0) {
+            return FALSE;
+        }
+        if (ExpUpdateRundownRef(RunRef, Value, Value + ((ULONG_PTR)Count << EX_RUNDOWN_COUNT_SHIFT))) {
+            return TRUE;
+        }
+    }
+}
+
+/**
+ * @brief Acquires one reference unless rundown has started
+ *
+ * @param[in,out] RunRef Pointer to the rundown reference
+ * @return TRUE if the reference was acquired, FALSE if rundown has started
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+ExAcquireRundownProtection(
+    _Inout_ PEX_RUNDOWN_REF RunRef
+)
+{
+    return ExAcquireRundownProtectionEx(RunRef, 1);
+}
+
+/**
+ * @brief Releases Count references
+ *
+ * Wakes the thread waiting in ExWaitForRundownProtectionRelease when the last
+ * reference goes away.
+ *
+ * @param[in,out] RunRef Pointer to the rundown reference
+ * @param[in] Count Number of references to release
+ */
+static __forceinline
+VOID
+ExReleaseRundownProtectionEx(
+    _Inout_ PEX_RUNDOWN_REF RunRef,
+    _In_ ULONG Count
+)
+{
+    ULONG_PTR Value;
+    ULONG_PTR NewValue;
+
+    do {
+        Value = ExpReadRundownRef(RunRef);
+        NewValue = Value - ((ULONG_PTR)Count << EX_RUNDOWN_COUNT_SHIFT);
+    } while (!ExpUpdateRundownRef(RunRef, Value, NewValue));
+
+    if (NewValue == EX_RUNDOWN_ACTIVE) {
+        WakeByAddressAll((PVOID)&RunRef->Count);
+    }
+}
+
+/**
+ * @brief Releases one reference
+ *
+ * @param[in,out] RunRef Pointer to the rundown reference
+ */
+static __forceinline
+VOID
+ExReleaseRundownProtection(
+    _Inout_ PEX_RUNDOWN_REF RunRef
+)
+{
+    ExReleaseRundownProtectionEx(RunRef, 1);
+}
+
+/**
+ * @brief Starts rundown and waits until every reference has been released
+ *
+ * Acquires that begin after this call fail. On return the protected object is
+ * no longer in use and may be torn down.
+ *
+ * @param[in,out] RunRef Pointer to the rundown reference
+ */
+static __forceinline
+VOID
+ExWaitForRundownProtectionRelease(
+    _Inout_ PEX_RUNDOWN_REF RunRef
+)
+{
+    ULONG_PTR Value;
+
+    ExpBeginRundown(RunRef);
+    for (;;) {
+        Value = ExpReadRundownRef(RunRef);
+        if (Value == EX_RUNDOWN_ACTIVE) {
+            return;
+        }
+        WaitOnAddress((volatile VOID*)&RunRef->Count, &Value, sizeof(Value), INFINITE);
+    }
+}
+
+/**
+ * @brief Marks rundown as complete so that every later acquire fails
+ *
+ * @param[out] RunRef Pointer to the rundown reference
+ */
+static __forceinline
+VOID
+ExRundownCompleted(
+    _Out_ PEX_RUNDOWN_REF RunRef
+)
+{
+    WritePointerRelease(&RunRef->Ptr, (PVOID)EX_RUNDOWN_ACTIVE);
+}
+
+/**
+ * @brief Initializes a cache-aware rundown reference
+ *
+ * @param[out] RunRefCacheAware Pointer to the rundown reference
+ * @param[in] Number Number of per-processor references, or 0 for one per processor;
+ *                   capped at EX_RUNDOWN_REF_CACHE_AWARE_MAX_SLOTS
+ * @return STATUS_SUCCESS or STATUS_NO_MEMORY
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+ExInitializeRundownProtectionCacheAware(
+    _Out_ PEX_RUNDOWN_REF_CACHE_AWARE RunRefCacheAware,
+    _In_ ULONG Number
+)
+{
+    ULONG Index;
+
+    if (Number == 0) {
+        SYSTEM_INFO SystemInfo;
+        GetSystemInfo(&SystemInfo);
+        Number = SystemInfo.dwNumberOfProcessors;
+    }
+    if (Number > EX_RUNDOWN_REF_CACHE_AWARE_MAX_SLOTS) {
+        Number = EX_RUNDOWN_REF_CACHE_AWARE_MAX_SLOTS;
+    }
+
+    RunRefCacheAware->RunRefs = (PEX_RUNDOWN_REF_CACHE_AWARE_PADDED)ExAllocateCacheAlignedPoolTracked(
+        NonPagedPoolCacheAligned, (SIZE_T)Number * sizeof(EX_RUNDOWN_REF_CACHE_AWARE_PADDED),
+        &RunRefCacheAware->RunRefsAllocation);
+    if (RunRefCacheAware->RunRefs == NULL) {
+        RunRefCacheAware->Number = 0;
+        return STATUS_NO_MEMORY;
+    }
+
+    for (Index = 0; Index < Number; Index++) {
+        ExInitializeRundownProtection(&RunRefCacheAware->RunRefs[Index].RunRef);
+    }
+    RunRefCacheAware->Number = Number;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Frees a cache-aware rundown reference
+ *
+ * @param[in,out] RunRefCacheAware Pointer to the rundown reference
+ */
+static __forceinline
+VOID
+ExFreeRundownProtectionCacheAware(
+    _Inout_ PEX_RUNDOWN_REF_CACHE_AWARE RunRefCacheAware
+)
+{
+    FREE_POOL(RunRefCacheAware->RunRefsAllocation);
+    RunRefCacheAware->RunRefs = NULL;
+    RunRefCacheAware->Number = 0;
+}
+
+/**
+ * @brief Makes a cache-aware rundown reference usable again after rundown
+ *
+ * @param[in,out] RunRefCacheAware Pointer to the rundown reference
+ */
+static __forceinline
+VOID
+ExReInitializeRundownProtectionCacheAware(
+    _Inout_ PEX_RUNDOWN_REF_CACHE_AWARE RunRefCacheAware
+)
+{
+    ULONG Index;
+
+    for (Index = 0; Index < RunRefCacheAware->Number; Index++) {
+        ExReInitializeRundownProtection(&RunRefCacheAware->RunRefs[Index].RunRef);
+    }
+}
+
+/**
+ * @brief Acquires a reference on the current processor's slot
+ *
+ * The thread may migrate before it releases, so the slot that was used is
+ * returned and must be passed to ExReleaseRundownProtectionCacheAware.
+ *
+ * @param[in,out] RunRefCacheAware Pointer to the rundown reference
+ * @return The per-processor reference that was acquired, or NULL if rundown has started
+ */
+_Must_inspect_result_
+static __forceinline
+PEX_RUNDOWN_REF
+ExAcquireRundownProtectionCacheAware(
+    _Inout_ PEX_RUNDOWN_REF_CACHE_AWARE RunRefCacheAware
+)
+{
+    PEX_RUNDOWN_REF RunRef =
+        &RunRefCacheAware->RunRefs[GetCurrentProcessorNumber() % RunRefCacheAware->Number].RunRef;
+
+    return ExAcquireRundownProtection(RunRef) ? RunRef : NULL;
+}
+
+/**
+ * @brief Releases a reference taken by ExAcquireRundownProtectionCacheAware
+ *
+ * @param[in,out] RunRef Per-processor reference returned by the matching acquire
+ */
+static __forceinline
+VOID
+ExReleaseRundownProtectionCacheAware(
+    _Inout_ PEX_RUNDOWN_REF RunRef
+)
+{
+    ExReleaseRundownProtection(RunRef);
+}
+
+/**
+ * @brief Starts rundown on every slot and waits for all references to be released
+ *
+ * Rundown is started on all slots before waiting on any of them, so no new
+ * reference can be taken anywhere once the first wait begins.
+ *
+ * @param[in,out] RunRefCacheAware Pointer to the rundown reference
+ */
+static __forceinline
+VOID
+ExWaitForRundownProtectionReleaseCacheAware(
+    _Inout_ PEX_RUNDOWN_REF_CACHE_AWARE RunRefCacheAware
+)
+{
+    ULONG Index;
+
+    for (Index = 0; Index < RunRefCacheAware->Number; Index++) {
+        ExpBeginRundown(&RunRefCacheAware->RunRefs[Index].RunRef);
+    }
+
+    for (Index = 0; Index < RunRefCacheAware->Number; Index++) {
+        ExWaitForRundownProtectionRelease(&RunRefCacheAware->RunRefs[Index].RunRef);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_RUNDOWN_H_ */
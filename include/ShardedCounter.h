@@ -0,0 +1,131 @@
+/**
+ * @file ShardedCounter.h
+ * @brief Statistic counters split into per-processor cache lines
+ *
+ * A single interlocked counter updated from many processors at once makes
+ * every update pull the counter's cache line away from the previous writer.
+ * A SHARDED_COUNTER instead keeps SHARDED_COUNTER_SLOTS partial sums, each on
+ * its own cache line, and an update only touches the slot of the processor
+ * the caller runs on. Updates are interlocked but carry no ordering
+ * guarantee, since a thread may migrate or share a slot with another.
+ *
+ * Reading the total sums every slot. The result is exact once updates have
+ * stopped; while updates are running it is a value the counter held at some
+ * point during the read, which is what statistics need.
+ */
+
+#ifndef WINKERNEL_SHARDEDCOUNTER_H_
+#define WINKERNEL_SHARDEDCOUNTER_H_
+
+#include <Windows.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of partial sums per counter; a power of two */
+#ifndef SHARDED_COUNTER_SLOTS
+#define SHARDED_COUNTER_SLOTS 64
+#endif
+
+/* Spacing of the partial sums */
+#define SHARDED_COUNTER_CACHE_LINE 64
+
+C_ASSERT((SHARDED_COUNTER_SLOTS & (SHARDED_COUNTER_SLOTS - 1)) == 0);
+
+/**
+ * @brief One partial sum, aligned and padded so that no two share a cache line
+ *
+ * Structures embedding a SHARDED_COUNTER inherit this alignment; pool
+ * allocations of them must come from ExAllocateCacheAlignedPoolTracked.
+ */
+typedef struct DECLSPEC_CACHEALIGN _SHARDED_COUNTER_SLOT {
+    volatile LONG64 Value;
+    UCHAR Pad[SHARDED_COUNTER_CACHE_LINE - sizeof(LONG64)];
+} SHARDED_COUNTER_SLOT, *PSHARDED_COUNTER_SLOT;
+
+/**
+ * @brief Counter whose value is the sum of per-processor partial sums
+ */
+typedef struct _SHARDED_COUNTER {
+    SHARDED_COUNTER_SLOT Slots[SHARDED_COUNTER_SLOTS];
+} SHARDED_COUNTER, *PSHARDED_COUNTER;
+
+/**
+ * @brief Sets a sharded counter to zero
+ *
+ * Must not race with updates.
+ *
+ * @param[out] Counter Pointer to the counter
+ */
+static __forceinline
+VOID
+RtlInitializeShardedCounter(
+    _Out_ PSHARDED_COUNTER Counter
+)
+{
+    ULONG Index;
+
+    for (Index = 0; Index < SHARDED_COUNTER_SLOTS; Index++) {
+        Counter->Slots[Index].Value = 0;
+    }
+}
+
+/**
+ * @brief Adds a value to a sharded counter
+ *
+ * @param[in,out] Counter Pointer to the counter
+ * @param[in] Value Amount to add; may be negative
+ */
+static __forceinline
+VOID
+RtlAddShardedCounter(
+    _Inout_ PSHARDED_COUNTER Counter,
+    _In_ LONG64 Value
+)
+{
+    PSHARDED_COUNTER_SLOT Slot = &Counter->Slots[GetCurrentProcessorNumber() & (SHARDED_COUNTER_SLOTS - 1)];
+
+    InterlockedExchangeAddNoFence64(&Slot->Value, Value);
+}
+
+/**
+ * @brief Adds one to a sharded counter
+ *
+ * @param[in,out] Counter Pointer to the counter
+ */
+static __forceinline
+VOID
+RtlIncrementShardedCounter(
+    _Inout_ PSHARDED_COUNTER Counter
+)
+{
+    RtlAddShardedCounter(Counter, 1);
+}
+
+/**
+ * @brief Returns the total of a sharded counter
+ *
+ * @param[in] Counter Pointer to the counter
+ * @return Sum of all partial sums
+ */
+static __forceinline
+LONG64
+RtlReadShardedCounter(
+    _In_ const SHARDED_COUNTER* Counter
+)
+{
+    LONG64 Total = 0;
+    ULONG Index;
+
+    for (Index = 0; Index < SHARDED_COUNTER_SLOTS; Index++) {
+        Total += ReadNoFence64(&Counter->Slots[Index].Value);
+    }
+    return Total;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_SHARDEDCOUNTER_H_ */
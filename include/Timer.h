@@ -0,0 +1,561 @@
+/**
+ * @file Timer.h
+ * @brief Timer objects (KTIMER) kept in a hierarchical timer wheel
+ *
+ * A KTIMER_TABLE holds armed timers in TIMER_WHEEL_LEVELS levels of
+ * TIMER_WHEEL_SLOTS lists. A timer due within 64 ticks (milliseconds) goes
+ * into the level 0 slot of its due tick; later timers go into a coarser level
+ * whose slots each cover 64 slots of the level below, and are moved down
+ * ("cascaded") when the wheel reaches them. Timers beyond the last level wait
+ * on an overflow list that is rescanned each time the top level wraps.
+ * Arming and canceling a timer is a list insertion or removal under the
+ * table lock, regardless of how many timers are armed.
+ *
+ * Each table owns one expiry thread. It sleeps until the next occupied slot
+ * or the next cascade, then expires every slot up to the current tick under
+ * one acquisition of the table lock, skipping runs of empty slots with a
+ * per-level occupancy mask. Expired timers become signaled, so threads can
+ * wait for them with KeWaitForSingleObject, and their DPCs are collected and
+ * run on the expiry thread after the lock is dropped, up to
+ * TIMER_EXPIRY_BATCH at a time.
+ *
+ * Unlike the kernel, which has one system-wide timer table, a caller creates
+ * and owns each KTIMER_TABLE and binds timers to it when initializing them.
+ * Due times have the resolution of GetTickCount64.
+ */
+
+#ifndef WINKERNEL_TIMER_H_
+#define WINKERNEL_TIMER_H_
+
+#include <Windows.h>
+#include "Bitmap.h"
+#include "Dispatcher.h"
+#include "Dpc.h"
+#include "LinkedList.h"
+#include "NtStatus.h"
+#include "PushLock.h"
+
+#if defined(_MSC_VER)
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of wheel levels and slots per level; the levels cover 2^24 ticks */
+#define TIMER_WHEEL_LEVELS      4
+#define TIMER_WHEEL_SLOT_BITS   6
+#define TIMER_WHEEL_SLOTS       (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK   (TIMER_WHEEL_SLOTS - 1)
+
+/* Level recorded for timers on the overflow list */
+#define TIMER_OVERFLOW_LEVEL    TIMER_WHEEL_LEVELS
+
+/* Largest number of DPCs the expiry thread collects per lock acquisition */
+#define TIMER_EXPIRY_BATCH      64
+
+/* Sleep deadline of an expiry thread with no armed timers */
+#define TIMER_NO_DEADLINE       (~(ULONGLONG)0)
+
+C_ASSERT(TIMER_WHEEL_SLOTS == 64);
+
+typedef enum _TIMER_TYPE {
+    NotificationTimer,      /**< Stays signaled until set again; releases every waiter */
+    SynchronizationTimer    /**< Auto-reset; each expiration releases one waiter */
+} TIMER_TYPE;
+
+/**
+ * @brief Timer wheel and the thread that expires it
+ */
+typedef struct _KTIMER_TABLE {
+    EX_PUSH_LOCK Lock;                  /**< Protects everything up to Thread */
+    ULONGLONG CurrentTick;              /**< First tick not yet expired */
+    ULONGLONG NextWakeTick;             /**< Tick the expiry thread sleeps until */
+    ULONG TimerCount;                   /**< Armed timers */
+    ULONG64 Occupied[TIMER_WHEEL_LEVELS];           /**< Non-empty slots of each level */
+    LIST_ENTRY Wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    LIST_ENTRY Overflow;                /**< Timers beyond the last level */
+    volatile LONG WakeSignal;           /**< Bumped to wake the expiry thread */
+    volatile LONG Terminating;          /**< Set by KeDeleteTimerTable */
+    HANDLE Thread;                      /**< Expiry thread */
+} KTIMER_TABLE, *PKTIMER_TABLE;
+
+/**
+ * @brief Timer object
+ */
+typedef struct _KTIMER {
+    DISPATCHER_HEADER Header;
+    ULONGLONG DueTime;                  /**< GetTickCount64 value the timer expires at */
+    LIST_ENTRY TimerListEntry;          /**< Link in a wheel slot or the overflow list */
+    PKDPC Dpc;                          /**< Optional DPC run at expiration */
+    LONG Period;                        /**< Milliseconds between expirations, 0 for one-shot */
+    BOOLEAN Inserted;                   /**< TRUE while the timer is armed */
+    UCHAR Level;                        /**< Wheel level, or TIMER_OVERFLOW_LEVEL */
+    UCHAR Slot;                         /**< Slot within Level */
+    PKTIMER_TABLE TimerTable;           /**< Table the timer is armed in */
+} KTIMER, *PKTIMER, *PRKTIMER;
+
+/*
+ * Links a timer into the slot its due time falls in, relative to the current
+ * tick. Timers already due go into the current slot. Called with the table
+ * lock held.
+ */
+static __forceinline
+VOID
+KiInsertTimerInWheel(
+    _Inout_ PKTIMER_TABLE TimerTable,
+    _Inout_ PKTIMER Timer
+)
+{
+    ULONGLONG DueTick = Timer->DueTime;
+    ULONGLONG Delta;
+    ULONG Level = 0;
+    ULONG Slot;
+
+    if (DueTick < TimerTable->CurrentTick) {
+        DueTick = TimerTable->CurrentTick;
+    }
+    Delta = DueTick - TimerTable->CurrentTick;
+
+    while (Level < TIMER_WHEEL_LEVELS && (Delta >> ((Level + 1) * TIMER_WHEEL_SLOT_BITS)) != 0) {
+        Level++;
+    }
+
+    Timer->Level = (UCHAR)Level;
+    if (Level == TIMER_OVERFLOW_LEVEL) {
+        InsertTailList(&TimerTable->Overflow, &Timer->TimerListEntry);
+        return;
+    }
+
+    Slot = (ULONG)(DueTick >> (Level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+    Timer->Slot = (UCHAR)Slot;
+    InsertTailList(&TimerTable->Wheel[Level][Slot], &Timer->TimerListEntry);
+    TimerTable->Occupied[Level] |= 1ULL << Slot;
+}
+
+/* Unlinks an armed timer. Called with the table lock held. */
+static __forceinline
+VOID
+KiRemoveTimerFromWheel(
+    _Inout_ PKTIMER_TABLE TimerTable,
+    _Inout_ PKTIMER Timer
+)
+{
+    if (RemoveEntryList(&Timer->TimerListEntry) && Timer->Level != TIMER_OVERFLOW_LEVEL) {
+        TimerTable->Occupied[Timer->Level] &= ~(1ULL << Timer->Slot);
+    }
+}
+
+/* Re-inserts every timer of a list relative to the current tick */
+static __forceinline
+VOID
+KiReinsertTimers(
+    _Inout_ PKTIMER_TABLE TimerTable,
+    _Inout_ PLIST_ENTRY ListHead
+)
+{
+    LIST_ENTRY Pending;
+
+    InitializeListHead(&Pending);
+    SpliceListTail(&Pending, ListHead);
+    while (!IsListEmpty(&Pending)) {
+        PKTIMER Timer = CONTAINING_RECORD(RemoveHeadList(&Pending), KTIMER, TimerListEntry);
+        KiInsertTimerInWheel(TimerTable, Timer);
+    }
+}
+
+/*
+ * Moves timers down from the coarser levels when the current tick starts a
+ * new round of level 0. A level is cascaded only when every level below it
+ * wrapped as well, and the overflow list when all of them did.
+ */
+static __forceinline
+VOID
+KiCascadeTimers(
+    _Inout_ PKTIMER_TABLE TimerTable
+)
+{
+    ULONGLONG Tick = TimerTable->CurrentTick;
+    ULONG Level;
+
+    for (Level = 1; Level < TIMER_WHEEL_LEVELS; Level++) {
+        ULONG Slot = (ULONG)(Tick >> (Level * TIMER_WHEEL_SLOT_BITS)) & TIMER_WHEEL_SLOT_MASK;
+
+        if (TimerTable->Occupied[Level] & (1ULL << Slot)) {
+            TimerTable->Occupied[Level] &= ~(1ULL << Slot);
+            KiReinsertTimers(TimerTable, &TimerTable->Wheel[Level][Slot]);
+        }
+        if (Slot != 0) {
+            return;
+        }
+    }
+    KiReinsertTimers(TimerTable, &TimerTable->Overflow);
+}
+
+/*
+ * Returns the tick the expiry thread has to run at next: the next occupied
+ * level 0 slot in this round, or else the start of the next round, where
+ * the coarser levels are cascaded. Called with the table lock held.
+ */
+static __forceinline
+ULONGLONG
+KiNextTimerTick(
+    _In_ PKTIMER_TABLE TimerTable
+)
+{
+    ULONGLONG Tick = TimerTable->CurrentTick;
+    ULONG64 Pending = TimerTable->Occupied[0] >> (ULONG)(Tick & TIMER_WHEEL_SLOT_MASK);
+
+    if (TimerTable->TimerCount == 0) {
+        return TIMER_NO_DEADLINE;
+    }
+    if (Pending != 0) {
+        return Tick + RtlpBitMapLowestSetBit(Pending);
+    }
+    return (Tick | TIMER_WHEEL_SLOT_MASK) + 1;
+}
+
+/*
+ * Expires every timer due at or before Now. Each pass takes the table lock
+ * once, signals the expired timers, re-arms periodic ones and collects up to
+ * TIMER_EXPIRY_BATCH DPCs, which run after the lock is released.
+ */
+static __forceinline
+VOID
+KiExpireTimers(
+    _Inout_ PKTIMER_TABLE TimerTable,
+    _In_ ULONGLONG Now
+)
+{
+    PKDPC Dpcs[TIMER_EXPIRY_BATCH];
+    ULONG DpcCount;
+    ULONG i;
+
+    do {
+        DpcCount = 0;
+
+        ExAcquirePushLockExclusive(&TimerTable->Lock);
+        while (DpcCount < TIMER_EXPIRY_BATCH && TimerTable->CurrentTick <= Now) {
+            ULONGLONG Tick = TimerTable->CurrentTick;
+            ULONG Slot = (ULONG)(Tick & TIMER_WHEEL_SLOT_MASK);
+            PLIST_ENTRY ListHead = &TimerTable->Wheel[0][Slot];
+            ULONGLONG Next;
+            ULONG64 Pending;
+
+            // Repeating the cascade after a full batch finds the slots empty
+            if (Slot == 0) {
+                KiCascadeTimers(TimerTable);
+            }
+
+            while (DpcCount < TIMER_EXPIRY_BATCH && !IsListEmpty(ListHead)) {
+                PKTIMER Timer = CONTAINING_RECORD(RemoveHeadList(ListHead), KTIMER, TimerListEntry);
+
+                InterlockedExchange(&Timer->Header.SignalState, 1);
+                KiWakeWaiters(&Timer->Header, KiSignalWakeBudget(&Timer->Header));
+                if (Timer->Dpc != NULL) {
+                    Dpcs[DpcCount++] = Timer->Dpc;
+                }
+
+                if (Timer->Period != 0) {
+                    Timer->DueTime += (ULONGLONG)Timer->Period;
+                    if (Timer->DueTime <= Tick) {
+                        Timer->DueTime = Tick + 1;
+                    }
+                    KiInsertTimerInWheel(TimerTable, Timer);
+                } else {
+                    Timer->Inserted = FALSE;
+                    TimerTable->TimerCount--;
+                }
+            }
+            if (!IsListEmpty(ListHead)) {
+                break;
+            }
+            TimerTable->Occupied[0] &= ~(1ULL << Slot);
+
+            // Skip to the next occupied slot of this round or the next cascade
+            Tick++;
+            Pending = (Tick & TIMER_WHEEL_SLOT_MASK) != 0 ? TimerTable->Occupied[0] >> (ULONG)(Tick & TIMER_WHEEL_SLOT_MASK)
+                                                          : 1;
+            Next = (Pending != 0) ? Tick + RtlpBitMapLowestSetBit(Pending) : (Tick | TIMER_WHEEL_SLOT_MASK) + 1;
+            TimerTable->CurrentTick = (Next <= Now) ? Next : Now + 1;
+        }
+        ExReleasePushLockExclusive(&TimerTable->Lock);
+
+        for (i = 0; i < DpcCount; i++) {
+            Dpcs[i]->DeferredRoutine(Dpcs[i], Dpcs[i]->DeferredContext,
+                                     (PVOID)(ULONG_PTR)Now, (PVOID)(ULONG_PTR)(Now >> 16 >> 16));
+        }
+    } while (DpcCount == TIMER_EXPIRY_BATCH);
+}
+
+static
+DWORD
+WINAPI
+KiTimerThread(
+    _In_ LPVOID Parameter
+)
+{
+    PKTIMER_TABLE TimerTable = (PKTIMER_TABLE)Parameter;
+
+    while (!ReadAcquire(&TimerTable->Terminating)) {
+        ULONGLONG Next;
+        ULONGLONG Now;
+        LONG Signal;
+
+        KiExpireTimers(TimerTable, GetTickCount64());
+
+        // Arming an earlier timer after this point bumps WakeSignal, so the
+        // wait below returns at once instead of oversleeping it
+        ExAcquirePushLockExclusive(&TimerTable->Lock);
+        Next = KiNextTimerTick(TimerTable);
+        TimerTable->NextWakeTick = Next;
+        Signal = ReadNoFence(&TimerTable->WakeSignal);
+        ExReleasePushLockExclusive(&TimerTable->Lock);
+
+        Now = GetTickCount64();
+        if (Next == TIMER_NO_DEADLINE) {
+            WaitOnAddress(&TimerTable->WakeSignal, &Signal, sizeof(LONG), INFINITE);
+        } else if (Next > Now) {
+            WaitOnAddress(&TimerTable->WakeSignal, &Signal, sizeof(LONG),
+                          (DWORD)((Next - Now < 0x7FFFFFFF) ? Next - Now : 0x7FFFFFFF));
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Creates a timer table and starts its expiry thread
+ *
+ * @param[out] TimerTable Pointer to the table to initialize
+ * @return STATUS_SUCCESS, or STATUS_INSUFFICIENT_RESOURCES if the thread
+ *         could not be created
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+KeInitializeTimerTable(
+    _Out_ PKTIMER_TABLE TimerTable
+)
+{
+    ULONG Level;
+    ULONG Slot;
+
+    RtlZeroMemory(TimerTable, sizeof(*TimerTable));
+    ExInitializePushLock(&TimerTable->Lock);
+    TimerTable->CurrentTick = GetTickCount64();
+    TimerTable->NextWakeTick = TIMER_NO_DEADLINE;
+    for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+        for (Slot = 0; Slot < TIMER_WHEEL_SLOTS; Slot++) {
+            InitializeListHead(&TimerTable->Wheel[Level][Slot]);
+        }
+    }
+    InitializeListHead(&TimerTable->Overflow);
+
+    TimerTable->Thread = CreateThread(NULL, 0, KiTimerThread, TimerTable, 0, NULL);
+    if (TimerTable->Thread == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Stops the expiry thread of a timer table
+ *
+ * Timers still armed are dropped without expiring; they must not be used
+ * with the table afterwards. A DPC that is running when this is called
+ * finishes first.
+ *
+ * @param[in,out] TimerTable Pointer to an initialized timer table
+ * @note Must not be called from a DPC of the table's timers
+ */
+static __forceinline
+VOID
+KeDeleteTimerTable(
+    _Inout_ PKTIMER_TABLE TimerTable
+)
+{
+    WriteRelease(&TimerTable->Terminating, TRUE);
+    InterlockedIncrement(&TimerTable->WakeSignal);
+    WakeByAddressAll((PVOID)&TimerTable->WakeSignal);
+
+    WaitForSingleObject(TimerTable->Thread, INFINITE);
+    CloseHandle(TimerTable->Thread);
+    TimerTable->Thread = NULL;
+}
+
+/**
+ * @brief Initializes a timer of the given type
+ *
+ * @param[out] Timer Pointer to the timer
+ * @param[in] Type NotificationTimer or SynchronizationTimer
+ * @param[in] TimerTable Table the timer is armed in
+ */
+static __forceinline
+VOID
+KeInitializeTimerEx(
+    _Out_ PKTIMER Timer,
+    _In_ TIMER_TYPE Type,
+    _In_ PKTIMER_TABLE TimerTable
+)
+{
+    KiInitializeDispatcherHeader(&Timer->Header,
+                                 (UCHAR)(Type == NotificationTimer ? TimerNotificationObject
+                                                                   : TimerSynchronizationObject),
+                                 0);
+    Timer->DueTime = 0;
+    Timer->TimerListEntry.Flink = Timer->TimerListEntry.Blink = NULL;
+    Timer->Dpc = NULL;
+    Timer->Period = 0;
+    Timer->Inserted = FALSE;
+    Timer->Level = 0;
+    Timer->Slot = 0;
+    Timer->TimerTable = TimerTable;
+}
+
+/**
+ * @brief Initializes a notification timer
+ *
+ * @param[out] Timer Pointer to the timer
+ * @param[in] TimerTable Table the timer is armed in
+ */
+static __forceinline
+VOID
+KeInitializeTimer(
+    _Out_ PKTIMER Timer,
+    _In_ PKTIMER_TABLE TimerTable
+)
+{
+    KeInitializeTimerEx(Timer, NotificationTimer, TimerTable);
+}
+
+/**
+ * @brief Arms a timer, optionally periodic, replacing any earlier setting
+ *
+ * The timer is reset to not-signaled. Arming is O(1); the expiry thread is
+ * only woken when the new due time is earlier than the one it sleeps until.
+ *
+ * @param[in,out] Timer Pointer to an initialized timer
+ * @param[in] DueTime Negative for a relative interval, positive for an
+ *            absolute system time, in 100-nanosecond units
+ * @param[in] Period Milliseconds between later expirations, 0 for one-shot
+ * @param[in] Dpc Optional DPC to run at each expiration
+ * @return TRUE if the timer was already armed
+ */
+static __forceinline
+BOOLEAN
+KeSetTimerEx(
+    _Inout_ PKTIMER Timer,
+    _In_ LARGE_INTEGER DueTime,
+    _In_ LONG Period,
+    _In_opt_ PKDPC Dpc
+)
+{
+    PKTIMER_TABLE TimerTable = Timer->TimerTable;
+    BOOLEAN Infinite;
+    BOOLEAN WasInserted;
+    BOOLEAN Wake;
+    ULONGLONG Deadline;
+
+    KiComputeWaitDeadline(&DueTime, &Infinite, &Deadline);
+
+    ExAcquirePushLockExclusive(&TimerTable->Lock);
+    WasInserted = Timer->Inserted;
+    if (WasInserted) {
+        KiRemoveTimerFromWheel(TimerTable, Timer);
+    } else {
+        TimerTable->TimerCount++;
+    }
+
+    WriteRelease(&Timer->Header.SignalState, 0);
+    Timer->DueTime = Deadline;
+    Timer->Period = (Period > 0) ? Period : 0;
+    Timer->Dpc = Dpc;
+    Timer->Inserted = TRUE;
+    KiInsertTimerInWheel(TimerTable, Timer);
+
+    Wake = (Deadline < TimerTable->NextWakeTick);
+    if (Wake) {
+        TimerTable->NextWakeTick = Deadline;
+        InterlockedIncrement(&TimerTable->WakeSignal);
+    }
+    ExReleasePushLockExclusive(&TimerTable->Lock);
+
+    if (Wake) {
+        WakeByAddressSingle((PVOID)&TimerTable->WakeSignal);
+    }
+    return WasInserted;
+}
+
+/**
+ * @brief Arms a one-shot timer, replacing any earlier setting
+ *
+ * @param[in,out] Timer Pointer to an initialized timer
+ * @param[in] DueTime Negative for a relative interval, positive for an
+ *            absolute system time, in 100-nanosecond units
+ * @param[in] Dpc Optional DPC to run at expiration
+ * @return TRUE if the timer was already armed
+ */
+static __forceinline
+BOOLEAN
+KeSetTimer(
+    _Inout_ PKTIMER Timer,
+    _In_ LARGE_INTEGER DueTime,
+    _In_opt_ PKDPC Dpc
+)
+{
+    return KeSetTimerEx(Timer, DueTime, 0, Dpc);
+}
+
+/**
+ * @brief Disarms a timer
+ *
+ * A DPC of the timer that the expiry thread has already collected still
+ * runs after this returns.
+ *
+ * @param[in,out] Timer Pointer to an initialized timer
+ * @return TRUE if the timer was armed
+ */
+static __forceinline
+BOOLEAN
+KeCancelTimer(
+    _Inout_ PKTIMER Timer
+)
+{
+    PKTIMER_TABLE TimerTable = Timer->TimerTable;
+    BOOLEAN WasInserted;
+
+    ExAcquirePushLockExclusive(&TimerTable->Lock);
+    WasInserted = Timer->Inserted;
+    if (WasInserted) {
+        KiRemoveTimerFromWheel(TimerTable, Timer);
+        Timer->Inserted = FALSE;
+        TimerTable->TimerCount--;
+    }
+    ExReleasePushLockExclusive(&TimerTable->Lock);
+
+    return WasInserted;
+}
+
+/**
+ * @brief Returns whether a timer has expired since it was last set
+ *
+ * @param[in] Timer Pointer to the timer
+ * @return TRUE if the timer is signaled
+ */
+static __forceinline
+BOOLEAN
+KeReadStateTimer(
+    _In_ PKTIMER Timer
+)
+{
+    return ReadAcquire(&Timer->Header.SignalState) != 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_TIMER_H_ */
@@ -6,11 +6,34 @@
  * 
  * This header provides a set of functions for handling Unicode strings in a way that
  * is compatible with Windows kernel conventions. It includes functions for string
- * initialization, validation, and duplication.
+ * initialization, validation, duplication, copying, comparison, case conversion,
+ * hashing and conversion to and from UTF-8 and ANSI (Latin-1), and an owned
+ * string type that keeps short strings inline instead of in the pool.
+ *
+ * Comparisons run 8 code units at a time with SSE2 (always available on x64),
+ * or 16 at a time when the translation unit is compiled with AVX2 enabled
+ * (/arch:AVX2 or -mavx2). Case-insensitive comparisons fold ASCII letters in
+ * the vector registers and fall back to the full case table only for lanes
+ * that still differ; case conversion likewise converts ASCII a vector at a
+ * time and looks up only the code units above 0x7F. UTF-8 conversion moves
+ * ASCII and runs of two-byte sequences a vector at a time and decodes
+ * everything else with a strict scalar decoder.
  */
 
 #include <Windows.h>
+#include <intrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "KernelHeapAlloc.h"
+#include "NtStatus.h"
+#include "UnicodeCaseTable.h"
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#define RTLP_UNICODE_STRING_SSE2 1
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,27 +50,47 @@ typedef struct _UNICODE_STRING {
 
 typedef const UNICODE_STRING *PCUNICODE_STRING;
 
-typedef LONG NTSTATUS;
-#ifndef STATUS_SUCCESS
-#define STATUS_SUCCESS ((NTSTATUS)0x00000000L)
-#endif
+/**
+ * @brief Counted 8-bit string compatible with the Windows kernel STRING
+ *
+ * ANSI_STRING and UTF8_STRING are the same structure holding Latin-1 and
+ * UTF-8 text respectively. Length excludes any terminating null.
+ */
+typedef struct _STRING {
+    USHORT Length;        /**< Length of the string in bytes */
+    USHORT MaximumLength; /**< Maximum size of buffer in bytes */
+    PCHAR  Buffer;        /**< Pointer to string buffer */
+} STRING, *PSTRING;
 
-#ifndef STATUS_INVALID_PARAMETER
-#define STATUS_INVALID_PARAMETER ((NTSTATUS)0xC000000DL)
-#endif
+typedef const STRING *PCSTRING;
 
-#ifndef STATUS_NO_MEMORY
-#define STATUS_NO_MEMORY ((NTSTATUS)0xC0000017L)
-#endif
+typedef STRING ANSI_STRING;
+typedef PSTRING PANSI_STRING;
+typedef PCSTRING PCANSI_STRING;
 
-#ifndef STATUS_NAME_TOO_LONG
-#define STATUS_NAME_TOO_LONG ((NTSTATUS)0xC0000106L)
-#endif
+typedef STRING UTF8_STRING;
+typedef PSTRING PUTF8_STRING;
+typedef PCSTRING PCUTF8_STRING;
 
-#ifndef NT_SUCCESS
-#define NT_SUCCESS(Status) (((NTSTATUS)(Status)) >= 0)
+/* Code units, terminator included, that an INLINE_UNICODE_STRING holds without allocating */
+#ifndef INLINE_UNICODE_STRING_CHARS
+#define INLINE_UNICODE_STRING_CHARS 32
 #endif
 
+/**
+ * @brief Owned Unicode string that stores short strings in the structure itself
+ *
+ * String is an ordinary view for every routine taking a UNICODE_STRING. Its
+ * Buffer points at InlineBuffer when the string and its terminator fit there
+ * and at a pool allocation otherwise. Because the view may point into the
+ * structure, an INLINE_UNICODE_STRING must not be copied by assignment or
+ * memcpy; use RtlMoveInlineUnicodeString. A zero-filled one is empty.
+ */
+typedef struct _INLINE_UNICODE_STRING {
+    UNICODE_STRING String;                          /**< The view; always null-terminated once set */
+    WCHAR InlineBuffer[INLINE_UNICODE_STRING_CHARS];
+} INLINE_UNICODE_STRING, *PINLINE_UNICODE_STRING;
+
 #ifndef RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE
 #define RTL_DUPLICATE_UNICODE_STRING_NULL_TERMINATE (0x00000001)
 #endif
@@ -68,6 +111,44 @@ typedef LONG NTSTATUS;
 #define UNICODE_STRING_MAX_CHARS (32767)
 #endif
 
+/**
+ * @brief Initializes a UNICODE_STRING from a string literal at compile time
+ *
+ * The literal stays the buffer; MaximumLength includes its terminator.
+ */
+#ifndef RTL_CONSTANT_STRING
+#define RTL_CONSTANT_STRING(s) { sizeof(s) - sizeof((s)[0]), sizeof(s), (PWSTR)(s) }
+#endif
+
+/**
+ * @brief Declares an empty UNICODE_STRING backed by a stack buffer
+ *
+ * Declares _var together with a WCHAR array _var_buffer of _size elements
+ * that the copy and append routines fill without allocating.
+ */
+#ifndef DECLARE_UNICODE_STRING_SIZE
+#define DECLARE_UNICODE_STRING_SIZE(_var, _size) \
+    WCHAR _var ## _buffer[_size];                  \
+    UNICODE_STRING _var = { 0, (USHORT)((_size) * sizeof(WCHAR)), _var ## _buffer }
+#endif
+
+#ifndef HASH_STRING_ALGORITHM_DEFAULT
+#define HASH_STRING_ALGORITHM_DEFAULT (0)
+#endif
+
+#ifndef HASH_STRING_ALGORITHM_X65599
+#define HASH_STRING_ALGORITHM_X65599 (1)
+#endif
+
+/* Library extension: a faster hash whose values are not compatible with Windows */
+#ifndef HASH_STRING_ALGORITHM_FAST
+#define HASH_STRING_ALGORITHM_FAST (2)
+#endif
+
+#ifndef HASH_STRING_ALGORITHM_INVALID
+#define HASH_STRING_ALGORITHM_INVALID (0xffffffff)
+#endif
+
 /**
  * @brief Initializes a UNICODE_STRING from a null-terminated wide string
  * 
@@ -79,7 +160,7 @@ typedef LONG NTSTATUS;
  * The Buffer in DestinationString will point to SourceString's buffer.
  * No memory allocation is performed.
  */
-NTSTATUS RtlInitUnicodeString(
+static NTSTATUS RtlInitUnicodeString(
     OUT PUNICODE_STRING DestinationString,
     IN PCWSTR SourceString OPTIONAL
     );
@@ -97,7 +178,7 @@ NTSTATUS RtlInitUnicodeString(
  * - Buffer alignment
  * - Buffer not NULL if Length > 0
  */
-NTSTATUS RtlValidateUnicodeString(
+static NTSTATUS RtlValidateUnicodeString(
     ULONG Flags,
     PCUNICODE_STRING String
     );
@@ -113,7 +194,7 @@ NTSTATUS RtlValidateUnicodeString(
  * Memory is allocated for the new string's buffer.
  * The caller must free the buffer using FreeUnicodeString when done.
  */
-NTSTATUS RtlDuplicateUnicodeString(
+static NTSTATUS RtlDuplicateUnicodeString(
     ULONG Flags,
     PCUNICODE_STRING StringIn,
     PUNICODE_STRING StringOut
@@ -127,14 +208,83 @@ NTSTATUS RtlDuplicateUnicodeString(
  * Frees the Buffer and resets the structure fields.
  * Only use this for strings allocated by RtlDuplicateUnicodeString.
  */
-void FreeUnicodeString(PUNICODE_STRING UnicodeString);
+static void FreeUnicodeString(PUNICODE_STRING UnicodeString);
 
 #ifdef __cplusplus
 }
 #endif
 
+/**
+ * @brief Counts the 16-bit code units before a null terminator
+ *
+ * @param String String to measure
+ * @param MaxCount Maximum number of code units to count
+ * @return Number of code units before the terminator, or MaxCount if there is
+ *         none among the first MaxCount
+ *
+ * Always scans 16-bit units, whatever the size of wchar_t on the platform.
+ * Vector loads are aligned to their own size; lanes before String in the
+ * first load are discarded. No load reaches past the first MaxCount code
+ * units: once less than a full vector remains, the rest is scanned one code
+ * unit at a time, as is a string that is not WCHAR aligned.
+ */
+static __forceinline
+SIZE_T
+RtlpUnicodeStringLength(
+    _In_ PCWSTR String,
+    _In_ SIZE_T MaxCount
+)
+{
+    const USHORT* const Units = (const USHORT*)String;
+    SIZE_T Length = 0;
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+    // An empty bound may point at the end of a page, so nothing is read
+    if (MaxCount != 0 && ((ULONG_PTR)String & 1) == 0) {
+#if defined(__AVX2__)
+        SIZE_T const Width = sizeof(__m256i);
+#else
+        SIZE_T const Width = sizeof(__m128i);
+#endif
+        const UCHAR* const Start = (const UCHAR*)String;
+        const UCHAR* Block = (const UCHAR*)((ULONG_PTR)String & ~(ULONG_PTR)(Width - 1));
+        const UCHAR* Base = Start;
+        ULONG Terminators;
+
+        for (;;) {
+            if ((SIZE_T)(Block + Width - Start) / sizeof(WCHAR) > MaxCount) {
+                // Less than a vector left before MaxCount
+                Length = (SIZE_T)(Base - Start) / sizeof(WCHAR);
+                break;
+            }
+#if defined(__AVX2__)
+            Terminators = (ULONG)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi16(_mm256_load_si256((const __m256i*)Block), _mm256_setzero_si256()));
+#else
+            Terminators = (ULONG)_mm_movemask_epi8(
+                _mm_cmpeq_epi16(_mm_load_si128((const __m128i*)Block), _mm_setzero_si128()));
+#endif
+            // Bit 0 of the mask now stands for the byte at Base
+            Terminators >>= (ULONG)(Base - Block);
+            if (Terminators != 0) {
+                unsigned long Lane;
+                _BitScanForward(&Lane, Terminators);
+                return (SIZE_T)(Base - Start + Lane) / sizeof(WCHAR);
+            }
+            Block += Width;
+            Base = Block;
+        }
+    }
+#endif
+
+    while (Length < MaxCount && Units[Length] != 0) {
+        Length++;
+    }
+    return Length;
+}
+
 // Helper functions for UNICODE_STRING management
-inline NTSTATUS RtlInitUnicodeString(
+static __forceinline NTSTATUS RtlInitUnicodeString(
     OUT PUNICODE_STRING DestinationString,
     IN PCWSTR SourceString OPTIONAL
     )
@@ -146,8 +296,10 @@ inline NTSTATUS RtlInitUnicodeString(
     DestinationString->Buffer = (PWSTR)SourceString;  // Set Buffer first, matching Windows implementation
 
     if (SourceString != NULL) {
-        SIZE_T Length = wcslen(SourceString) * sizeof(WCHAR);
-        if (Length > UNICODE_STRING_MAX_BYTES) {
+        // The terminator must fit in MaximumLength too, so the scan can stop
+        // as soon as it reaches UNICODE_STRING_MAX_CHARS code units
+        SIZE_T Length = RtlpUnicodeStringLength(SourceString, UNICODE_STRING_MAX_CHARS) * sizeof(WCHAR);
+        if (Length > UNICODE_STRING_MAX_BYTES - sizeof(UNICODE_NULL)) {
             return STATUS_NAME_TOO_LONG;
         }
         DestinationString->Length = (USHORT)Length;
@@ -159,7 +311,7 @@ inline NTSTATUS RtlInitUnicodeString(
     return STATUS_SUCCESS;
 }
 
-inline NTSTATUS RtlValidateUnicodeString(ULONG Flags, PCUNICODE_STRING String)
+static __forceinline NTSTATUS RtlValidateUnicodeString(ULONG Flags, PCUNICODE_STRING String)
 {
     // It seems that Flags was not used in the original version either
 
@@ -203,7 +355,7 @@ inline NTSTATUS RtlValidateUnicodeString(ULONG Flags, PCUNICODE_STRING String)
     return STATUS_SUCCESS;
 }
 
-inline NTSTATUS RtlDuplicateUnicodeString(
+static __forceinline NTSTATUS RtlDuplicateUnicodeString(
     ULONG Flags,
     PCUNICODE_STRING StringIn,
     PUNICODE_STRING StringOut
@@ -282,7 +434,7 @@ inline NTSTATUS RtlDuplicateUnicodeString(
     return STATUS_SUCCESS;
 }
 
-inline void FreeUnicodeString(PUNICODE_STRING UnicodeString)
+static __forceinline void FreeUnicodeString(PUNICODE_STRING UnicodeString)
 {
 	if (UnicodeString && UnicodeString->Buffer) {
 		// Use tracked free
@@ -295,4 +447,2028 @@ inline void FreeUnicodeString(PUNICODE_STRING UnicodeString)
 	}
 }
 
-#endif
\ No newline at end of file
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes a UNICODE_STRING from a string of bounded length
+ *
+ * @param DestinationString UNICODE_STRING to initialize
+ * @param SourceString String to reference, or NULL for an empty string
+ * @param MaxCount Size of the buffer at SourceString in code units; no
+ *        code unit past it is read
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER, or STATUS_NAME_TOO_LONG
+ *         if the string does not fit in a UNICODE_STRING
+ *
+ * Suits fixed-size fields that are null-terminated only when shorter than
+ * the field: a string without a terminator fills all MaxCount code units and
+ * gets MaximumLength equal to Length. Nothing is copied or allocated.
+ */
+static __forceinline
+NTSTATUS
+RtlInitUnicodeStringEx(
+    _Out_ PUNICODE_STRING DestinationString,
+    _In_opt_ PCWSTR SourceString,
+    _In_ SIZE_T MaxCount
+)
+{
+    SIZE_T const Bound = MaxCount < UNICODE_STRING_MAX_CHARS ? MaxCount : UNICODE_STRING_MAX_CHARS;
+    SIZE_T Length;
+
+    if (DestinationString == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    DestinationString->Buffer = (PWSTR)SourceString;
+    DestinationString->Length = 0;
+    DestinationString->MaximumLength = 0;
+    if (SourceString == NULL) {
+        return STATUS_SUCCESS;
+    }
+
+    Length = RtlpUnicodeStringLength(SourceString, Bound);
+    if (Length < Bound) {
+        DestinationString->Length = (USHORT)(Length * sizeof(WCHAR));
+        DestinationString->MaximumLength = (USHORT)((Length + 1) * sizeof(WCHAR));
+    } else if (Bound == MaxCount) {
+        DestinationString->Length = (USHORT)(Length * sizeof(WCHAR));
+        DestinationString->MaximumLength = DestinationString->Length;
+    } else {
+        return STATUS_NAME_TOO_LONG;
+    }
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Copies a Unicode string into a caller-owned buffer
+ *
+ * @param DestinationString Receives the copy in its existing Buffer
+ * @param SourceString String to copy, or NULL for an empty string
+ * @return STATUS_SUCCESS, or STATUS_BUFFER_TOO_SMALL if the source did not fit
+ *
+ * As in Windows, a source longer than DestinationString->MaximumLength is
+ * truncated to fit rather than rejected, so callers that ignore the result
+ * behave exactly as with the kernel's VOID version; the status reports the
+ * truncation. The copy is null-terminated when there is room.
+ */
+static __forceinline
+NTSTATUS
+RtlCopyUnicodeString(
+    _Inout_ PUNICODE_STRING DestinationString,
+    _In_opt_ PCUNICODE_STRING SourceString
+)
+{
+    USHORT Length;
+
+    if (SourceString == NULL) {
+        DestinationString->Length = 0;
+        return STATUS_SUCCESS;
+    }
+
+    Length = SourceString->Length;
+    if (Length > DestinationString->MaximumLength) {
+        Length = DestinationString->MaximumLength & ~(USHORT)(sizeof(WCHAR) - 1);
+    }
+    RtlMoveMemory(DestinationString->Buffer, SourceString->Buffer, Length);
+    DestinationString->Length = Length;
+    if (Length + sizeof(WCHAR) <= DestinationString->MaximumLength) {
+        DestinationString->Buffer[Length / sizeof(WCHAR)] = UNICODE_NULL;
+    }
+    return Length == SourceString->Length ? STATUS_SUCCESS : STATUS_BUFFER_TOO_SMALL;
+}
+
+/**
+ * @brief Appends a Unicode string to another in its existing buffer
+ *
+ * @param Destination String to extend
+ * @param Source String to append
+ * @return STATUS_SUCCESS, or STATUS_BUFFER_TOO_SMALL, in which case
+ *         Destination is left unchanged
+ *
+ * The result is null-terminated when there is room. Source may point into
+ * Destination's own buffer.
+ */
+static __forceinline
+NTSTATUS
+RtlAppendUnicodeStringToString(
+    _Inout_ PUNICODE_STRING Destination,
+    _In_ PCUNICODE_STRING Source
+)
+{
+    ULONG const Length = (ULONG)Destination->Length + Source->Length;
+
+    if (Source->Length == 0) {
+        return STATUS_SUCCESS;
+    }
+    if (Length > Destination->MaximumLength) {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    RtlMoveMemory((PUCHAR)Destination->Buffer + Destination->Length, Source->Buffer, Source->Length);
+    Destination->Length = (USHORT)Length;
+    if (Length + sizeof(WCHAR) <= Destination->MaximumLength) {
+        Destination->Buffer[Length / sizeof(WCHAR)] = UNICODE_NULL;
+    }
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Appends a null-terminated wide string to a Unicode string
+ *
+ * @param Destination String to extend
+ * @param Source Null-terminated string to append, or NULL to append nothing
+ * @return STATUS_SUCCESS, STATUS_BUFFER_TOO_SMALL (Destination unchanged), or
+ *         STATUS_NAME_TOO_LONG if Source exceeds UNICODE_STRING_MAX_BYTES
+ */
+static __forceinline
+NTSTATUS
+RtlAppendUnicodeToString(
+    _Inout_ PUNICODE_STRING Destination,
+    _In_opt_ PCWSTR Source
+)
+{
+    UNICODE_STRING SourceString;
+    NTSTATUS const Status = RtlInitUnicodeString(&SourceString, Source);
+
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+    return RtlAppendUnicodeStringToString(Destination, &SourceString);
+}
+
+/**
+ * @brief Converts a code unit to upper case
+ *
+ * @param SourceCharacter Code unit to convert
+ * @return The upper-case form, or SourceCharacter if it has none
+ *
+ * Uses the simple one-to-one mappings of UnicodeCaseTable.h; ASCII is handled
+ * without touching the table.
+ */
+static __forceinline
+WCHAR
+RtlUpcaseUnicodeChar(
+    _In_ WCHAR SourceCharacter
+)
+{
+    USHORT const Code = (USHORT)SourceCharacter;
+
+    if (Code < 0x80) {
+        return ((USHORT)(Code - L'a') <= L'z' - L'a') ? (WCHAR)(Code - (L'a' - L'A')) : SourceCharacter;
+    }
+    return (WCHAR)(USHORT)(Code + RtlpUpcaseTableData[
+        ((ULONG)RtlpUpcaseTableIndex[Code >> RTL_CASE_TABLE_BLOCK_SHIFT] << RTL_CASE_TABLE_BLOCK_SHIFT) +
+        (Code & (RTL_CASE_TABLE_BLOCK_SIZE - 1))]);
+}
+
+/**
+ * @brief Converts a code unit to lower case
+ *
+ * @param SourceCharacter Code unit to convert
+ * @return The lower-case form, or SourceCharacter if it has none
+ */
+static __forceinline
+WCHAR
+RtlDowncaseUnicodeChar(
+    _In_ WCHAR SourceCharacter
+)
+{
+    USHORT const Code = (USHORT)SourceCharacter;
+
+    if (Code < 0x80) {
+        return ((USHORT)(Code - L'A') <= L'Z' - L'A') ? (WCHAR)(Code + (L'a' - L'A')) : SourceCharacter;
+    }
+    return (WCHAR)(USHORT)(Code + RtlpDowncaseTableData[
+        ((ULONG)RtlpDowncaseTableIndex[Code >> RTL_CASE_TABLE_BLOCK_SHIFT] << RTL_CASE_TABLE_BLOCK_SHIFT) +
+        (Code & (RTL_CASE_TABLE_BLOCK_SIZE - 1))]);
+}
+
+#if defined(__AVX2__)
+/* Upper-cases the ASCII letters of 16 code units; everything else passes through */
+static __forceinline
+__m256i
+RtlpUpcaseAscii256(
+    _In_ __m256i Units
+)
+{
+    __m256i const IsLower = _mm256_and_si256(
+        _mm256_cmpgt_epi16(Units, _mm256_set1_epi16(L'a' - 1)),
+        _mm256_cmpgt_epi16(_mm256_set1_epi16(L'z' + 1), Units));
+    return _mm256_sub_epi16(Units, _mm256_and_si256(IsLower, _mm256_set1_epi16(L'a' - L'A')));
+}
+
+/* Lower-cases the ASCII letters of 16 code units; everything else passes through */
+static __forceinline
+__m256i
+RtlpDowncaseAscii256(
+    _In_ __m256i Units
+)
+{
+    __m256i const IsUpper = _mm256_and_si256(
+        _mm256_cmpgt_epi16(Units, _mm256_set1_epi16(L'A' - 1)),
+        _mm256_cmpgt_epi16(_mm256_set1_epi16(L'Z' + 1), Units));
+    return _mm256_add_epi16(Units, _mm256_and_si256(IsUpper, _mm256_set1_epi16(L'a' - L'A')));
+}
+
+/* Returns a mask with two bits set for every code unit above 0x7F */
+static __forceinline
+ULONG
+RtlpNonAsciiMask256(
+    _In_ __m256i Units
+)
+{
+    __m256i const High = _mm256_and_si256(Units, _mm256_set1_epi16((SHORT)0xFF80));
+    return ~(ULONG)_mm256_movemask_epi8(_mm256_cmpeq_epi16(High, _mm256_setzero_si256()));
+}
+#endif
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+/* Upper-cases the ASCII letters of 8 code units; everything else passes through */
+static __forceinline
+__m128i
+RtlpUpcaseAscii128(
+    _In_ __m128i Units
+)
+{
+    __m128i const IsLower = _mm_and_si128(
+        _mm_cmpgt_epi16(Units, _mm_set1_epi16(L'a' - 1)),
+        _mm_cmplt_epi16(Units, _mm_set1_epi16(L'z' + 1)));
+    return _mm_sub_epi16(Units, _mm_and_si128(IsLower, _mm_set1_epi16(L'a' - L'A')));
+}
+
+/* Lower-cases the ASCII letters of 8 code units; everything else passes through */
+static __forceinline
+__m128i
+RtlpDowncaseAscii128(
+    _In_ __m128i Units
+)
+{
+    __m128i const IsUpper = _mm_and_si128(
+        _mm_cmpgt_epi16(Units, _mm_set1_epi16(L'A' - 1)),
+        _mm_cmplt_epi16(Units, _mm_set1_epi16(L'Z' + 1)));
+    return _mm_add_epi16(Units, _mm_and_si128(IsUpper, _mm_set1_epi16(L'a' - L'A')));
+}
+
+/* Returns a mask with two bits set for every code unit above 0x7F */
+static __forceinline
+ULONG
+RtlpNonAsciiMask128(
+    _In_ __m128i Units
+)
+{
+    __m128i const High = _mm_and_si128(Units, _mm_set1_epi16((SHORT)0xFF80));
+    return (ULONG)_mm_movemask_epi8(_mm_cmpeq_epi16(High, _mm_setzero_si128())) ^ 0xFFFF;
+}
+#endif
+
+/**
+ * @brief Returns the index of the first code unit at which two buffers differ
+ *
+ * @param String1 First buffer
+ * @param String2 Second buffer
+ * @param Count Number of code units to examine
+ * @param CaseInSensitive Compare upper-case forms instead of raw code units
+ * @return Index of the first difference, or Count if there is none
+ *
+ * Code units are compared a vector at a time. When case is ignored, ASCII
+ * letters are folded inside the vector; a vector that still differs is
+ * rechecked from the first differing lane against the full case table. Lanes above 0x7FFF compare
+ * as negative in the signed 16-bit compares and are never folded there.
+ */
+static __forceinline
+SIZE_T
+RtlpFindUnicodeMismatch(
+    _In_reads_(Count) PCWSTR String1,
+    _In_reads_(Count) PCWSTR String2,
+    _In_ SIZE_T Count,
+    _In_ BOOLEAN CaseInSensitive
+)
+{
+    SIZE_T Index = 0;
+
+#if defined(__AVX2__)
+    while (Count - Index >= 16) {
+        __m256i Units1 = _mm256_loadu_si256((const __m256i*)(String1 + Index));
+        __m256i Units2 = _mm256_loadu_si256((const __m256i*)(String2 + Index));
+        ULONG Different;
+        unsigned long Lane;
+
+        if (CaseInSensitive) {
+            Units1 = RtlpUpcaseAscii256(Units1);
+            Units2 = RtlpUpcaseAscii256(Units2);
+        }
+        Different = ~(ULONG)_mm256_movemask_epi8(_mm256_cmpeq_epi16(Units1, Units2));
+        if (Different != 0) {
+            _BitScanForward(&Lane, Different);
+            if (!CaseInSensitive) {
+                return Index + Lane / sizeof(WCHAR);
+            }
+            for (Lane /= sizeof(WCHAR); Lane < 16; Lane++) {
+                if (String1[Index + Lane] != String2[Index + Lane] &&
+                    RtlUpcaseUnicodeChar(String1[Index + Lane]) != RtlUpcaseUnicodeChar(String2[Index + Lane])) {
+                    return Index + Lane;
+                }
+            }
+        }
+        Index += 16;
+    }
+#endif
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+    while (Count - Index >= 8) {
+        __m128i Units1 = _mm_loadu_si128((const __m128i*)(String1 + Index));
+        __m128i Units2 = _mm_loadu_si128((const __m128i*)(String2 + Index));
+        ULONG Different;
+        unsigned long Lane;
+
+        if (CaseInSensitive) {
+            Units1 = RtlpUpcaseAscii128(Units1);
+            Units2 = RtlpUpcaseAscii128(Units2);
+        }
+        Different = (ULONG)_mm_movemask_epi8(_mm_cmpeq_epi16(Units1, Units2)) ^ 0xFFFF;
+        if (Different != 0) {
+            _BitScanForward(&Lane, Different);
+            if (!CaseInSensitive) {
+                return Index + Lane / sizeof(WCHAR);
+            }
+            for (Lane /= sizeof(WCHAR); Lane < 8; Lane++) {
+                if (String1[Index + Lane] != String2[Index + Lane] &&
+                    RtlUpcaseUnicodeChar(String1[Index + Lane]) != RtlUpcaseUnicodeChar(String2[Index + Lane])) {
+                    return Index + Lane;
+                }
+            }
+        }
+        Index += 8;
+    }
+#endif
+
+    for (; Index < Count; Index++) {
+        if (String1[Index] != String2[Index] &&
+            (!CaseInSensitive ||
+             RtlUpcaseUnicodeChar(String1[Index]) != RtlUpcaseUnicodeChar(String2[Index]))) {
+            break;
+        }
+    }
+    return Index;
+}
+
+/**
+ * @brief Compares two Unicode strings
+ *
+ * @param String1 First string
+ * @param String2 Second string
+ * @param CaseInSensitive TRUE to compare the upper-case forms of the strings
+ * @return Zero if the strings are equal, a negative value if String1 sorts
+ *         first and a positive value if String2 sorts first
+ *
+ * At the first differing code unit the result is the difference of the two
+ * code units (upper-cased when CaseInSensitive is TRUE). If one string is a
+ * prefix of the other the result is the difference of the lengths in bytes.
+ */
+static __forceinline
+LONG
+RtlCompareUnicodeString(
+    _In_ PCUNICODE_STRING String1,
+    _In_ PCUNICODE_STRING String2,
+    _In_ BOOLEAN CaseInSensitive
+)
+{
+    SIZE_T const Count = (String1->Length < String2->Length ? String1->Length : String2->Length) / sizeof(WCHAR);
+    SIZE_T const Index = RtlpFindUnicodeMismatch(String1->Buffer, String2->Buffer, Count, CaseInSensitive);
+
+    if (Index < Count) {
+        WCHAR Char1 = String1->Buffer[Index];
+        WCHAR Char2 = String2->Buffer[Index];
+        if (CaseInSensitive) {
+            Char1 = RtlUpcaseUnicodeChar(Char1);
+            Char2 = RtlUpcaseUnicodeChar(Char2);
+        }
+        return (LONG)(USHORT)Char1 - (LONG)(USHORT)Char2;
+    }
+    return (LONG)String1->Length - (LONG)String2->Length;
+}
+
+/**
+ * @brief Tests two Unicode strings for equality
+ *
+ * @param String1 First string
+ * @param String2 Second string
+ * @param CaseInSensitive TRUE to ignore case
+ * @return TRUE if the strings have the same length and contents
+ */
+static __forceinline
+BOOLEAN
+RtlEqualUnicodeString(
+    _In_ PCUNICODE_STRING String1,
+    _In_ PCUNICODE_STRING String2,
+    _In_ BOOLEAN CaseInSensitive
+)
+{
+    SIZE_T const Count = String1->Length / sizeof(WCHAR);
+
+    if (String1->Length != String2->Length) {
+        return FALSE;
+    }
+    return RtlpFindUnicodeMismatch(String1->Buffer, String2->Buffer, Count, CaseInSensitive) == Count;
+}
+
+/**
+ * @brief Tests whether one Unicode string begins with another
+ *
+ * @param String1 The prefix
+ * @param String2 The string to examine
+ * @param CaseInSensitive TRUE to ignore case
+ * @return TRUE if String2 begins with String1
+ */
+static __forceinline
+BOOLEAN
+RtlPrefixUnicodeString(
+    _In_ PCUNICODE_STRING String1,
+    _In_ PCUNICODE_STRING String2,
+    _In_ BOOLEAN CaseInSensitive
+)
+{
+    SIZE_T const Count = String1->Length / sizeof(WCHAR);
+
+    if (String1->Length > String2->Length) {
+        return FALSE;
+    }
+    return RtlpFindUnicodeMismatch(String1->Buffer, String2->Buffer, Count, CaseInSensitive) == Count;
+}
+
+/**
+ * @brief Writes the upper- or lower-case form of Count code units
+ *
+ * @param Destination Receives the converted code units; may equal Source
+ * @param Source Code units to convert
+ * @param Count Number of code units
+ * @param Upcase TRUE to upper-case, FALSE to lower-case
+ *
+ * Vectors of pure ASCII are converted in registers. A vector holding any
+ * code unit above 0x7F is converted one code unit at a time from the case
+ * table, which is faster than patching individual lanes of a stored vector.
+ */
+static __forceinline
+VOID
+RtlpChangeCaseBuffer(
+    _Out_writes_(Count) PWSTR Destination,
+    _In_reads_(Count) PCWSTR Source,
+    _In_ SIZE_T Count,
+    _In_ BOOLEAN Upcase
+)
+{
+    SIZE_T Index = 0;
+
+#if defined(__AVX2__)
+    while (Count - Index >= 16) {
+        __m256i const Units = _mm256_loadu_si256((const __m256i*)(Source + Index));
+
+        if (RtlpNonAsciiMask256(Units) == 0) {
+            _mm256_storeu_si256((__m256i*)(Destination + Index),
+                                Upcase ? RtlpUpcaseAscii256(Units) : RtlpDowncaseAscii256(Units));
+        } else {
+            for (SIZE_T Unit = Index; Unit < Index + 16; Unit++) {
+                Destination[Unit] = Upcase ? RtlUpcaseUnicodeChar(Source[Unit]) : RtlDowncaseUnicodeChar(Source[Unit]);
+            }
+        }
+        Index += 16;
+    }
+#endif
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+    while (Count - Index >= 8) {
+        __m128i const Units = _mm_loadu_si128((const __m128i*)(Source + Index));
+
+        if (RtlpNonAsciiMask128(Units) == 0) {
+            _mm_storeu_si128((__m128i*)(Destination + Index),
+                             Upcase ? RtlpUpcaseAscii128(Units) : RtlpDowncaseAscii128(Units));
+        } else {
+            for (SIZE_T Unit = Index; Unit < Index + 8; Unit++) {
+                Destination[Unit] = Upcase ? RtlUpcaseUnicodeChar(Source[Unit]) : RtlDowncaseUnicodeChar(Source[Unit]);
+            }
+        }
+        Index += 8;
+    }
+#endif
+
+    for (; Index < Count; Index++) {
+        Destination[Index] = Upcase ? RtlUpcaseUnicodeChar(Source[Index]) : RtlDowncaseUnicodeChar(Source[Index]);
+    }
+}
+
+/* Shared body of RtlUpcaseUnicodeString and RtlDowncaseUnicodeString */
+static __forceinline
+NTSTATUS
+RtlpChangeCaseUnicodeString(
+    _Inout_ PUNICODE_STRING DestinationString,
+    _In_ PCUNICODE_STRING SourceString,
+    _In_ BOOLEAN AllocateDestinationString,
+    _In_ BOOLEAN Upcase
+)
+{
+    PCWSTR const Source = SourceString->Buffer;
+    USHORT const Length = SourceString->Length;
+
+    if (AllocateDestinationString) {
+        PWSTR Buffer = NULL;
+        if (Length != 0) {
+            Buffer = (PWSTR)ExAllocatePoolTracked(PagedPool, Length);
+            if (Buffer == NULL) {
+                return STATUS_NO_MEMORY;
+            }
+        }
+        DestinationString->Buffer = Buffer;
+        DestinationString->MaximumLength = Length;
+    } else if (DestinationString->MaximumLength < Length) {
+        return STATUS_BUFFER_OVERFLOW;
+    }
+
+    RtlpChangeCaseBuffer(DestinationString->Buffer, Source, Length / sizeof(WCHAR), Upcase);
+    DestinationString->Length = Length;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Converts a Unicode string to upper case
+ *
+ * @param DestinationString Receives the converted string. May be the same as
+ *        SourceString, or share its buffer, to convert in place
+ * @param SourceString String to convert
+ * @param AllocateDestinationString TRUE to allocate the destination buffer
+ *        from the pool; the caller frees it with FreeUnicodeString
+ * @return STATUS_SUCCESS, STATUS_NO_MEMORY if the allocation fails, or
+ *         STATUS_BUFFER_OVERFLOW if the caller's buffer is too small
+ */
+static __forceinline
+NTSTATUS
+RtlUpcaseUnicodeString(
+    _Inout_ PUNICODE_STRING DestinationString,
+    _In_ PCUNICODE_STRING SourceString,
+    _In_ BOOLEAN AllocateDestinationString
+)
+{
+    return RtlpChangeCaseUnicodeString(DestinationString, SourceString, AllocateDestinationString, TRUE);
+}
+
+/**
+ * @brief Converts a Unicode string to lower case
+ *
+ * @param DestinationString Receives the converted string. May be the same as
+ *        SourceString, or share its buffer, to convert in place
+ * @param SourceString String to convert
+ * @param AllocateDestinationString TRUE to allocate the destination buffer
+ *        from the pool; the caller frees it with FreeUnicodeString
+ * @return STATUS_SUCCESS, STATUS_NO_MEMORY if the allocation fails, or
+ *         STATUS_BUFFER_OVERFLOW if the caller's buffer is too small
+ */
+static __forceinline
+NTSTATUS
+RtlDowncaseUnicodeString(
+    _Inout_ PUNICODE_STRING DestinationString,
+    _In_ PCUNICODE_STRING SourceString,
+    _In_ BOOLEAN AllocateDestinationString
+)
+{
+    return RtlpChangeCaseUnicodeString(DestinationString, SourceString, AllocateDestinationString, FALSE);
+}
+
+/* Powers of 65599 modulo 2^32, used to recombine the X65599 vector lanes */
+static const ULONG RtlpX65599Powers[17] = {
+    0x00000001, 0x0001003f, 0x007e0f81, 0x2e86d0bf, 0x43ec5f01, 0x162c613f, 0xd62aee81, 0xa311b1bf,
+    0xd319be01, 0xb156c23f, 0x6698cd81, 0x0d1b92bf, 0xcc881d01, 0x7280233f, 0x50c7ac81, 0x8da473bf,
+    0x4f377c01
+};
+
+/*
+ * Keys of the fast hash: the first splitmix64 outputs for seed 0. Stripe N of
+ * a block is keyed with entries N..N+3, entry 19 keys the scramble and
+ * entries 20..23 seed the accumulators.
+ */
+static const ULONG64 RtlpHashSecret[24] = {
+    0xe220a8397b1dcdafULL, 0x6e789e6aa1b965f4ULL, 0x06c45d188009454fULL,
+    0xf88bb8a8724c81ecULL, 0x1b39896a51a8749bULL, 0x53cb9f0c747ea2eaULL,
+    0x2c829abe1f4532e1ULL, 0xc584133ac916ab3cULL, 0x3ee5789041c98ac3ULL,
+    0xf3b8488c368cb0a6ULL, 0x657eecdd3cb13d09ULL, 0xc2d326e0055bdef6ULL,
+    0x8621a03fe0bbdb7bULL, 0x8e1f7555983aa92fULL, 0xb54e0f1600cc4d19ULL,
+    0x84bb3f97971d80abULL, 0x7d29825c75521255ULL, 0xc3cf17102b7f7f86ULL,
+    0x3466e9a083914f64ULL, 0xd81a8d2b5a4485acULL, 0xdb01602b100b9ed7ULL,
+    0xa9038a921825f10dULL, 0xedf5f1d90dca2f6aULL, 0x54496ad67bd2634cULL
+};
+
+/* Code units per stripe of the fast hash, and stripes between scrambles */
+#define RTLP_HASH_STRIPE_UNITS      16
+#define RTLP_HASH_STRIPES_PER_BLOCK 16
+#define RTLP_HASH_SCRAMBLE_PRIME    0x9E3779B1u
+
+#if defined(__AVX2__)
+/* Loads 16 code units, upper-cased when CaseInSensitive is TRUE */
+static __forceinline
+__m256i
+RtlpLoadUnicode256(
+    _In_reads_(16) PCWSTR Source,
+    _In_ BOOLEAN CaseInSensitive
+)
+{
+    __m256i Units = _mm256_loadu_si256((const __m256i*)Source);
+
+    if (CaseInSensitive) {
+        if (RtlpNonAsciiMask256(Units) == 0) {
+            Units = RtlpUpcaseAscii256(Units);
+        } else {
+            WCHAR Folded[16];
+            for (ULONG Unit = 0; Unit < 16; Unit++) {
+                Folded[Unit] = RtlUpcaseUnicodeChar(Source[Unit]);
+            }
+            Units = _mm256_loadu_si256((const __m256i*)Folded);
+        }
+    }
+    return Units;
+}
+#endif
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+/* Loads 8 code units, upper-cased when CaseInSensitive is TRUE */
+static __forceinline
+__m128i
+RtlpLoadUnicode128(
+    _In_reads_(8) PCWSTR Source,
+    _In_ BOOLEAN CaseInSensitive
+)
+{
+    __m128i Units = _mm_loadu_si128((const __m128i*)Source);
+
+    if (CaseInSensitive) {
+        if (RtlpNonAsciiMask128(Units) == 0) {
+            Units = RtlpUpcaseAscii128(Units);
+        } else {
+            WCHAR Folded[8];
+            for (ULONG Unit = 0; Unit < 8; Unit++) {
+                Folded[Unit] = RtlUpcaseUnicodeChar(Source[Unit]);
+            }
+            Units = _mm_loadu_si128((const __m128i*)Folded);
+        }
+    }
+    return Units;
+}
+
+/* 32-bit lane-wise multiply (SSE4.1 pmulld) built from SSE2 pmuludq */
+static __forceinline
+__m128i
+RtlpMultiplyLow32(
+    _In_ __m128i Left,
+    _In_ __m128i Right
+)
+{
+    __m128i const Even = _mm_mul_epu32(Left, Right);
+    __m128i const Odd = _mm_mul_epu32(_mm_srli_epi64(Left, 32), _mm_srli_epi64(Right, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(Odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/* 64-bit lane-wise multiply by a 32-bit constant */
+static __forceinline
+__m128i
+RtlpMultiply64By32(
+    _In_ __m128i Value,
+    _In_ __m128i Multiplier
+)
+{
+    __m128i const Low = _mm_mul_epu32(Value, Multiplier);
+    __m128i const High = _mm_mul_epu32(_mm_srli_epi64(Value, 32), Multiplier);
+    return _mm_add_epi64(Low, _mm_slli_epi64(High, 32));
+}
+#endif
+
+/**
+ * @brief Computes the X65599 hash of a run of code units
+ *
+ * @param Buffer Code units to hash
+ * @param Count Number of code units
+ * @param CaseInSensitive Hash the upper-case forms of the code units
+ * @return Sum of Buffer[i] * 65599^(Count - 1 - i), modulo 2^32
+ *
+ * The Horner recurrence Hash = Hash * 65599 + Char is split across vector
+ * lanes: lane j accumulates every W-th code unit with multiplier 65599^W,
+ * and the lanes are recombined with 65599^(W - 1 - j) before the remainder
+ * continues the scalar recurrence. The result is bit-identical to the
+ * scalar form.
+ */
+static __forceinline
+ULONG
+RtlpHashUnicodeX65599(
+    _In_reads_(Count) PCWSTR Buffer,
+    _In_ SIZE_T Count,
+    _In_ BOOLEAN CaseInSensitive
+)
+{
+    ULONG Hash = 0;
+    SIZE_T Index = 0;
+
+#if defined(__AVX2__)
+    if (Count >= 16) {
+        __m256i const Multiplier = _mm256_set1_epi32((int)RtlpX65599Powers[16]);
+        __m256i Low = _mm256_setzero_si256();
+        __m256i High = _mm256_setzero_si256();
+        ULONG Lanes[16];
+
+        for (; Count - Index >= 16; Index += 16) {
+            __m256i const Units = RtlpLoadUnicode256(Buffer + Index, CaseInSensitive);
+            Low = _mm256_add_epi32(_mm256_mullo_epi32(Low, Multiplier),
+                                   _mm256_cvtepu16_epi32(_mm256_castsi256_si128(Units)));
+            High = _mm256_add_epi32(_mm256_mullo_epi32(High, Multiplier),
+                                    _mm256_cvtepu16_epi32(_mm256_extracti128_si256(Units, 1)));
+        }
+        _mm256_storeu_si256((__m256i*)Lanes, Low);
+        _mm256_storeu_si256((__m256i*)(Lanes + 8), High);
+        for (ULONG Lane = 0; Lane < 16; Lane++) {
+            Hash += Lanes[Lane] * RtlpX65599Powers[15 - Lane];
+        }
+    }
+#elif defined(RTLP_UNICODE_STRING_SSE2)
+    if (Count >= 8) {
+        __m128i const Multiplier = _mm_set1_epi32((int)RtlpX65599Powers[8]);
+        __m128i const Zero = _mm_setzero_si128();
+        __m128i Low = Zero;
+        __m128i High = Zero;
+        ULONG Lanes[8];
+
+        for (; Count - Index >= 8; Index += 8) {
+            __m128i const Units = RtlpLoadUnicode128(Buffer + Index, CaseInSensitive);
+            Low = _mm_add_epi32(RtlpMultiplyLow32(Low, Multiplier), _mm_unpacklo_epi16(Units, Zero));
+            High = _mm_add_epi32(RtlpMultiplyLow32(High, Multiplier), _mm_unpackhi_epi16(Units, Zero));
+        }
+        _mm_storeu_si128((__m128i*)Lanes, Low);
+        _mm_storeu_si128((__m128i*)(Lanes + 4), High);
+        for (ULONG Lane = 0; Lane < 8; Lane++) {
+            Hash += Lanes[Lane] * RtlpX65599Powers[7 - Lane];
+        }
+    }
+#endif
+
+    for (; Index < Count; Index++) {
+        WCHAR const Char = CaseInSensitive ? RtlUpcaseUnicodeChar(Buffer[Index]) : Buffer[Index];
+        Hash = Hash * 65599 + (USHORT)Char;
+    }
+    return Hash;
+}
+
+/* Final avalanche of the fast hash (the MurmurHash3 64-bit finalizer) */
+static __forceinline
+ULONG64
+RtlpHashMix64(
+    _In_ ULONG64 Value
+)
+{
+    Value ^= Value >> 33;
+    Value *= 0xff51afd7ed558ccdULL;
+    Value ^= Value >> 33;
+    Value *= 0xc4ceb9fe1a85ec53ULL;
+    Value ^= Value >> 33;
+    return Value;
+}
+
+/**
+ * @brief Computes the fast hash of a run of code units
+ *
+ * @param Buffer Code units to hash
+ * @param Count Number of code units
+ * @param CaseInSensitive Hash the upper-case forms of the code units
+ * @return 32-bit hash
+ *
+ * Follows the XXH3 long-input design. Four 64-bit accumulators absorb the
+ * input 32 bytes (one stripe) at a time: each data word is XORed with a
+ * sliding key, its two halves are multiplied together and added to its
+ * accumulator, and the raw word is added to the neighbouring one. Every 16
+ * stripes the accumulators are scrambled. A short final stripe is padded
+ * with zeros; the length goes into the final mix so padding cannot collide.
+ * The AVX2, SSE2 and portable paths produce identical values.
+ */
+static __forceinline
+ULONG
+RtlpHashUnicodeFast(
+    _In_reads_(Count) PCWSTR Buffer,
+    _In_ SIZE_T Count,
+    _In_ BOOLEAN CaseInSensitive
+)
+{
+    WCHAR Tail[RTLP_HASH_STRIPE_UNITS];
+    ULONG64 Lanes[4];
+    PCWSTR Stripe = Buffer;
+    SIZE_T Remaining = Count;
+    ULONG StripeIndex = 0;
+    ULONG64 Hash;
+
+#if defined(__AVX2__)
+    __m256i Acc = _mm256_loadu_si256((const __m256i*)(RtlpHashSecret + 20));
+    __m256i const ScrambleKey = _mm256_set1_epi64x((LONG64)RtlpHashSecret[19]);
+    __m256i const Prime = _mm256_set1_epi32((int)RTLP_HASH_SCRAMBLE_PRIME);
+#elif defined(RTLP_UNICODE_STRING_SSE2)
+    __m128i Acc0 = _mm_loadu_si128((const __m128i*)(RtlpHashSecret + 20));
+    __m128i Acc1 = _mm_loadu_si128((const __m128i*)(RtlpHashSecret + 22));
+    __m128i const ScrambleKey = _mm_set1_epi64x((LONG64)RtlpHashSecret[19]);
+    __m128i const Prime = _mm_set1_epi32((int)RTLP_HASH_SCRAMBLE_PRIME);
+#else
+    RtlCopyMemory(Lanes, RtlpHashSecret + 20, sizeof(Lanes));
+#endif
+
+    while (Remaining != 0) {
+        if (Remaining < RTLP_HASH_STRIPE_UNITS) {
+            RtlZeroMemory(Tail, sizeof(Tail));
+            RtlCopyMemory(Tail, Stripe, Remaining * sizeof(WCHAR));
+            Stripe = Tail;
+            Remaining = RTLP_HASH_STRIPE_UNITS;
+        }
+
+#if defined(__AVX2__)
+        {
+            __m256i const Data = RtlpLoadUnicode256(Stripe, CaseInSensitive);
+            __m256i const Keyed = _mm256_xor_si256(
+                Data, _mm256_loadu_si256((const __m256i*)(RtlpHashSecret + StripeIndex)));
+            __m256i const Product = _mm256_mul_epu32(Keyed, _mm256_srli_epi64(Keyed, 32));
+            Acc = _mm256_add_epi64(Acc, _mm256_add_epi64(Product, _mm256_shuffle_epi32(Data, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+        if (++StripeIndex == RTLP_HASH_STRIPES_PER_BLOCK) {
+            Acc = _mm256_xor_si256(_mm256_xor_si256(Acc, _mm256_srli_epi64(Acc, 47)), ScrambleKey);
+            Acc = _mm256_add_epi64(_mm256_mul_epu32(Acc, Prime),
+                                   _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(Acc, 32), Prime), 32));
+            StripeIndex = 0;
+        }
+#elif defined(RTLP_UNICODE_STRING_SSE2)
+        {
+            __m128i const Data0 = RtlpLoadUnicode128(Stripe, CaseInSensitive);
+            __m128i const Data1 = RtlpLoadUnicode128(Stripe + 8, CaseInSensitive);
+            __m128i const Keyed0 = _mm_xor_si128(Data0, _mm_loadu_si128((const __m128i*)(RtlpHashSecret + StripeIndex)));
+            __m128i const Keyed1 = _mm_xor_si128(Data1, _mm_loadu_si128((const __m128i*)(RtlpHashSecret + StripeIndex + 2)));
+            Acc0 = _mm_add_epi64(Acc0, _mm_add_epi64(_mm_mul_epu32(Keyed0, _mm_srli_epi64(Keyed0, 32)),
+                                                     _mm_shuffle_epi32(Data0, _MM_SHUFFLE(1, 0, 3, 2))));
+            Acc1 = _mm_add_epi64(Acc1, _mm_add_epi64(_mm_mul_epu32(Keyed1, _mm_srli_epi64(Keyed1, 32)),
+                                                     _mm_shuffle_epi32(Data1, _MM_SHUFFLE(1, 0, 3, 2))));
+        }
+        if (++StripeIndex == RTLP_HASH_STRIPES_PER_BLOCK) {
+            Acc0 = RtlpMultiply64By32(_mm_xor_si128(_mm_xor_si128(Acc0, _mm_srli_epi64(Acc0, 47)), ScrambleKey), Prime);
+            Acc1 = RtlpMultiply64By32(_mm_xor_si128(_mm_xor_si128(Acc1, _mm_srli_epi64(Acc1, 47)), ScrambleKey), Prime);
+            StripeIndex = 0;
+        }
+#else
+        {
+            WCHAR Folded[RTLP_HASH_STRIPE_UNITS];
+            ULONG64 Data[4];
+            for (ULONG Unit = 0; Unit < RTLP_HASH_STRIPE_UNITS; Unit++) {
+                Folded[Unit] = CaseInSensitive ? RtlUpcaseUnicodeChar(Stripe[Unit]) : Stripe[Unit];
+            }
+            RtlCopyMemory(Data, Folded, sizeof(Data));
+            for (ULONG Lane = 0; Lane < 4; Lane++) {
+                ULONG64 const Keyed = Data[Lane] ^ RtlpHashSecret[StripeIndex + Lane];
+                Lanes[Lane] += (ULONG64)(ULONG)Keyed * (Keyed >> 32) + Data[Lane ^ 1];
+            }
+        }
+        if (++StripeIndex == RTLP_HASH_STRIPES_PER_BLOCK) {
+            for (ULONG Lane = 0; Lane < 4; Lane++) {
+                Lanes[Lane] = (Lanes[Lane] ^ (Lanes[Lane] >> 47) ^ RtlpHashSecret[19]) * RTLP_HASH_SCRAMBLE_PRIME;
+            }
+            StripeIndex = 0;
+        }
+#endif
+
+        Stripe += RTLP_HASH_STRIPE_UNITS;
+        Remaining -= RTLP_HASH_STRIPE_UNITS;
+    }
+
+#if defined(__AVX2__)
+    _mm256_storeu_si256((__m256i*)Lanes, Acc);
+#elif defined(RTLP_UNICODE_STRING_SSE2)
+    _mm_storeu_si128((__m128i*)Lanes, Acc0);
+    _mm_storeu_si128((__m128i*)(Lanes + 2), Acc1);
+#endif
+
+    // Two independent finalizers keep the latency of short strings down
+    Hash = RtlpHashMix64(Lanes[0] ^ ((Lanes[1] << 32) | (Lanes[1] >> 32)) ^ ((ULONG64)Count * 0x9E3779B97F4A7C15ULL)) ^
+           RtlpHashMix64(Lanes[2] ^ ((Lanes[3] << 32) | (Lanes[3] >> 32)) ^ RtlpHashSecret[19]);
+    return (ULONG)(Hash ^ (Hash >> 32));
+}
+
+/**
+ * @brief Computes a hash value for a Unicode string
+ *
+ * @param String String to hash
+ * @param CaseInSensitive TRUE to hash the upper-case form of the string, so
+ *        that strings differing only in case hash alike
+ * @param HashAlgorithm HASH_STRING_ALGORITHM_X65599 (or _DEFAULT) for the
+ *        value Windows computes, or HASH_STRING_ALGORITHM_FAST
+ * @param HashValue Receives the hash
+ * @return STATUS_SUCCESS, or STATUS_INVALID_PARAMETER for a NULL argument or
+ *         an unknown algorithm
+ *
+ * Case is folded while hashing; nothing is allocated. X65599 values are
+ * stable and match Windows. FAST values are only meaningful within one
+ * build of this library and must not be persisted.
+ */
+static __forceinline
+NTSTATUS
+RtlHashUnicodeString(
+    _In_ PCUNICODE_STRING String,
+    _In_ BOOLEAN CaseInSensitive,
+    _In_ ULONG HashAlgorithm,
+    _Out_ PULONG HashValue
+)
+{
+    if (String == NULL || HashValue == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    switch (HashAlgorithm) {
+    case HASH_STRING_ALGORITHM_DEFAULT:
+    case HASH_STRING_ALGORITHM_X65599:
+        *HashValue = RtlpHashUnicodeX65599(String->Buffer, String->Length / sizeof(WCHAR), CaseInSensitive);
+        return STATUS_SUCCESS;
+
+    case HASH_STRING_ALGORITHM_FAST:
+        *HashValue = RtlpHashUnicodeFast(String->Buffer, String->Length / sizeof(WCHAR), CaseInSensitive);
+        return STATUS_SUCCESS;
+
+    default:
+        return STATUS_INVALID_PARAMETER;
+    }
+}
+
+/* Replaces each ill-formed sequence and unpaired surrogate when converting */
+#define RTLP_REPLACEMENT_CHARACTER 0xFFFD
+#define RTLP_INVALID_CODE_POINT    0xFFFFFFFF
+
+/**
+ * @brief Decodes one UTF-8 sequence
+ *
+ * @param Source Bytes to decode
+ * @param Remaining Number of bytes available at Source, at least 1
+ * @param CodePoint Receives the scalar value, or RTLP_INVALID_CODE_POINT
+ * @return Number of bytes consumed
+ *
+ * Only the well-formed sequences of the Unicode standard (table 3-7) are
+ * accepted: overlong forms, encoded surrogates and values above U+10FFFF are
+ * rejected. An ill-formed sequence consumes its maximal valid prefix, or one
+ * byte, so each such subpart is replaced by exactly one U+FFFD.
+ */
+static __forceinline
+ULONG
+RtlpDecodeUTF8(
+    _In_reads_(Remaining) const UCHAR* Source,
+    _In_ SIZE_T Remaining,
+    _Out_ PULONG CodePoint
+)
+{
+    UCHAR const Lead = Source[0];
+    UCHAR Low = 0x80;
+    UCHAR High = 0xBF;
+    ULONG Length;
+    ULONG Value;
+
+    *CodePoint = RTLP_INVALID_CODE_POINT;
+    if (Lead < 0x80) {
+        *CodePoint = Lead;
+        return 1;
+    }
+    if (Lead < 0xC2) {
+        return 1;
+    } else if (Lead < 0xE0) {
+        Length = 2;
+        Value = Lead & 0x1F;
+    } else if (Lead < 0xF0) {
+        Length = 3;
+        Value = Lead & 0x0F;
+        Low = Lead == 0xE0 ? 0xA0 : 0x80;
+        High = Lead == 0xED ? 0x9F : 0xBF;
+    } else if (Lead < 0xF5) {
+        Length = 4;
+        Value = Lead & 0x07;
+        Low = Lead == 0xF0 ? 0x90 : 0x80;
+        High = Lead == 0xF4 ? 0x8F : 0xBF;
+    } else {
+        return 1;
+    }
+
+    for (ULONG Index = 1; Index < Length; Index++) {
+        if (Index == Remaining || Source[Index] < Low || Source[Index] > High) {
+            return Index;
+        }
+        Value = (Value << 6) | (Source[Index] & 0x3F);
+        Low = 0x80;
+        High = 0xBF;
+    }
+    *CodePoint = Value;
+    return Length;
+}
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+/*
+ * Two-byte sequences cover U+0080 to U+07FF (Latin supplements, Greek,
+ * Cyrillic, Hebrew, Arabic). Seen as 16-bit little-endian lanes, a sequence
+ * is its lead byte in the low half and its continuation byte in the high half.
+ */
+
+/* Counts the well-formed two-byte sequences at the start of 16 bytes */
+static __forceinline
+ULONG
+RtlpUTF8TwoBytePrefix128(
+    _In_ __m128i Bytes
+)
+{
+    __m128i const Shape = _mm_cmpeq_epi16(_mm_and_si128(Bytes, _mm_set1_epi16((short)0xC0E0)),
+                                          _mm_set1_epi16((short)0x80C0));
+    // C0 and C1 leads would be overlong encodings of ASCII
+    __m128i const Overlong = _mm_cmpeq_epi16(_mm_and_si128(Bytes, _mm_set1_epi16(0x1E)), _mm_setzero_si128());
+
+    ULONG const Valid = (ULONG)_mm_movemask_epi8(_mm_andnot_si128(Overlong, Shape));
+    unsigned long Invalid;
+
+    if (Valid == 0xFFFF) {
+        return 8;
+    }
+    _BitScanForward(&Invalid, ~Valid);
+    return Invalid / 2;
+}
+
+/* Decodes eight two-byte sequences into eight code units; lanes past a
+   malformed sequence hold garbage */
+static __forceinline
+__m128i
+RtlpDecodeUTF8TwoByte128(
+    _In_ __m128i Bytes
+)
+{
+    return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(Bytes, _mm_set1_epi16(0x1F)), 6),
+                        _mm_and_si128(_mm_srli_epi16(Bytes, 8), _mm_set1_epi16(0x3F)));
+}
+
+/* Counts the code units in U+0080 to U+07FF at the start of eight */
+static __forceinline
+ULONG
+RtlpUnicodeTwoBytePrefix128(
+    _In_ __m128i Units
+)
+{
+    __m128i const Zero = _mm_setzero_si128();
+    __m128i const Below800 = _mm_cmpeq_epi16(_mm_and_si128(Units, _mm_set1_epi16((short)0xF800)), Zero);
+    __m128i const Ascii = _mm_cmpeq_epi16(_mm_and_si128(Units, _mm_set1_epi16((short)0xFF80)), Zero);
+
+    ULONG const Valid = (ULONG)_mm_movemask_epi8(_mm_andnot_si128(Ascii, Below800));
+    unsigned long Invalid;
+
+    if (Valid == 0xFFFF) {
+        return 8;
+    }
+    _BitScanForward(&Invalid, ~Valid);
+    return Invalid / 2;
+}
+
+/* Encodes eight code units in U+0080 to U+07FF as 16 bytes of UTF-8 */
+static __forceinline
+__m128i
+RtlpEncodeUTF8TwoByte128(
+    _In_ __m128i Units
+)
+{
+    return _mm_or_si128(_mm_or_si128(_mm_set1_epi16((short)0x80C0), _mm_srli_epi16(Units, 6)),
+                        _mm_slli_epi16(_mm_and_si128(Units, _mm_set1_epi16(0x3F)), 8));
+}
+#endif
+
+/**
+ * @brief Converts UTF-8 to UTF-16, or measures the result
+ *
+ * @param Destination Receives the code units, or NULL to only count them
+ * @param Capacity Room at Destination in code units
+ * @param Source UTF-8 bytes
+ * @param Count Number of bytes at Source
+ * @param Written Receives the number of code units produced
+ * @return STATUS_SUCCESS, STATUS_SOME_NOT_MAPPED if ill-formed input was
+ *         replaced, or STATUS_BUFFER_TOO_SMALL once the next character does
+ *         not fit; characters are never split
+ *
+ * ASCII is widened 16 bytes at a time (32 with AVX2). A vector with a
+ * non-ASCII byte still stores its widened ASCII prefix, and a run of up to
+ * eight two-byte sequences is decoded in registers the same way. Anything
+ * else is decoded one sequence at a time for the rest of that vector before
+ * the next attempt.
+ */
+static __forceinline
+NTSTATUS
+RtlpUTF8ToUnicode(
+    _Out_writes_opt_(Capacity) PWSTR Destination,
+    _In_ SIZE_T Capacity,
+    _In_reads_(Count) const UCHAR* Source,
+    _In_ SIZE_T Count,
+    _Out_ PSIZE_T Written
+)
+{
+    SIZE_T Index = 0;
+    SIZE_T Output = 0;
+    BOOLEAN Replaced = FALSE;
+
+    while (Index < Count) {
+        SIZE_T WindowEnd = Index + 1;
+
+#if defined(__AVX2__)
+        if (Count - Index >= 32 && Capacity - Output >= 32) {
+            __m256i const Bytes = _mm256_loadu_si256((const __m256i*)(Source + Index));
+
+            if (_mm256_movemask_epi8(Bytes) == 0) {
+                if (Destination != NULL) {
+                    _mm256_storeu_si256((__m256i*)(Destination + Output),
+                                        _mm256_cvtepu8_epi16(_mm256_castsi256_si128(Bytes)));
+                    _mm256_storeu_si256((__m256i*)(Destination + Output + 16),
+                                        _mm256_cvtepu8_epi16(_mm256_extracti128_si256(Bytes, 1)));
+                }
+                Index += 32;
+                Output += 32;
+                continue;
+            }
+        }
+#endif
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+        if (Count - Index >= 16 && Capacity - Output >= 16) {
+            __m128i const Bytes = _mm_loadu_si128((const __m128i*)(Source + Index));
+            ULONG const NonAscii = (ULONG)_mm_movemask_epi8(Bytes);
+            unsigned long Ascii;
+            ULONG Pairs;
+
+            if ((NonAscii & 1) == 0) {
+                if (Destination != NULL) {
+                    _mm_storeu_si128((__m128i*)(Destination + Output), _mm_unpacklo_epi8(Bytes, _mm_setzero_si128()));
+                    _mm_storeu_si128((__m128i*)(Destination + Output + 8), _mm_unpackhi_epi8(Bytes, _mm_setzero_si128()));
+                }
+                if (NonAscii == 0) {
+                    Index += 16;
+                    Output += 16;
+                    continue;
+                }
+                // Keep only the code units before the first non-ASCII byte
+                _BitScanForward(&Ascii, NonAscii);
+                Index += Ascii;
+                Output += Ascii;
+                continue;
+            }
+            // Stores all eight lanes but keeps only the leading well-formed run
+            Pairs = RtlpUTF8TwoBytePrefix128(Bytes);
+            if (Pairs != 0) {
+                if (Destination != NULL) {
+                    _mm_storeu_si128((__m128i*)(Destination + Output), RtlpDecodeUTF8TwoByte128(Bytes));
+                }
+                Index += Pairs * 2;
+                Output += Pairs;
+                continue;
+            }
+            WindowEnd = Index + 16;
+        }
+#endif
+
+        while (Index < WindowEnd && Index < Count) {
+            ULONG CodePoint;
+            ULONG const Consumed = RtlpDecodeUTF8(Source + Index, Count - Index, &CodePoint);
+
+            if (CodePoint == RTLP_INVALID_CODE_POINT) {
+                CodePoint = RTLP_REPLACEMENT_CHARACTER;
+                Replaced = TRUE;
+            }
+            if (CodePoint < 0x10000) {
+                if (Output == Capacity) {
+                    *Written = Output;
+                    return STATUS_BUFFER_TOO_SMALL;
+                }
+                if (Destination != NULL) {
+                    Destination[Output] = (WCHAR)CodePoint;
+                }
+                Output += 1;
+            } else {
+                if (Capacity - Output < 2) {
+                    *Written = Output;
+                    return STATUS_BUFFER_TOO_SMALL;
+                }
+                if (Destination != NULL) {
+                    Destination[Output] = (WCHAR)(0xD800 + ((CodePoint - 0x10000) >> 10));
+                    Destination[Output + 1] = (WCHAR)(0xDC00 + (CodePoint & 0x3FF));
+                }
+                Output += 2;
+            }
+            Index += Consumed;
+        }
+    }
+
+    *Written = Output;
+    return Replaced ? STATUS_SOME_NOT_MAPPED : STATUS_SUCCESS;
+}
+
+/**
+ * @brief Converts UTF-16 to UTF-8, or measures the result
+ *
+ * @param Destination Receives the bytes, or NULL to only count them
+ * @param Capacity Room at Destination in bytes
+ * @param Source UTF-16 code units
+ * @param Count Number of code units at Source
+ * @param Written Receives the number of bytes produced
+ * @return STATUS_SUCCESS, STATUS_SOME_NOT_MAPPED if an unpaired surrogate
+ *         was replaced, or STATUS_BUFFER_TOO_SMALL once the next character
+ *         does not fit; characters are never split
+ *
+ * The mirror image of RtlpUTF8ToUnicode: ASCII is narrowed 16 code units at a
+ * time (32 with AVX2) and runs of U+0080 to U+07FF are encoded in registers.
+ */
+static __forceinline
+NTSTATUS
+RtlpUnicodeToUTF8(
+    _Out_writes_opt_(Capacity) PUCHAR Destination,
+    _In_ SIZE_T Capacity,
+    _In_reads_(Count) PCWSTR Source,
+    _In_ SIZE_T Count,
+    _Out_ PSIZE_T Written
+)
+{
+    SIZE_T Index = 0;
+    SIZE_T Output = 0;
+    BOOLEAN Replaced = FALSE;
+
+    while (Index < Count) {
+        SIZE_T WindowEnd = Index + 1;
+
+#if defined(__AVX2__)
+        if (Count - Index >= 32 && Capacity - Output >= 32) {
+            __m256i const Units1 = _mm256_loadu_si256((const __m256i*)(Source + Index));
+            __m256i const Units2 = _mm256_loadu_si256((const __m256i*)(Source + Index + 16));
+
+            if (_mm256_testz_si256(_mm256_or_si256(Units1, Units2), _mm256_set1_epi16((short)0xFF80))) {
+                if (Destination != NULL) {
+                    // packus works within 128-bit halves; restore the order of the quadwords
+                    _mm256_storeu_si256((__m256i*)(Destination + Output),
+                                        _mm256_permute4x64_epi64(_mm256_packus_epi16(Units1, Units2), 0xD8));
+                }
+                Index += 32;
+                Output += 32;
+                continue;
+            }
+        }
+#endif
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+        if (Count - Index >= 16 && Capacity - Output >= 16) {
+            __m128i const Units1 = _mm_loadu_si128((const __m128i*)(Source + Index));
+            __m128i const Units2 = _mm_loadu_si128((const __m128i*)(Source + Index + 8));
+            __m128i const Mask = _mm_set1_epi16((short)0xFF80);
+            // One bit per code unit, set for ASCII
+            ULONG const IsAscii = (ULONG)_mm_movemask_epi8(_mm_packs_epi16(
+                _mm_cmpeq_epi16(_mm_and_si128(Units1, Mask), _mm_setzero_si128()),
+                _mm_cmpeq_epi16(_mm_and_si128(Units2, Mask), _mm_setzero_si128())));
+            unsigned long Ascii;
+            ULONG Pairs;
+
+            if ((IsAscii & 1) != 0) {
+                if (Destination != NULL) {
+                    _mm_storeu_si128((__m128i*)(Destination + Output), _mm_packus_epi16(Units1, Units2));
+                }
+                if (IsAscii == 0xFFFF) {
+                    Index += 16;
+                    Output += 16;
+                    continue;
+                }
+                // Keep only the bytes before the first non-ASCII code unit
+                _BitScanForward(&Ascii, ~IsAscii);
+                Index += Ascii;
+                Output += Ascii;
+                continue;
+            }
+            Pairs = RtlpUnicodeTwoBytePrefix128(Units1);
+            if (Pairs != 0) {
+                if (Destination != NULL) {
+                    _mm_storeu_si128((__m128i*)(Destination + Output), RtlpEncodeUTF8TwoByte128(Units1));
+                }
+                Index += Pairs;
+                Output += Pairs * 2;
+                continue;
+            }
+            WindowEnd = Index + 8;
+        }
+#endif
+
+        while (Index < WindowEnd && Index < Count) {
+            ULONG CodePoint = (USHORT)Source[Index];
+            ULONG Consumed = 1;
+            ULONG Length;
+
+            if (CodePoint - 0xD800 < 0x800) {
+                if (CodePoint < 0xDC00 && Index + 1 < Count && (ULONG)(USHORT)Source[Index + 1] - 0xDC00 < 0x400) {
+                    CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + ((USHORT)Source[Index + 1] - 0xDC00);
+                    Consumed = 2;
+                } else {
+                    CodePoint = RTLP_REPLACEMENT_CHARACTER;
+                    Replaced = TRUE;
+                }
+            }
+            Length = CodePoint < 0x80 ? 1 : CodePoint < 0x800 ? 2 : CodePoint < 0x10000 ? 3 : 4;
+            if (Capacity - Output < Length) {
+                *Written = Output;
+                return STATUS_BUFFER_TOO_SMALL;
+            }
+
+            if (Destination != NULL) {
+                PUCHAR const Bytes = Destination + Output;
+                switch (Length) {
+                case 1:
+                    Bytes[0] = (UCHAR)CodePoint;
+                    break;
+                case 2:
+                    Bytes[0] = (UCHAR)(0xC0 | (CodePoint >> 6));
+                    Bytes[1] = (UCHAR)(0x80 | (CodePoint & 0x3F));
+                    break;
+                case 3:
+                    Bytes[0] = (UCHAR)(0xE0 | (CodePoint >> 12));
+                    Bytes[1] = (UCHAR)(0x80 | ((CodePoint >> 6) & 0x3F));
+                    Bytes[2] = (UCHAR)(0x80 | (CodePoint & 0x3F));
+                    break;
+                default:
+                    Bytes[0] = (UCHAR)(0xF0 | (CodePoint >> 18));
+                    Bytes[1] = (UCHAR)(0x80 | ((CodePoint >> 12) & 0x3F));
+                    Bytes[2] = (UCHAR)(0x80 | ((CodePoint >> 6) & 0x3F));
+                    Bytes[3] = (UCHAR)(0x80 | (CodePoint & 0x3F));
+                    break;
+                }
+            }
+            Output += Length;
+            Index += Consumed;
+        }
+    }
+
+    *Written = Output;
+    return Replaced ? STATUS_SOME_NOT_MAPPED : STATUS_SUCCESS;
+}
+
+/**
+ * @brief Converts a UTF-8 string to UTF-16
+ *
+ * @param UnicodeStringDestination Receives the UTF-16 text, or NULL to query
+ *        the size of the result
+ * @param UnicodeStringMaxByteCount Size of UnicodeStringDestination in bytes
+ * @param UnicodeStringActualByteCount Receives the number of bytes written,
+ *        or the number required when UnicodeStringDestination is NULL
+ * @param UTF8StringSource UTF-8 text, which need not be null-terminated
+ * @param UTF8StringByteCount Number of bytes at UTF8StringSource
+ * @return STATUS_SUCCESS; STATUS_SOME_NOT_MAPPED (a success code) if
+ *         ill-formed input was replaced by U+FFFD; STATUS_BUFFER_TOO_SMALL if
+ *         the destination filled up, in which case it holds as many whole
+ *         characters as fit; or STATUS_INVALID_PARAMETER
+ *
+ * Validation is strict: overlong forms, encoded surrogates, values above
+ * U+10FFFF and truncated sequences are all replaced, never passed through.
+ * Callers that must reject such input treat STATUS_SOME_NOT_MAPPED as an
+ * error. Nothing is allocated.
+ */
+static __forceinline
+NTSTATUS
+RtlUTF8ToUnicodeN(
+    _Out_writes_bytes_to_opt_(UnicodeStringMaxByteCount, *UnicodeStringActualByteCount) PWSTR UnicodeStringDestination,
+    _In_ ULONG UnicodeStringMaxByteCount,
+    _Out_ PULONG UnicodeStringActualByteCount,
+    _In_reads_bytes_(UTF8StringByteCount) PCCH UTF8StringSource,
+    _In_ ULONG UTF8StringByteCount
+)
+{
+    SIZE_T const Capacity = (UnicodeStringDestination != NULL ? UnicodeStringMaxByteCount : MAXULONG) / sizeof(WCHAR);
+    SIZE_T Written;
+    NTSTATUS Status;
+
+    if (UnicodeStringActualByteCount == NULL || (UTF8StringSource == NULL && UTF8StringByteCount != 0)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Status = RtlpUTF8ToUnicode(UnicodeStringDestination, Capacity, (const UCHAR*)UTF8StringSource,
+                               UTF8StringByteCount, &Written);
+    *UnicodeStringActualByteCount = (ULONG)(Written * sizeof(WCHAR));
+    return Status;
+}
+
+/**
+ * @brief Converts a UTF-16 string to UTF-8
+ *
+ * @param UTF8StringDestination Receives the UTF-8 text, or NULL to query the
+ *        size of the result
+ * @param UTF8StringMaxByteCount Size of UTF8StringDestination in bytes
+ * @param UTF8StringActualByteCount Receives the number of bytes written, or
+ *        the number required when UTF8StringDestination is NULL
+ * @param UnicodeStringSource UTF-16 text, which need not be null-terminated
+ * @param UnicodeStringByteCount Number of bytes at UnicodeStringSource; must
+ *        be even
+ * @return STATUS_SUCCESS; STATUS_SOME_NOT_MAPPED (a success code) if an
+ *         unpaired surrogate was replaced by U+FFFD; STATUS_BUFFER_TOO_SMALL
+ *         if the destination filled up, in which case it holds as many whole
+ *         characters as fit; or STATUS_INVALID_PARAMETER
+ */
+static __forceinline
+NTSTATUS
+RtlUnicodeToUTF8N(
+    _Out_writes_bytes_to_opt_(UTF8StringMaxByteCount, *UTF8StringActualByteCount) PCHAR UTF8StringDestination,
+    _In_ ULONG UTF8StringMaxByteCount,
+    _Out_ PULONG UTF8StringActualByteCount,
+    _In_reads_bytes_(UnicodeStringByteCount) PCWCH UnicodeStringSource,
+    _In_ ULONG UnicodeStringByteCount
+)
+{
+    SIZE_T const Capacity = UTF8StringDestination != NULL ? UTF8StringMaxByteCount : MAXULONG;
+    SIZE_T Written;
+    NTSTATUS Status;
+
+    if (UTF8StringActualByteCount == NULL || (UnicodeStringByteCount & 1) != 0 ||
+        (UnicodeStringSource == NULL && UnicodeStringByteCount != 0)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Status = RtlpUnicodeToUTF8((PUCHAR)UTF8StringDestination, Capacity, UnicodeStringSource,
+                               UnicodeStringByteCount / sizeof(WCHAR), &Written);
+    *UTF8StringActualByteCount = (ULONG)Written;
+    return Status;
+}
+
+/**
+ * @brief Initializes a counted 8-bit string from a null-terminated string
+ *
+ * @param DestinationString STRING to initialize
+ * @param SourceString Null-terminated string, or NULL for an empty string
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER, or STATUS_NAME_TOO_LONG
+ *         if the text does not fit in a STRING
+ *
+ * The Buffer points at SourceString; nothing is copied or allocated.
+ */
+static __forceinline
+NTSTATUS
+RtlInitString(
+    _Out_ PSTRING DestinationString,
+    _In_opt_ PCSTR SourceString
+)
+{
+    if (DestinationString == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    DestinationString->Buffer = (PCHAR)SourceString;
+    DestinationString->Length = 0;
+    DestinationString->MaximumLength = 0;
+    if (SourceString != NULL) {
+        SIZE_T const Length = strlen(SourceString);
+        if (Length >= 0xFFFF) {
+            return STATUS_NAME_TOO_LONG;
+        }
+        DestinationString->Length = (USHORT)Length;
+        DestinationString->MaximumLength = (USHORT)(Length + 1);
+    }
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Initializes a UTF8_STRING from a null-terminated string
+ *
+ * @param DestinationString UTF8_STRING to initialize
+ * @param SourceString Null-terminated UTF-8 text, or NULL for an empty string
+ * @return As for RtlInitString
+ */
+static __forceinline
+NTSTATUS
+RtlInitUTF8String(
+    _Out_ PUTF8_STRING DestinationString,
+    _In_opt_ PCSTR SourceString
+)
+{
+    return RtlInitString(DestinationString, SourceString);
+}
+
+/**
+ * @brief Converts a UTF8_STRING to a UNICODE_STRING
+ *
+ * @param DestinationString Receives the converted string
+ * @param SourceString UTF-8 string to convert
+ * @param AllocateDestinationString TRUE to allocate a null-terminated buffer
+ *        from the pool; the caller frees it with FreeUnicodeString
+ * @return STATUS_SUCCESS, STATUS_SOME_NOT_MAPPED (see RtlUTF8ToUnicodeN),
+ *         STATUS_NO_MEMORY, STATUS_NAME_TOO_LONG if the result exceeds
+ *         UNICODE_STRING_MAX_BYTES, or STATUS_BUFFER_OVERFLOW if the caller's
+ *         buffer is too small, in which case it holds the characters that fit
+ *
+ * The result is null-terminated whenever there is room.
+ */
+static __forceinline
+NTSTATUS
+RtlUTF8StringToUnicodeString(
+    _Inout_ PUNICODE_STRING DestinationString,
+    _In_ PCUTF8_STRING SourceString,
+    _In_ BOOLEAN AllocateDestinationString
+)
+{
+    const UCHAR* const Source = (const UCHAR*)SourceString->Buffer;
+    SIZE_T Length;
+    NTSTATUS Status;
+
+    if (AllocateDestinationString) {
+        PWSTR Buffer;
+        RtlpUTF8ToUnicode(NULL, MAXULONG, Source, SourceString->Length, &Length);
+        if (Length * sizeof(WCHAR) > UNICODE_STRING_MAX_BYTES - sizeof(WCHAR)) {
+            return STATUS_NAME_TOO_LONG;
+        }
+        Buffer = (PWSTR)ExAllocatePoolTracked(PagedPool, (Length + 1) * sizeof(WCHAR));
+        if (Buffer == NULL) {
+            return STATUS_NO_MEMORY;
+        }
+        DestinationString->Buffer = Buffer;
+        DestinationString->MaximumLength = (USHORT)((Length + 1) * sizeof(WCHAR));
+    }
+
+    Status = RtlpUTF8ToUnicode(DestinationString->Buffer, DestinationString->MaximumLength / sizeof(WCHAR),
+                               Source, SourceString->Length, &Length);
+    DestinationString->Length = (USHORT)(Length * sizeof(WCHAR));
+    if (DestinationString->Length + sizeof(WCHAR) <= DestinationString->MaximumLength) {
+        DestinationString->Buffer[Length] = UNICODE_NULL;
+    }
+    return Status == STATUS_BUFFER_TOO_SMALL ? STATUS_BUFFER_OVERFLOW : Status;
+}
+
+/**
+ * @brief Converts a UNICODE_STRING to a UTF8_STRING
+ *
+ * @param DestinationString Receives the converted string
+ * @param SourceString UTF-16 string to convert
+ * @param AllocateDestinationString TRUE to allocate a null-terminated buffer
+ *        from the pool; the caller frees it with RtlFreeUTF8String
+ * @return STATUS_SUCCESS, STATUS_SOME_NOT_MAPPED (see RtlUnicodeToUTF8N),
+ *         STATUS_NO_MEMORY, STATUS_NAME_TOO_LONG if the result does not fit in
+ *         a UTF8_STRING, or STATUS_BUFFER_OVERFLOW if the caller's buffer is
+ *         too small, in which case it holds the characters that fit
+ *
+ * The result is null-terminated whenever there is room.
+ */
+static __forceinline
+NTSTATUS
+RtlUnicodeStringToUTF8String(
+    _Inout_ PUTF8_STRING DestinationString,
+    _In_ PCUNICODE_STRING SourceString,
+    _In_ BOOLEAN AllocateDestinationString
+)
+{
+    SIZE_T const Count = SourceString->Length / sizeof(WCHAR);
+    SIZE_T Length;
+    NTSTATUS Status;
+
+    if (AllocateDestinationString) {
+        PCHAR Buffer;
+        RtlpUnicodeToUTF8(NULL, MAXULONG, SourceString->Buffer, Count, &Length);
+        if (Length >= 0xFFFF) {
+            return STATUS_NAME_TOO_LONG;
+        }
+        Buffer = (PCHAR)ExAllocatePoolTracked(PagedPool, Length + 1);
+        if (Buffer == NULL) {
+            return STATUS_NO_MEMORY;
+        }
+        DestinationString->Buffer = Buffer;
+        DestinationString->MaximumLength = (USHORT)(Length + 1);
+    }
+
+    Status = RtlpUnicodeToUTF8((PUCHAR)DestinationString->Buffer, DestinationString->MaximumLength,
+                               SourceString->Buffer, Count, &Length);
+    DestinationString->Length = (USHORT)Length;
+    if (Length < DestinationString->MaximumLength) {
+        DestinationString->Buffer[Length] = '\0';
+    }
+    return Status == STATUS_BUFFER_TOO_SMALL ? STATUS_BUFFER_OVERFLOW : Status;
+}
+
+/* Frees the pool buffer of a converted STRING and resets its fields */
+static __forceinline
+VOID
+RtlpFreeString(
+    _Inout_ PSTRING String
+)
+{
+    if (String != NULL && String->Buffer != NULL) {
+        FREE_POOL_TRACKED(String->Buffer);
+        memset(String, 0, sizeof(*String));
+    }
+}
+
+/**
+ * @brief Frees a UTF8_STRING allocated by RtlUnicodeStringToUTF8String
+ *
+ * @param Utf8String String to free; its fields are reset
+ */
+static __forceinline
+VOID
+RtlFreeUTF8String(
+    _Inout_ PUTF8_STRING Utf8String
+)
+{
+    RtlpFreeString(Utf8String);
+}
+
+/*
+ * ANSI strings are ISO 8859-1 (Latin-1): every byte is the code point of the
+ * same value, so conversion is a plain widen or narrow with no table.
+ */
+
+/* Stands in for code units above U+00FF when narrowing, as in Windows */
+#define RTLP_ANSI_DEFAULT_CHARACTER '?'
+
+/**
+ * @brief Widens Latin-1 bytes to UTF-16 code units
+ *
+ * @param Destination Receives Count code units
+ * @param Source Bytes to widen
+ * @param Count Number of bytes
+ */
+static __forceinline
+VOID
+RtlpWidenAnsi(
+    _Out_writes_(Count) PWSTR Destination,
+    _In_reads_(Count) const UCHAR* Source,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T Index = 0;
+
+#if defined(__AVX2__)
+    for (; Count - Index >= 32; Index += 32) {
+        __m256i const Bytes = _mm256_loadu_si256((const __m256i*)(Source + Index));
+        _mm256_storeu_si256((__m256i*)(Destination + Index), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(Bytes)));
+        _mm256_storeu_si256((__m256i*)(Destination + Index + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(Bytes, 1)));
+    }
+#endif
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+    for (; Count - Index >= 16; Index += 16) {
+        __m128i const Bytes = _mm_loadu_si128((const __m128i*)(Source + Index));
+        _mm_storeu_si128((__m128i*)(Destination + Index), _mm_unpacklo_epi8(Bytes, _mm_setzero_si128()));
+        _mm_storeu_si128((__m128i*)(Destination + Index + 8), _mm_unpackhi_epi8(Bytes, _mm_setzero_si128()));
+    }
+#endif
+
+    for (; Index < Count; Index++) {
+        Destination[Index] = (WCHAR)Source[Index];
+    }
+}
+
+/* Narrows code units one at a time; returns FALSE if any had to be replaced */
+static __forceinline
+BOOLEAN
+RtlpNarrowUnicodeScalar(
+    _Out_writes_(Count) PUCHAR Destination,
+    _In_reads_(Count) PCWSTR Source,
+    _In_ SIZE_T Count
+)
+{
+    BOOLEAN Mapped = TRUE;
+
+    for (SIZE_T Index = 0; Index < Count; Index++) {
+        USHORT const Code = (USHORT)Source[Index];
+        if (Code > 0xFF) {
+            Destination[Index] = RTLP_ANSI_DEFAULT_CHARACTER;
+            Mapped = FALSE;
+        } else {
+            Destination[Index] = (UCHAR)Code;
+        }
+    }
+    return Mapped;
+}
+
+/**
+ * @brief Narrows UTF-16 code units to Latin-1 bytes
+ *
+ * @param Destination Receives Count bytes
+ * @param Source Code units to narrow
+ * @param Count Number of code units
+ * @return TRUE, or FALSE if a code unit above U+00FF was replaced by
+ *         RTLP_ANSI_DEFAULT_CHARACTER
+ *
+ * Vectors of Latin-1 are packed in registers; a vector holding any other code
+ * unit is narrowed one code unit at a time.
+ */
+static __forceinline
+BOOLEAN
+RtlpNarrowUnicode(
+    _Out_writes_(Count) PUCHAR Destination,
+    _In_reads_(Count) PCWSTR Source,
+    _In_ SIZE_T Count
+)
+{
+    SIZE_T Index = 0;
+    BOOLEAN Mapped = TRUE;
+
+#if defined(__AVX2__)
+    for (; Count - Index >= 32; Index += 32) {
+        __m256i const Units1 = _mm256_loadu_si256((const __m256i*)(Source + Index));
+        __m256i const Units2 = _mm256_loadu_si256((const __m256i*)(Source + Index + 16));
+
+        if (_mm256_testz_si256(_mm256_or_si256(Units1, Units2), _mm256_set1_epi16((short)0xFF00))) {
+            _mm256_storeu_si256((__m256i*)(Destination + Index),
+                                _mm256_permute4x64_epi64(_mm256_packus_epi16(Units1, Units2), 0xD8));
+        } else {
+            Mapped &= RtlpNarrowUnicodeScalar(Destination + Index, Source + Index, 32);
+        }
+    }
+#endif
+
+#if defined(RTLP_UNICODE_STRING_SSE2)
+    for (; Count - Index >= 16; Index += 16) {
+        __m128i const Units1 = _mm_loadu_si128((const __m128i*)(Source + Index));
+        __m128i const Units2 = _mm_loadu_si128((const __m128i*)(Source + Index + 8));
+        __m128i const High = _mm_and_si128(_mm_or_si128(Units1, Units2), _mm_set1_epi16((short)0xFF00));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(High, _mm_setzero_si128())) == 0xFFFF) {
+            _mm_storeu_si128((__m128i*)(Destination + Index), _mm_packus_epi16(Units1, Units2));
+        } else {
+            Mapped &= RtlpNarrowUnicodeScalar(Destination + Index, Source + Index, 16);
+        }
+    }
+#endif
+
+    Mapped &= RtlpNarrowUnicodeScalar(Destination + Index, Source + Index, Count - Index);
+    return Mapped;
+}
+
+/**
+ * @brief Initializes an ANSI_STRING from a null-terminated string
+ *
+ * @param DestinationString ANSI_STRING to initialize
+ * @param SourceString Null-terminated Latin-1 text, or NULL for an empty string
+ * @return As for RtlInitString
+ */
+static __forceinline
+NTSTATUS
+RtlInitAnsiString(
+    _Out_ PANSI_STRING DestinationString,
+    _In_opt_ PCSTR SourceString
+)
+{
+    return RtlInitString(DestinationString, SourceString);
+}
+
+/**
+ * @brief Converts an ANSI_STRING to a UNICODE_STRING
+ *
+ * @param DestinationString Receives the converted string
+ * @param SourceString Latin-1 string to convert
+ * @param AllocateDestinationString TRUE to allocate a null-terminated buffer
+ *        from the pool; the caller frees it with FreeUnicodeString
+ * @return STATUS_SUCCESS, STATUS_NO_MEMORY, STATUS_NAME_TOO_LONG if the result
+ *         exceeds UNICODE_STRING_MAX_BYTES, or STATUS_BUFFER_OVERFLOW if the
+ *         caller's buffer is too small, in which case it holds the characters
+ *         that fit
+ *
+ * Every byte has a Unicode equivalent, so the conversion cannot fail to map.
+ * The result is null-terminated whenever there is room.
+ */
+static __forceinline
+NTSTATUS
+RtlAnsiStringToUnicodeString(
+    _Inout_ PUNICODE_STRING DestinationString,
+    _In_ PCANSI_STRING SourceString,
+    _In_ BOOLEAN AllocateDestinationString
+)
+{
+    ULONG const Length = (ULONG)SourceString->Length * sizeof(WCHAR);
+    ULONG Converted = Length;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    if (AllocateDestinationString) {
+        PWSTR Buffer;
+        if (Length > UNICODE_STRING_MAX_BYTES - sizeof(WCHAR)) {
+            return STATUS_NAME_TOO_LONG;
+        }
+        Buffer = (PWSTR)ExAllocatePoolTracked(PagedPool, Length + sizeof(WCHAR));
+        if (Buffer == NULL) {
+            return STATUS_NO_MEMORY;
+        }
+        DestinationString->Buffer = Buffer;
+        DestinationString->MaximumLength = (USHORT)(Length + sizeof(WCHAR));
+    } else if (Length > DestinationString->MaximumLength) {
+        Converted = DestinationString->MaximumLength & ~(ULONG)(sizeof(WCHAR) - 1);
+        Status = STATUS_BUFFER_OVERFLOW;
+    }
+
+    RtlpWidenAnsi(DestinationString->Buffer, (const UCHAR*)SourceString->Buffer, Converted / sizeof(WCHAR));
+    DestinationString->Length = (USHORT)Converted;
+    if (Converted + sizeof(WCHAR) <= DestinationString->MaximumLength) {
+        DestinationString->Buffer[Converted / sizeof(WCHAR)] = UNICODE_NULL;
+    }
+    return Status;
+}
+
+/**
+ * @brief Converts a UNICODE_STRING to an ANSI_STRING
+ *
+ * @param DestinationString Receives the converted string
+ * @param SourceString UTF-16 string to convert
+ * @param AllocateDestinationString TRUE to allocate a null-terminated buffer
+ *        from the pool; the caller frees it with RtlFreeAnsiString
+ * @return STATUS_SUCCESS, STATUS_SOME_NOT_MAPPED (a success code) if code
+ *         units above U+00FF were replaced by '?', STATUS_NO_MEMORY, or
+ *         STATUS_BUFFER_OVERFLOW if the caller's buffer is too small, in
+ *         which case it holds the characters that fit
+ *
+ * A surrogate pair becomes two '?' bytes, one per code unit, as in Windows.
+ * The result is null-terminated whenever there is room.
+ */
+static __forceinline
+NTSTATUS
+RtlUnicodeStringToAnsiString(
+    _Inout_ PANSI_STRING DestinationString,
+    _In_ PCUNICODE_STRING SourceString,
+    _In_ BOOLEAN AllocateDestinationString
+)
+{
+    ULONG const Length = SourceString->Length / sizeof(WCHAR);
+    ULONG Converted = Length;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    if (AllocateDestinationString) {
+        PCHAR const Buffer = (PCHAR)ExAllocatePoolTracked(PagedPool, Length + 1);
+        if (Buffer == NULL) {
+            return STATUS_NO_MEMORY;
+        }
+        DestinationString->Buffer = Buffer;
+        DestinationString->MaximumLength = (USHORT)(Length + 1);
+    } else if (Length > DestinationString->MaximumLength) {
+        Converted = DestinationString->MaximumLength;
+        Status = STATUS_BUFFER_OVERFLOW;
+    }
+
+    if (!RtlpNarrowUnicode((PUCHAR)DestinationString->Buffer, SourceString->Buffer, Converted) &&
+        Status == STATUS_SUCCESS) {
+        Status = STATUS_SOME_NOT_MAPPED;
+    }
+    DestinationString->Length = (USHORT)Converted;
+    if (Converted < DestinationString->MaximumLength) {
+        DestinationString->Buffer[Converted] = '\0';
+    }
+    return Status;
+}
+
+/**
+ * @brief Frees an ANSI_STRING allocated by RtlUnicodeStringToAnsiString
+ *
+ * @param AnsiString String to free; its fields are reset
+ */
+static __forceinline
+VOID
+RtlFreeAnsiString(
+    _Inout_ PANSI_STRING AnsiString
+)
+{
+    RtlpFreeString(AnsiString);
+}
+
+/*
+ * Owned strings with inline storage. Most names are short, so keeping them
+ * in the INLINE_UNICODE_STRING saves the pool allocation and the tracking
+ * entry that RtlDuplicateUnicodeString would cost.
+ */
+
+/**
+ * @brief Initializes an empty INLINE_UNICODE_STRING
+ *
+ * @param String String to initialize
+ */
+static __forceinline
+VOID
+RtlInitializeInlineUnicodeString(
+    _Out_ PINLINE_UNICODE_STRING String
+)
+{
+    String->InlineBuffer[0] = UNICODE_NULL;
+    String->String.Buffer = String->InlineBuffer;
+    String->String.Length = 0;
+    String->String.MaximumLength = sizeof(String->InlineBuffer);
+}
+
+/**
+ * @brief Tests whether an INLINE_UNICODE_STRING owns a pool allocation
+ *
+ * @param String String to examine
+ * @return TRUE if the string was too long for InlineBuffer
+ */
+static __forceinline
+BOOLEAN
+RtlIsInlineUnicodeStringAllocated(
+    _In_ const INLINE_UNICODE_STRING* String
+)
+{
+    return String->String.Buffer != NULL && String->String.Buffer != String->InlineBuffer;
+}
+
+/**
+ * @brief Copies a Unicode string into an INLINE_UNICODE_STRING
+ *
+ * @param SourceString String to copy, or NULL for an empty string
+ * @param DestinationString Receives the copy; any previous contents are
+ *        overwritten without being freed
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER, STATUS_NAME_TOO_LONG if
+ *         the string and its terminator exceed UNICODE_STRING_MAX_BYTES, or
+ *         STATUS_NO_MEMORY, in which case DestinationString is empty
+ *
+ * Strings shorter than INLINE_UNICODE_STRING_CHARS code units are stored
+ * inline; longer ones are copied to the pool. The copy is null-terminated
+ * either way. Free it with RtlFreeInlineUnicodeString.
+ */
+static __forceinline
+NTSTATUS
+RtlDuplicateInlineUnicodeString(
+    _In_opt_ PCUNICODE_STRING SourceString,
+    _Out_ PINLINE_UNICODE_STRING DestinationString
+)
+{
+    USHORT Length;
+    NTSTATUS Status;
+
+    if (DestinationString == NULL) {
+        return STATUS_INVALID_PARAMETER;
+    }
+    RtlInitializeInlineUnicodeString(DestinationString);
+
+    Status = RtlValidateUnicodeString(0, SourceString);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+    Length = SourceString != NULL ? SourceString->Length : 0;
+    if (Length > UNICODE_STRING_MAX_BYTES - sizeof(WCHAR)) {
+        return STATUS_NAME_TOO_LONG;
+    }
+
+    if (Length + sizeof(WCHAR) > sizeof(DestinationString->InlineBuffer)) {
+        PWSTR const Buffer = (PWSTR)ExAllocatePoolTracked(PagedPool, Length + sizeof(WCHAR));
+        if (Buffer == NULL) {
+            return STATUS_NO_MEMORY;
+        }
+        DestinationString->String.Buffer = Buffer;
+        DestinationString->String.MaximumLength = (USHORT)(Length + sizeof(WCHAR));
+    }
+
+    if (Length != 0) {
+        RtlCopyMemory(DestinationString->String.Buffer, SourceString->Buffer, Length);
+    }
+    DestinationString->String.Buffer[Length / sizeof(WCHAR)] = UNICODE_NULL;
+    DestinationString->String.Length = Length;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Moves an INLINE_UNICODE_STRING to another location
+ *
+ * @param DestinationString Receives the string; any previous contents are
+ *        overwritten without being freed
+ * @param SourceString String to move; left empty
+ *
+ * A pool buffer changes owner without being copied; an inline string is
+ * copied into DestinationString's own InlineBuffer.
+ */
+static __forceinline
+VOID
+RtlMoveInlineUnicodeString(
+    _Out_ PINLINE_UNICODE_STRING DestinationString,
+    _Inout_ PINLINE_UNICODE_STRING SourceString
+)
+{
+    if (DestinationString == SourceString) {
+        return;
+    }
+
+    if (RtlIsInlineUnicodeStringAllocated(SourceString)) {
+        DestinationString->String = SourceString->String;
+    } else {
+        RtlInitializeInlineUnicodeString(DestinationString);
+        if (SourceString->String.Buffer != NULL) {
+            // Length plus the terminator always fits: it fitted in the source
+            RtlCopyMemory(DestinationString->InlineBuffer, SourceString->InlineBuffer,
+                          SourceString->String.Length + sizeof(WCHAR));
+            DestinationString->String.Length = SourceString->String.Length;
+        }
+    }
+    RtlInitializeInlineUnicodeString(SourceString);
+}
+
+/**
+ * @brief Frees an INLINE_UNICODE_STRING
+ *
+ * @param String String to free; left empty and may be reused or freed again
+ *
+ * Only a string that did not fit inline has pool memory to release.
+ */
+static __forceinline
+VOID
+RtlFreeInlineUnicodeString(
+    _Inout_ PINLINE_UNICODE_STRING String
+)
+{
+    if (RtlIsInlineUnicodeStringAllocated(String)) {
+        FREE_POOL_TRACKED(String->String.Buffer);
+    }
+    RtlInitializeInlineUnicodeString(String);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
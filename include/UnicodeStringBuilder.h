@@ -0,0 +1,381 @@
+/**
+ * @file UnicodeStringBuilder.h
+ * @brief Growable buffer for assembling a UNICODE_STRING from pieces
+ *
+ * A UNICODE_STRING_BUILDER collects Unicode strings, null-terminated wide
+ * strings, single characters and formatted integers into one pool buffer.
+ * When an append does not fit, the buffer is replaced by one at least twice
+ * as large, so each code unit is copied a bounded number of times and
+ * building a string of n code units costs O(n) however many pieces it has.
+ * Appending the same pieces with RtlDuplicateUnicodeString and a copy per
+ * step costs O(n) per piece instead, and an allocation each time.
+ *
+ * RtlFinishUnicodeStringBuilder hands the buffer itself to a UNICODE_STRING,
+ * which the caller frees with FreeUnicodeString; nothing is copied. The text
+ * is kept null-terminated after every append, so the result is too.
+ *
+ * A builder never exceeds UNICODE_STRING_MAX_BYTES including the terminator.
+ * An append that would fails with STATUS_NAME_TOO_LONG, and, like every
+ * failed append, leaves the text built so far unchanged.
+ */
+
+#ifndef WINKERNEL_UNICODESTRINGBUILDER_H_
+#define WINKERNEL_UNICODESTRINGBUILDER_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "NtStatus.h"
+#include "UnicodeString.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bytes allocated by the first append, enough for most device paths */
+#ifndef UNICODE_STRING_BUILDER_MIN_BYTES
+#define UNICODE_STRING_BUILDER_MIN_BYTES    128
+#endif
+
+/**
+ * @brief Text being assembled
+ *
+ * String may be read at any time; it must only be changed through the
+ * RtlXxxUnicodeStringBuilder and RtlAppendXxxToBuilder routines. A
+ * zero-filled builder is empty.
+ */
+typedef struct _UNICODE_STRING_BUILDER {
+    UNICODE_STRING String;                      /**< Text so far; Buffer is NULL or a null-terminated pool block */
+} UNICODE_STRING_BUILDER, *PUNICODE_STRING_BUILDER;
+
+/**
+ * @brief Initializes an empty builder
+ *
+ * @param[out] Builder Builder to initialize
+ *
+ * Nothing is allocated until the first append or reservation.
+ */
+static __forceinline
+VOID
+RtlInitializeUnicodeStringBuilder(
+    _Out_ PUNICODE_STRING_BUILDER Builder
+)
+{
+    Builder->String.Buffer = NULL;
+    Builder->String.Length = 0;
+    Builder->String.MaximumLength = 0;
+}
+
+/**
+ * @brief Moves the text to a larger buffer
+ *
+ * @param[in,out] Builder Builder to grow
+ * @param[in] Required Bytes needed, including the terminator; at most
+ *            UNICODE_STRING_MAX_BYTES
+ * @param[in] Source Code units to append after the existing text, or NULL
+ * @param[in] SourceLength Size of Source in bytes
+ * @return STATUS_SUCCESS or STATUS_NO_MEMORY, in which case Builder is
+ *         unchanged
+ *
+ * The new buffer is twice the old one, or Required if that is larger. Source
+ * is copied before the old buffer is freed, so it may point into it.
+ * Length and the terminator are left to the caller.
+ */
+static __forceinline
+NTSTATUS
+RtlpGrowUnicodeStringBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _In_ ULONG Required,
+    _In_opt_ const WCHAR* Source,
+    _In_ ULONG SourceLength
+)
+{
+    ULONG Capacity = (ULONG)Builder->String.MaximumLength * 2;
+    PWSTR Buffer;
+
+    if (Capacity < UNICODE_STRING_BUILDER_MIN_BYTES) {
+        Capacity = UNICODE_STRING_BUILDER_MIN_BYTES;
+    }
+    if (Capacity < Required) {
+        Capacity = Required;
+    }
+    if (Capacity > UNICODE_STRING_MAX_BYTES) {
+        Capacity = UNICODE_STRING_MAX_BYTES;
+    }
+
+    Buffer = (PWSTR)ExAllocatePoolTracked(PagedPool, Capacity);
+    if (Buffer == NULL) {
+        return STATUS_NO_MEMORY;
+    }
+    if (Builder->String.Length != 0) {
+        RtlCopyMemory(Buffer, Builder->String.Buffer, Builder->String.Length);
+    }
+    if (SourceLength != 0) {
+        RtlCopyMemory((PUCHAR)Buffer + Builder->String.Length, Source, SourceLength);
+    }
+
+    FREE_POOL_TRACKED(Builder->String.Buffer);
+    Builder->String.Buffer = Buffer;
+    Builder->String.MaximumLength = (USHORT)Capacity;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Appends code units to the text
+ *
+ * @param[in,out] Builder Builder to extend
+ * @param[in] Source Code units to append; may point into the builder's text
+ * @param[in] SourceLength Size of Source in bytes, a multiple of sizeof(WCHAR)
+ * @return STATUS_SUCCESS, STATUS_NAME_TOO_LONG or STATUS_NO_MEMORY, in which
+ *         case Builder is unchanged
+ */
+static __forceinline
+NTSTATUS
+RtlpAppendToUnicodeStringBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _In_reads_bytes_(SourceLength) const WCHAR* Source,
+    _In_ ULONG SourceLength
+)
+{
+    ULONG const Length = (ULONG)Builder->String.Length + SourceLength;
+
+    if (SourceLength == 0) {
+        return STATUS_SUCCESS;
+    }
+    if (Length > UNICODE_STRING_MAX_BYTES - sizeof(WCHAR)) {
+        return STATUS_NAME_TOO_LONG;
+    }
+
+    if (Length + sizeof(WCHAR) > Builder->String.MaximumLength) {
+        NTSTATUS const Status = RtlpGrowUnicodeStringBuilder(Builder, Length + sizeof(WCHAR),
+                                                             Source, SourceLength);
+        if (!NT_SUCCESS(Status)) {
+            return Status;
+        }
+    } else {
+        RtlCopyMemory((PUCHAR)Builder->String.Buffer + Builder->String.Length, Source, SourceLength);
+    }
+
+    Builder->String.Length = (USHORT)Length;
+    Builder->String.Buffer[Length / sizeof(WCHAR)] = UNICODE_NULL;
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Makes room for more text without changing it
+ *
+ * @param[in,out] Builder Builder to extend
+ * @param[in] Length Bytes that are about to be appended
+ * @return STATUS_SUCCESS, STATUS_NAME_TOO_LONG if the text could not grow by
+ *         Length, or STATUS_NO_MEMORY
+ *
+ * Appends of up to Length bytes in total will then not allocate. Reserving
+ * the final size up front saves the intermediate buffers when it is known.
+ */
+static __forceinline
+NTSTATUS
+RtlReserveUnicodeStringBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _In_ ULONG Length
+)
+{
+    ULONG Required;
+    NTSTATUS Status;
+
+    if (Length > UNICODE_STRING_MAX_BYTES - sizeof(WCHAR) - (ULONG)Builder->String.Length) {
+        return STATUS_NAME_TOO_LONG;
+    }
+    Required = Builder->String.Length + Length + sizeof(WCHAR);
+    if (Required <= Builder->String.MaximumLength) {
+        return STATUS_SUCCESS;
+    }
+
+    Status = RtlpGrowUnicodeStringBuilder(Builder, Required, NULL, 0);
+    if (NT_SUCCESS(Status)) {
+        Builder->String.Buffer[Builder->String.Length / sizeof(WCHAR)] = UNICODE_NULL;
+    }
+    return Status;
+}
+
+/**
+ * @brief Appends a Unicode string
+ *
+ * @param[in,out] Builder Builder to extend
+ * @param[in] Source String to append, or NULL to append nothing; may be the
+ *            builder's own String
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER, STATUS_NAME_TOO_LONG or
+ *         STATUS_NO_MEMORY, in which case Builder is unchanged
+ */
+static __forceinline
+NTSTATUS
+RtlAppendUnicodeStringToBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _In_opt_ PCUNICODE_STRING Source
+)
+{
+    NTSTATUS const Status = RtlValidateUnicodeString(0, Source);
+
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+    if (Source == NULL) {
+        return STATUS_SUCCESS;
+    }
+    return RtlpAppendToUnicodeStringBuilder(Builder, Source->Buffer, Source->Length);
+}
+
+/**
+ * @brief Appends a null-terminated wide string
+ *
+ * @param[in,out] Builder Builder to extend
+ * @param[in] Source String to append, such as a literal, or NULL to append
+ *            nothing
+ * @return STATUS_SUCCESS, STATUS_NAME_TOO_LONG or STATUS_NO_MEMORY, in which
+ *         case Builder is unchanged
+ */
+static __forceinline
+NTSTATUS
+RtlAppendUnicodeToBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _In_opt_ PCWSTR Source
+)
+{
+    UNICODE_STRING SourceString;
+    NTSTATUS const Status = RtlInitUnicodeString(&SourceString, Source);
+
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+    return RtlpAppendToUnicodeStringBuilder(Builder, SourceString.Buffer, SourceString.Length);
+}
+
+/**
+ * @brief Appends one code unit
+ *
+ * @param[in,out] Builder Builder to extend
+ * @param[in] Character Code unit to append
+ * @return STATUS_SUCCESS, STATUS_NAME_TOO_LONG or STATUS_NO_MEMORY, in which
+ *         case Builder is unchanged
+ */
+static __forceinline
+NTSTATUS
+RtlAppendUnicodeCharToBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _In_ WCHAR Character
+)
+{
+    return RtlpAppendToUnicodeStringBuilder(Builder, &Character, sizeof(WCHAR));
+}
+
+/**
+ * @brief Appends a signed integer in decimal
+ *
+ * @param[in,out] Builder Builder to extend
+ * @param[in] Value Integer to append; negative values get a leading '-'
+ * @return STATUS_SUCCESS, STATUS_NAME_TOO_LONG or STATUS_NO_MEMORY, in which
+ *         case Builder is unchanged
+ */
+static __forceinline
+NTSTATUS
+RtlAppendIntegerToBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _In_ LONG64 Value
+)
+{
+    WCHAR Digits[20];
+    PWCHAR const End = Digits + sizeof(Digits) / sizeof(Digits[0]);
+    PWCHAR Next = End;
+    ULONG64 Magnitude = Value < 0 ? 0 - (ULONG64)Value : (ULONG64)Value;
+
+    do {
+        *--Next = (WCHAR)(L'0' + Magnitude % 10);
+        Magnitude /= 10;
+    } while (Magnitude != 0);
+    if (Value < 0) {
+        *--Next = L'-';
+    }
+
+    return RtlpAppendToUnicodeStringBuilder(Builder, Next, (ULONG)(End - Next) * sizeof(WCHAR));
+}
+
+/**
+ * @brief Appends an unsigned integer in upper-case hexadecimal
+ *
+ * @param[in,out] Builder Builder to extend
+ * @param[in] Value Integer to append, without a 0x prefix
+ * @param[in] MinimumDigits Digits to pad to with leading zeros, at most 16;
+ *            0 or 1 appends just the significant digits
+ * @return STATUS_SUCCESS, STATUS_INVALID_PARAMETER if MinimumDigits is over
+ *         16, STATUS_NAME_TOO_LONG or STATUS_NO_MEMORY, in which case Builder
+ *         is unchanged
+ */
+static __forceinline
+NTSTATUS
+RtlAppendHexToBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _In_ ULONG64 Value,
+    _In_ ULONG MinimumDigits
+)
+{
+    static const char HexDigits[] = "0123456789ABCDEF";
+    WCHAR Digits[16];
+    PWCHAR const End = Digits + sizeof(Digits) / sizeof(Digits[0]);
+    PWCHAR Next = End;
+
+    if (MinimumDigits > sizeof(Digits) / sizeof(Digits[0])) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    do {
+        *--Next = (WCHAR)HexDigits[Value & 0xF];
+        Value >>= 4;
+    } while (Value != 0);
+    while ((ULONG)(End - Next) < MinimumDigits) {
+        *--Next = L'0';
+    }
+
+    return RtlpAppendToUnicodeStringBuilder(Builder, Next, (ULONG)(End - Next) * sizeof(WCHAR));
+}
+
+/**
+ * @brief Hands the text to a UNICODE_STRING and empties the builder
+ *
+ * @param[in,out] Builder Builder to finish; left empty and may be reused
+ * @param[out] DestinationString Receives the text in the builder's own
+ *             buffer; free it with FreeUnicodeString
+ *
+ * The buffer is not copied or shrunk, so MaximumLength may exceed Length
+ * and the spare room may be used, for example by
+ * RtlAppendUnicodeStringToString. The string is null-terminated. A builder
+ * nothing was appended to produces an empty string with a NULL Buffer.
+ */
+static __forceinline
+VOID
+RtlFinishUnicodeStringBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder,
+    _Out_ PUNICODE_STRING DestinationString
+)
+{
+    *DestinationString = Builder->String;
+    RtlInitializeUnicodeStringBuilder(Builder);
+}
+
+/**
+ * @brief Frees an unfinished builder's text
+ *
+ * @param[in,out] Builder Builder to free; left empty and may be reused
+ */
+static __forceinline
+VOID
+RtlFreeUnicodeStringBuilder(
+    _Inout_ PUNICODE_STRING_BUILDER Builder
+)
+{
+    FREE_POOL_TRACKED(Builder->String.Buffer);
+    RtlInitializeUnicodeStringBuilder(Builder);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_UNICODESTRINGBUILDER_H_ */
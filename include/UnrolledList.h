@@ -0,0 +1,287 @@
+/**
+ * @file UnrolledList.h
+ * @brief Unrolled list: a sequence of element pointers stored in cache-line-sized chunks
+ *
+ * A LIST_ENTRY list costs one dependent cache miss per element when it is
+ * walked, because each node lives wherever the heap put it. The unrolled list
+ * keeps the element pointers themselves packed into chunks of
+ * UNROLLED_LIST_CHUNK_SIZE bytes (a whole number of cache lines), so a full
+ * scan touches one chunk per UNROLLED_LIST_CHUNK_CAPACITY elements and the
+ * element addresses are known ahead of time, letting the CPU overlap the
+ * loads of the elements themselves.
+ *
+ * Chunks are linked with LIST_ENTRY and allocated from the tracked pool.
+ * Appending is O(1). Removal goes through a cursor and is O(chunk capacity);
+ * a chunk that empties is freed and a chunk that would fit into its
+ * predecessor is merged into it, so chunks stay at least half full on average.
+ * Element order is preserved by every operation.
+ */
+
+#ifndef WINKERNEL_UNROLLEDLIST_H_
+#define WINKERNEL_UNROLLEDLIST_H_
+
+#include <Windows.h>
+#include <string.h>
+#include "KernelHeapAlloc.h"
+#include "LinkedList.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of one chunk in bytes, a multiple of the cache line size */
+#define UNROLLED_LIST_CHUNK_SIZE 256
+
+/* Number of element pointers held by one chunk */
+#define UNROLLED_LIST_CHUNK_CAPACITY \
+    ((UNROLLED_LIST_CHUNK_SIZE - sizeof(LIST_ENTRY) - 2 * sizeof(ULONG)) / sizeof(PVOID))
+
+/**
+ * @brief One chunk of an unrolled list
+ */
+typedef struct _UNROLLED_LIST_CHUNK {
+    LIST_ENTRY ChunkLinks;                            /**< Links to the neighbouring chunks */
+    ULONG Count;                                      /**< Number of used slots in Elements */
+    ULONG Reserved;
+    PVOID Elements[UNROLLED_LIST_CHUNK_CAPACITY];     /**< Element pointers, in list order */
+} UNROLLED_LIST_CHUNK, *PUNROLLED_LIST_CHUNK;
+
+C_ASSERT(sizeof(UNROLLED_LIST_CHUNK) == UNROLLED_LIST_CHUNK_SIZE);
+
+/**
+ * @brief Head of an unrolled list
+ */
+typedef struct _UNROLLED_LIST {
+    LIST_ENTRY ChunkListHead;   /**< Circular list of UNROLLED_LIST_CHUNK */
+    SIZE_T Count;               /**< Total number of elements */
+    POOL_TYPE PoolType;         /**< Pool used for chunk allocations */
+} UNROLLED_LIST, *PUNROLLED_LIST;
+
+/**
+ * @brief Position within an unrolled list
+ *
+ * The cursor designates the element that the next call to
+ * RtlNextUnrolledListElement returns. The element returned last can be
+ * removed with RtlRemoveUnrolledListElementAtCursor without invalidating the
+ * cursor. Any other modification of the list invalidates all cursors except
+ * appends, which are picked up by cursors that have not yet reached the end.
+ */
+typedef struct _UNROLLED_LIST_CURSOR {
+    PLIST_ENTRY ChunkLink;      /**< Chunk holding the next element, or the list head at the end */
+    ULONG Index;                /**< Slot of the next element within that chunk */
+    BOOLEAN HasCurrent;         /**< TRUE if the element before Index may be removed */
+} UNROLLED_LIST_CURSOR, *PUNROLLED_LIST_CURSOR;
+
+/**
+ * @brief Initializes an empty unrolled list
+ *
+ * @param[out] List Pointer to the list to initialize
+ * @param[in] PoolType Pool used for chunk allocations
+ */
+static __forceinline
+void
+RtlInitializeUnrolledList(
+    _Out_ PUNROLLED_LIST List,
+    _In_ POOL_TYPE PoolType
+)
+{
+    InitializeListHead(&List->ChunkListHead);
+    List->Count = 0;
+    List->PoolType = PoolType;
+}
+
+/**
+ * @brief Returns the number of elements in an unrolled list
+ *
+ * @param[in] List Pointer to the list
+ * @return Number of elements
+ */
+static __forceinline
+SIZE_T
+RtlUnrolledListCount(
+    _In_ const UNROLLED_LIST* List
+)
+{
+    return List->Count;
+}
+
+/**
+ * @brief Appends an element pointer to the end of an unrolled list
+ *
+ * Runs in O(1): the element goes into the last chunk, and a new chunk is
+ * allocated only when that one is full.
+ *
+ * @param[in,out] List Pointer to the list
+ * @param[in] Element Element pointer to store; must not be NULL
+ * @return TRUE on success, FALSE if Element is NULL or a chunk could not be allocated
+ */
+_Must_inspect_result_
+static __forceinline
+BOOLEAN
+RtlAppendUnrolledList(
+    _Inout_ PUNROLLED_LIST List,
+    _In_ PVOID Element
+)
+{
+    PUNROLLED_LIST_CHUNK Chunk = NULL;
+
+    if (Element == NULL) {
+        return FALSE;
+    }
+
+    if (!IsListEmpty(&List->ChunkListHead)) {
+        Chunk = CONTAINING_RECORD(List->ChunkListHead.Blink, UNROLLED_LIST_CHUNK, ChunkLinks);
+    }
+
+    if (Chunk == NULL || Chunk->Count == UNROLLED_LIST_CHUNK_CAPACITY) {
+        Chunk = (PUNROLLED_LIST_CHUNK)ExAllocatePoolTracked(List->PoolType, sizeof(UNROLLED_LIST_CHUNK));
+        if (Chunk == NULL) {
+            return FALSE;
+        }
+        Chunk->Count = 0;
+        Chunk->Reserved = 0;
+        InsertTailList(&List->ChunkListHead, &Chunk->ChunkLinks);
+    }
+
+    Chunk->Elements[Chunk->Count++] = Element;
+    List->Count++;
+    return TRUE;
+}
+
+/**
+ * @brief Positions a cursor at the first element of an unrolled list
+ *
+ * @param[in] List Pointer to the list
+ * @param[out] Cursor Pointer to the cursor to initialize
+ */
+static __forceinline
+void
+RtlStartUnrolledListScan(
+    _In_ PUNROLLED_LIST List,
+    _Out_ PUNROLLED_LIST_CURSOR Cursor
+)
+{
+    Cursor->ChunkLink = List->ChunkListHead.Flink;
+    Cursor->Index = 0;
+    Cursor->HasCurrent = FALSE;
+}
+
+/**
+ * @brief Returns the element at the cursor and advances the cursor
+ *
+ * When the scan moves onto a chunk, the chunk after it is prefetched so that
+ * the next chunk transition does not stall.
+ *
+ * @param[in] List Pointer to the list
+ * @param[in,out] Cursor Pointer to a cursor set up by RtlStartUnrolledListScan
+ * @return The next element pointer, or NULL at the end of the list
+ */
+static __forceinline
+PVOID
+RtlNextUnrolledListElement(
+    _In_ PUNROLLED_LIST List,
+    _Inout_ PUNROLLED_LIST_CURSOR Cursor
+)
+{
+    while (Cursor->ChunkLink != &List->ChunkListHead) {
+        PUNROLLED_LIST_CHUNK const Chunk = CONTAINING_RECORD(Cursor->ChunkLink, UNROLLED_LIST_CHUNK, ChunkLinks);
+
+        if (Cursor->Index < Chunk->Count) {
+            if (Cursor->Index == 0) {
+                PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, Chunk->ChunkLinks.Flink);
+            }
+            Cursor->HasCurrent = TRUE;
+            return Chunk->Elements[Cursor->Index++];
+        }
+
+        Cursor->ChunkLink = Chunk->ChunkLinks.Flink;
+        Cursor->Index = 0;
+    }
+
+    Cursor->HasCurrent = FALSE;
+    return NULL;
+}
+
+/**
+ * @brief Removes the element most recently returned through a cursor
+ *
+ * The remaining elements keep their order and the cursor stays valid: the
+ * next call to RtlNextUnrolledListElement returns the element that followed
+ * the removed one. Runs in O(UNROLLED_LIST_CHUNK_CAPACITY).
+ *
+ * @param[in,out] List Pointer to the list
+ * @param[in,out] Cursor Pointer to the cursor that returned the element
+ * @return The removed element pointer, or NULL if the cursor has not returned
+ *         an element since it was started or since the last removal
+ */
+static __forceinline
+PVOID
+RtlRemoveUnrolledListElementAtCursor(
+    _Inout_ PUNROLLED_LIST List,
+    _Inout_ PUNROLLED_LIST_CURSOR Cursor
+)
+{
+    PUNROLLED_LIST_CHUNK Chunk;
+    PVOID Element;
+
+    if (!Cursor->HasCurrent) {
+        return NULL;
+    }
+
+    Cursor->HasCurrent = FALSE;
+    Chunk = CONTAINING_RECORD(Cursor->ChunkLink, UNROLLED_LIST_CHUNK, ChunkLinks);
+    Cursor->Index--;
+    Element = Chunk->Elements[Cursor->Index];
+    memmove(&Chunk->Elements[Cursor->Index],
+            &Chunk->Elements[Cursor->Index + 1],
+            (Chunk->Count - Cursor->Index - 1) * sizeof(PVOID));
+    Chunk->Count--;
+    List->Count--;
+
+    if (Chunk->Count == 0) {
+        // Continue the scan at the start of the following chunk
+        Cursor->ChunkLink = Chunk->ChunkLinks.Flink;
+        Cursor->Index = 0;
+        RemoveEntryList(&Chunk->ChunkLinks);
+        ExFreePool(Chunk);
+    } else if (Chunk->ChunkLinks.Flink != &List->ChunkListHead) {
+        PUNROLLED_LIST_CHUNK const NextChunk = CONTAINING_RECORD(Chunk->ChunkLinks.Flink, UNROLLED_LIST_CHUNK, ChunkLinks);
+
+        // Fold the next chunk into this one when both fit; the cursor is unaffected
+        if (Chunk->Count + NextChunk->Count <= UNROLLED_LIST_CHUNK_CAPACITY) {
+            memcpy(&Chunk->Elements[Chunk->Count], NextChunk->Elements, NextChunk->Count * sizeof(PVOID));
+            Chunk->Count += NextChunk->Count;
+            RemoveEntryList(&NextChunk->ChunkLinks);
+            ExFreePool(NextChunk);
+        }
+    }
+
+    return Element;
+}
+
+/**
+ * @brief Frees every chunk of an unrolled list
+ *
+ * The element pointers are dropped; the objects they reference are not freed.
+ * The list is left empty and can be reused.
+ *
+ * @param[in,out] List Pointer to the list
+ */
+static __forceinline
+void
+RtlFreeUnrolledList(
+    _Inout_ PUNROLLED_LIST List
+)
+{
+    while (!IsListEmpty(&List->ChunkListHead)) {
+        PLIST_ENTRY const Link = RemoveHeadList(&List->ChunkListHead);
+        ExFreePool(CONTAINING_RECORD(Link, UNROLLED_LIST_CHUNK, ChunkLinks));
+    }
+    List->Count = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_UNROLLEDLIST_H_ */
@@ -0,0 +1,704 @@
+/**
+ * @file WorkQueue.h
+ * @brief Work queues and work items modeled on ExQueueWorkItem and IoQueueWorkItem
+ *
+ * An EX_WORK_QUEUE owns a fixed pool of worker threads. Work items queued from
+ * outside the pool go through a shared RING_QUEUE; work items queued by a
+ * routine that is already running on a worker go onto that worker's own
+ * Chase-Lev deque, where the owner takes them LIFO (cache-warm) and idle
+ * workers steal them FIFO from the other end. A worker with nothing to do
+ * spins briefly and then sleeps with WaitOnAddress until new work is queued.
+ *
+ * IO_WORKITEMs are allocated from a per-worker cache backed by a lookaside
+ * list, so the allocate/queue/free cycle of short-lived work items does not
+ * touch the pool in the steady state.
+ *
+ * ExFlushWorkQueue waits until every work item queued so far, including the
+ * items those items queue, has finished. ExRundownWorkQueue flushes, stops
+ * the workers and frees the queue's resources.
+ *
+ * Unlike the kernel, which has one system-wide set of work queues, a caller
+ * creates and owns each EX_WORK_QUEUE, and the queuing routines take it as
+ * an explicit parameter.
+ */
+
+#ifndef WINKERNEL_WORKQUEUE_H_
+#define WINKERNEL_WORKQUEUE_H_
+
+#include <Windows.h>
+#include "KernelHeapAlloc.h"
+#include "LinkedList.h"
+#include "Lookaside.h"
+#include "NtStatus.h"
+#include "RingQueue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Capacity of each worker's deque; must be a power of two */
+#define EX_WORKER_DEQUE_SIZE 1024
+
+/* Capacity of the shared queue for items queued from outside the pool */
+#define EX_WORK_QUEUE_INJECTION_SIZE 4096
+
+/* Milliseconds an external submitter waits for room in a full shared queue
+   before waking the workers again and retrying */
+#define EX_WORK_QUEUE_INJECTION_RETRY_MS 10
+
+/* Upper bound on the number of worker threads in one queue */
+#define EX_WORK_QUEUE_MAX_WORKERS 256
+
+/* Rounds of work searching an idle worker does before it sleeps */
+#define EX_WORKER_SPIN_COUNT 32
+
+/* Number of freed IO_WORKITEMs each worker keeps for reuse */
+#define EX_WORKER_WORK_ITEM_CACHE_DEPTH 64
+
+/**
+ * @brief Queue types accepted by ExQueueWorkItem
+ *
+ * Accepted for source compatibility. All types are served by the same
+ * worker threads in the order described in the file comment.
+ */
+typedef enum _WORK_QUEUE_TYPE {
+    CriticalWorkQueue,
+    DelayedWorkQueue,
+    HyperCriticalWorkQueue,
+    MaximumWorkQueue
+} WORK_QUEUE_TYPE;
+
+typedef VOID (*PWORKER_THREAD_ROUTINE)(
+    _In_ PVOID Parameter
+);
+
+/**
+ * @brief Caller-allocated work item, laid out as in the kernel
+ */
+typedef struct _WORK_QUEUE_ITEM {
+    LIST_ENTRY List;                        /**< Reserved for the owner of the item */
+    PWORKER_THREAD_ROUTINE WorkerRoutine;   /**< Routine run on a worker thread */
+    PVOID Parameter;                        /**< Argument passed to WorkerRoutine */
+} WORK_QUEUE_ITEM, *PWORK_QUEUE_ITEM;
+
+/**
+ * @brief Initializes a WORK_QUEUE_ITEM before it is queued
+ */
+#define ExInitializeWorkItem(Item, Routine, Context) \
+    do { \
+        (Item)->WorkerRoutine = (Routine); \
+        (Item)->Parameter = (Context); \
+        (Item)->List.Flink = NULL; \
+    } while (0)
+
+struct _EX_WORK_QUEUE;
+struct _IO_WORKITEM;
+
+/**
+ * @brief Per-thread state of a worker
+ *
+ * Top is written by thieves and Bottom by the owner, so they live on separate
+ * cache lines. Submitted and Completed are written only by the owner and read
+ * by ExFlushWorkQueue.
+ */
+typedef struct _EX_WORKER {
+    DECLSPEC_CACHEALIGN volatile LONG64 Top;        /**< Next slot thieves take from */
+    DECLSPEC_CACHEALIGN volatile LONG64 Bottom;     /**< Next slot the owner pushes to */
+    volatile LONG64 Submitted;                      /**< Items queued by routines on this worker */
+    volatile LONG64 Completed;                      /**< Items run on this worker */
+    ULONG RandomState;                              /**< Victim selection state */
+    ULONG FreeWorkItemCount;                        /**< Entries on FreeWorkItems */
+    struct _IO_WORKITEM* FreeWorkItems;             /**< Owner-only cache of freed IO_WORKITEMs */
+    struct _EX_WORK_QUEUE* WorkQueue;               /**< Queue this worker belongs to */
+    HANDLE Thread;                                  /**< Worker thread handle */
+    PVOID volatile Slots[EX_WORKER_DEQUE_SIZE];     /**< Deque storage, indexed modulo its size */
+} EX_WORKER, *PEX_WORKER;
+
+/**
+ * @brief A pool of worker threads and the queues that feed it
+ */
+typedef struct _EX_WORK_QUEUE {
+    RING_QUEUE Injection;                           /**< Items queued from outside the pool */
+    DECLSPEC_CACHEALIGN volatile LONG64 ExternalSubmitted;  /**< Items pushed to Injection */
+    DECLSPEC_CACHEALIGN volatile LONG WorkSignal;   /**< Bumped to wake idle workers */
+    volatile LONG IdleWorkers;                      /**< Workers about to sleep or sleeping */
+    volatile LONG FlushSignal;                      /**< Bumped by workers going idle while a flush waits */
+    volatile LONG FlushWaiters;                     /**< Threads inside ExFlushWorkQueue */
+    volatile LONG Terminating;                      /**< Set by ExRundownWorkQueue */
+    DECLSPEC_CACHEALIGN PEX_WORKER Workers;         /**< WorkerCount workers, cache aligned */
+    PVOID WorkersAllocation;                        /**< Pool block holding Workers */
+    ULONG WorkerCount;
+    DWORD TlsIndex;                                 /**< Maps a thread to its EX_WORKER */
+    NPAGED_LOOKASIDE_LIST IoWorkItemLookaside;      /**< Backing store for IO_WORKITEMs */
+} EX_WORK_QUEUE, *PEX_WORK_QUEUE;
+
+typedef VOID (*PIO_WORKITEM_ROUTINE)(
+    _In_opt_ PVOID IoObject,
+    _In_opt_ PVOID Context
+);
+
+/**
+ * @brief Work item allocated by IoAllocateWorkItem
+ */
+typedef struct _IO_WORKITEM {
+    WORK_QUEUE_ITEM WorkItem;           /**< Item handed to ExQueueWorkItem */
+    PIO_WORKITEM_ROUTINE Routine;       /**< Caller routine set by IoQueueWorkItem */
+    PVOID IoObject;                     /**< Object supplied to IoAllocateWorkItem */
+    PVOID Context;                      /**< Context supplied to IoQueueWorkItem */
+    PEX_WORK_QUEUE WorkQueue;           /**< Queue the item runs on */
+    struct _IO_WORKITEM* NextFree;      /**< Link in a worker's free cache */
+} IO_WORKITEM, *PIO_WORKITEM;
+
+/*
+ * Chase-Lev deque operations. Only the owning worker calls ExpWorkerPush and
+ * ExpWorkerPop; any worker may call ExpWorkerSteal.
+ */
+static __forceinline
+BOOLEAN
+ExpWorkerPush(
+    _Inout_ PEX_WORKER Worker,
+    _In_ PWORK_QUEUE_ITEM WorkItem
+)
+{
+    LONG64 Bottom = ReadNoFence64(&Worker->Bottom);
+    LONG64 Top = ReadAcquire64(&Worker->Top);
+
+    if (Bottom - Top >= EX_WORKER_DEQUE_SIZE) {
+        return FALSE;
+    }
+
+    WritePointerNoFence(&Worker->Slots[Bottom & (EX_WORKER_DEQUE_SIZE - 1)], WorkItem);
+    WriteRelease64(&Worker->Bottom, Bottom + 1);
+    return TRUE;
+}
+
+static __forceinline
+PWORK_QUEUE_ITEM
+ExpWorkerPop(
+    _Inout_ PEX_WORKER Worker
+)
+{
+    LONG64 Bottom = ReadNoFence64(&Worker->Bottom) - 1;
+    LONG64 Top;
+    PWORK_QUEUE_ITEM WorkItem;
+
+    // Reserve the bottom slot before looking at Top; pairs with the barrier in ExpWorkerSteal
+    WriteNoFence64(&Worker->Bottom, Bottom);
+    MemoryBarrier();
+    Top = ReadNoFence64(&Worker->Top);
+
+    if (Top > Bottom) {
+        WriteNoFence64(&Worker->Bottom, Bottom + 1);
+        return NULL;
+    }
+
+    WorkItem = (PWORK_QUEUE_ITEM)ReadPointerNoFence(&Worker->Slots[Bottom & (EX_WORKER_DEQUE_SIZE - 1)]);
+    if (Top == Bottom) {
+        // Last item: race the thieves for it
+        if (InterlockedCompareExchange64(&Worker->Top, Top + 1, Top) != Top) {
+            WorkItem = NULL;
+        }
+        WriteNoFence64(&Worker->Bottom, Bottom + 1);
+    }
+    return WorkItem;
+}
+
+static __forceinline
+PWORK_QUEUE_ITEM
+ExpWorkerSteal(
+    _Inout_ PEX_WORKER Victim
+)
+{
+    for (;;) {
+        LONG64 Top = ReadAcquire64(&Victim->Top);
+        LONG64 Bottom;
+        PWORK_QUEUE_ITEM WorkItem;
+
+        MemoryBarrier();
+        Bottom = ReadAcquire64(&Victim->Bottom);
+        if (Top >= Bottom) {
+            return NULL;
+        }
+
+        WorkItem = (PWORK_QUEUE_ITEM)ReadPointerNoFence(&Victim->Slots[Top & (EX_WORKER_DEQUE_SIZE - 1)]);
+        if (InterlockedCompareExchange64(&Victim->Top, Top + 1, Top) == Top) {
+            return WorkItem;
+        }
+        // Lost the item to the owner or another thief; look again
+    }
+}
+
+/*
+ * Returns the worker structure of the calling thread if it is a worker of
+ * WorkQueue, NULL otherwise.
+ */
+static __forceinline
+PEX_WORKER
+ExpCurrentWorker(
+    _In_ PEX_WORK_QUEUE WorkQueue
+)
+{
+    return (PEX_WORKER)TlsGetValue(WorkQueue->TlsIndex);
+}
+
+/*
+ * Wakes one idle worker if any may be sleeping. The barrier orders the
+ * caller's publication of a work item before the IdleWorkers check; see
+ * ExpWorkerThread for the other half of the protocol.
+ */
+static __forceinline
+VOID
+ExpSignalWork(
+    _Inout_ PEX_WORK_QUEUE WorkQueue
+)
+{
+    MemoryBarrier();
+    if (ReadNoFence(&WorkQueue->IdleWorkers) != 0) {
+        InterlockedIncrement(&WorkQueue->WorkSignal);
+        WakeByAddressSingle((PVOID)&WorkQueue->WorkSignal);
+    }
+}
+
+static __forceinline
+VOID
+ExpRunWorkItem(
+    _Inout_ PEX_WORKER Worker,
+    _In_ PWORK_QUEUE_ITEM WorkItem
+)
+{
+    // The routine may free or requeue the item, so it is not touched afterwards
+    WorkItem->WorkerRoutine(WorkItem->Parameter);
+    WriteRelease64(&Worker->Completed, ReadNoFence64(&Worker->Completed) + 1);
+}
+
+static __forceinline
+PWORK_QUEUE_ITEM
+ExpFindWork(
+    _Inout_ PEX_WORKER Worker
+)
+{
+    PEX_WORK_QUEUE WorkQueue = Worker->WorkQueue;
+    PVOID WorkItem = ExpWorkerPop(Worker);
+    ULONG Count = WorkQueue->WorkerCount;
+    ULONG Start;
+    ULONG Index;
+
+    if (WorkItem != NULL) {
+        return (PWORK_QUEUE_ITEM)WorkItem;
+    }
+
+    if (RtlTryPopRingQueue(&WorkQueue->Injection, &WorkItem)) {
+        return (PWORK_QUEUE_ITEM)WorkItem;
+    }
+
+    // xorshift32 picks where the steal scan starts so thieves spread out
+    Worker->RandomState ^= Worker->RandomState << 13;
+    Worker->RandomState ^= Worker->RandomState >> 17;
+    Worker->RandomState ^= Worker->RandomState << 5;
+    Start = Worker->RandomState % Count;
+
+    for (Index = 0; Index < Count; Index++) {
+        PEX_WORKER Victim = &WorkQueue->Workers[(Start + Index) % Count];
+        if (Victim != Worker) {
+            WorkItem = ExpWorkerSteal(Victim);
+            if (WorkItem != NULL) {
+                return (PWORK_QUEUE_ITEM)WorkItem;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static
+DWORD
+WINAPI
+ExpWorkerThread(
+    _In_ LPVOID Parameter
+)
+{
+    PEX_WORKER Worker = (PEX_WORKER)Parameter;
+    PEX_WORK_QUEUE WorkQueue = Worker->WorkQueue;
+
+    TlsSetValue(WorkQueue->TlsIndex, Worker);
+
+    for (;;) {
+        PWORK_QUEUE_ITEM WorkItem = NULL;
+        ULONG Spin;
+        LONG Snapshot;
+
+        for (Spin = 0; Spin < EX_WORKER_SPIN_COUNT && WorkItem == NULL; Spin++) {
+            WorkItem = ExpFindWork(Worker);
+            if (WorkItem == NULL) {
+                YieldProcessor();
+            }
+        }
+
+        if (WorkItem != NULL) {
+            ExpRunWorkItem(Worker, WorkItem);
+            continue;
+        }
+
+        // Out of work: let a pending flush re-check for completion
+        MemoryBarrier();
+        if (ReadNoFence(&WorkQueue->FlushWaiters) != 0) {
+            InterlockedIncrement(&WorkQueue->FlushSignal);
+            WakeByAddressAll((PVOID)&WorkQueue->FlushSignal);
+        }
+
+        // Register as idle, then look once more before sleeping. A submitter
+        // either sees IdleWorkers != 0 and bumps WorkSignal, or published its
+        // item before the increment below and the re-check finds it.
+        InterlockedIncrement(&WorkQueue->IdleWorkers);
+        Snapshot = ReadAcquire(&WorkQueue->WorkSignal);
+        WorkItem = ExpFindWork(Worker);
+        if (WorkItem == NULL) {
+            if (ReadAcquire(&WorkQueue->Terminating)) {
+                InterlockedDecrement(&WorkQueue->IdleWorkers);
+                break;
+            }
+            WaitOnAddress(&WorkQueue->WorkSignal, &Snapshot, sizeof(Snapshot), INFINITE);
+        }
+        InterlockedDecrement(&WorkQueue->IdleWorkers);
+
+        if (WorkItem != NULL) {
+            ExpRunWorkItem(Worker, WorkItem);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Queues a work item to run on one of the queue's worker threads
+ *
+ * From a worker thread of WorkQueue the item goes onto that worker's deque;
+ * if the deque and the shared queue are both full it runs immediately on the
+ * calling thread. From any other thread the item goes onto the shared queue,
+ * waiting for room if it is full.
+ *
+ * @param[in,out] WorkQueue Pointer to an initialized work queue
+ * @param[in,out] WorkItem Item set up with ExInitializeWorkItem; must stay valid until its routine runs
+ * @param[in] QueueType Accepted for compatibility; see WORK_QUEUE_TYPE
+ * @note Must not be called after ExRundownWorkQueue has started
+ */
+static __forceinline
+VOID
+ExQueueWorkItem(
+    _Inout_ PEX_WORK_QUEUE WorkQueue,
+    _Inout_ __drv_aliasesMem PWORK_QUEUE_ITEM WorkItem,
+    _In_ WORK_QUEUE_TYPE QueueType
+)
+{
+    PEX_WORKER Worker = ExpCurrentWorker(WorkQueue);
+
+    UNREFERENCED_PARAMETER(QueueType);
+
+    if (Worker != NULL) {
+        // Count the item before anyone can complete it
+        WriteRelease64(&Worker->Submitted, ReadNoFence64(&Worker->Submitted) + 1);
+        if (!ExpWorkerPush(Worker, WorkItem) &&
+            !RtlTryPushRingQueue(&WorkQueue->Injection, WorkItem)) {
+            ExpRunWorkItem(Worker, WorkItem);
+            return;
+        }
+    } else {
+        InterlockedIncrement64(&WorkQueue->ExternalSubmitted);
+        // Never sleep indefinitely on a full queue: every timeout makes sure
+        // a worker is awake to drain it before trying again
+        while (RtlPushRingQueue(&WorkQueue->Injection, WorkItem,
+                                EX_WORK_QUEUE_INJECTION_RETRY_MS) == STATUS_TIMEOUT) {
+            ExpSignalWork(WorkQueue);
+        }
+    }
+
+    ExpSignalWork(WorkQueue);
+}
+
+/*
+ * TRUE when every item counted as submitted has also completed. Completion
+ * counts are read before submission counts: an item queued by a routine is
+ * counted as submitted before that routine completes, so a routine that
+ * finished before the first read cannot have an uncounted child.
+ */
+static __forceinline
+BOOLEAN
+ExpIsWorkQueueIdle(
+    _In_ PEX_WORK_QUEUE WorkQueue
+)
+{
+    LONG64 Completed = 0;
+    LONG64 Submitted;
+    ULONG Index;
+
+    for (Index = 0; Index < WorkQueue->WorkerCount; Index++) {
+        Completed += ReadAcquire64(&WorkQueue->Workers[Index].Completed);
+    }
+
+    Submitted = ReadAcquire64(&WorkQueue->ExternalSubmitted);
+    for (Index = 0; Index < WorkQueue->WorkerCount; Index++) {
+        Submitted += ReadAcquire64(&WorkQueue->Workers[Index].Submitted);
+    }
+
+    return Completed == Submitted;
+}
+
+/**
+ * @brief Waits until every queued work item has finished running
+ *
+ * Items queued by running items are waited for as well. Items queued by other
+ * threads while the flush is in progress may or may not be waited for.
+ *
+ * @param[in,out] WorkQueue Pointer to an initialized work queue
+ * @note Must not be called from a worker thread of WorkQueue
+ */
+static __forceinline
+VOID
+ExFlushWorkQueue(
+    _Inout_ PEX_WORK_QUEUE WorkQueue
+)
+{
+    while (!ExpIsWorkQueueIdle(WorkQueue)) {
+        LONG Snapshot;
+
+        InterlockedIncrement(&WorkQueue->FlushWaiters);
+        Snapshot = ReadAcquire(&WorkQueue->FlushSignal);
+        if (!ExpIsWorkQueueIdle(WorkQueue)) {
+            WaitOnAddress(&WorkQueue->FlushSignal, &Snapshot, sizeof(Snapshot), INFINITE);
+        }
+        InterlockedDecrement(&WorkQueue->FlushWaiters);
+    }
+}
+
+/*
+ * Stops and joins the first WorkerCount workers and frees everything
+ * ExInitializeWorkQueue allocated. Shared by rundown and the failure path of
+ * initialization.
+ */
+static __forceinline
+VOID
+ExpDestroyWorkQueue(
+    _Inout_ PEX_WORK_QUEUE WorkQueue,
+    _In_ ULONG StartedWorkers
+)
+{
+    ULONG Index;
+
+    WriteRelease(&WorkQueue->Terminating, TRUE);
+    InterlockedIncrement(&WorkQueue->WorkSignal);
+    WakeByAddressAll((PVOID)&WorkQueue->WorkSignal);
+
+    for (Index = 0; Index < StartedWorkers; Index++) {
+        PEX_WORKER Worker = &WorkQueue->Workers[Index];
+        WaitForSingleObject(Worker->Thread, INFINITE);
+        CloseHandle(Worker->Thread);
+    }
+
+    for (Index = 0; Index < WorkQueue->WorkerCount; Index++) {
+        PEX_WORKER Worker = &WorkQueue->Workers[Index];
+        while (Worker->FreeWorkItems != NULL) {
+            PIO_WORKITEM IoWorkItem = Worker->FreeWorkItems;
+            Worker->FreeWorkItems = IoWorkItem->NextFree;
+            ExFreeToNPagedLookasideList(&WorkQueue->IoWorkItemLookaside, IoWorkItem);
+        }
+    }
+
+    ExDeleteNPagedLookasideList(&WorkQueue->IoWorkItemLookaside);
+    RtlDeleteRingQueue(&WorkQueue->Injection);
+    TlsFree(WorkQueue->TlsIndex);
+    FREE_POOL(WorkQueue->WorkersAllocation);
+    WorkQueue->Workers = NULL;
+    WorkQueue->WorkerCount = 0;
+}
+
+/**
+ * @brief Creates a work queue and starts its worker threads
+ *
+ * @param[out] WorkQueue Pointer to the queue to initialize
+ * @param[in] WorkerCount Number of worker threads, or 0 for one per processor
+ * @return STATUS_SUCCESS, STATUS_NO_MEMORY if an allocation failed, or
+ *         STATUS_INSUFFICIENT_RESOURCES if a TLS slot or thread could not be created
+ */
+_Must_inspect_result_
+static __forceinline
+NTSTATUS
+ExInitializeWorkQueue(
+    _Out_ PEX_WORK_QUEUE WorkQueue,
+    _In_ ULONG WorkerCount
+)
+{
+    NTSTATUS Status;
+    ULONG Index;
+
+    RtlZeroMemory(WorkQueue, sizeof(*WorkQueue));
+
+    if (WorkerCount == 0) {
+        SYSTEM_INFO SystemInfo;
+        GetSystemInfo(&SystemInfo);
+        WorkerCount = SystemInfo.dwNumberOfProcessors;
+    }
+    if (WorkerCount > EX_WORK_QUEUE_MAX_WORKERS) {
+        WorkerCount = EX_WORK_QUEUE_MAX_WORKERS;
+    }
+
+    WorkQueue->TlsIndex = TlsAlloc();
+    if (WorkQueue->TlsIndex == TLS_OUT_OF_INDEXES) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    Status = RtlInitializeRingQueue(&WorkQueue->Injection, EX_WORK_QUEUE_INJECTION_SIZE);
+    if (!NT_SUCCESS(Status)) {
+        TlsFree(WorkQueue->TlsIndex);
+        return Status;
+    }
+
+    WorkQueue->Workers = (PEX_WORKER)ExAllocateCacheAlignedPoolTracked(
+        NonPagedPoolCacheAligned, (SIZE_T)WorkerCount * sizeof(EX_WORKER), &WorkQueue->WorkersAllocation);
+    if (WorkQueue->Workers == NULL) {
+        RtlDeleteRingQueue(&WorkQueue->Injection);
+        TlsFree(WorkQueue->TlsIndex);
+        return STATUS_NO_MEMORY;
+    }
+    RtlZeroMemory(WorkQueue->Workers, (SIZE_T)WorkerCount * sizeof(EX_WORKER));
+    WorkQueue->WorkerCount = WorkerCount;
+
+    ExInitializeNPagedLookasideList(&WorkQueue->IoWorkItemLookaside, NULL, NULL, 0, sizeof(IO_WORKITEM), 0, 0);
+
+    for (Index = 0; Index < WorkerCount; Index++) {
+        WorkQueue->Workers[Index].WorkQueue = WorkQueue;
+        WorkQueue->Workers[Index].RandomState = 0x9E3779B9u * (Index + 1);
+    }
+
+    for (Index = 0; Index < WorkerCount; Index++) {
+        PEX_WORKER Worker = &WorkQueue->Workers[Index];
+        Worker->Thread = CreateThread(NULL, 0, ExpWorkerThread, Worker, 0, NULL);
+        if (Worker->Thread == NULL) {
+            ExpDestroyWorkQueue(WorkQueue, Index);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/**
+ * @brief Drains a work queue, stops its workers and frees its resources
+ *
+ * Waits for every queued work item to finish, including items they queue,
+ * then joins the worker threads. IO_WORKITEMs that are still allocated must
+ * have been freed with IoFreeWorkItem before this call.
+ *
+ * @param[in,out] WorkQueue Pointer to an initialized work queue
+ * @note Must not be called from a worker thread of WorkQueue
+ */
+static __forceinline
+VOID
+ExRundownWorkQueue(
+    _Inout_ PEX_WORK_QUEUE WorkQueue
+)
+{
+    ExFlushWorkQueue(WorkQueue);
+    ExpDestroyWorkQueue(WorkQueue, WorkQueue->WorkerCount);
+}
+
+static __forceinline
+VOID
+IopRunWorkItem(
+    _In_ PVOID Parameter
+)
+{
+    PIO_WORKITEM IoWorkItem = (PIO_WORKITEM)Parameter;
+    IoWorkItem->Routine(IoWorkItem->IoObject, IoWorkItem->Context);
+}
+
+/**
+ * @brief Allocates a work item for use with IoQueueWorkItem
+ *
+ * On a worker thread of WorkQueue the item comes from that worker's private
+ * cache when possible; otherwise from the queue's lookaside list.
+ *
+ * @param[in] WorkQueue Queue the item will run on
+ * @param[in] IoObject Optional object passed to the work item routine
+ * @return Pointer to the work item, or NULL if memory is exhausted
+ */
+_Must_inspect_result_
+static __forceinline
+PIO_WORKITEM
+IoAllocateWorkItem(
+    _In_ PEX_WORK_QUEUE WorkQueue,
+    _In_opt_ PVOID IoObject
+)
+{
+    PEX_WORKER Worker = ExpCurrentWorker(WorkQueue);
+    PIO_WORKITEM IoWorkItem;
+
+    if (Worker != NULL && Worker->FreeWorkItems != NULL) {
+        IoWorkItem = Worker->FreeWorkItems;
+        Worker->FreeWorkItems = IoWorkItem->NextFree;
+        Worker->FreeWorkItemCount--;
+    } else {
+        IoWorkItem = (PIO_WORKITEM)ExAllocateFromNPagedLookasideList(&WorkQueue->IoWorkItemLookaside);
+        if (IoWorkItem == NULL) {
+            return NULL;
+        }
+    }
+
+    IoWorkItem->IoObject = IoObject;
+    IoWorkItem->WorkQueue = WorkQueue;
+    IoWorkItem->NextFree = NULL;
+    return IoWorkItem;
+}
+
+/**
+ * @brief Frees a work item allocated by IoAllocateWorkItem
+ *
+ * May be called from the item's own routine.
+ *
+ * @param[in] IoWorkItem Work item to free; must not be queued
+ */
+static __forceinline
+VOID
+IoFreeWorkItem(
+    _In_ __drv_aliasesMem PIO_WORKITEM IoWorkItem
+)
+{
+    PEX_WORK_QUEUE WorkQueue = IoWorkItem->WorkQueue;
+    PEX_WORKER Worker = ExpCurrentWorker(WorkQueue);
+
+    if (Worker != NULL && Worker->FreeWorkItemCount < EX_WORKER_WORK_ITEM_CACHE_DEPTH) {
+        IoWorkItem->NextFree = Worker->FreeWorkItems;
+        Worker->FreeWorkItems = IoWorkItem;
+        Worker->FreeWorkItemCount++;
+    } else {
+        ExFreeToNPagedLookasideList(&WorkQueue->IoWorkItemLookaside, IoWorkItem);
+    }
+}
+
+/**
+ * @brief Queues a work item allocated by IoAllocateWorkItem
+ *
+ * @param[in,out] IoWorkItem Work item to queue; must not already be queued
+ * @param[in] WorkerRoutine Routine called with the item's IoObject and Context
+ * @param[in] QueueType Accepted for compatibility; see WORK_QUEUE_TYPE
+ * @param[in] Context Optional context passed to WorkerRoutine
+ */
+static __forceinline
+VOID
+IoQueueWorkItem(
+    _Inout_ PIO_WORKITEM IoWorkItem,
+    _In_ PIO_WORKITEM_ROUTINE WorkerRoutine,
+    _In_ WORK_QUEUE_TYPE QueueType,
+    _In_opt_ PVOID Context
+)
+{
+    IoWorkItem->Routine = WorkerRoutine;
+    IoWorkItem->Context = Context;
+    ExInitializeWorkItem(&IoWorkItem->WorkItem, IopRunWorkItem, IoWorkItem);
+    ExQueueWorkItem(IoWorkItem->WorkQueue, &IoWorkItem->WorkItem, QueueType);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* WINKERNEL_WORKQUEUE_H_ */
@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../include/AtomTable.h"
+
+class AtomTableTest : public ::testing::Test {
+protected:
+    PRTL_ATOM_TABLE AtomTable = nullptr;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+        ASSERT_EQ(RtlCreateAtomTable(0, FALSE, &AtomTable), STATUS_SUCCESS);
+    }
+
+    void TearDown() override {
+        if (AtomTable != nullptr) {
+            RtlDestroyAtomTable(AtomTable);
+        }
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+
+    static UNICODE_STRING Name(std::vector<WCHAR>& text, const char* value) {
+        text.assign(value, value + strlen(value));
+        UNICODE_STRING string;
+        string.Buffer = text.data();
+        string.Length = (USHORT)(text.size() * sizeof(WCHAR));
+        string.MaximumLength = string.Length;
+        return string;
+    }
+};
+
+TEST_F(AtomTableTest, EqualStringsShareOneAtom) {
+    std::vector<WCHAR> text1, text2, text3;
+    UNICODE_STRING name1 = Name(text1, "Contoso");
+    UNICODE_STRING name2 = Name(text2, "Contoso");
+    UNICODE_STRING name3 = Name(text3, "Fabrikam");
+    RTL_ATOM atom1, atom2, atom3;
+
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &name1, &atom1), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &name2, &atom2), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &name3, &atom3), STATUS_SUCCESS);
+
+    EXPECT_EQ(atom1, atom2);
+    EXPECT_NE(atom1, atom3);
+    EXPECT_EQ(RtlQueryAtomCount(AtomTable), 2u);
+
+    // The atom is the table's own null-terminated copy
+    EXPECT_NE(atom1->Buffer, name1.Buffer);
+    EXPECT_TRUE(RtlEqualUnicodeString(atom1, &name1, FALSE));
+    EXPECT_EQ(atom1->Buffer[atom1->Length / sizeof(WCHAR)], UNICODE_NULL);
+    EXPECT_EQ(atom1->MaximumLength, atom1->Length + sizeof(WCHAR));
+
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom1), STATUS_SUCCESS);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom2), STATUS_SUCCESS);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom3), STATUS_SUCCESS);
+    EXPECT_EQ(RtlQueryAtomCount(AtomTable), 0u);
+}
+
+TEST_F(AtomTableTest, LastDeleteFreesTheString) {
+    std::vector<WCHAR> text;
+    UNICODE_STRING name = Name(text, "{36fc9e60-c465-11cf-8056-444553540000}");
+    RTL_ATOM atom, again;
+    SIZE_T emptyTableBytes = GetGlobalState()->CurrentBytesAllocated;
+
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &name, &atom), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &name, &again), STATUS_SUCCESS);
+    EXPECT_GT(GetGlobalState()->CurrentBytesAllocated, emptyTableBytes);
+
+    ASSERT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom), STATUS_SUCCESS);
+    EXPECT_EQ(RtlQueryAtomCount(AtomTable), 1u);
+    ASSERT_EQ(RtlLookupAtomInAtomTable(AtomTable, &name, &atom), STATUS_SUCCESS);
+    EXPECT_EQ(atom, again);
+    ASSERT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom), STATUS_SUCCESS);
+
+    ASSERT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, again), STATUS_SUCCESS);
+    EXPECT_EQ(RtlQueryAtomCount(AtomTable), 0u);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, emptyTableBytes);
+    EXPECT_EQ(RtlLookupAtomInAtomTable(AtomTable, &name, &atom), STATUS_OBJECT_NAME_NOT_FOUND);
+    EXPECT_EQ(atom, nullptr);
+
+    // Interning the string again creates a fresh entry
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &name, &atom), STATUS_SUCCESS);
+    EXPECT_TRUE(RtlEqualUnicodeString(atom, &name, FALSE));
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom), STATUS_SUCCESS);
+}
+
+TEST_F(AtomTableTest, ReferenceAtomKeepsTheStringAlive) {
+    std::vector<WCHAR> text;
+    UNICODE_STRING name = Name(text, "Mass Storage");
+    RTL_ATOM atom, found;
+
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &name, &atom), STATUS_SUCCESS);
+    RTL_ATOM shared = RtlReferenceAtom(atom);
+    EXPECT_EQ(shared, atom);
+
+    ASSERT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom), STATUS_SUCCESS);
+    ASSERT_EQ(RtlLookupAtomInAtomTable(AtomTable, &name, &found), STATUS_SUCCESS);
+    EXPECT_EQ(found, shared);
+
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, found), STATUS_SUCCESS);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, shared), STATUS_SUCCESS);
+    EXPECT_EQ(RtlQueryAtomCount(AtomTable), 0u);
+}
+
+TEST_F(AtomTableTest, CaseInSensitiveTableKeepsFirstSpelling) {
+    PRTL_ATOM_TABLE folded;
+    std::vector<WCHAR> text1, text2;
+    UNICODE_STRING lower = Name(text1, "usb\\class_08");
+    UNICODE_STRING upper = Name(text2, "USB\\CLASS_08");
+    RTL_ATOM atom1, atom2;
+
+    ASSERT_EQ(RtlCreateAtomTable(16, TRUE, &folded), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAddAtomToAtomTable(folded, &lower, &atom1), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAddAtomToAtomTable(folded, &upper, &atom2), STATUS_SUCCESS);
+    EXPECT_EQ(atom1, atom2);
+    EXPECT_TRUE(RtlEqualUnicodeString(atom2, &lower, FALSE));
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(folded, atom1), STATUS_SUCCESS);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(folded, atom2), STATUS_SUCCESS);
+    RtlDestroyAtomTable(folded);
+
+    // The default table is case-sensitive
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &lower, &atom1), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &upper, &atom2), STATUS_SUCCESS);
+    EXPECT_NE(atom1, atom2);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom1), STATUS_SUCCESS);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom2), STATUS_SUCCESS);
+}
+
+TEST_F(AtomTableTest, SingleBucketChainsEveryString) {
+    PRTL_ATOM_TABLE chained;
+    std::vector<RTL_ATOM> atoms;
+
+    ASSERT_EQ(RtlCreateAtomTable(1, FALSE, &chained), STATUS_SUCCESS);
+    for (int i = 0; i < 100; i++) {
+        std::vector<WCHAR> text;
+        std::string value = "Vendor " + std::to_string(i);
+        UNICODE_STRING name = Name(text, value.c_str());
+        RTL_ATOM atom;
+        ASSERT_EQ(RtlAddAtomToAtomTable(chained, &name, &atom), STATUS_SUCCESS);
+        atoms.push_back(atom);
+    }
+    EXPECT_EQ(RtlQueryAtomCount(chained), 100u);
+
+    // Deleting from the middle of the chain leaves the rest reachable
+    for (int i = 0; i < 100; i += 2) {
+        ASSERT_EQ(RtlDeleteAtomFromAtomTable(chained, atoms[i]), STATUS_SUCCESS);
+    }
+    for (int i = 1; i < 100; i += 2) {
+        RTL_ATOM found;
+        ASSERT_EQ(RtlLookupAtomInAtomTable(chained, atoms[i], &found), STATUS_SUCCESS);
+        EXPECT_EQ(found, atoms[i]);
+        ASSERT_EQ(RtlDeleteAtomFromAtomTable(chained, found), STATUS_SUCCESS);
+    }
+    EXPECT_EQ(RtlQueryAtomCount(chained), 50u);
+
+    // Destroying the table frees atoms that are still referenced
+    RtlDestroyAtomTable(chained);
+}
+
+TEST_F(AtomTableTest, EmptyAndInvalidNames) {
+    UNICODE_STRING empty = { 0, 0, nullptr };
+    UNICODE_STRING broken = { 4, 4, nullptr };
+    std::vector<WCHAR> text(UNICODE_STRING_MAX_CHARS, L'x');
+    UNICODE_STRING tooLong = { UNICODE_STRING_MAX_BYTES, UNICODE_STRING_MAX_BYTES, text.data() };
+    RTL_ATOM atom;
+
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &empty, &atom), STATUS_SUCCESS);
+    EXPECT_EQ(atom->Length, 0);
+    EXPECT_EQ(atom->Buffer[0], UNICODE_NULL);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom), STATUS_SUCCESS);
+
+    EXPECT_EQ(RtlAddAtomToAtomTable(AtomTable, &broken, &atom), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlAddAtomToAtomTable(AtomTable, &tooLong, &atom), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(RtlLookupAtomInAtomTable(AtomTable, &tooLong, &atom), STATUS_NAME_TOO_LONG);
+
+    // The longest string whose terminator still fits
+    tooLong.Length -= sizeof(WCHAR);
+    ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &tooLong, &atom), STATUS_SUCCESS);
+    EXPECT_EQ(atom->MaximumLength, UNICODE_STRING_MAX_BYTES);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, atom), STATUS_SUCCESS);
+
+    EXPECT_EQ(RtlAddAtomToAtomTable(AtomTable, nullptr, &atom), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlAddAtomToAtomTable(AtomTable, &empty, nullptr), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlLookupAtomInAtomTable(nullptr, &empty, &atom), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, nullptr), STATUS_INVALID_PARAMETER);
+
+    PRTL_ATOM_TABLE table;
+    EXPECT_EQ(RtlCreateAtomTable(RTL_ATOM_TABLE_MAX_BUCKETS + 1, FALSE, &table), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(table, nullptr);
+    EXPECT_EQ(RtlCreateAtomTable(0, FALSE, nullptr), STATUS_INVALID_PARAMETER);
+}
+
+TEST_F(AtomTableTest, ConcurrentAddersAgreeOnOneAtom) {
+    const int kThreads = 8;
+    const int kNames = 8;
+    const int kIterations = 20000;
+    std::vector<std::vector<WCHAR>> texts(kNames);
+    std::vector<UNICODE_STRING> names(kNames);
+    RTL_ATOM kept[kNames / 2];
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < kNames; i++) {
+        std::string value = "Manufacturer " + std::to_string(i);
+        names[i] = Name(texts[i], value.c_str());
+    }
+    // Half the names stay interned throughout; the other half keep dropping
+    // to zero references and being interned again
+    for (int i = 0; i < kNames / 2; i++) {
+        ASSERT_EQ(RtlAddAtomToAtomTable(AtomTable, &names[i], &kept[i]), STATUS_SUCCESS);
+    }
+
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < kIterations; i++) {
+                int index = (i + t) % kNames;
+                RTL_ATOM atom, other;
+                if (!NT_SUCCESS(RtlAddAtomToAtomTable(AtomTable, &names[index], &atom))) {
+                    mismatches++;
+                    continue;
+                }
+                if (!RtlEqualUnicodeString(atom, &names[index], FALSE) ||
+                    (index < kNames / 2 && atom != kept[index])) {
+                    mismatches++;
+                }
+                // While this thread holds a reference, a lookup must find the same atom
+                if (RtlLookupAtomInAtomTable(AtomTable, &names[index], &other) != STATUS_SUCCESS) {
+                    mismatches++;
+                } else {
+                    if (other != atom) {
+                        mismatches++;
+                    }
+                    RtlDeleteAtomFromAtomTable(AtomTable, other);
+                }
+                RtlDeleteAtomFromAtomTable(AtomTable, atom);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_EQ(RtlQueryAtomCount(AtomTable), (ULONG)(kNames / 2));
+    for (int i = 0; i < kNames / 2; i++) {
+        EXPECT_EQ(RtlDeleteAtomFromAtomTable(AtomTable, kept[i]), STATUS_SUCCESS);
+    }
+    EXPECT_EQ(RtlQueryAtomCount(AtomTable), 0u);
+}
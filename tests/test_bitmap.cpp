@@ -0,0 +1,215 @@
+#include <gtest/gtest.h>
+#include <Windows.h>
+#include <random>
+#include <vector>
+#include "../include/Bitmap.h"
+
+class BitmapTest : public ::testing::Test {
+protected:
+    std::vector<ULONG> Buffer;
+    RTL_BITMAP BitMap;
+
+    void Init(ULONG sizeInBits) {
+        Buffer.assign((sizeInBits + 31) / 32, 0);
+        RtlInitializeBitMap(&BitMap, Buffer.data(), sizeInBits);
+        RtlClearAllBits(&BitMap);
+    }
+
+    // Reference implementation: lowest run of n clear bits inside [start, end)
+    ULONG ReferenceFindClear(ULONG n, ULONG start, ULONG end) {
+        ULONG run = 0;
+        for (ULONG i = start; i < end; i++) {
+            run = RtlTestBit(&BitMap, i) ? 0 : run + 1;
+            if (run == n) {
+                return i + 1 - n;
+            }
+        }
+        return RTL_BITMAP_NOT_FOUND;
+    }
+
+    ULONG ReferenceLongestRun(ULONG* startOut) {
+        ULONG best = 0, bestStart = 0, run = 0;
+        for (ULONG i = 0; i < BitMap.SizeOfBitMap; i++) {
+            run = RtlTestBit(&BitMap, i) ? 0 : run + 1;
+            if (run > best) {
+                best = run;
+                bestStart = i + 1 - run;
+            }
+        }
+        *startOut = bestStart;
+        return best;
+    }
+
+    void FillRandom(std::mt19937& rng, double fillRatio, ULONG maxRun) {
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        std::uniform_int_distribution<ULONG> runLength(1, maxRun);
+        RtlClearAllBits(&BitMap);
+        for (ULONG i = 0; i < BitMap.SizeOfBitMap;) {
+            ULONG len = runLength(rng);
+            if (len > BitMap.SizeOfBitMap - i) {
+                len = BitMap.SizeOfBitMap - i;
+            }
+            if (coin(rng) < fillRatio) {
+                RtlSetBits(&BitMap, i, len);
+            }
+            i += len;
+        }
+    }
+};
+
+TEST_F(BitmapTest, InitializeBitMap_SetsHeader) {
+    Init(100);
+    EXPECT_EQ(BitMap.SizeOfBitMap, 100u);
+    EXPECT_EQ(BitMap.Buffer, Buffer.data());
+    EXPECT_EQ(RtlNumberOfSetBits(&BitMap), 0u);
+    EXPECT_EQ(RtlNumberOfClearBits(&BitMap), 100u);
+}
+
+TEST_F(BitmapTest, SetBits_WithinSingleUlong) {
+    Init(64);
+    RtlSetBits(&BitMap, 3, 5);
+    EXPECT_EQ(Buffer[0], 0xF8u);
+    EXPECT_EQ(Buffer[1], 0u);
+    EXPECT_EQ(RtlNumberOfSetBits(&BitMap), 5u);
+}
+
+TEST_F(BitmapTest, SetBits_AcrossUlongs) {
+    Init(128);
+    RtlSetBits(&BitMap, 30, 70);
+    EXPECT_EQ(Buffer[0], 0xC0000000u);
+    EXPECT_EQ(Buffer[1], 0xFFFFFFFFu);
+    EXPECT_EQ(Buffer[2], 0xFFFFFFFFu);
+    EXPECT_EQ(Buffer[3], 0xFu);
+    EXPECT_EQ(RtlNumberOfSetBits(&BitMap), 70u);
+    EXPECT_TRUE(RtlAreBitsSet(&BitMap, 30, 70));
+    EXPECT_FALSE(RtlAreBitsSet(&BitMap, 29, 70));
+}
+
+TEST_F(BitmapTest, ClearBits_AcrossUlongs) {
+    Init(128);
+    RtlSetAllBits(&BitMap);
+    RtlClearBits(&BitMap, 5, 100);
+    EXPECT_EQ(Buffer[0], 0x1Fu);
+    EXPECT_EQ(Buffer[1], 0u);
+    EXPECT_EQ(Buffer[2], 0u);
+    EXPECT_EQ(Buffer[3], 0xFFFFFE00u);
+    EXPECT_EQ(RtlNumberOfSetBits(&BitMap), 28u);
+    EXPECT_TRUE(RtlAreBitsClear(&BitMap, 5, 100));
+    EXPECT_FALSE(RtlAreBitsClear(&BitMap, 4, 2));
+}
+
+TEST_F(BitmapTest, NumberOfSetBits_IgnoresBitsPastEnd) {
+    Init(40);
+    Buffer[1] = 0xFFFFFFFF;  // Only the low 8 bits belong to the bitmap
+    EXPECT_EQ(RtlNumberOfSetBits(&BitMap), 8u);
+}
+
+TEST_F(BitmapTest, FindClearBits_EmptyBitmap) {
+    Init(1000);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 10, 0), 0u);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 10, 500), 500u);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 1000, 0), 0u);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 1001, 0), RTL_BITMAP_NOT_FOUND);
+}
+
+TEST_F(BitmapTest, FindClearBits_ZeroLengthReturnsRoundedHint) {
+    Init(100);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 0, 13), 8u);
+}
+
+TEST_F(BitmapTest, FindClearBits_FullBitmap) {
+    Init(300);
+    RtlSetAllBits(&BitMap);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 1, 0), RTL_BITMAP_NOT_FOUND);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 1, 150), RTL_BITMAP_NOT_FOUND);
+}
+
+TEST_F(BitmapTest, FindClearBits_WrapsAroundHint) {
+    Init(256);
+    RtlSetAllBits(&BitMap);
+    RtlClearBits(&BitMap, 10, 4);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 4, 200), 10u);
+    // The wrapped search may overlap the hint
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 4, 12), 10u);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 5, 12), RTL_BITMAP_NOT_FOUND);
+}
+
+TEST_F(BitmapTest, FindClearBits_RunSpanningWords) {
+    Init(512);
+    RtlSetAllBits(&BitMap);
+    RtlClearBits(&BitMap, 60, 200);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 200, 0), 60u);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 201, 0), RTL_BITMAP_NOT_FOUND);
+    EXPECT_EQ(RtlFindClearBits(&BitMap, 3, 100), 100u);
+}
+
+TEST_F(BitmapTest, FindClearBitsAndSet_AllocatesSequentially) {
+    Init(100);
+    for (ULONG i = 0; i < 10; i++) {
+        EXPECT_EQ(RtlFindClearBitsAndSet(&BitMap, 10, 0), i * 10);
+    }
+    EXPECT_EQ(RtlFindClearBitsAndSet(&BitMap, 1, 0), RTL_BITMAP_NOT_FOUND);
+    EXPECT_EQ(RtlNumberOfSetBits(&BitMap), 100u);
+
+    RtlClearBits(&BitMap, 42, 1);
+    EXPECT_EQ(RtlFindClearBitsAndSet(&BitMap, 1, 0), 42u);
+}
+
+TEST_F(BitmapTest, FindLongestRunClear_Basic) {
+    Init(200);
+    RtlSetAllBits(&BitMap);
+    RtlClearBits(&BitMap, 3, 10);
+    RtlClearBits(&BitMap, 50, 90);
+    RtlClearBits(&BitMap, 180, 20);
+
+    ULONG start = 0;
+    EXPECT_EQ(RtlFindLongestRunClear(&BitMap, &start), 90u);
+    EXPECT_EQ(start, 50u);
+}
+
+TEST_F(BitmapTest, FindLongestRunClear_FullAndEmpty) {
+    ULONG start = 123;
+    Init(77);
+    EXPECT_EQ(RtlFindLongestRunClear(&BitMap, &start), 77u);
+    EXPECT_EQ(start, 0u);
+
+    RtlSetAllBits(&BitMap);
+    EXPECT_EQ(RtlFindLongestRunClear(&BitMap, &start), 0u);
+    EXPECT_EQ(start, 0u);
+}
+
+TEST_F(BitmapTest, RandomizedAgainstReference) {
+    std::mt19937 rng(12345);
+    const ULONG sizes[] = { 1, 31, 64, 65, 257, 1000, 4096, 10007 };
+    const double ratios[] = { 0.0, 0.1, 0.5, 0.9, 0.99 };
+
+    for (ULONG size : sizes) {
+        Init(size);
+        for (double ratio : ratios) {
+            for (ULONG maxRun : { 1u, 8u, 300u }) {
+                FillRandom(rng, ratio, maxRun);
+
+                ULONG expectedSet = 0;
+                for (ULONG i = 0; i < size; i++) {
+                    expectedSet += RtlTestBit(&BitMap, i);
+                }
+                ASSERT_EQ(RtlNumberOfSetBits(&BitMap), expectedSet);
+
+                ULONG expectedStart = 0, actualStart = 0;
+                ULONG expectedLongest = ReferenceLongestRun(&expectedStart);
+                ASSERT_EQ(RtlFindLongestRunClear(&BitMap, &actualStart), expectedLongest);
+                ASSERT_EQ(actualStart, expectedStart);
+
+                for (ULONG n : { 1u, 2u, 7u, 64u, 65u, 200u }) {
+                    ULONG hint = size > 1 ? rng() % size : 0;
+                    ULONG expected = ReferenceFindClear(n, hint, size);
+                    if (expected == RTL_BITMAP_NOT_FOUND && n <= size) {
+                        expected = ReferenceFindClear(n, 0, (hint + n - 1 < size) ? hint + n - 1 : size);
+                    }
+                    ASSERT_EQ(RtlFindClearBits(&BitMap, n, hint), expected)
+                        << "size=" << size << " ratio=" << ratio << " n=" << n << " hint=" << hint;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,270 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../include/Dispatcher.h"
+
+class DispatcherTest : public ::testing::Test {
+protected:
+    static LARGE_INTEGER RelativeMs(LONGLONG Milliseconds) {
+        LARGE_INTEGER Timeout;
+        Timeout.QuadPart = -Milliseconds * 10000;
+        return Timeout;
+    }
+
+    static NTSTATUS Poll(PVOID Object) {
+        LARGE_INTEGER Zero;
+        Zero.QuadPart = 0;
+        return KeWaitForSingleObject(Object, Executive, KernelMode, FALSE, &Zero);
+    }
+};
+
+TEST_F(DispatcherTest, NotificationEvent_StaysSignaledUntilReset) {
+    KEVENT Event;
+    KeInitializeEvent(&Event, NotificationEvent, FALSE);
+
+    EXPECT_EQ(KeReadStateEvent(&Event), 0);
+    EXPECT_EQ(Poll(&Event), STATUS_TIMEOUT);
+
+    EXPECT_EQ(KeSetEvent(&Event, IO_NO_INCREMENT, FALSE), 0);
+    EXPECT_EQ(KeSetEvent(&Event, IO_NO_INCREMENT, FALSE), 1);
+    EXPECT_EQ(Poll(&Event), STATUS_SUCCESS);
+    EXPECT_EQ(Poll(&Event), STATUS_SUCCESS);
+
+    EXPECT_EQ(KeResetEvent(&Event), 1);
+    EXPECT_EQ(Poll(&Event), STATUS_TIMEOUT);
+
+    KeSetEvent(&Event, IO_NO_INCREMENT, FALSE);
+    KeClearEvent(&Event);
+    EXPECT_EQ(KeReadStateEvent(&Event), 0);
+}
+
+TEST_F(DispatcherTest, SynchronizationEvent_WaitConsumesSignal) {
+    KEVENT Event;
+    KeInitializeEvent(&Event, SynchronizationEvent, TRUE);
+
+    EXPECT_EQ(Poll(&Event), STATUS_SUCCESS);
+    EXPECT_EQ(KeReadStateEvent(&Event), 0);
+    EXPECT_EQ(Poll(&Event), STATUS_TIMEOUT);
+}
+
+TEST_F(DispatcherTest, Semaphore_CountsAndLimit) {
+    KSEMAPHORE Semaphore;
+    KeInitializeSemaphore(&Semaphore, 2, 3);
+
+    EXPECT_EQ(Poll(&Semaphore), STATUS_SUCCESS);
+    EXPECT_EQ(Poll(&Semaphore), STATUS_SUCCESS);
+    EXPECT_EQ(Poll(&Semaphore), STATUS_TIMEOUT);
+
+    EXPECT_EQ(KeReleaseSemaphore(&Semaphore, IO_NO_INCREMENT, 3, FALSE), 0);
+    EXPECT_EQ(KeReadStateSemaphore(&Semaphore), 3);
+    EXPECT_EQ(KeReleaseSemaphore(&Semaphore, IO_NO_INCREMENT, 1, FALSE), -1);
+    EXPECT_EQ(KeReleaseSemaphore(&Semaphore, IO_NO_INCREMENT, 0, FALSE), -1);
+    EXPECT_EQ(KeReadStateSemaphore(&Semaphore), 3);
+}
+
+TEST_F(DispatcherTest, Wait_RelativeTimeoutExpires) {
+    KEVENT Event;
+    KeInitializeEvent(&Event, SynchronizationEvent, FALSE);
+    LARGE_INTEGER Timeout = RelativeMs(30);
+
+    auto Start = std::chrono::steady_clock::now();
+    EXPECT_EQ(KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, &Timeout), STATUS_TIMEOUT);
+    auto Elapsed = std::chrono::steady_clock::now() - Start;
+
+    EXPECT_GE(std::chrono::duration_cast<std::chrono::milliseconds>(Elapsed).count(), 25);
+    EXPECT_EQ(Event.Header.WaiterCount, 0);
+    EXPECT_TRUE(IsListEmpty(&Event.Header.WaitListHead));
+}
+
+TEST_F(DispatcherTest, Wait_AbsoluteTimeoutExpires) {
+    KEVENT Event;
+    KeInitializeEvent(&Event, NotificationEvent, FALSE);
+    FILETIME Now;
+    LARGE_INTEGER Timeout;
+
+    GetSystemTimeAsFileTime(&Now);
+    Timeout.LowPart = Now.dwLowDateTime;
+    Timeout.HighPart = (LONG)Now.dwHighDateTime;
+    Timeout.QuadPart += 20 * 10000;
+
+    EXPECT_EQ(KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, &Timeout), STATUS_TIMEOUT);
+}
+
+TEST_F(DispatcherTest, SetEvent_WakesSleepingWaiter) {
+    KEVENT Event;
+    KeInitializeEvent(&Event, SynchronizationEvent, FALSE);
+    std::atomic<NTSTATUS> Status(-1);
+
+    std::thread Waiter([&]() {
+        Status = KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL);
+    });
+
+    while (ReadAcquire(&Event.Header.WaiterCount) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(Status.load(), -1);
+
+    KeSetEvent(&Event, IO_NO_INCREMENT, FALSE);
+    Waiter.join();
+
+    EXPECT_EQ(Status.load(), STATUS_SUCCESS);
+    EXPECT_EQ(KeReadStateEvent(&Event), 0);
+    EXPECT_EQ(Event.Header.WaiterCount, 0);
+}
+
+TEST_F(DispatcherTest, NotificationEvent_ReleasesAllWaiters) {
+    const int WaiterThreads = 4;
+    KEVENT Event;
+    KeInitializeEvent(&Event, NotificationEvent, FALSE);
+    std::atomic<int> Released(0);
+    std::vector<std::thread> Threads;
+
+    for (int i = 0; i < WaiterThreads; i++) {
+        Threads.emplace_back([&]() {
+            if (KeWaitForSingleObject(&Event, Executive, KernelMode, FALSE, NULL) == STATUS_SUCCESS) {
+                Released++;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    KeSetEvent(&Event, IO_NO_INCREMENT, FALSE);
+    for (auto& Thread : Threads) {
+        Thread.join();
+    }
+
+    EXPECT_EQ(Released.load(), WaiterThreads);
+    EXPECT_EQ(KeReadStateEvent(&Event), 1);
+}
+
+TEST_F(DispatcherTest, Semaphore_ReleaseAdmitsExactlyThatManyWaiters) {
+    const int WaiterThreads = 6;
+    KSEMAPHORE Semaphore;
+    KeInitializeSemaphore(&Semaphore, 0, WaiterThreads);
+    std::atomic<int> Acquired(0);
+    std::vector<std::thread> Threads;
+
+    for (int i = 0; i < WaiterThreads; i++) {
+        Threads.emplace_back([&]() {
+            KeWaitForSingleObject(&Semaphore, Executive, KernelMode, FALSE, NULL);
+            Acquired++;
+        });
+    }
+
+    KeReleaseSemaphore(&Semaphore, IO_NO_INCREMENT, 2, FALSE);
+    while (Acquired.load() < 2) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(Acquired.load(), 2);
+
+    KeReleaseSemaphore(&Semaphore, IO_NO_INCREMENT, WaiterThreads - 2, FALSE);
+    for (auto& Thread : Threads) {
+        Thread.join();
+    }
+
+    EXPECT_EQ(Acquired.load(), WaiterThreads);
+    EXPECT_EQ(KeReadStateSemaphore(&Semaphore), 0);
+}
+
+TEST_F(DispatcherTest, WaitAny_ReturnsIndexOfSignaledObject) {
+    KEVENT First;
+    KEVENT Second;
+    KSEMAPHORE Third;
+    KeInitializeEvent(&First, SynchronizationEvent, FALSE);
+    KeInitializeEvent(&Second, NotificationEvent, FALSE);
+    KeInitializeSemaphore(&Third, 0, 1);
+    PVOID Objects[] = { &First, &Second, &Third };
+    LARGE_INTEGER Zero;
+    Zero.QuadPart = 0;
+
+    EXPECT_EQ(KeWaitForMultipleObjects(3, Objects, WaitAny, Executive, KernelMode, FALSE, &Zero, NULL),
+              STATUS_TIMEOUT);
+
+    KeReleaseSemaphore(&Third, IO_NO_INCREMENT, 1, FALSE);
+    EXPECT_EQ(KeWaitForMultipleObjects(3, Objects, WaitAny, Executive, KernelMode, FALSE, NULL, NULL),
+              STATUS_WAIT_0 + 2);
+    EXPECT_EQ(KeReadStateSemaphore(&Third), 0);
+
+    std::thread Setter([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        KeSetEvent(&Second, IO_NO_INCREMENT, FALSE);
+    });
+    EXPECT_EQ(KeWaitForMultipleObjects(3, Objects, WaitAny, Executive, KernelMode, FALSE, NULL, NULL),
+              STATUS_WAIT_0 + 1);
+    Setter.join();
+}
+
+TEST_F(DispatcherTest, WaitAll_AcquiresTogetherOrNotAtAll) {
+    KEVENT Event;
+    KSEMAPHORE Semaphore;
+    KeInitializeEvent(&Event, SynchronizationEvent, TRUE);
+    KeInitializeSemaphore(&Semaphore, 0, 1);
+    PVOID Objects[] = { &Event, &Semaphore };
+    LARGE_INTEGER Timeout = RelativeMs(10);
+
+    EXPECT_EQ(KeWaitForMultipleObjects(2, Objects, WaitAll, Executive, KernelMode, FALSE, &Timeout, NULL),
+              STATUS_TIMEOUT);
+    EXPECT_EQ(KeReadStateEvent(&Event), 1);
+
+    std::thread Releaser([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        KeReleaseSemaphore(&Semaphore, IO_NO_INCREMENT, 1, FALSE);
+    });
+    EXPECT_EQ(KeWaitForMultipleObjects(2, Objects, WaitAll, Executive, KernelMode, FALSE, NULL, NULL),
+              STATUS_SUCCESS);
+    Releaser.join();
+
+    EXPECT_EQ(KeReadStateEvent(&Event), 0);
+    EXPECT_EQ(KeReadStateSemaphore(&Semaphore), 0);
+}
+
+TEST_F(DispatcherTest, WaitMultiple_ValidatesParameters) {
+    KEVENT Events[THREAD_WAIT_OBJECTS + 1];
+    PVOID Objects[THREAD_WAIT_OBJECTS + 1];
+    KWAIT_BLOCK WaitBlocks[THREAD_WAIT_OBJECTS + 1];
+
+    for (int i = 0; i <= THREAD_WAIT_OBJECTS; i++) {
+        KeInitializeEvent(&Events[i], NotificationEvent, FALSE);
+        Objects[i] = &Events[i];
+    }
+    KeSetEvent(&Events[THREAD_WAIT_OBJECTS], IO_NO_INCREMENT, FALSE);
+
+    EXPECT_EQ(KeWaitForMultipleObjects(0, Objects, WaitAny, Executive, KernelMode, FALSE, NULL, NULL),
+              STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(KeWaitForMultipleObjects(THREAD_WAIT_OBJECTS + 1, Objects, WaitAny, Executive, KernelMode,
+                                       FALSE, NULL, NULL),
+              STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(KeWaitForMultipleObjects(THREAD_WAIT_OBJECTS + 1, Objects, WaitAny, Executive, KernelMode,
+                                       FALSE, NULL, WaitBlocks),
+              STATUS_WAIT_0 + THREAD_WAIT_OBJECTS);
+}
+
+TEST_F(DispatcherTest, PingPong_SynchronizationEventsHandOffEveryRound) {
+    const int Rounds = 2000;
+    KEVENT Ping;
+    KEVENT Pong;
+    KeInitializeEvent(&Ping, SynchronizationEvent, FALSE);
+    KeInitializeEvent(&Pong, SynchronizationEvent, FALSE);
+    int Counter = 0;
+
+    std::thread Partner([&]() {
+        for (int i = 0; i < Rounds; i++) {
+            KeWaitForSingleObject(&Ping, Executive, KernelMode, FALSE, NULL);
+            Counter++;
+            KeSetEvent(&Pong, IO_NO_INCREMENT, FALSE);
+        }
+    });
+
+    for (int i = 0; i < Rounds; i++) {
+        KeSetEvent(&Ping, IO_NO_INCREMENT, FALSE);
+        KeWaitForSingleObject(&Pong, Executive, KernelMode, FALSE, NULL);
+        ASSERT_EQ(Counter, i + 1);
+    }
+    Partner.join();
+
+    EXPECT_EQ(Ping.Header.WaiterCount, 0);
+    EXPECT_EQ(Pong.Header.WaiterCount, 0);
+}
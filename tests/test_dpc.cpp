@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../include/Dispatcher.h"
+#include "../include/Dpc.h"
+
+struct RecordedDpc {
+    KDPC Dpc;
+    int Id;
+    std::atomic<int> Runs{0};
+    PVOID SystemArgument1 = nullptr;
+    PVOID SystemArgument2 = nullptr;
+    std::mutex* OrderLock = nullptr;
+    std::vector<int>* Order = nullptr;
+};
+
+static VOID RecordDpc(PKDPC Dpc, PVOID, PVOID SystemArgument1, PVOID SystemArgument2) {
+    RecordedDpc* record = CONTAINING_RECORD(Dpc, RecordedDpc, Dpc);
+    record->SystemArgument1 = SystemArgument1;
+    record->SystemArgument2 = SystemArgument2;
+    if (record->Order != nullptr) {
+        std::lock_guard<std::mutex> guard(*record->OrderLock);
+        record->Order->push_back(record->Id);
+    }
+    record->Runs++;
+}
+
+/* Holds its worker until the gate is set */
+static VOID BlockDpc(PKDPC, PVOID DeferredContext, PVOID, PVOID) {
+    KeWaitForSingleObject(DeferredContext, Executive, KernelMode, FALSE, NULL);
+}
+
+class DpcTest : public ::testing::Test {
+protected:
+    KDPC_QUEUE DpcQueue;
+    bool Initialized = false;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+    }
+
+    void TearDown() override {
+        if (Initialized) {
+            KeRundownDpcQueue(&DpcQueue);
+        }
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+
+    void CreateQueue(ULONG ProcessorCount) {
+        ASSERT_EQ(KeInitializeDpcQueue(&DpcQueue, ProcessorCount), STATUS_SUCCESS);
+        Initialized = true;
+    }
+
+    /* Occupies the worker of one queue so that DPCs inserted there stay queued */
+    void BlockQueue(PKDPC Blocker, PKEVENT Gate, CCHAR Number) {
+        KeInitializeEvent(Gate, NotificationEvent, FALSE);
+        KeInitializeDpc(Blocker, BlockDpc, Gate);
+        KeSetTargetProcessorDpc(Blocker, Number);
+        ASSERT_TRUE(KeInsertQueueDpc(&DpcQueue, Blocker, nullptr, nullptr));
+        while (ReadPointerAcquire(&Blocker->DpcData) != nullptr) {
+            SwitchToThread();
+        }
+    }
+};
+
+TEST_F(DpcTest, Insert_RunsRoutineWithArguments) {
+    CreateQueue(0);
+    RecordedDpc record;
+    KeInitializeDpc(&record.Dpc, RecordDpc, nullptr);
+
+    EXPECT_TRUE(KeInsertQueueDpc(&DpcQueue, &record.Dpc, (PVOID)1, (PVOID)2));
+    KeFlushQueuedDpcs(&DpcQueue);
+
+    EXPECT_EQ(record.Runs.load(), 1);
+    EXPECT_EQ(record.SystemArgument1, (PVOID)1);
+    EXPECT_EQ(record.SystemArgument2, (PVOID)2);
+    EXPECT_EQ(record.Dpc.DpcData, nullptr);
+}
+
+TEST_F(DpcTest, Insert_SuppressesDuplicateWhileQueued) {
+    CreateQueue(1);
+    KDPC blocker;
+    KEVENT gate;
+    RecordedDpc record;
+    BlockQueue(&blocker, &gate, 0);
+    KeInitializeDpc(&record.Dpc, RecordDpc, nullptr);
+
+    EXPECT_TRUE(KeInsertQueueDpc(&DpcQueue, &record.Dpc, (PVOID)1, nullptr));
+    EXPECT_FALSE(KeInsertQueueDpc(&DpcQueue, &record.Dpc, (PVOID)2, nullptr));
+
+    KeSetEvent(&gate, IO_NO_INCREMENT, FALSE);
+    KeFlushQueuedDpcs(&DpcQueue);
+    EXPECT_EQ(record.Runs.load(), 1);
+    EXPECT_EQ(record.SystemArgument1, (PVOID)1);
+
+    EXPECT_TRUE(KeInsertQueueDpc(&DpcQueue, &record.Dpc, (PVOID)3, nullptr));
+    KeFlushQueuedDpcs(&DpcQueue);
+    EXPECT_EQ(record.Runs.load(), 2);
+}
+
+TEST_F(DpcTest, TargetProcessor_SelectsQueue) {
+    CreateQueue(4);
+    RecordedDpc records[4];
+
+    for (int i = 0; i < 4; i++) {
+        KeInitializeDpc(&records[i].Dpc, RecordDpc, nullptr);
+        KeSetTargetProcessorDpc(&records[i].Dpc, (CCHAR)(i == 3 ? 6 : i));
+        EXPECT_TRUE(KeInsertQueueDpc(&DpcQueue, &records[i].Dpc, nullptr, nullptr));
+    }
+    KeFlushQueuedDpcs(&DpcQueue);
+
+    // Processor 6 wraps around to queue 2
+    EXPECT_EQ(DpcQueue.Processors[0].Completed, 1);
+    EXPECT_EQ(DpcQueue.Processors[1].Completed, 1);
+    EXPECT_EQ(DpcQueue.Processors[2].Completed, 2);
+    EXPECT_EQ(DpcQueue.Processors[3].Completed, 0);
+}
+
+TEST_F(DpcTest, Processors_AreCacheAligned) {
+    CreateQueue(5);
+
+    // The inserter and worker halves of each queue must not share a line
+    for (ULONG i = 0; i < DpcQueue.ProcessorCount; i++) {
+        EXPECT_EQ((ULONG_PTR)&DpcQueue.Processors[i] & 63, 0u) << i;
+        EXPECT_EQ((ULONG_PTR)&DpcQueue.Processors[i].Idle & 63, 0u) << i;
+    }
+}
+
+TEST_F(DpcTest, HighImportance_RunsAheadOfQueuedDpcs) {
+    CreateQueue(1);
+    KDPC blocker;
+    KEVENT gate;
+    std::mutex orderLock;
+    std::vector<int> order;
+    RecordedDpc records[3];
+    BlockQueue(&blocker, &gate, 0);
+
+    for (int i = 0; i < 3; i++) {
+        records[i].Id = i;
+        records[i].OrderLock = &orderLock;
+        records[i].Order = &order;
+        KeInitializeDpc(&records[i].Dpc, RecordDpc, nullptr);
+    }
+    KeSetImportanceDpc(&records[2].Dpc, HighImportance);
+    for (int i = 0; i < 3; i++) {
+        KeInsertQueueDpc(&DpcQueue, &records[i].Dpc, nullptr, nullptr);
+    }
+
+    KeSetEvent(&gate, IO_NO_INCREMENT, FALSE);
+    KeFlushQueuedDpcs(&DpcQueue);
+    ASSERT_EQ(order.size(), 3u);
+    EXPECT_EQ(order[0], 2);
+    EXPECT_EQ(order[1], 0);
+    EXPECT_EQ(order[2], 1);
+}
+
+struct RequeuingDpc {
+    KDPC Dpc;
+    PKDPC_QUEUE DpcQueue;
+    int Remaining;
+    KEVENT Done;
+};
+
+static VOID RequeueDpc(PKDPC Dpc, PVOID, PVOID, PVOID) {
+    RequeuingDpc* requeuing = CONTAINING_RECORD(Dpc, RequeuingDpc, Dpc);
+    if (--requeuing->Remaining > 0) {
+        KeInsertQueueDpc(requeuing->DpcQueue, Dpc, nullptr, nullptr);
+    } else {
+        KeSetEvent(&requeuing->Done, IO_NO_INCREMENT, FALSE);
+    }
+}
+
+TEST_F(DpcTest, Routine_MayQueueItsOwnDpc) {
+    CreateQueue(2);
+    RequeuingDpc requeuing;
+    requeuing.DpcQueue = &DpcQueue;
+    requeuing.Remaining = 100;
+    KeInitializeEvent(&requeuing.Done, NotificationEvent, FALSE);
+    KeInitializeDpc(&requeuing.Dpc, RequeueDpc, nullptr);
+
+    ASSERT_TRUE(KeInsertQueueDpc(&DpcQueue, &requeuing.Dpc, nullptr, nullptr));
+    EXPECT_EQ(KeWaitForSingleObject(&requeuing.Done, Executive, KernelMode, FALSE, nullptr), STATUS_SUCCESS);
+    EXPECT_EQ(requeuing.Remaining, 0);
+}
+
+TEST_F(DpcTest, ConcurrentInserters_EveryDpcRunsOnce) {
+    CreateQueue(4);
+    const int threads = 4;
+    const int perThread = 2000;
+    std::vector<RecordedDpc> records(threads * perThread);
+
+    for (auto& record : records) {
+        KeInitializeDpc(&record.Dpc, RecordDpc, nullptr);
+    }
+
+    std::vector<std::thread> inserters;
+    for (int t = 0; t < threads; t++) {
+        inserters.emplace_back([&, t]() {
+            for (int i = 0; i < perThread; i++) {
+                RecordedDpc& record = records[t * perThread + i];
+                KeSetTargetProcessorDpc(&record.Dpc, (CCHAR)(i % 4));
+                KeInsertQueueDpc(&DpcQueue, &record.Dpc, nullptr, nullptr);
+            }
+        });
+    }
+    for (auto& inserter : inserters) {
+        inserter.join();
+    }
+    KeFlushQueuedDpcs(&DpcQueue);
+
+    for (auto& record : records) {
+        ASSERT_EQ(record.Runs.load(), 1);
+    }
+}
+
+TEST_F(DpcTest, Rundown_RunsQueuedDpcs) {
+    CreateQueue(2);
+    std::vector<RecordedDpc> records(100);
+
+    for (auto& record : records) {
+        KeInitializeDpc(&record.Dpc, RecordDpc, nullptr);
+        KeInsertQueueDpc(&DpcQueue, &record.Dpc, nullptr, nullptr);
+    }
+    KeRundownDpcQueue(&DpcQueue);
+    Initialized = false;
+
+    for (auto& record : records) {
+        EXPECT_EQ(record.Runs.load(), 1);
+    }
+}
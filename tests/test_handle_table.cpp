@@ -0,0 +1,260 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+#include "../include/HandleTable.h"
+
+class HandleTableTest : public ::testing::Test {
+protected:
+    PHANDLE_TABLE HandleTable = nullptr;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+        ASSERT_EQ(ExCreateHandleTable(&HandleTable), STATUS_SUCCESS);
+    }
+
+    void TearDown() override {
+        if (HandleTable != nullptr) {
+            ExDestroyHandleTable(HandleTable, nullptr, nullptr);
+        }
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+
+    static PVOID Value(ULONG_PTR n) {
+        return (PVOID)((n + 1) * 16);
+    }
+};
+
+static ULONG HandleIndex(HANDLE handle) {
+    return (ULONG)(((ULONG_PTR)handle >> HANDLE_TAG_BITS) & HANDLE_INDEX_MASK);
+}
+
+TEST_F(HandleTableTest, CreateLookupDestroy) {
+    HANDLE handle = ExCreateHandle(HandleTable, Value(1));
+    ASSERT_NE(handle, nullptr);
+    EXPECT_EQ((ULONG_PTR)handle & 3, 0u);
+    EXPECT_EQ(ExQueryHandleCount(HandleTable), 1u);
+
+    EXPECT_EQ(ExMapHandleToPointer(HandleTable, handle), Value(1));
+
+    EXPECT_EQ(ExDestroyHandle(HandleTable, handle), Value(1));
+    EXPECT_EQ(ExMapHandleToPointer(HandleTable, handle), nullptr);
+    EXPECT_EQ(ExDestroyHandle(HandleTable, handle), nullptr);
+    EXPECT_EQ(ExQueryHandleCount(HandleTable), 0u);
+}
+
+TEST_F(HandleTableTest, RejectsNullObjectAndMalformedHandles) {
+    EXPECT_EQ(ExCreateHandle(HandleTable, nullptr), nullptr);
+
+    HANDLE handle = ExCreateHandle(HandleTable, Value(1));
+    ASSERT_NE(handle, nullptr);
+
+    EXPECT_EQ(ExMapHandleToPointer(HandleTable, nullptr), nullptr);
+    EXPECT_EQ(ExMapHandleToPointer(HandleTable, (HANDLE)((ULONG_PTR)handle | 1)), nullptr);
+    EXPECT_EQ(ExMapHandleToPointer(HandleTable, (HANDLE)(ULONG_PTR)(HANDLE_INDEX_MASK << HANDLE_TAG_BITS)), nullptr);
+    EXPECT_EQ(ExDestroyHandle(HandleTable, (HANDLE)((ULONG_PTR)handle | 2)), nullptr);
+
+    EXPECT_EQ(ExDestroyHandle(HandleTable, handle), Value(1));
+}
+
+TEST_F(HandleTableTest, ReusedEntryRejectsStaleHandle) {
+    HANDLE first = ExCreateHandle(HandleTable, Value(1));
+    ASSERT_NE(first, nullptr);
+    ASSERT_EQ(ExDestroyHandle(HandleTable, first), Value(1));
+
+    // The freed entry is at the head of this processor's free list
+    HANDLE second = ExCreateHandle(HandleTable, Value(2));
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(HandleIndex(second), HandleIndex(first));
+    EXPECT_NE(second, first);
+
+    EXPECT_EQ(ExMapHandleToPointer(HandleTable, first), nullptr);
+    EXPECT_EQ(ExDestroyHandle(HandleTable, first), nullptr);
+    EXPECT_EQ(ExMapHandleToPointer(HandleTable, second), Value(2));
+
+    EXPECT_EQ(ExDestroyHandle(HandleTable, second), Value(2));
+}
+
+TEST_F(HandleTableTest, GrowsAcrossPages) {
+    const int count = HANDLE_TABLE_ENTRIES_PER_PAGE * 3 + 7;
+    std::vector<HANDLE> handles;
+    std::set<HANDLE> unique;
+
+    for (int i = 0; i < count; i++) {
+        HANDLE handle = ExCreateHandle(HandleTable, Value(i));
+        ASSERT_NE(handle, nullptr);
+        handles.push_back(handle);
+        unique.insert(handle);
+    }
+    EXPECT_EQ(unique.size(), (size_t)count);
+    EXPECT_EQ(ExQueryHandleCount(HandleTable), (ULONG)count);
+
+    for (int i = 0; i < count; i++) {
+        ASSERT_EQ(ExMapHandleToPointer(HandleTable, handles[i]), Value(i));
+    }
+    for (int i = 0; i < count; i += 2) {
+        ASSERT_EQ(ExDestroyHandle(HandleTable, handles[i]), Value(i));
+    }
+    for (int i = 0; i < count; i++) {
+        ASSERT_EQ(ExMapHandleToPointer(HandleTable, handles[i]), (i % 2 == 0) ? nullptr : Value(i));
+    }
+}
+
+TEST_F(HandleTableTest, ClosedEntriesAreReusedBeforeGrowing) {
+    std::vector<HANDLE> handles;
+
+    for (int i = 0; i < 100; i++) {
+        handles.push_back(ExCreateHandle(HandleTable, Value(i)));
+    }
+    ULONG grownTo = HandleTable->NextIndexNeedingPool;
+
+    for (int round = 0; round < 50; round++) {
+        for (auto& handle : handles) {
+            ASSERT_NE(ExDestroyHandle(HandleTable, handle), nullptr);
+        }
+        for (int i = 0; i < 100; i++) {
+            handles[i] = ExCreateHandle(HandleTable, Value(i));
+            ASSERT_NE(handles[i], nullptr);
+        }
+    }
+    EXPECT_EQ(HandleTable->NextIndexNeedingPool, grownTo);
+}
+
+static BOOLEAN CollectHandle(PHANDLE_TABLE, HANDLE handle, PVOID object, PVOID context) {
+    auto seen = static_cast<std::vector<std::pair<HANDLE, PVOID>>*>(context);
+    seen->push_back({ handle, object });
+    return FALSE;
+}
+
+static BOOLEAN StopAtThirdValue(PHANDLE_TABLE, HANDLE, PVOID object, PVOID) {
+    return object == (PVOID)(3 * 16);
+}
+
+TEST_F(HandleTableTest, EnumeratesOpenHandles) {
+    std::vector<HANDLE> handles;
+    for (int i = 0; i < 10; i++) {
+        handles.push_back(ExCreateHandle(HandleTable, Value(i)));
+    }
+    ExDestroyHandle(HandleTable, handles[4]);
+
+    std::vector<std::pair<HANDLE, PVOID>> seen;
+    EXPECT_FALSE(ExEnumHandleTable(HandleTable, CollectHandle, &seen, nullptr));
+    ASSERT_EQ(seen.size(), 9u);
+    for (auto& entry : seen) {
+        EXPECT_EQ(ExMapHandleToPointer(HandleTable, entry.first), entry.second);
+        EXPECT_NE(entry.first, handles[4]);
+    }
+
+    HANDLE stoppedAt = nullptr;
+    EXPECT_TRUE(ExEnumHandleTable(HandleTable, StopAtThirdValue, nullptr, &stoppedAt));
+    EXPECT_EQ(stoppedAt, handles[2]);
+}
+
+static VOID CountDestroyedHandle(HANDLE, PVOID, PVOID context) {
+    (*static_cast<int*>(context))++;
+}
+
+TEST_F(HandleTableTest, DestroyTableReportsOpenHandles) {
+    for (int i = 0; i < 5; i++) {
+        ASSERT_NE(ExCreateHandle(HandleTable, Value(i)), nullptr);
+    }
+
+    int destroyed = 0;
+    ExDestroyHandleTable(HandleTable, CountDestroyedHandle, &destroyed);
+    HandleTable = nullptr;
+    EXPECT_EQ(destroyed, 5);
+}
+
+TEST_F(HandleTableTest, ConcurrentCloseSucceedsOnce) {
+    const int rounds = 500;
+    for (int round = 0; round < rounds; round++) {
+        HANDLE handle = ExCreateHandle(HandleTable, Value(round));
+        std::atomic<int> closed(0);
+        std::vector<std::thread> closers;
+        for (int t = 0; t < 3; t++) {
+            closers.emplace_back([&]() {
+                if (ExDestroyHandle(HandleTable, handle) != nullptr) {
+                    closed++;
+                }
+            });
+        }
+        for (auto& closer : closers) {
+            closer.join();
+        }
+        ASSERT_EQ(closed.load(), 1);
+    }
+    EXPECT_EQ(ExQueryHandleCount(HandleTable), 0u);
+}
+
+TEST_F(HandleTableTest, LookupsNeverResolveToAnotherSlotsObject) {
+    const int slots = 64;
+    const int churnThreads = 2;
+    const int lookupThreads = 2;
+    std::atomic<ULONG_PTR> published[slots];
+    std::atomic<bool> stop(false);
+    std::atomic<long> mismatches(0);
+    std::atomic<long> hits(0);
+
+    for (int i = 0; i < slots; i++) {
+        published[i] = 0;
+    }
+
+    // Each churn thread owns the slots congruent to its number and keeps
+    // closing and recreating their handles; slot i always maps to Value(i)
+    std::vector<std::thread> threads;
+    for (int t = 0; t < churnThreads; t++) {
+        threads.emplace_back([&, t]() {
+            for (int round = 0; round < 2000; round++) {
+                for (int i = t; i < slots; i += churnThreads) {
+                    HANDLE old = (HANDLE)published[i].exchange(0);
+                    if (old != nullptr) {
+                        ASSERT_EQ(ExDestroyHandle(HandleTable, old), Value(i));
+                    }
+                    HANDLE handle = ExCreateHandle(HandleTable, Value(i));
+                    ASSERT_NE(handle, nullptr);
+                    published[i] = (ULONG_PTR)handle;
+                }
+            }
+        });
+    }
+    for (int t = 0; t < lookupThreads; t++) {
+        threads.emplace_back([&]() {
+            std::vector<HANDLE> stale(slots, nullptr);
+            while (!stop.load()) {
+                for (int i = 0; i < slots; i++) {
+                    HANDLE handle = (HANDLE)published[i].load();
+                    // Stale handles from earlier rounds must resolve to nothing or to this slot
+                    for (HANDLE candidate : { handle, stale[i] }) {
+                        if (candidate == nullptr) {
+                            continue;
+                        }
+                        PVOID object = ExMapHandleToPointer(HandleTable, candidate);
+                        if (object != nullptr && object != Value(i)) {
+                            mismatches++;
+                        } else if (object != nullptr) {
+                            hits++;
+                        }
+                    }
+                    if (handle != nullptr) {
+                        stale[i] = handle;
+                    }
+                }
+                SwitchToThread();
+            }
+        });
+    }
+
+    for (int t = 0; t < churnThreads; t++) {
+        threads[t].join();
+    }
+    stop = true;
+    for (int t = churnThreads; t < churnThreads + lookupThreads; t++) {
+        threads[t].join();
+    }
+
+    EXPECT_EQ(mismatches.load(), 0);
+    EXPECT_GT(hits.load(), 0);
+    EXPECT_EQ(ExQueryHandleCount(HandleTable), (ULONG)slots);
+}
@@ -30,15 +30,15 @@ TEST_F(KernelHeapAllocTest, BasicAllocation) {
     GLOBAL_STATE* state = GetGlobalState();
     
     ASSERT_NE(ptr, nullptr) << "Allocation failed";
-    ASSERT_EQ(state->AllocationCount, (SIZE_T)1) << "Allocation count mismatch";
+    ASSERT_EQ((SIZE_T)RtlReadShardedCounter(&state->AllocationCount), (SIZE_T)1) << "Allocation count mismatch";
     ASSERT_EQ(state->CurrentBytesAllocated, allocSize) << "Current bytes allocated mismatch";
-    ASSERT_EQ(state->TotalBytesAllocated, allocSize) << "Total bytes allocated mismatch";
+    ASSERT_EQ((SIZE_T)RtlReadShardedCounter(&state->TotalBytesAllocated), allocSize) << "Total bytes allocated mismatch";
     ASSERT_EQ(state->PeakBytesAllocated, allocSize) << "Peak bytes allocated mismatch";
 
     ExFreePoolTracked(ptr);
     
     ASSERT_EQ(state->CurrentBytesAllocated, (SIZE_T)0) << "Memory not properly freed";
-    ASSERT_EQ(state->AllocationCount, (SIZE_T)1) << "Total allocation count changed after free";
+    ASSERT_EQ((SIZE_T)RtlReadShardedCounter(&state->AllocationCount), (SIZE_T)1) << "Total allocation count changed after free";
 }
 
 TEST_F(KernelHeapAllocTest, MultipleAllocations) {
@@ -53,7 +53,7 @@ TEST_F(KernelHeapAllocTest, MultipleAllocations) {
         ptrs.push_back(ptr);
     }
     
-    ASSERT_EQ(state->AllocationCount, (SIZE_T)numAllocs) << "Allocation count mismatch";
+    ASSERT_EQ((SIZE_T)RtlReadShardedCounter(&state->AllocationCount), (SIZE_T)numAllocs) << "Allocation count mismatch";
     ASSERT_EQ(state->CurrentBytesAllocated, size * numAllocs) << "Current bytes allocated mismatch";
     
     for (PVOID ptr : ptrs) {
@@ -217,6 +217,32 @@ TEST_F(KernelHeapAllocTest, ThreadSafety) {
     ASSERT_EQ(state->CurrentBytesAllocated, (SIZE_T)0) << "Memory leak in threaded test";
 }
 
+TEST_F(KernelHeapAllocTest, CacheAlignedAllocation) {
+    GLOBAL_STATE* state = GetGlobalState();
+    PVOID blocks[8];
+    SIZE_T sizes[8] = { 1, 16, 63, 64, 65, 100, 1000, 4096 };
+
+    for (int i = 0; i < 8; i++) {
+        PUCHAR ptr = (PUCHAR)ExAllocateCacheAlignedPoolTracked(NonPagedPoolCacheAligned, sizes[i], &blocks[i]);
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ((ULONG_PTR)ptr % SYSTEM_CACHE_ALIGNMENT_SIZE, 0u) << sizes[i];
+        EXPECT_GE(ptr, (PUCHAR)blocks[i]);
+        EXPECT_LT(ptr, (PUCHAR)blocks[i] + SYSTEM_CACHE_ALIGNMENT_SIZE);
+        memset(ptr, 0xAB, sizes[i]);
+    }
+    for (int i = 0; i < 8; i++) {
+        ExFreePoolTracked(blocks[i]);
+    }
+    EXPECT_EQ(state->CurrentBytesAllocated, (SIZE_T)0);
+
+    // Rounding up must not wrap around
+    PVOID block = (PVOID)1;
+    SetErrorSuppression(TRUE);
+    EXPECT_EQ(ExAllocateCacheAlignedPoolTracked(NonPagedPoolCacheAligned, (SIZE_T)-1, &block), nullptr);
+    EXPECT_EQ(block, nullptr);
+    SetErrorSuppression(FALSE);
+}
+
 TEST_F(KernelHeapAllocTest, MemoryContent) {
     const SIZE_T size = 100;
     PVOID ptr = ExAllocatePoolTracked(NonPagedPool, size);
@@ -245,7 +271,7 @@ TEST_F(KernelHeapAllocTest, AllocationFailure) {
     ASSERT_EQ(ptr, nullptr) << "Allocation should return NULL when it fails";
     
     // Verify no memory was added to tracking
-    ASSERT_EQ(state->AllocationCount, (SIZE_T)0) << "Failed allocation should not be tracked";
+    ASSERT_EQ((SIZE_T)RtlReadShardedCounter(&state->AllocationCount), (SIZE_T)0) << "Failed allocation should not be tracked";
     ASSERT_EQ(state->CurrentBytesAllocated, (SIZE_T)0) << "Failed allocation should not affect bytes count";
     
     SetErrorSuppression(FALSE); // Restore error messages
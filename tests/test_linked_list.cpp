@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include <Windows.h>
+#include <algorithm>
+#include <random>
+#include <vector>
 #include "../include/LinkedList.h"
 
 // Helper struct for testing
@@ -237,3 +240,253 @@ TEST_F(LinkedListTest, TraverseBackward) {
     }
     EXPECT_EQ(i, -1);
 }
+
+// Orders by Value / 10 so that distinct values can compare equal
+static LONG CompareByBucket(PLIST_ENTRY First, PLIST_ENTRY Second, PVOID Context) {
+    int* calls = static_cast<int*>(Context);
+    if (calls != nullptr) {
+        (*calls)++;
+    }
+    int a = CONTAINING_RECORD(First, TestItem, ListEntry)->Value / 10;
+    int b = CONTAINING_RECORD(Second, TestItem, ListEntry)->Value / 10;
+    return (a > b) - (a < b);
+}
+
+// Collects values front to back and checks every Blink against its predecessor
+static std::vector<int> CollectAndVerify(PLIST_ENTRY head) {
+    std::vector<int> values;
+    PLIST_ENTRY previous = head;
+    for (PLIST_ENTRY entry = head->Flink; entry != head; entry = entry->Flink) {
+        EXPECT_EQ(entry->Blink, previous);
+        values.push_back(CONTAINING_RECORD(entry, TestItem, ListEntry)->Value);
+        previous = entry;
+    }
+    EXPECT_EQ(head->Blink, previous);
+    return values;
+}
+
+TEST_F(LinkedListTest, MergeSortList_EmptyAndSingle) {
+    MergeSortList(&ListHead, CompareByBucket, nullptr);
+    EXPECT_TRUE(IsListEmpty(&ListHead));
+
+    TestItem* item = CreateTestItem(5);
+    InsertTailList(&ListHead, &item->ListEntry);
+    MergeSortList(&ListHead, CompareByBucket, nullptr);
+    EXPECT_EQ(ListHead.Flink, &item->ListEntry);
+    EXPECT_EQ(ListHead.Blink, &item->ListEntry);
+}
+
+TEST_F(LinkedListTest, MergeSortList_SortsAndIsStable) {
+    std::mt19937 rng(7);
+    for (int count : { 2, 3, 17, 1000 }) {
+        InitializeListHead(&ListHead);
+        std::vector<int> expected;
+        for (int i = 0; i < count; i++) {
+            int value = (int)(rng() % 100) * 10 + (i % 10);  // Ties share a bucket
+            InsertTailList(&ListHead, &CreateTestItem(value)->ListEntry);
+            expected.push_back(value);
+        }
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](int a, int b) { return a / 10 < b / 10; });
+
+        int calls = 0;
+        MergeSortList(&ListHead, CompareByBucket, &calls);
+
+        EXPECT_EQ(CollectAndVerify(&ListHead), expected) << "count=" << count;
+        EXPECT_GT(calls, 0);
+    }
+}
+
+TEST_F(LinkedListTest, MergeSortList_AlreadySortedAndReversed) {
+    for (int i = 0; i < 64; i++) {
+        InsertHeadList(&ListHead, &CreateTestItem(i * 10)->ListEntry);
+    }
+    MergeSortList(&ListHead, CompareByBucket, nullptr);
+    std::vector<int> values = CollectAndVerify(&ListHead);
+    ASSERT_EQ(values.size(), 64u);
+    EXPECT_TRUE(std::is_sorted(values.begin(), values.end()));
+
+    MergeSortList(&ListHead, CompareByBucket, nullptr);
+    EXPECT_EQ(CollectAndVerify(&ListHead), values);
+}
+
+TEST_F(LinkedListTest, MergeSortedLists_InterleavesAndEmptiesSource) {
+    LIST_ENTRY otherList;
+    InitializeListHead(&otherList);
+
+    for (int value : { 10, 30, 50, 51 }) {
+        InsertTailList(&ListHead, &CreateTestItem(value)->ListEntry);
+    }
+    for (int value : { 0, 31, 52, 90 }) {
+        InsertTailList(&otherList, &CreateTestItem(value)->ListEntry);
+    }
+
+    MergeSortedLists(&ListHead, &otherList, CompareByBucket, nullptr);
+
+    // Equal buckets keep ListHead entries first
+    std::vector<int> expected = { 0, 10, 30, 31, 50, 51, 52, 90 };
+    EXPECT_EQ(CollectAndVerify(&ListHead), expected);
+    EXPECT_TRUE(IsListEmpty(&otherList));
+}
+
+TEST_F(LinkedListTest, MergeSortedLists_EmptyCases) {
+    LIST_ENTRY otherList;
+    InitializeListHead(&otherList);
+
+    MergeSortedLists(&ListHead, &otherList, CompareByBucket, nullptr);
+    EXPECT_TRUE(IsListEmpty(&ListHead));
+
+    InsertTailList(&otherList, &CreateTestItem(20)->ListEntry);
+    InsertTailList(&otherList, &CreateTestItem(40)->ListEntry);
+    MergeSortedLists(&ListHead, &otherList, CompareByBucket, nullptr);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 20, 40 }));
+    EXPECT_TRUE(IsListEmpty(&otherList));
+
+    MergeSortedLists(&ListHead, &otherList, CompareByBucket, nullptr);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 20, 40 }));
+}
+
+TEST_F(LinkedListTest, SpliceListTail_ReinitializesSource) {
+    LIST_ENTRY otherList;
+    InitializeListHead(&otherList);
+
+    SpliceListTail(&ListHead, &otherList);
+    EXPECT_TRUE(IsListEmpty(&ListHead));
+    EXPECT_TRUE(IsListEmpty(&otherList));
+
+    InsertTailList(&ListHead, &CreateTestItem(1)->ListEntry);
+    InsertTailList(&otherList, &CreateTestItem(2)->ListEntry);
+    InsertTailList(&otherList, &CreateTestItem(3)->ListEntry);
+
+    SpliceListTail(&ListHead, &otherList);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 1, 2, 3 }));
+    EXPECT_TRUE(IsListEmpty(&otherList));
+
+    // The source head is immediately reusable
+    InsertTailList(&otherList, &CreateTestItem(4)->ListEntry);
+    EXPECT_EQ(CollectAndVerify(&otherList), std::vector<int>({ 4 }));
+}
+
+TEST_F(LinkedListTest, SpliceListHead_PrependsInOrder) {
+    LIST_ENTRY otherList;
+    InitializeListHead(&otherList);
+
+    InsertTailList(&ListHead, &CreateTestItem(3)->ListEntry);
+    InsertTailList(&otherList, &CreateTestItem(1)->ListEntry);
+    InsertTailList(&otherList, &CreateTestItem(2)->ListEntry);
+
+    SpliceListHead(&ListHead, &otherList);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 1, 2, 3 }));
+    EXPECT_TRUE(IsListEmpty(&otherList));
+
+    SpliceListHead(&otherList, &ListHead);
+    EXPECT_EQ(CollectAndVerify(&otherList), std::vector<int>({ 1, 2, 3 }));
+    EXPECT_TRUE(IsListEmpty(&ListHead));
+}
+
+TEST_F(LinkedListTest, MoveListRange_BetweenLists) {
+    LIST_ENTRY otherList;
+    InitializeListHead(&otherList);
+    TestItem* entries[6];
+
+    for (int i = 0; i < 6; i++) {
+        entries[i] = CreateTestItem(i);
+        InsertTailList(&ListHead, &entries[i]->ListEntry);
+    }
+    InsertTailList(&otherList, &CreateTestItem(10)->ListEntry);
+
+    MoveListRangeTail(&otherList, &entries[1]->ListEntry, &entries[3]->ListEntry);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 0, 4, 5 }));
+    EXPECT_EQ(CollectAndVerify(&otherList), std::vector<int>({ 10, 1, 2, 3 }));
+
+    MoveListRangeHead(&otherList, &entries[5]->ListEntry, &entries[5]->ListEntry);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 0, 4 }));
+    EXPECT_EQ(CollectAndVerify(&otherList), std::vector<int>({ 5, 10, 1, 2, 3 }));
+
+    MoveListRangeTail(&otherList, &entries[0]->ListEntry, &entries[4]->ListEntry);
+    EXPECT_TRUE(IsListEmpty(&ListHead));
+    EXPECT_EQ(CollectAndVerify(&otherList), std::vector<int>({ 5, 10, 1, 2, 3, 0, 4 }));
+}
+
+TEST_F(LinkedListTest, MoveListRange_WithinSameList) {
+    TestItem* entries[5];
+
+    for (int i = 0; i < 5; i++) {
+        entries[i] = CreateTestItem(i);
+        InsertTailList(&ListHead, &entries[i]->ListEntry);
+    }
+
+    MoveListRangeTail(&ListHead, &entries[0]->ListEntry, &entries[1]->ListEntry);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 2, 3, 4, 0, 1 }));
+
+    MoveListRangeHead(&ListHead, &entries[0]->ListEntry, &entries[1]->ListEntry);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 0, 1, 2, 3, 4 }));
+
+    // Moving the leading run to the head is a no-op
+    MoveListRangeHead(&ListHead, &entries[0]->ListEntry, &entries[2]->ListEntry);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 0, 1, 2, 3, 4 }));
+}
+
+TEST_F(LinkedListTest, RemoveListRange_KeepsRunLinked) {
+    TestItem* entries[4];
+
+    for (int i = 0; i < 4; i++) {
+        entries[i] = CreateTestItem(i);
+        InsertTailList(&ListHead, &entries[i]->ListEntry);
+    }
+
+    RemoveListRange(&entries[1]->ListEntry, &entries[2]->ListEntry);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 0, 3 }));
+    EXPECT_EQ(entries[1]->ListEntry.Flink, &entries[2]->ListEntry);
+    EXPECT_EQ(entries[2]->ListEntry.Blink, &entries[1]->ListEntry);
+}
+
+TEST_F(LinkedListTest, SplitListAtEntry_Cases) {
+    LIST_ENTRY tailList;
+    TestItem* entries[4];
+
+    for (int i = 0; i < 4; i++) {
+        entries[i] = CreateTestItem(i);
+        InsertTailList(&ListHead, &entries[i]->ListEntry);
+    }
+
+    SplitListAtEntry(&ListHead, &entries[2]->ListEntry, &tailList);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 0, 1 }));
+    EXPECT_EQ(CollectAndVerify(&tailList), std::vector<int>({ 2, 3 }));
+
+    // Splitting at the head moves nothing
+    SplitListAtEntry(&ListHead, &ListHead, &tailList);
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 0, 1 }));
+    EXPECT_TRUE(IsListEmpty(&tailList));
+
+    // Splitting at the first entry moves everything
+    SplitListAtEntry(&ListHead, &entries[0]->ListEntry, &tailList);
+    EXPECT_TRUE(IsListEmpty(&ListHead));
+    EXPECT_EQ(CollectAndVerify(&tailList), std::vector<int>({ 0, 1 }));
+}
+
+TEST_F(LinkedListTest, ListIterator_VisitsAllAndAllowsRemoval) {
+    LIST_ITERATOR iterator;
+    PLIST_ENTRY entry;
+
+    InitializeListIterator(&iterator, &ListHead);
+    EXPECT_EQ(ListIteratorNext(&iterator), nullptr);
+
+    for (int i = 0; i < 6; i++) {
+        InsertTailList(&ListHead, &CreateTestItem(i)->ListEntry);
+    }
+
+    std::vector<int> visited;
+    InitializeListIterator(&iterator, &ListHead);
+    while ((entry = ListIteratorNext(&iterator)) != NULL) {
+        int value = CONTAINING_RECORD(entry, TestItem, ListEntry)->Value;
+        visited.push_back(value);
+        if (value % 2 == 0) {
+            RemoveEntryList(entry);
+        }
+    }
+
+    EXPECT_EQ(visited, std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(CollectAndVerify(&ListHead), std::vector<int>({ 1, 3, 5 }));
+    EXPECT_EQ(ListIteratorNext(&iterator), nullptr);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+#include "../include/Lookaside.h"
+
+class LookasideTest : public ::testing::Test {
+protected:
+    NPAGED_LOOKASIDE_LIST Lookaside;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+    }
+
+    void TearDown() override {
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+};
+
+static LONG g_CustomAllocations = 0;
+static LONG g_CustomFrees = 0;
+
+static PVOID CustomAllocate(POOL_TYPE PoolType, SIZE_T NumberOfBytes, ULONG Tag) {
+    EXPECT_EQ(Tag, (ULONG)'tseT');
+    g_CustomAllocations++;
+    return ExAllocatePoolTracked(PoolType, NumberOfBytes);
+}
+
+static VOID CustomFree(PVOID Buffer) {
+    g_CustomFrees++;
+    ExFreePool(Buffer);
+}
+
+TEST_F(LookasideTest, Initialize_AppliesDefaults) {
+    ExInitializeNPagedLookasideList(&Lookaside, NULL, NULL, 0, 1, 0, 0);
+    EXPECT_EQ(Lookaside.Depth, LOOKASIDE_DEFAULT_DEPTH);
+    EXPECT_EQ(Lookaside.Size, sizeof(SLIST_ENTRY));
+    ExDeleteNPagedLookasideList(&Lookaside);
+}
+
+TEST_F(LookasideTest, FreedBlocksAreReused) {
+    ExInitializeNPagedLookasideList(&Lookaside, NULL, NULL, 0, 64, 0, 4);
+
+    PVOID first = ExAllocateFromNPagedLookasideList(&Lookaside);
+    ASSERT_NE(first, nullptr);
+    ExFreeToNPagedLookasideList(&Lookaside, first);
+
+    PVOID second = ExAllocateFromNPagedLookasideList(&Lookaside);
+    EXPECT_EQ(second, first);
+    EXPECT_EQ(Lookaside.TotalAllocates, 2u);
+    EXPECT_EQ(Lookaside.AllocateMisses, 1u);
+
+    ExFreeToNPagedLookasideList(&Lookaside, second);
+    ExDeleteNPagedLookasideList(&Lookaside);
+}
+
+TEST_F(LookasideTest, DepthBoundsTheCache) {
+    g_CustomAllocations = 0;
+    g_CustomFrees = 0;
+    ExInitializeNPagedLookasideList(&Lookaside, CustomAllocate, CustomFree, 0, 32, 'tseT', 3);
+
+    std::vector<PVOID> blocks;
+    for (int i = 0; i < 5; i++) {
+        blocks.push_back(ExAllocateFromNPagedLookasideList(&Lookaside));
+        ASSERT_NE(blocks.back(), nullptr);
+    }
+    EXPECT_EQ(std::set<PVOID>(blocks.begin(), blocks.end()).size(), 5u);
+    EXPECT_EQ(g_CustomAllocations, 5);
+
+    for (PVOID block : blocks) {
+        ExFreeToNPagedLookasideList(&Lookaside, block);
+    }
+    // Three blocks are cached, the other two go straight back to the pool
+    EXPECT_EQ(g_CustomFrees, 2);
+    EXPECT_EQ(Lookaside.FreeMisses, 2u);
+    EXPECT_EQ(QueryDepthSList(&Lookaside.ListHead), 3);
+
+    ExDeleteNPagedLookasideList(&Lookaside);
+    EXPECT_EQ(g_CustomFrees, 5);
+}
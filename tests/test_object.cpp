@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../include/Object.h"
+
+#define TEST_OBJECT_TAG 'jbOT'
+
+struct TestObject {
+    ULONG Value;
+    std::atomic<int>* Deleted;
+};
+
+static VOID DeleteTestObject(PVOID Object) {
+    TestObject* object = static_cast<TestObject*>(Object);
+    if (object->Deleted != nullptr) {
+        (*object->Deleted)++;
+    }
+}
+
+class ObjectTest : public ::testing::Test {
+protected:
+    POBJECT_TYPE ObjectType = nullptr;
+    std::atomic<int> Deleted{0};
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+    }
+
+    void TearDown() override {
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+
+    void CreateType(PEX_WORK_QUEUE DeferredDeleteQueue) {
+        OBJECT_TYPE_INITIALIZER initializer = {};
+        initializer.PoolType = NonPagedPool;
+        initializer.PoolTag = TEST_OBJECT_TAG;
+        initializer.DeleteProcedure = DeleteTestObject;
+        initializer.DeferredDeleteQueue = DeferredDeleteQueue;
+        ASSERT_EQ(ObCreateObjectType("TestObject", &initializer, &ObjectType), STATUS_SUCCESS);
+    }
+
+    TestObject* CreateObject(ULONG value) {
+        PVOID object = nullptr;
+        EXPECT_EQ(ObCreateObject(ObjectType, sizeof(TestObject), &object), STATUS_SUCCESS);
+        TestObject* typed = static_cast<TestObject*>(object);
+        if (typed != nullptr) {
+            typed->Value = value;
+            typed->Deleted = &Deleted;
+        }
+        return typed;
+    }
+};
+
+TEST_F(ObjectTest, CreateType_RejectsInvalidParameters) {
+    OBJECT_TYPE_INITIALIZER initializer = {};
+    POBJECT_TYPE type = reinterpret_cast<POBJECT_TYPE>(1);
+
+    EXPECT_EQ(ObCreateObjectType(nullptr, &initializer, &type), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(type, nullptr);
+    EXPECT_EQ(ObCreateObjectType("Type", nullptr, &type), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(ObCreateObjectType("Type", &initializer, nullptr), STATUS_INVALID_PARAMETER);
+}
+
+TEST_F(ObjectTest, CreateObject_StartsWithOneReferenceAndZeroedBody) {
+    CreateType(nullptr);
+    PVOID object = nullptr;
+
+    ASSERT_EQ(ObCreateObject(ObjectType, 64, &object), STATUS_SUCCESS);
+    EXPECT_EQ(OBJECT_TO_OBJECT_HEADER(object)->PointerCount, 1);
+    EXPECT_EQ(ObGetObjectType(object), ObjectType);
+    EXPECT_EQ((ULONG_PTR)object % sizeof(ULONGLONG), 0u);
+    for (int i = 0; i < 64; i++) {
+        EXPECT_EQ(static_cast<PUCHAR>(object)[i], 0);
+    }
+    EXPECT_EQ(ObjectType->TotalNumberOfObjects, 1);
+
+    EXPECT_EQ(ObDereferenceObject(object), 0);
+    EXPECT_EQ(ObjectType->TotalNumberOfObjects, 0);
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 0u);
+}
+
+TEST_F(ObjectTest, LastDereferenceRunsDeleteProcedure) {
+    CreateType(nullptr);
+    TestObject* object = CreateObject(7);
+    ASSERT_NE(object, nullptr);
+
+    EXPECT_EQ(ObReferenceObject(object), 2);
+    EXPECT_EQ(ObReferenceObject(object), 3);
+    EXPECT_EQ(ObDereferenceObject(object), 2);
+    EXPECT_EQ(ObDereferenceObject(object), 1);
+    EXPECT_EQ(Deleted.load(), 0);
+
+    EXPECT_EQ(ObDereferenceObject(object), 0);
+    EXPECT_EQ(Deleted.load(), 1);
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 0u);
+}
+
+TEST_F(ObjectTest, ReferenceObjectSafe_FailsOnceCountReachedZero) {
+    CreateType(nullptr);
+    TestObject* object = CreateObject(1);
+    ASSERT_NE(object, nullptr);
+
+    ASSERT_TRUE(ObReferenceObjectSafe(object));
+    EXPECT_EQ(OBJECT_TO_OBJECT_HEADER(object)->PointerCount, 2);
+    ObDereferenceObject(object);
+
+    // Hold the memory past the final dereference by deferring the delete
+    EXPECT_EQ(ObDereferenceObjectDeferDelete(object), 0);
+    EXPECT_FALSE(ObReferenceObjectSafe(object));
+    EXPECT_EQ(Deleted.load(), 0);
+
+    ObFlushDeferredDeletes(ObjectType);
+    EXPECT_EQ(Deleted.load(), 1);
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 0u);
+}
+
+TEST_F(ObjectTest, TypeCountsLiveObjectsAndHighWater) {
+    CreateType(nullptr);
+    TestObject* objects[5];
+
+    for (int i = 0; i < 5; i++) {
+        objects[i] = CreateObject(i);
+        ASSERT_NE(objects[i], nullptr);
+    }
+    EXPECT_EQ(ObjectType->TotalNumberOfObjects, 5);
+
+    for (int i = 0; i < 3; i++) {
+        ObDereferenceObject(objects[i]);
+    }
+    EXPECT_EQ(ObjectType->TotalNumberOfObjects, 2);
+    EXPECT_EQ(ObjectType->HighWaterNumberOfObjects, 5);
+
+    ObDereferenceObject(objects[3]);
+    ObDereferenceObject(objects[4]);
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 0u);
+}
+
+TEST_F(ObjectTest, ObjectsAreChargedToTheTypePoolTag) {
+    CreateType(nullptr);
+    SIZE_T allocations = 0;
+    SIZE_T bytes = 0;
+
+    TestObject* first = CreateObject(1);
+    TestObject* second = CreateObject(2);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+
+    ExQueryPoolTagUsage(TEST_OBJECT_TAG, &allocations, &bytes);
+    EXPECT_EQ(allocations, 2u);
+    EXPECT_EQ(bytes, 2 * (FIELD_OFFSET(OBJECT_HEADER, Body) + sizeof(TestObject)));
+
+    ObDereferenceObject(first);
+    ObDereferenceObject(second);
+    ExQueryPoolTagUsage(TEST_OBJECT_TAG, &allocations, &bytes);
+    EXPECT_EQ(allocations, 0u);
+    EXPECT_EQ(bytes, 0u);
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 0u);
+}
+
+TEST_F(ObjectTest, DeleteObjectType_ReportsLeakedObjects) {
+    CreateType(nullptr);
+    TestObject* leaked = CreateObject(1);
+    TestObject* released = CreateObject(2);
+    ASSERT_NE(leaked, nullptr);
+    ObDereferenceObject(released);
+
+    EXPECT_EQ(ObPrintObjectLeaks(ObjectType), 1u);
+
+    SetErrorSuppression(TRUE);
+    POBJECT_HEADER header = OBJECT_TO_OBJECT_HEADER(leaked);
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 1u);
+    SetErrorSuppression(FALSE);
+
+    // The leaked object is left to the allocator's report; free it so the fixture stays clean
+    ExFreePool(header);
+}
+
+TEST_F(ObjectTest, DeferDelete_WithoutQueueWaitsForFlush) {
+    CreateType(nullptr);
+    TestObject* objects[4];
+
+    for (int i = 0; i < 4; i++) {
+        objects[i] = CreateObject(i);
+        ASSERT_NE(objects[i], nullptr);
+        EXPECT_EQ(ObDereferenceObjectDeferDelete(objects[i]), 0);
+    }
+    EXPECT_EQ(Deleted.load(), 0);
+    EXPECT_EQ(ObjectType->TotalNumberOfObjects, 4);
+
+    ObFlushDeferredDeletes(ObjectType);
+    EXPECT_EQ(Deleted.load(), 4);
+    EXPECT_EQ(ObjectType->TotalNumberOfObjects, 0);
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 0u);
+}
+
+TEST_F(ObjectTest, DeferDelete_RunsOnWorkQueue) {
+    EX_WORK_QUEUE workQueue;
+    ASSERT_EQ(ExInitializeWorkQueue(&workQueue, 2), STATUS_SUCCESS);
+    CreateType(&workQueue);
+
+    const int count = 100;
+    for (int i = 0; i < count; i++) {
+        TestObject* object = CreateObject(i);
+        ASSERT_NE(object, nullptr);
+        ObDereferenceObjectDeferDelete(object);
+    }
+
+    ExFlushWorkQueue(&workQueue);
+    EXPECT_EQ(Deleted.load(), count);
+    EXPECT_EQ(ObjectType->TotalNumberOfObjects, 0);
+
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 0u);
+    ExRundownWorkQueue(&workQueue);
+}
+
+TEST_F(ObjectTest, SharedByManyThreads_DeletedExactlyOnce) {
+    EX_WORK_QUEUE workQueue;
+    ASSERT_EQ(ExInitializeWorkQueue(&workQueue, 2), STATUS_SUCCESS);
+    CreateType(&workQueue);
+
+    const int threads = 4;
+    const int rounds = 200;
+    for (int round = 0; round < rounds; round++) {
+        TestObject* object = CreateObject(round);
+        ASSERT_NE(object, nullptr);
+
+        std::vector<std::thread> holders;
+        for (int t = 0; t < threads; t++) {
+            ObReferenceObject(object);
+            holders.emplace_back([object, t]() {
+                if (t % 2 == 0) {
+                    ObDereferenceObject(object);
+                } else {
+                    ObDereferenceObjectDeferDelete(object);
+                }
+            });
+        }
+        ObDereferenceObject(object);
+        for (auto& holder : holders) {
+            holder.join();
+        }
+    }
+
+    ExFlushWorkQueue(&workQueue);
+    EXPECT_EQ(Deleted.load(), rounds);
+    EXPECT_EQ(ObDeleteObjectType(ObjectType), 0u);
+    ExRundownWorkQueue(&workQueue);
+}
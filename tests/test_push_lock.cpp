@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../include/PushLock.h"
+
+class PushLockTest : public ::testing::Test {
+protected:
+    EX_PUSH_LOCK PushLock;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+        ExInitializePushLock(&PushLock);
+    }
+
+    void TearDown() override {
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+};
+
+TEST_F(PushLockTest, IsPointerSized) {
+    EXPECT_EQ(sizeof(EX_PUSH_LOCK), sizeof(PVOID));
+    EXPECT_EQ(PushLock.Value, 0u);
+}
+
+TEST_F(PushLockTest, SharedOwnersCoexist) {
+    ExAcquirePushLockShared(&PushLock);
+    ASSERT_TRUE(ExTryAcquirePushLockShared(&PushLock));
+    EXPECT_FALSE(ExTryAcquirePushLockExclusive(&PushLock));
+
+    ExReleasePushLockShared(&PushLock);
+    EXPECT_FALSE(ExTryAcquirePushLockExclusive(&PushLock));
+    ExReleasePushLockShared(&PushLock);
+    EXPECT_EQ(PushLock.Value, 0u);
+}
+
+TEST_F(PushLockTest, ExclusiveExcludesEveryone) {
+    ExAcquirePushLockExclusive(&PushLock);
+    EXPECT_FALSE(ExTryAcquirePushLockShared(&PushLock));
+    EXPECT_FALSE(ExTryAcquirePushLockExclusive(&PushLock));
+    ExReleasePushLockExclusive(&PushLock);
+
+    ASSERT_TRUE(ExTryAcquirePushLockExclusive(&PushLock));
+    ExReleasePushLockExclusive(&PushLock);
+    EXPECT_EQ(PushLock.Value, 0u);
+}
+
+TEST_F(PushLockTest, WaitingWriterHoldsOffNewReaders) {
+    std::atomic<bool> writerDone(false);
+
+    ExAcquirePushLockShared(&PushLock);
+    std::thread writer([&]() {
+        ExAcquirePushLockExclusive(&PushLock);
+        writerDone = true;
+        ExReleasePushLockExclusive(&PushLock);
+    });
+
+    // Wait until the writer has given up spinning and gone to sleep
+    while ((ReadPointerAcquire(&PushLock.Ptr) == (PVOID)EX_PUSH_LOCK_SHARE_INC)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_NE(PushLock.Value & EX_PUSH_LOCK_WRITER_WAITING, 0u);
+    EXPECT_FALSE(ExTryAcquirePushLockShared(&PushLock));
+    EXPECT_FALSE(writerDone.load());
+
+    ExReleasePushLockShared(&PushLock);
+    writer.join();
+    EXPECT_TRUE(writerDone.load());
+    EXPECT_TRUE(ExTryAcquirePushLockShared(&PushLock));
+    ExReleasePushLockShared(&PushLock);
+}
+
+TEST_F(PushLockTest, Stress_ReadersSeeConsistentState) {
+    const int threads = 6;
+    const int iterations = 20000;
+    volatile LONG first = 0;
+    volatile LONG second = 0;
+    std::atomic<int> torn(0);
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < iterations; i++) {
+                if ((i + t) % 10 == 0) {
+                    ExAcquirePushLockExclusive(&PushLock);
+                    first = first + 1;
+                    second = second + 1;
+                    ExReleasePushLockExclusive(&PushLock);
+                } else {
+                    ExAcquirePushLockShared(&PushLock);
+                    if (first != second) {
+                        torn++;
+                    }
+                    ExReleasePushLockShared(&PushLock);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(first, threads * iterations / 10);
+    EXPECT_EQ(PushLock.Value, 0u);
+}
+
+TEST_F(PushLockTest, CacheAware_SlotsAreOnSeparateLines) {
+    EX_PUSH_LOCK_CACHE_AWARE cacheAware;
+    ASSERT_EQ(ExInitializeCacheAwarePushLock(&cacheAware, 4), STATUS_SUCCESS);
+    EXPECT_EQ(cacheAware.SlotCount, 4u);
+    for (ULONG i = 0; i < cacheAware.SlotCount; i++) {
+        EXPECT_EQ((ULONG_PTR)&cacheAware.Slots[i] % EX_PUSH_LOCK_CACHE_LINE, 0u) << i;
+    }
+    for (ULONG i = 1; i < cacheAware.SlotCount; i++) {
+        EXPECT_GE((ULONG_PTR)&cacheAware.Slots[i].Lock - (ULONG_PTR)&cacheAware.Slots[i - 1].Lock,
+                  (ULONG_PTR)EX_PUSH_LOCK_CACHE_LINE);
+    }
+    ExDeleteCacheAwarePushLock(&cacheAware);
+    EXPECT_EQ(cacheAware.Slots, nullptr);
+}
+
+TEST_F(PushLockTest, CacheAware_ExclusiveTakesEverySlot) {
+    EX_PUSH_LOCK_CACHE_AWARE cacheAware;
+    ASSERT_EQ(ExInitializeCacheAwarePushLock(&cacheAware, 3), STATUS_SUCCESS);
+
+    PEX_PUSH_LOCK slot = ExAcquireCacheAwarePushLockShared(&cacheAware);
+    EXPECT_NE(slot->Value & EX_PUSH_LOCK_SHARE_MASK, 0u);
+    ExReleaseCacheAwarePushLockShared(slot);
+
+    ExAcquireCacheAwarePushLockExclusive(&cacheAware);
+    for (ULONG i = 0; i < cacheAware.SlotCount; i++) {
+        EXPECT_FALSE(ExTryAcquirePushLockShared(&cacheAware.Slots[i].Lock));
+    }
+    ExReleaseCacheAwarePushLockExclusive(&cacheAware);
+    for (ULONG i = 0; i < cacheAware.SlotCount; i++) {
+        EXPECT_EQ(cacheAware.Slots[i].Lock.Value, 0u);
+    }
+
+    ExDeleteCacheAwarePushLock(&cacheAware);
+}
+
+TEST_F(PushLockTest, CacheAware_Stress) {
+    EX_PUSH_LOCK_CACHE_AWARE cacheAware;
+    const int threads = 4;
+    const int iterations = 10000;
+    volatile LONG first = 0;
+    volatile LONG second = 0;
+    std::atomic<int> torn(0);
+    std::vector<std::thread> workers;
+
+    ASSERT_EQ(ExInitializeCacheAwarePushLock(&cacheAware, 0), STATUS_SUCCESS);
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (int i = 0; i < iterations; i++) {
+                if ((i + t) % 20 == 0) {
+                    ExAcquireCacheAwarePushLockExclusive(&cacheAware);
+                    first = first + 1;
+                    second = second + 1;
+                    ExReleaseCacheAwarePushLockExclusive(&cacheAware);
+                } else {
+                    PEX_PUSH_LOCK slot = ExAcquireCacheAwarePushLockShared(&cacheAware);
+                    if (first != second) {
+                        torn++;
+                    }
+                    ExReleaseCacheAwarePushLockShared(slot);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_EQ(first, threads * iterations / 20);
+    ExDeleteCacheAwarePushLock(&cacheAware);
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../include/RingQueue.h"
+
+class RingQueueTest : public ::testing::Test {
+protected:
+    RING_QUEUE Queue;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+        ASSERT_EQ(RtlInitializeRingQueue(&Queue, 8), STATUS_SUCCESS);
+    }
+
+    void TearDown() override {
+        RtlDeleteRingQueue(&Queue);
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+
+    static PVOID ToItem(ULONG_PTR value) {
+        return (PVOID)value;
+    }
+};
+
+TEST_F(RingQueueTest, Initialize_RejectsBadCapacity) {
+    RING_QUEUE other;
+    EXPECT_EQ(RtlInitializeRingQueue(&other, 0), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlInitializeRingQueue(&other, 1), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlInitializeRingQueue(&other, 12), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(other.Slots, nullptr);
+}
+
+TEST_F(RingQueueTest, HotFieldsOnSeparateCacheLines) {
+    EXPECT_GE(FIELD_OFFSET(RING_QUEUE, DequeuePosition) - FIELD_OFFSET(RING_QUEUE, EnqueuePosition), 64);
+    EXPECT_GE(FIELD_OFFSET(RING_QUEUE, Slots) - FIELD_OFFSET(RING_QUEUE, DequeuePosition), 64);
+}
+
+TEST_F(RingQueueTest, FifoUntilFullThenEmpty) {
+    PVOID item = nullptr;
+    EXPECT_FALSE(RtlTryPopRingQueue(&Queue, &item));
+
+    for (ULONG_PTR i = 0; i < 8; i++) {
+        EXPECT_TRUE(RtlTryPushRingQueue(&Queue, ToItem(i)));
+    }
+    EXPECT_FALSE(RtlTryPushRingQueue(&Queue, ToItem(99)));
+
+    for (ULONG_PTR i = 0; i < 8; i++) {
+        ASSERT_TRUE(RtlTryPopRingQueue(&Queue, &item));
+        EXPECT_EQ(item, ToItem(i));
+    }
+    EXPECT_FALSE(RtlTryPopRingQueue(&Queue, &item));
+}
+
+TEST_F(RingQueueTest, WrapsAroundManyLaps) {
+    PVOID item = nullptr;
+    for (ULONG_PTR i = 0; i < 1000; i++) {
+        ASSERT_TRUE(RtlTryPushRingQueue(&Queue, ToItem(i)));
+        ASSERT_TRUE(RtlTryPushRingQueue(&Queue, ToItem(i + 5000)));
+        ASSERT_TRUE(RtlTryPopRingQueue(&Queue, &item));
+        ASSERT_TRUE(RtlTryPopRingQueue(&Queue, &item));
+        ASSERT_EQ(item, ToItem(i + 5000));
+    }
+}
+
+TEST_F(RingQueueTest, Batch_PartialWhenNearlyFull) {
+    PVOID items[10];
+    PVOID out[10];
+    for (ULONG_PTR i = 0; i < 10; i++) {
+        items[i] = ToItem(i + 1);
+    }
+
+    EXPECT_EQ(RtlTryPushRingQueueBatch(&Queue, items, 0), 0u);
+    EXPECT_EQ(RtlTryPushRingQueueBatch(&Queue, items, 3), 3u);
+    EXPECT_EQ(RtlTryPushRingQueueBatch(&Queue, items + 3, 7), 5u);
+    EXPECT_EQ(RtlTryPushRingQueueBatch(&Queue, items + 8, 2), 0u);
+
+    EXPECT_EQ(RtlTryPopRingQueueBatch(&Queue, out, 2), 2u);
+    EXPECT_EQ(out[0], items[0]);
+    EXPECT_EQ(out[1], items[1]);
+    EXPECT_EQ(RtlTryPopRingQueueBatch(&Queue, out, 10), 6u);
+    for (int i = 0; i < 6; i++) {
+        EXPECT_EQ(out[i], items[i + 2]);
+    }
+    EXPECT_EQ(RtlTryPopRingQueueBatch(&Queue, out, 10), 0u);
+}
+
+TEST_F(RingQueueTest, BlockingPop_TimesOutWhenEmpty) {
+    PVOID item = nullptr;
+    EXPECT_EQ(RtlPopRingQueue(&Queue, &item, 0), STATUS_TIMEOUT);
+    EXPECT_EQ(RtlPopRingQueue(&Queue, &item, 20), STATUS_TIMEOUT);
+    EXPECT_EQ(Queue.PopWaiters, 0);
+}
+
+TEST_F(RingQueueTest, BlockingPush_TimesOutWhenFull) {
+    for (ULONG_PTR i = 0; i < 8; i++) {
+        ASSERT_TRUE(RtlTryPushRingQueue(&Queue, ToItem(i)));
+    }
+    EXPECT_EQ(RtlPushRingQueue(&Queue, ToItem(8), 20), STATUS_TIMEOUT);
+    EXPECT_EQ(Queue.PushWaiters, 0);
+}
+
+TEST_F(RingQueueTest, BlockingPop_WokenByProducer) {
+    PVOID item = nullptr;
+    std::thread producer([this]() {
+        Sleep(30);
+        EXPECT_TRUE(RtlTryPushRingQueue(&Queue, ToItem(42)));
+    });
+
+    EXPECT_EQ(RtlPopRingQueue(&Queue, &item, INFINITE), STATUS_SUCCESS);
+    EXPECT_EQ(item, ToItem(42));
+    producer.join();
+}
+
+// Every push and pop of a minimal queue blocks, so each one races a claim
+// whose slot is not yet published; a wakeup lost to that race hangs here
+TEST_F(RingQueueTest, BlockingPushPop_MinimalCapacityNeverHangs) {
+    const ULONG_PTR kItems = 200000;
+    RING_QUEUE small;
+
+    ASSERT_EQ(RtlInitializeRingQueue(&small, 2), STATUS_SUCCESS);
+    std::thread producer([&small]() {
+        for (ULONG_PTR i = 1; i <= kItems; i++) {
+            ASSERT_EQ(RtlPushRingQueue(&small, ToItem(i), INFINITE), STATUS_SUCCESS);
+        }
+    });
+    for (ULONG_PTR i = 1; i <= kItems; i++) {
+        PVOID item = nullptr;
+        ASSERT_EQ(RtlPopRingQueue(&small, &item, INFINITE), STATUS_SUCCESS);
+        ASSERT_EQ(item, ToItem(i));
+    }
+    producer.join();
+
+    EXPECT_EQ(small.PushWaiters, 0);
+    EXPECT_EQ(small.PopWaiters, 0);
+    RtlDeleteRingQueue(&small);
+}
+
+TEST_F(RingQueueTest, MultiProducerMultiConsumer_DeliversEveryItemOnce) {
+    const int producers = 4;
+    const int consumers = 4;
+    const ULONG_PTR perProducer = 20000;
+    std::vector<std::atomic<int>> seen(producers * perProducer);
+    std::atomic<ULONG_PTR> received(0);
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            for (ULONG_PTR i = 0; i < perProducer; i++) {
+                // Offset by one so no item is NULL
+                ASSERT_EQ(RtlPushRingQueue(&Queue, ToItem(p * perProducer + i + 1), INFINITE), STATUS_SUCCESS);
+            }
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&, c]() {
+            PVOID batch[4];
+            while (received.load() < producers * perProducer) {
+                ULONG count = (c % 2) ? RtlTryPopRingQueueBatch(&Queue, batch, 4) : 0;
+                if (count == 0) {
+                    if (RtlPopRingQueue(&Queue, &batch[0], 10) != STATUS_SUCCESS) {
+                        continue;
+                    }
+                    count = 1;
+                }
+                for (ULONG i = 0; i < count; i++) {
+                    seen[(ULONG_PTR)batch[i] - 1]++;
+                }
+                received += count;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < seen.size(); i++) {
+        ASSERT_EQ(seen[i].load(), 1) << "item " << i;
+    }
+    PVOID item;
+    EXPECT_FALSE(RtlTryPopRingQueue(&Queue, &item));
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../include/Rundown.h"
+
+class RundownTest : public ::testing::Test {
+protected:
+    EX_RUNDOWN_REF RunRef;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+        ExInitializeRundownProtection(&RunRef);
+    }
+
+    void TearDown() override {
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+};
+
+TEST_F(RundownTest, AcquireAndRelease) {
+    ASSERT_TRUE(ExAcquireRundownProtection(&RunRef));
+    ASSERT_TRUE(ExAcquireRundownProtectionEx(&RunRef, 3));
+    EXPECT_EQ(RunRef.Count, 4 * EX_RUNDOWN_COUNT_INC);
+
+    ExReleaseRundownProtectionEx(&RunRef, 3);
+    ExReleaseRundownProtection(&RunRef);
+    EXPECT_EQ(RunRef.Count, 0u);
+}
+
+TEST_F(RundownTest, Wait_WithNoReferencesReturnsAtOnce) {
+    ExWaitForRundownProtectionRelease(&RunRef);
+    EXPECT_FALSE(ExAcquireRundownProtection(&RunRef));
+
+    ExReInitializeRundownProtection(&RunRef);
+    ASSERT_TRUE(ExAcquireRundownProtection(&RunRef));
+    ExReleaseRundownProtection(&RunRef);
+}
+
+TEST_F(RundownTest, Wait_BlocksUntilLastReleaseAndRefusesNewAcquires) {
+    std::atomic<bool> waitDone(false);
+
+    ASSERT_TRUE(ExAcquireRundownProtection(&RunRef));
+    ASSERT_TRUE(ExAcquireRundownProtection(&RunRef));
+
+    std::thread waiter([&]() {
+        ExWaitForRundownProtectionRelease(&RunRef);
+        waitDone = true;
+    });
+
+    while ((RunRef.Count & EX_RUNDOWN_ACTIVE) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_FALSE(ExAcquireRundownProtection(&RunRef));
+
+    ExReleaseRundownProtection(&RunRef);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(waitDone.load());
+
+    ExReleaseRundownProtection(&RunRef);
+    waiter.join();
+    EXPECT_TRUE(waitDone.load());
+    EXPECT_EQ(RunRef.Count, EX_RUNDOWN_ACTIVE);
+}
+
+TEST_F(RundownTest, RundownCompleted_FailsAcquires) {
+    ExRundownCompleted(&RunRef);
+    EXPECT_FALSE(ExAcquireRundownProtection(&RunRef));
+}
+
+TEST_F(RundownTest, Stress_NoAccessAfterRundown) {
+    const int threads = 4;
+    std::atomic<bool> tornDown(false);
+    std::atomic<int> accessesAfterTeardown(0);
+    std::atomic<int> accesses(0);
+    std::vector<std::thread> users;
+
+    for (int t = 0; t < threads; t++) {
+        users.emplace_back([&]() {
+            while (ExAcquireRundownProtection(&RunRef)) {
+                if (tornDown.load()) {
+                    accessesAfterTeardown++;
+                }
+                accesses++;
+                ExReleaseRundownProtection(&RunRef);
+            }
+        });
+    }
+
+    while (accesses.load() < 1000) {
+        std::this_thread::yield();
+    }
+    ExWaitForRundownProtectionRelease(&RunRef);
+    tornDown = true;
+
+    for (auto& user : users) {
+        user.join();
+    }
+    EXPECT_EQ(accessesAfterTeardown.load(), 0);
+}
+
+TEST_F(RundownTest, CacheAware_AcquireReleaseAndWait) {
+    EX_RUNDOWN_REF_CACHE_AWARE cacheAware;
+    ASSERT_EQ(ExInitializeRundownProtectionCacheAware(&cacheAware, 4), STATUS_SUCCESS);
+    EXPECT_EQ(cacheAware.Number, 4u);
+    for (ULONG i = 0; i < cacheAware.Number; i++) {
+        EXPECT_EQ((ULONG_PTR)&cacheAware.RunRefs[i] % EX_RUNDOWN_REF_CACHE_LINE, 0u) << i;
+    }
+    for (ULONG i = 1; i < cacheAware.Number; i++) {
+        EXPECT_GE((ULONG_PTR)&cacheAware.RunRefs[i].RunRef - (ULONG_PTR)&cacheAware.RunRefs[i - 1].RunRef,
+                  (ULONG_PTR)EX_RUNDOWN_REF_CACHE_LINE);
+    }
+
+    PEX_RUNDOWN_REF slot = ExAcquireRundownProtectionCacheAware(&cacheAware);
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot->Count, EX_RUNDOWN_COUNT_INC);
+
+    std::thread waiter([&]() {
+        ExWaitForRundownProtectionReleaseCacheAware(&cacheAware);
+    });
+    while ((slot->Count & EX_RUNDOWN_ACTIVE) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(ExAcquireRundownProtectionCacheAware(&cacheAware), nullptr);
+    ExReleaseRundownProtectionCacheAware(slot);
+    waiter.join();
+
+    for (ULONG i = 0; i < cacheAware.Number; i++) {
+        EXPECT_EQ(cacheAware.RunRefs[i].RunRef.Count, EX_RUNDOWN_ACTIVE);
+    }
+
+    ExReInitializeRundownProtectionCacheAware(&cacheAware);
+    slot = ExAcquireRundownProtectionCacheAware(&cacheAware);
+    ASSERT_NE(slot, nullptr);
+    ExReleaseRundownProtectionCacheAware(slot);
+
+    ExFreeRundownProtectionCacheAware(&cacheAware);
+    EXPECT_EQ(cacheAware.RunRefs, nullptr);
+}
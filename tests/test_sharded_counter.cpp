@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../include/KernelHeapAlloc.h"
+#include "../include/ShardedCounter.h"
+
+class ShardedCounterTest : public ::testing::Test {
+protected:
+    SHARDED_COUNTER Counter;
+
+    void SetUp() override {
+        RtlInitializeShardedCounter(&Counter);
+    }
+};
+
+TEST_F(ShardedCounterTest, SlotsAreOnSeparateLines) {
+    EXPECT_EQ(sizeof(SHARDED_COUNTER_SLOT), (size_t)SHARDED_COUNTER_CACHE_LINE);
+    EXPECT_EQ(sizeof(SHARDED_COUNTER), (size_t)SHARDED_COUNTER_SLOTS * SHARDED_COUNTER_CACHE_LINE);
+
+    // Padding alone only helps if each slot also starts a line
+    for (ULONG i = 0; i < SHARDED_COUNTER_SLOTS; i++) {
+        EXPECT_EQ((ULONG_PTR)&Counter.Slots[i] % SHARDED_COUNTER_CACHE_LINE, 0u) << i;
+    }
+
+    // Including counters embedded in pool-allocated structures
+    ASSERT_TRUE(InitHeap());
+    GLOBAL_STATE* state = GetGlobalState();
+    EXPECT_EQ((ULONG_PTR)&state->AllocationCount.Slots[0] % SHARDED_COUNTER_CACHE_LINE, 0u);
+    EXPECT_EQ((ULONG_PTR)&state->TotalBytesAllocated.Slots[0] % SHARDED_COUNTER_CACHE_LINE, 0u);
+    CleanupHeap();
+}
+
+TEST_F(ShardedCounterTest, StartsAtZero) {
+    EXPECT_EQ(RtlReadShardedCounter(&Counter), 0);
+}
+
+TEST_F(ShardedCounterTest, AddAndIncrement) {
+    RtlIncrementShardedCounter(&Counter);
+    RtlAddShardedCounter(&Counter, 41);
+    EXPECT_EQ(RtlReadShardedCounter(&Counter), 42);
+
+    RtlAddShardedCounter(&Counter, -50);
+    EXPECT_EQ(RtlReadShardedCounter(&Counter), -8);
+
+    RtlInitializeShardedCounter(&Counter);
+    EXPECT_EQ(RtlReadShardedCounter(&Counter), 0);
+}
+
+TEST_F(ShardedCounterTest, ConcurrentUpdatesAreNotLost) {
+    const int threads = 8;
+    const int iterations = 100000;
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < iterations; i++) {
+                RtlIncrementShardedCounter(&Counter);
+                RtlAddShardedCounter(&Counter, 2);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    EXPECT_EQ(RtlReadShardedCounter(&Counter), (LONG64)threads * iterations * 3);
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "../include/Timer.h"
+
+struct DpcRecord {
+    std::atomic<int> Count{0};
+    KEVENT Fired;
+};
+
+static VOID CountDpc(PKDPC, PVOID DeferredContext, PVOID, PVOID) {
+    DpcRecord* record = static_cast<DpcRecord*>(DeferredContext);
+    record->Count++;
+    KeSetEvent(&record->Fired, IO_NO_INCREMENT, FALSE);
+}
+
+class TimerTest : public ::testing::Test {
+protected:
+    KTIMER_TABLE TimerTable;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+        ASSERT_EQ(KeInitializeTimerTable(&TimerTable), STATUS_SUCCESS);
+    }
+
+    void TearDown() override {
+        KeDeleteTimerTable(&TimerTable);
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+
+    static LARGE_INTEGER RelativeMs(LONGLONG Milliseconds) {
+        LARGE_INTEGER DueTime;
+        DueTime.QuadPart = -Milliseconds * 10000;
+        return DueTime;
+    }
+
+    static NTSTATUS WaitMs(PVOID Object, LONGLONG Milliseconds) {
+        LARGE_INTEGER Timeout = RelativeMs(Milliseconds);
+        return KeWaitForSingleObject(Object, Executive, KernelMode, FALSE, &Timeout);
+    }
+};
+
+TEST_F(TimerTest, OneShot_RunsDpcAndSignals) {
+    KTIMER Timer;
+    KDPC Dpc;
+    DpcRecord record;
+    KeInitializeEvent(&record.Fired, NotificationEvent, FALSE);
+    KeInitializeTimer(&Timer, &TimerTable);
+    KeInitializeDpc(&Dpc, CountDpc, &record);
+
+    EXPECT_FALSE(KeSetTimer(&Timer, RelativeMs(20), &Dpc));
+    EXPECT_FALSE(KeReadStateTimer(&Timer));
+
+    ASSERT_EQ(WaitMs(&record.Fired, 5000), STATUS_SUCCESS);
+    EXPECT_TRUE(KeReadStateTimer(&Timer));
+    EXPECT_EQ(record.Count.load(), 1);
+    EXPECT_FALSE(KeCancelTimer(&Timer));
+}
+
+TEST_F(TimerTest, Wait_ReleasedAtExpiry) {
+    KTIMER Timer;
+    KeInitializeTimerEx(&Timer, SynchronizationTimer, &TimerTable);
+
+    KeSetTimer(&Timer, RelativeMs(10), NULL);
+    EXPECT_EQ(WaitMs(&Timer, 5000), STATUS_SUCCESS);
+
+    // A synchronization timer is reset by the wait it satisfies
+    EXPECT_FALSE(KeReadStateTimer(&Timer));
+    EXPECT_EQ(WaitMs(&Timer, 0), STATUS_TIMEOUT);
+}
+
+TEST_F(TimerTest, Cancel_PreventsExpiry) {
+    KTIMER Timer;
+    KDPC Dpc;
+    DpcRecord record;
+    KeInitializeEvent(&record.Fired, NotificationEvent, FALSE);
+    KeInitializeTimer(&Timer, &TimerTable);
+    KeInitializeDpc(&Dpc, CountDpc, &record);
+
+    KeSetTimer(&Timer, RelativeMs(50), &Dpc);
+    EXPECT_TRUE(KeCancelTimer(&Timer));
+    EXPECT_FALSE(KeCancelTimer(&Timer));
+
+    EXPECT_EQ(WaitMs(&record.Fired, 150), STATUS_TIMEOUT);
+    EXPECT_EQ(record.Count.load(), 0);
+    EXPECT_FALSE(KeReadStateTimer(&Timer));
+}
+
+TEST_F(TimerTest, SetAgain_ReplacesDueTime) {
+    KTIMER Timer;
+    KeInitializeTimer(&Timer, &TimerTable);
+
+    EXPECT_FALSE(KeSetTimer(&Timer, RelativeMs(60000), NULL));
+    EXPECT_TRUE(KeSetTimer(&Timer, RelativeMs(10), NULL));
+    EXPECT_EQ(WaitMs(&Timer, 5000), STATUS_SUCCESS);
+    EXPECT_EQ(TimerTable.TimerCount, 0u);
+}
+
+TEST_F(TimerTest, Periodic_FiresUntilCanceled) {
+    KTIMER Timer;
+    KDPC Dpc;
+    DpcRecord record;
+    KeInitializeEvent(&record.Fired, SynchronizationEvent, FALSE);
+    KeInitializeTimer(&Timer, &TimerTable);
+    KeInitializeDpc(&Dpc, CountDpc, &record);
+
+    KeSetTimerEx(&Timer, RelativeMs(5), 5, &Dpc);
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQ(WaitMs(&record.Fired, 5000), STATUS_SUCCESS);
+    }
+    EXPECT_TRUE(KeCancelTimer(&Timer));
+    EXPECT_GE(record.Count.load(), 5);
+}
+
+TEST_F(TimerTest, ManyTimers_AllExpire) {
+    const int count = 2000;
+    std::vector<KTIMER> timers(count);
+    KDPC Dpc;
+    DpcRecord record;
+    KeInitializeEvent(&record.Fired, NotificationEvent, FALSE);
+    KeInitializeDpc(&Dpc, CountDpc, &record);
+
+    for (int i = 0; i < count; i++) {
+        KeInitializeTimer(&timers[i], &TimerTable);
+        KeSetTimer(&timers[i], RelativeMs(1 + (i * 7919) % 150), &Dpc);
+    }
+
+    for (int waited = 0; record.Count.load() < count && waited < 5000; waited += 10) {
+        Sleep(10);
+    }
+    EXPECT_EQ(record.Count.load(), count);
+    EXPECT_EQ(TimerTable.TimerCount, 0u);
+}
+
+struct OrderRecord {
+    std::mutex Lock;
+    std::vector<int> Order;
+};
+
+struct OrderedDpc {
+    KDPC Dpc;
+    int Id;
+    OrderRecord* Record;
+};
+
+static VOID RecordOrderDpc(PKDPC Dpc, PVOID, PVOID, PVOID) {
+    OrderedDpc* ordered = CONTAINING_RECORD(Dpc, OrderedDpc, Dpc);
+    std::lock_guard<std::mutex> guard(ordered->Record->Lock);
+    ordered->Record->Order.push_back(ordered->Id);
+}
+
+TEST_F(TimerTest, Cascade_ExpiresEveryLevelAtItsDueTick) {
+    // Timers far enough out that the expiry thread does not reach them;
+    // the test drives the wheel forward itself. The last one is past the
+    // top level and starts on the overflow list.
+    const LONGLONG delays[] = { 3000, 60000, 600000, 20000000 };
+    const int count = sizeof(delays) / sizeof(delays[0]);
+    KTIMER timers[count];
+    OrderedDpc dpcs[count];
+    OrderRecord record;
+
+    for (int i = 0; i < count; i++) {
+        KeInitializeTimer(&timers[i], &TimerTable);
+        dpcs[i].Id = i;
+        dpcs[i].Record = &record;
+        KeInitializeDpc(&dpcs[i].Dpc, RecordOrderDpc, NULL);
+        KeSetTimer(&timers[i], RelativeMs(delays[i]), &dpcs[i].Dpc);
+    }
+    EXPECT_EQ(timers[0].Level, 1);
+    EXPECT_EQ(timers[1].Level, 2);
+    EXPECT_EQ(timers[2].Level, 3);
+    EXPECT_EQ(timers[3].Level, TIMER_OVERFLOW_LEVEL);
+
+    for (int i = 0; i < count; i++) {
+        KiExpireTimers(&TimerTable, timers[i].DueTime - 1);
+        EXPECT_TRUE(timers[i].Inserted) << i;
+        KiExpireTimers(&TimerTable, timers[i].DueTime);
+        EXPECT_FALSE(timers[i].Inserted) << i;
+        EXPECT_TRUE(KeReadStateTimer(&timers[i])) << i;
+    }
+
+    ASSERT_EQ(record.Order.size(), (size_t)count);
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(record.Order[i], i);
+    }
+    EXPECT_EQ(TimerTable.TimerCount, 0u);
+}
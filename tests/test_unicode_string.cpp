@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <string>
+#include <vector>
 #include "../include/UnicodeString.h"
 #include "../include/KernelHeapAlloc.h"
 
@@ -87,7 +89,7 @@ TEST_F(UnicodeStringTest, HeapAllocation_Tracking) {
 
     // Verify tracking after free
     ASSERT_EQ(state->CurrentBytesAllocated, (SIZE_T)0);
-    ASSERT_EQ(state->AllocationCount, (SIZE_T)1);  // Total count remains the same
+    ASSERT_EQ((SIZE_T)RtlReadShardedCounter(&state->AllocationCount), (SIZE_T)1);  // Total count remains the same
 }
 
 TEST_F(UnicodeStringTest, RtlDuplicateUnicodeString_NullTerminate) {
@@ -273,3 +275,991 @@ TEST_F(UnicodeStringTest, RtlDuplicateUnicodeString_StringTooLong) {
 
     ASSERT_EQ(status, STATUS_NAME_TOO_LONG);
 }
+
+static UNICODE_STRING VectorString(std::vector<WCHAR>& Text) {
+    UNICODE_STRING string;
+    string.Buffer = Text.data();
+    string.Length = (USHORT)(Text.size() * sizeof(WCHAR));
+    string.MaximumLength = string.Length;
+    return string;
+}
+
+TEST_F(UnicodeStringTest, RtlUpcaseUnicodeChar_Mappings) {
+    EXPECT_EQ(RtlUpcaseUnicodeChar(L'a'), L'A');
+    EXPECT_EQ(RtlUpcaseUnicodeChar(L'Z'), L'Z');
+    EXPECT_EQ(RtlUpcaseUnicodeChar(L'@'), L'@');
+    EXPECT_EQ(RtlUpcaseUnicodeChar(L'{'), L'{');
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0x00E9), 0x00C9);  // e acute
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0x00FF), 0x0178);  // y diaeresis
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0x0131), L'I');    // dotless i
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0x00DF), 0x00DF);  // sharp s has no single-unit upper case
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0x03C3), 0x03A3);  // sigma
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0x03C2), 0x03A3);  // final sigma
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0x0436), 0x0416);  // Cyrillic zhe
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0xFF41), 0xFF21);  // fullwidth a
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0xD801), 0xD801);  // surrogates pass through
+    EXPECT_EQ(RtlUpcaseUnicodeChar(0x4E2D), 0x4E2D);
+
+    EXPECT_EQ(RtlDowncaseUnicodeChar(L'A'), L'a');
+    EXPECT_EQ(RtlDowncaseUnicodeChar(0x00C9), 0x00E9);
+    EXPECT_EQ(RtlDowncaseUnicodeChar(0x0130), L'i');  // dotted capital I
+    EXPECT_EQ(RtlDowncaseUnicodeChar(0x03A3), 0x03C3);
+    EXPECT_EQ(RtlDowncaseUnicodeChar(0x2C6F), 0x0250);
+    EXPECT_EQ(RtlDowncaseUnicodeChar(0xFF21), 0xFF41);
+}
+
+TEST_F(UnicodeStringTest, RtlCompareUnicodeString_CaseSensitive) {
+    UNICODE_STRING abc = RTL_CONSTANT_STRING(L"abc");
+    UNICODE_STRING abd = RTL_CONSTANT_STRING(L"abd");
+    UNICODE_STRING ab = RTL_CONSTANT_STRING(L"ab");
+    UNICODE_STRING upper = RTL_CONSTANT_STRING(L"ABC");
+    UNICODE_STRING empty = RTL_CONSTANT_STRING(L"");
+
+    EXPECT_EQ(RtlCompareUnicodeString(&abc, &abc, FALSE), 0);
+    EXPECT_LT(RtlCompareUnicodeString(&abc, &abd, FALSE), 0);
+    EXPECT_GT(RtlCompareUnicodeString(&abd, &abc, FALSE), 0);
+    EXPECT_EQ(RtlCompareUnicodeString(&ab, &abc, FALSE), -(LONG)sizeof(WCHAR));
+    EXPECT_EQ(RtlCompareUnicodeString(&abc, &ab, FALSE), (LONG)sizeof(WCHAR));
+    EXPECT_GT(RtlCompareUnicodeString(&abc, &upper, FALSE), 0);
+    EXPECT_EQ(RtlCompareUnicodeString(&empty, &empty, FALSE), 0);
+    EXPECT_LT(RtlCompareUnicodeString(&empty, &abc, FALSE), 0);
+}
+
+TEST_F(UnicodeStringTest, RtlCompareUnicodeString_CaseInsensitive) {
+    UNICODE_STRING lower = RTL_CONSTANT_STRING(L"manufacturer \x00e9tude \x03c3\x03bf\x03c6\x03af\x03b1 \x0436\x0443\x043a");
+    UNICODE_STRING upper = RTL_CONSTANT_STRING(L"MANUFACTURER \x00c9TUDE \x03a3\x039f\x03a6\x038a\x0391 \x0416\x0423\x041a");
+    UNICODE_STRING dotless = RTL_CONSTANT_STRING(L"\x0131");
+    UNICODE_STRING capitalI = RTL_CONSTANT_STRING(L"I");
+    UNICODE_STRING bracket = RTL_CONSTANT_STRING(L"[");
+    UNICODE_STRING letterA = RTL_CONSTANT_STRING(L"a");
+
+    EXPECT_NE(RtlCompareUnicodeString(&lower, &upper, FALSE), 0);
+    EXPECT_EQ(RtlCompareUnicodeString(&lower, &upper, TRUE), 0);
+    EXPECT_EQ(RtlCompareUnicodeString(&dotless, &capitalI, TRUE), 0);
+
+    // Case-insensitive ordering uses the upper-case forms: '[' sorts after 'A'
+    EXPECT_GT(RtlCompareUnicodeString(&bracket, &letterA, TRUE), 0);
+    EXPECT_LT(RtlCompareUnicodeString(&bracket, &letterA, FALSE), 0);
+}
+
+TEST_F(UnicodeStringTest, RtlEqualUnicodeString_Basic) {
+    UNICODE_STRING serial1 = RTL_CONSTANT_STRING(L"SN-00A7f3-Rev.B");
+    UNICODE_STRING serial2 = RTL_CONSTANT_STRING(L"sn-00a7F3-rev.b");
+    UNICODE_STRING shorter = RTL_CONSTANT_STRING(L"SN-00A7f3-Rev.");
+
+    EXPECT_TRUE(RtlEqualUnicodeString(&serial1, &serial1, FALSE));
+    EXPECT_FALSE(RtlEqualUnicodeString(&serial1, &serial2, FALSE));
+    EXPECT_TRUE(RtlEqualUnicodeString(&serial1, &serial2, TRUE));
+    EXPECT_FALSE(RtlEqualUnicodeString(&serial1, &shorter, TRUE));
+}
+
+TEST_F(UnicodeStringTest, RtlPrefixUnicodeString_Basic) {
+    UNICODE_STRING prefix = RTL_CONSTANT_STRING(L"PCI\\VEN_8086");
+    UNICODE_STRING lowerPrefix = RTL_CONSTANT_STRING(L"pci\\ven_8086");
+    UNICODE_STRING hardwareId = RTL_CONSTANT_STRING(L"PCI\\VEN_8086&DEV_1533&SUBSYS_00008086");
+    UNICODE_STRING other = RTL_CONSTANT_STRING(L"PCI\\VEN_10DE&DEV_1B80");
+    UNICODE_STRING empty = RTL_CONSTANT_STRING(L"");
+
+    EXPECT_TRUE(RtlPrefixUnicodeString(&prefix, &hardwareId, FALSE));
+    EXPECT_FALSE(RtlPrefixUnicodeString(&lowerPrefix, &hardwareId, FALSE));
+    EXPECT_TRUE(RtlPrefixUnicodeString(&lowerPrefix, &hardwareId, TRUE));
+    EXPECT_FALSE(RtlPrefixUnicodeString(&prefix, &other, TRUE));
+    EXPECT_FALSE(RtlPrefixUnicodeString(&hardwareId, &prefix, FALSE));
+    EXPECT_TRUE(RtlPrefixUnicodeString(&empty, &prefix, FALSE));
+    EXPECT_TRUE(RtlPrefixUnicodeString(&prefix, &prefix, FALSE));
+}
+
+TEST_F(UnicodeStringTest, RtlCompareUnicodeString_MismatchAtEveryPosition) {
+    // Covers the vector loops, their remainders and the scalar tail
+    for (size_t length = 1; length <= 70; length++) {
+        std::vector<WCHAR> base(length);
+        for (size_t i = 0; i < length; i++) {
+            base[i] = (WCHAR)(L'a' + i % 26);
+        }
+        for (size_t position = 0; position < length; position++) {
+            std::vector<WCHAR> folded(base);
+            std::vector<WCHAR> changed(base);
+            folded[position] = RtlUpcaseUnicodeChar(base[position]);
+            changed[position] = (WCHAR)0x00E9;
+            UNICODE_STRING baseString = VectorString(base);
+            UNICODE_STRING foldedString = VectorString(folded);
+            UNICODE_STRING changedString = VectorString(changed);
+
+            ASSERT_LT(RtlCompareUnicodeString(&foldedString, &baseString, FALSE), 0) << length << " " << position;
+            ASSERT_TRUE(RtlEqualUnicodeString(&foldedString, &baseString, TRUE)) << length << " " << position;
+            ASSERT_EQ(RtlCompareUnicodeString(&baseString, &changedString, TRUE),
+                      (LONG)RtlUpcaseUnicodeChar(base[position]) - 0x00C9) << length << " " << position;
+            ASSERT_FALSE(RtlPrefixUnicodeString(&changedString, &baseString, TRUE)) << length << " " << position;
+        }
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlCompareUnicodeString_MatchesScalarReference) {
+    static const WCHAR alphabet[] = { L'a', L'A', L'z', L'Z', L'0', L'[', L'`', L'{', 0x00E9, 0x00C9, 0x0131, L'I',
+                                      L'i', 0x03C2, 0x03C3, 0x03A3, 0x0430, 0x0410, 0x8000, 0xFFFF };
+    unsigned seed = 12345;
+    auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return seed >> 16; };
+
+    for (int iteration = 0; iteration < 20000; iteration++) {
+        std::vector<WCHAR> text1(next() % 48);
+        std::vector<WCHAR> text2(next() % 48);
+        for (auto& unit : text1) unit = alphabet[next() % 20];
+        for (size_t i = 0; i < text2.size(); i++) {
+            // Mostly copy text1 so that long common prefixes are exercised
+            text2[i] = (i < text1.size() && next() % 8 != 0) ? text1[i] : alphabet[next() % 20];
+        }
+        UNICODE_STRING string1 = VectorString(text1);
+        UNICODE_STRING string2 = VectorString(text2);
+
+        for (int caseInSensitive = 0; caseInSensitive < 2; caseInSensitive++) {
+            LONG expected = (LONG)string1.Length - (LONG)string2.Length;
+            for (size_t i = 0; i < text1.size() && i < text2.size(); i++) {
+                WCHAR char1 = caseInSensitive ? RtlUpcaseUnicodeChar(text1[i]) : text1[i];
+                WCHAR char2 = caseInSensitive ? RtlUpcaseUnicodeChar(text2[i]) : text2[i];
+                if (char1 != char2) {
+                    expected = (LONG)char1 - (LONG)char2;
+                    break;
+                }
+            }
+            ASSERT_EQ(RtlCompareUnicodeString(&string1, &string2, (BOOLEAN)caseInSensitive), expected);
+        }
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlUpcaseUnicodeString_Allocate) {
+    UNICODE_STRING source = RTL_CONSTANT_STRING(L"usb\\vid_046d&pid_c52b \x00e9\x0436\x03c3 \x00df");
+    UNICODE_STRING expected = RTL_CONSTANT_STRING(L"USB\\VID_046D&PID_C52B \x00c9\x0416\x03a3 \x00df");
+    UNICODE_STRING dest = {0};
+
+    ASSERT_EQ(RtlUpcaseUnicodeString(&dest, &source, TRUE), STATUS_SUCCESS);
+    ASSERT_NE(dest.Buffer, source.Buffer);
+    EXPECT_EQ(dest.Length, source.Length);
+    EXPECT_EQ(dest.MaximumLength, source.Length);
+    EXPECT_TRUE(RtlEqualUnicodeString(&dest, &expected, FALSE));
+    EXPECT_GT(GetGlobalState()->CurrentBytesAllocated, 0u);
+
+    FreeUnicodeString(&dest);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlDowncaseUnicodeString_InPlace) {
+    WCHAR buffer[] = L"ACPI\\PNP0A08 \x00c9\x0416\x03a3 \x0130";
+    UNICODE_STRING string = RTL_CONSTANT_STRING(buffer);
+    UNICODE_STRING expected = RTL_CONSTANT_STRING(L"acpi\\pnp0a08 \x00e9\x0436\x03c3 i");
+
+    ASSERT_EQ(RtlDowncaseUnicodeString(&string, &string, FALSE), STATUS_SUCCESS);
+    EXPECT_EQ(string.Buffer, buffer);
+    EXPECT_TRUE(RtlEqualUnicodeString(&string, &expected, FALSE));
+}
+
+TEST_F(UnicodeStringTest, RtlUpcaseUnicodeString_CallerBuffer) {
+    UNICODE_STRING source = RTL_CONSTANT_STRING(L"serial-0042abcdef");
+    WCHAR buffer[32];
+    UNICODE_STRING dest;
+    dest.Buffer = buffer;
+    dest.Length = 0;
+    dest.MaximumLength = (USHORT)(source.Length - sizeof(WCHAR));
+
+    EXPECT_EQ(RtlUpcaseUnicodeString(&dest, &source, FALSE), STATUS_BUFFER_OVERFLOW);
+    EXPECT_EQ(dest.Length, 0);
+
+    dest.MaximumLength = sizeof(buffer);
+    ASSERT_EQ(RtlUpcaseUnicodeString(&dest, &source, FALSE), STATUS_SUCCESS);
+    EXPECT_EQ(dest.Length, source.Length);
+    EXPECT_TRUE(RtlEqualUnicodeString(&dest, &source, TRUE));
+    EXPECT_EQ(buffer[0], L'S');
+
+    UNICODE_STRING empty = RTL_CONSTANT_STRING(L"");
+    UNICODE_STRING allocated = {0};
+    ASSERT_EQ(RtlUpcaseUnicodeString(&allocated, &empty, TRUE), STATUS_SUCCESS);
+    EXPECT_EQ(allocated.Length, 0);
+}
+
+TEST_F(UnicodeStringTest, RtlChangeCaseUnicodeString_MatchesCharacterMappings) {
+    // Every BMP code unit, at every offset within a vector
+    std::vector<WCHAR> text(UNICODE_STRING_MAX_CHARS);
+    std::vector<WCHAR> upper(text.size());
+    std::vector<WCHAR> lower(text.size());
+
+    for (ULONG start = 0; start < 0x10000; start += (ULONG)text.size() - 5) {
+        for (size_t i = 0; i < text.size(); i++) {
+            text[i] = (WCHAR)(start + i);
+        }
+        UNICODE_STRING source = VectorString(text);
+        UNICODE_STRING upperString = VectorString(upper);
+        UNICODE_STRING lowerString = VectorString(lower);
+
+        ASSERT_EQ(RtlUpcaseUnicodeString(&upperString, &source, FALSE), STATUS_SUCCESS);
+        ASSERT_EQ(RtlDowncaseUnicodeString(&lowerString, &source, FALSE), STATUS_SUCCESS);
+        for (size_t i = 0; i < text.size(); i++) {
+            ASSERT_EQ(upper[i], RtlUpcaseUnicodeChar(text[i])) << std::hex << (ULONG)text[i];
+            ASSERT_EQ(lower[i], RtlDowncaseUnicodeChar(text[i])) << std::hex << (ULONG)text[i];
+        }
+    }
+}
+
+static ULONG ReferenceX65599(const std::vector<WCHAR>& Text, bool CaseInSensitive) {
+    ULONG hash = 0;
+    for (WCHAR unit : Text) {
+        hash = hash * 65599 + (USHORT)(CaseInSensitive ? RtlUpcaseUnicodeChar(unit) : unit);
+    }
+    return hash;
+}
+
+static ULONG HashOf(const std::vector<WCHAR>& Text, BOOLEAN CaseInSensitive, ULONG Algorithm) {
+    std::vector<WCHAR> copy(Text);
+    UNICODE_STRING string = VectorString(copy);
+    ULONG hash = 0;
+    EXPECT_EQ(RtlHashUnicodeString(&string, CaseInSensitive, Algorithm, &hash), STATUS_SUCCESS);
+    return hash;
+}
+
+TEST_F(UnicodeStringTest, RtlHashUnicodeString_X65599) {
+    UNICODE_STRING ab = RTL_CONSTANT_STRING(L"AB");
+    UNICODE_STRING lowerAb = RTL_CONSTANT_STRING(L"ab");
+    ULONG hash = 0;
+
+    ASSERT_EQ(RtlHashUnicodeString(&ab, FALSE, HASH_STRING_ALGORITHM_X65599, &hash), STATUS_SUCCESS);
+    EXPECT_EQ(hash, 65u * 65599u + 66u);
+    ASSERT_EQ(RtlHashUnicodeString(&lowerAb, TRUE, HASH_STRING_ALGORITHM_DEFAULT, &hash), STATUS_SUCCESS);
+    EXPECT_EQ(hash, 65u * 65599u + 66u);
+
+    // Lengths around the vector widths, with non-ASCII units in some lanes
+    for (size_t length = 0; length <= 300; length++) {
+        std::vector<WCHAR> text(length);
+        for (size_t i = 0; i < length; i++) {
+            text[i] = (i % 7 == 3) ? (WCHAR)(0x0430 + i % 32) : (WCHAR)(L'a' + i % 26);
+        }
+        ASSERT_EQ(HashOf(text, FALSE, HASH_STRING_ALGORITHM_X65599), ReferenceX65599(text, false)) << length;
+        ASSERT_EQ(HashOf(text, TRUE, HASH_STRING_ALGORITHM_X65599), ReferenceX65599(text, true)) << length;
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlHashUnicodeString_CaseInsensitiveMatchesUpcase) {
+    for (size_t length = 0; length <= 600; length += 7) {
+        std::vector<WCHAR> text(length);
+        std::vector<WCHAR> upper(length);
+        for (size_t i = 0; i < length; i++) {
+            text[i] = (i % 5 == 1) ? (WCHAR)(0x03B1 + i % 17) : (WCHAR)(L' ' + i % 95);
+        }
+        UNICODE_STRING source = VectorString(text);
+        UNICODE_STRING upperString = VectorString(upper);
+        ASSERT_EQ(RtlUpcaseUnicodeString(&upperString, &source, FALSE), STATUS_SUCCESS);
+
+        for (ULONG algorithm : { (ULONG)HASH_STRING_ALGORITHM_X65599, (ULONG)HASH_STRING_ALGORITHM_FAST }) {
+            EXPECT_EQ(HashOf(text, TRUE, algorithm), HashOf(upper, FALSE, algorithm)) << length;
+        }
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlHashUnicodeString_InvalidParameters) {
+    UNICODE_STRING string = RTL_CONSTANT_STRING(L"x");
+    ULONG hash;
+
+    EXPECT_EQ(RtlHashUnicodeString(nullptr, FALSE, HASH_STRING_ALGORITHM_X65599, &hash), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlHashUnicodeString(&string, FALSE, HASH_STRING_ALGORITHM_X65599, nullptr), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlHashUnicodeString(&string, FALSE, HASH_STRING_ALGORITHM_INVALID, &hash), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlHashUnicodeString(&string, FALSE, 3, &hash), STATUS_INVALID_PARAMETER);
+}
+
+static std::vector<WCHAR> DeviceKey(int Index) {
+    char key[64];
+    std::vector<WCHAR> text;
+    snprintf(key, sizeof(key), "USB\\VID_%04X&PID_%04X\\SN%06d", 0x046D + Index % 3, 0xC52B + Index % 5, Index);
+    for (const char* p = key; *p != '\0'; p++) {
+        text.push_back((WCHAR)*p);
+    }
+    return text;
+}
+
+TEST_F(UnicodeStringTest, RtlHashUnicodeString_FastDistribution) {
+    // Near-identical device keys should spread evenly over the low bits
+    const int keys = 1 << 17;
+    const int buckets = 1 << 12;
+    std::vector<int> counts(buckets);
+    std::vector<ULONG> hashes;
+
+    for (int i = 0; i < keys; i++) {
+        ULONG hash = HashOf(DeviceKey(i), FALSE, HASH_STRING_ALGORITHM_FAST);
+        counts[hash & (buckets - 1)]++;
+        hashes.push_back(hash);
+    }
+
+    // Chi-square with 4095 degrees of freedom: mean 4095, standard deviation about 90.5
+    double expected = (double)keys / buckets;
+    double chiSquare = 0;
+    for (int count : counts) {
+        chiSquare += (count - expected) * (count - expected) / expected;
+    }
+    EXPECT_LT(chiSquare, 4095 + 6 * 90.5);
+
+    // About keys^2 / 2^33 = 2 full 32-bit collisions are expected by chance
+    std::sort(hashes.begin(), hashes.end());
+    int collisions = 0;
+    for (size_t i = 1; i < hashes.size(); i++) {
+        collisions += hashes[i] == hashes[i - 1];
+    }
+    EXPECT_LE(collisions, 12);
+}
+
+TEST_F(UnicodeStringTest, RtlHashUnicodeString_FastAvalanche) {
+    // Flipping any single input bit should flip about half of the output bits
+    for (size_t length : { 1, 15, 16, 40, 300 }) {
+        std::vector<WCHAR> text(length);
+        for (size_t i = 0; i < length; i++) {
+            text[i] = (WCHAR)(L'A' + i % 26);
+        }
+        ULONG base = HashOf(text, FALSE, HASH_STRING_ALGORITHM_FAST);
+        double flipped = 0;
+        int trials = 0;
+
+        for (size_t unit = 0; unit < length; unit++) {
+            for (int bit = 0; bit < 16; bit++) {
+                text[unit] ^= (WCHAR)(1 << bit);
+                ULONG hash = HashOf(text, FALSE, HASH_STRING_ALGORITHM_FAST);
+                text[unit] ^= (WCHAR)(1 << bit);
+                ULONG diff = hash ^ base;
+                int bits = 0;
+                for (; diff != 0; diff &= diff - 1) {
+                    bits++;
+                }
+                EXPECT_GT(bits, 0) << length << " " << unit << " " << bit;
+                flipped += bits;
+                trials++;
+            }
+        }
+        EXPECT_NEAR(flipped / trials, 16.0, length == 1 ? 2.0 : 1.0) << length;
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlHashUnicodeString_FastDependsOnOrderAndLength) {
+    std::vector<WCHAR> text(600);
+    for (size_t i = 0; i < text.size(); i++) {
+        text[i] = (WCHAR)(L'a' + (i / 16) % 26);
+    }
+    ULONG base = HashOf(text, FALSE, HASH_STRING_ALGORITHM_FAST);
+
+    // Swap two whole 16-unit stripes, in the same block and across blocks
+    for (size_t other : { 16 * 5, 16 * 20 }) {
+        std::vector<WCHAR> swapped(text);
+        std::swap_ranges(swapped.begin() + 16, swapped.begin() + 32, swapped.begin() + other);
+        EXPECT_NE(HashOf(swapped, FALSE, HASH_STRING_ALGORITHM_FAST), base) << other;
+    }
+
+    // Trailing zero units are not lost in the padding of the last stripe
+    std::vector<WCHAR> shorter(5, L'x');
+    std::vector<WCHAR> padded(shorter);
+    padded.push_back(0);
+    EXPECT_NE(HashOf(shorter, FALSE, HASH_STRING_ALGORITHM_FAST), HashOf(padded, FALSE, HASH_STRING_ALGORITHM_FAST));
+    EXPECT_NE(HashOf(std::vector<WCHAR>(), FALSE, HASH_STRING_ALGORITHM_FAST),
+              HashOf(std::vector<WCHAR>(1, 0), FALSE, HASH_STRING_ALGORITHM_FAST));
+}
+
+TEST_F(UnicodeStringTest, RtlConstantString_Initializer) {
+    UNICODE_STRING string = RTL_CONSTANT_STRING(L"Device");
+    EXPECT_EQ(string.Length, 6 * sizeof(WCHAR));
+    EXPECT_EQ(string.MaximumLength, 7 * sizeof(WCHAR));
+    EXPECT_EQ(string.Buffer[0], L'D');
+
+    DECLARE_UNICODE_STRING_SIZE(path, 64);
+    EXPECT_EQ(path.Length, 0);
+    EXPECT_EQ(path.MaximumLength, 64 * sizeof(WCHAR));
+    EXPECT_EQ(path.Buffer, path_buffer);
+}
+
+TEST_F(UnicodeStringTest, RtlCopyUnicodeString_FitsAndTruncates) {
+    UNICODE_STRING source = RTL_CONSTANT_STRING(L"\\Device\\Harddisk0");
+    DECLARE_UNICODE_STRING_SIZE(large, 32);
+    DECLARE_UNICODE_STRING_SIZE(small, 7);
+
+    EXPECT_EQ(RtlCopyUnicodeString(&large, &source), STATUS_SUCCESS);
+    EXPECT_TRUE(RtlEqualUnicodeString(&large, &source, FALSE));
+    EXPECT_EQ(large_buffer[source.Length / sizeof(WCHAR)], UNICODE_NULL);
+
+    // Truncated to the whole buffer, without room for a terminator
+    EXPECT_EQ(RtlCopyUnicodeString(&small, &source), STATUS_BUFFER_TOO_SMALL);
+    EXPECT_EQ(small.Length, 7 * sizeof(WCHAR));
+    EXPECT_TRUE(RtlPrefixUnicodeString(&small, &source, FALSE));
+
+    EXPECT_EQ(RtlCopyUnicodeString(&large, nullptr), STATUS_SUCCESS);
+    EXPECT_EQ(large.Length, 0);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlAppendUnicodeStringToString_BuildsPath) {
+    UNICODE_STRING device = RTL_CONSTANT_STRING(L"\\Device\\");
+    UNICODE_STRING volume = RTL_CONSTANT_STRING(L"HarddiskVolume3");
+    UNICODE_STRING expected = RTL_CONSTANT_STRING(L"\\Device\\HarddiskVolume3\\Windows");
+    DECLARE_UNICODE_STRING_SIZE(path, 40);
+
+    ASSERT_EQ(RtlCopyUnicodeString(&path, &device), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeStringToString(&path, &volume), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeToString(&path, L"\\Windows"), STATUS_SUCCESS);
+    EXPECT_TRUE(RtlEqualUnicodeString(&path, &expected, FALSE));
+    EXPECT_EQ(path_buffer[path.Length / sizeof(WCHAR)], UNICODE_NULL);
+    EXPECT_EQ(RtlAppendUnicodeToString(&path, nullptr), STATUS_SUCCESS);
+    EXPECT_EQ(path.Length, expected.Length);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlAppendUnicodeStringToString_TooSmall) {
+    UNICODE_STRING tail = RTL_CONSTANT_STRING(L"5678");
+    DECLARE_UNICODE_STRING_SIZE(key, 8);
+
+    ASSERT_EQ(RtlAppendUnicodeToString(&key, L"1234"), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeStringToString(&key, &tail), STATUS_SUCCESS);
+    EXPECT_EQ(key.Length, key.MaximumLength);
+
+    // Exactly full: a further append fails and leaves the string unchanged
+    EXPECT_EQ(RtlAppendUnicodeToString(&key, L"9"), STATUS_BUFFER_TOO_SMALL);
+    EXPECT_EQ(RtlAppendUnicodeStringToString(&key, &tail), STATUS_BUFFER_TOO_SMALL);
+    EXPECT_EQ(key.Length, 8 * sizeof(WCHAR));
+    EXPECT_EQ(key_buffer[7], L'8');
+}
+
+TEST_F(UnicodeStringTest, RtlAppendUnicodeStringToString_Self) {
+    DECLARE_UNICODE_STRING_SIZE(string, 16);
+    ASSERT_EQ(RtlAppendUnicodeToString(&string, L"abc"), STATUS_SUCCESS);
+
+    UNICODE_STRING self = string;
+    ASSERT_EQ(RtlAppendUnicodeStringToString(&string, &self), STATUS_SUCCESS);
+    UNICODE_STRING expected = RTL_CONSTANT_STRING(L"abcabc");
+    EXPECT_TRUE(RtlEqualUnicodeString(&string, &expected, FALSE));
+}
+
+static std::string Utf8Of(ULONG CodePoint) {
+    std::string bytes;
+    if (CodePoint < 0x80) {
+        bytes += (char)CodePoint;
+    } else if (CodePoint < 0x800) {
+        bytes += (char)(0xC0 | (CodePoint >> 6));
+        bytes += (char)(0x80 | (CodePoint & 0x3F));
+    } else if (CodePoint < 0x10000) {
+        bytes += (char)(0xE0 | (CodePoint >> 12));
+        bytes += (char)(0x80 | ((CodePoint >> 6) & 0x3F));
+        bytes += (char)(0x80 | (CodePoint & 0x3F));
+    } else {
+        bytes += (char)(0xF0 | (CodePoint >> 18));
+        bytes += (char)(0x80 | ((CodePoint >> 12) & 0x3F));
+        bytes += (char)(0x80 | ((CodePoint >> 6) & 0x3F));
+        bytes += (char)(0x80 | (CodePoint & 0x3F));
+    }
+    return bytes;
+}
+
+static void AppendUtf16(std::vector<WCHAR>& Units, ULONG CodePoint) {
+    if (CodePoint < 0x10000) {
+        Units.push_back((WCHAR)CodePoint);
+    } else {
+        Units.push_back((WCHAR)(0xD800 + ((CodePoint - 0x10000) >> 10)));
+        Units.push_back((WCHAR)(0xDC00 + (CodePoint & 0x3FF)));
+    }
+}
+
+static NTSTATUS ToUtf16(const std::string& Utf8, std::vector<WCHAR>& Units) {
+    ULONG bytes = 0;
+    NTSTATUS status = RtlUTF8ToUnicodeN(nullptr, 0, &bytes, Utf8.data(), (ULONG)Utf8.size());
+    EXPECT_TRUE(NT_SUCCESS(status));
+    // One spare unit: the conversion must not write past what it reports
+    Units.assign(bytes / sizeof(WCHAR) + 1, (WCHAR)0x5A5A);
+    ULONG written = 0;
+    NTSTATUS converted = RtlUTF8ToUnicodeN(Units.data(), bytes, &written, Utf8.data(), (ULONG)Utf8.size());
+    EXPECT_EQ(converted, status);
+    EXPECT_EQ(written, bytes);
+    EXPECT_EQ(Units.back(), (WCHAR)0x5A5A);
+    Units.pop_back();
+    return converted;
+}
+
+static NTSTATUS ToUtf8(const std::vector<WCHAR>& Units, std::string& Utf8) {
+    ULONG bytes = 0;
+    ULONG const sourceBytes = (ULONG)(Units.size() * sizeof(WCHAR));
+    NTSTATUS status = RtlUnicodeToUTF8N(nullptr, 0, &bytes, Units.data(), sourceBytes);
+    EXPECT_TRUE(NT_SUCCESS(status));
+    Utf8.assign(bytes + 1, 'Z');
+    ULONG written = 0;
+    NTSTATUS converted = RtlUnicodeToUTF8N(&Utf8[0], bytes, &written, Units.data(), sourceBytes);
+    EXPECT_EQ(converted, status);
+    EXPECT_EQ(written, bytes);
+    EXPECT_EQ(Utf8.back(), 'Z');
+    Utf8.pop_back();
+    return converted;
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8ToUnicodeN_AllScalarValues) {
+    // Blocks of consecutive values keep each encoding length together, so the
+    // two-byte vector path sees long runs as well as the boundaries
+    for (ULONG first = 0; first < 0x110000; first += 0x1000) {
+        std::string utf8;
+        std::vector<WCHAR> expected;
+        for (ULONG codePoint = first; codePoint < first + 0x1000; codePoint++) {
+            if (codePoint >= 0xD800 && codePoint < 0xE000) {
+                continue;
+            }
+            utf8 += Utf8Of(codePoint);
+            AppendUtf16(expected, codePoint);
+        }
+
+        std::vector<WCHAR> units;
+        std::string back;
+        ASSERT_EQ(ToUtf16(utf8, units), STATUS_SUCCESS) << std::hex << first;
+        ASSERT_EQ(units, expected) << std::hex << first;
+        ASSERT_EQ(ToUtf8(units, back), STATUS_SUCCESS) << std::hex << first;
+        ASSERT_EQ(back, utf8) << std::hex << first;
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8ToUnicodeN_NonAsciiAtEveryPosition) {
+    const ULONG samples[] = { 0xE9, 0x044F, 0x20AC, 0x1F600 };
+
+    for (ULONG sample : samples) {
+        for (size_t length = 1; length <= 80; length++) {
+            for (size_t position = 0; position < length; position++) {
+                std::string utf8;
+                std::vector<WCHAR> expected;
+                for (size_t i = 0; i < length; i++) {
+                    ULONG codePoint = i == position ? sample : (ULONG)('a' + i % 26);
+                    utf8 += Utf8Of(codePoint);
+                    AppendUtf16(expected, codePoint);
+                }
+
+                std::vector<WCHAR> units;
+                std::string back;
+                ASSERT_EQ(ToUtf16(utf8, units), STATUS_SUCCESS);
+                ASSERT_EQ(units, expected) << std::hex << sample << " at " << position << " of " << length;
+                ASSERT_EQ(ToUtf8(units, back), STATUS_SUCCESS);
+                ASSERT_EQ(back, utf8) << std::hex << sample << " at " << position << " of " << length;
+            }
+        }
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8ToUnicodeN_ReplacesIllFormedSequences) {
+    struct { const char* Bytes; std::vector<WCHAR> Expected; } const cases[] = {
+        // The example of the Unicode standard, section 3.9
+        { "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64",
+          { 0x61, 0xFFFD, 0xFFFD, 0xFFFD, 0x62, 0xFFFD, 0x63, 0xFFFD, 0xFFFD, 0x64 } },
+        { "\xC0\xAF", { 0xFFFD, 0xFFFD } },                 // overlong '/'
+        { "\xE0\x80\xAF", { 0xFFFD, 0xFFFD, 0xFFFD } },     // overlong three-byte form
+        { "\xF0\x8F\xBF\xBF", { 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD } },
+        { "\xED\xA0\x80", { 0xFFFD, 0xFFFD, 0xFFFD } },     // encoded surrogate
+        { "\xF4\x90\x80\x80", { 0xFFFD, 0xFFFD, 0xFFFD, 0xFFFD } },  // above U+10FFFF
+        { "\xF5\xFF", { 0xFFFD, 0xFFFD } },
+        { "a\xE2\x82", { L'a', 0xFFFD } },                  // truncated at the end
+        { "\xF0\x9F\x98z", { 0xFFFD, L'z' } },
+    };
+
+    for (const auto& test : cases) {
+        std::vector<WCHAR> units;
+        EXPECT_EQ(ToUtf16(test.Bytes, units), STATUS_SOME_NOT_MAPPED);
+        EXPECT_EQ(units, test.Expected) << test.Bytes;
+    }
+
+    // Sixteen bytes of almost-two-byte sequences must not take the vector path
+    std::string utf8;
+    for (int i = 0; i < 8; i++) {
+        utf8 += i == 5 ? "\xC1\x81" : "\xD0\xB0";
+    }
+    std::vector<WCHAR> units;
+    EXPECT_EQ(ToUtf16(utf8, units), STATUS_SOME_NOT_MAPPED);
+    ASSERT_EQ(units.size(), 9u);
+    EXPECT_EQ(units[4], (WCHAR)0x0430);
+    EXPECT_EQ(units[5], (WCHAR)0xFFFD);
+    EXPECT_EQ(units[6], (WCHAR)0xFFFD);
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8ToUnicodeN_RandomFragments) {
+    // Every fragment starts with a byte that ends a preceding truncated
+    // sequence, so the expected output is the concatenation of the parts
+    struct { const char* Bytes; std::vector<WCHAR> Units; } const fragments[] = {
+        { "a", { L'a' } }, { "Z ", { L'Z', L' ' } }, { "\xC3\xA9", { 0xE9 } }, { "\xD0\xAF", { 0x042F } },
+        { "\xE2\x82\xAC", { 0x20AC } }, { "\xE6\x97\xA5", { 0x65E5 } }, { "\xF0\x9F\x98\x80", { 0xD83D, 0xDE00 } },
+        { "\xFF", { 0xFFFD } }, { "\xE2\x82", { 0xFFFD } }, { "\xF0\x9F\x98", { 0xFFFD } },
+    };
+    const int weights[] = { 40, 10, 8, 8, 4, 4, 2, 1, 1, 1 };
+    std::vector<int> pool;
+    for (int f = 0; f < 10; f++) {
+        pool.insert(pool.end(), weights[f], f);
+    }
+
+    ULONG seed = 12345;
+    for (int round = 0; round < 2000; round++) {
+        std::string utf8;
+        std::vector<WCHAR> expected;
+        bool replaced = false;
+        int count = (int)((seed = seed * 1103515245 + 12345) >> 16) % 64;
+        for (int i = 0; i < count; i++) {
+            int f = pool[((seed = seed * 1103515245 + 12345) >> 16) % pool.size()];
+            utf8 += fragments[f].Bytes;
+            expected.insert(expected.end(), fragments[f].Units.begin(), fragments[f].Units.end());
+            replaced |= f >= 7;
+        }
+
+        std::vector<WCHAR> units;
+        ASSERT_EQ(ToUtf16(utf8, units), replaced ? STATUS_SOME_NOT_MAPPED : STATUS_SUCCESS);
+        ASSERT_EQ(units, expected) << "round " << round;
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlUnicodeToUTF8N_ReplacesUnpairedSurrogates) {
+    std::vector<WCHAR> units = { L'a', 0xD800, L'b', 0xDC00, 0xDBFF, 0xDFFF, 0xDBFF };
+    std::string utf8;
+
+    EXPECT_EQ(ToUtf8(units, utf8), STATUS_SOME_NOT_MAPPED);
+    EXPECT_EQ(utf8, "a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xF4\x8F\xBF\xBF\xEF\xBF\xBD");
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8ToUnicodeN_BufferTooSmall) {
+    const char* utf8 = "ab\xF0\x9F\x98\x80";
+    WCHAR units[4] = { 0 };
+    ULONG written = 0;
+
+    // The surrogate pair does not fit in three code units and is not split
+    EXPECT_EQ(RtlUTF8ToUnicodeN(units, 3 * sizeof(WCHAR), &written, utf8, 6), STATUS_BUFFER_TOO_SMALL);
+    EXPECT_EQ(written, 2 * sizeof(WCHAR));
+    EXPECT_EQ(units[1], L'b');
+    EXPECT_EQ(units[2], 0);
+
+    std::vector<WCHAR> source(40, L'x');
+    source[20] = 0x20AC;
+    char bytes[64];
+    memset(bytes, 0, sizeof(bytes));
+    EXPECT_EQ(RtlUnicodeToUTF8N(bytes, 22, &written, source.data(), 40 * sizeof(WCHAR)), STATUS_BUFFER_TOO_SMALL);
+    EXPECT_EQ(written, 20u);
+    EXPECT_EQ(bytes[20], 0);
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8ToUnicodeN_InvalidParameters) {
+    WCHAR units[4];
+    char bytes[4];
+    ULONG written;
+
+    EXPECT_EQ(RtlUTF8ToUnicodeN(units, sizeof(units), nullptr, "a", 1), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlUTF8ToUnicodeN(units, sizeof(units), &written, nullptr, 1), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlUnicodeToUTF8N(bytes, sizeof(bytes), &written, L"ab", 3), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlUnicodeToUTF8N(bytes, sizeof(bytes), nullptr, L"ab", 4), STATUS_INVALID_PARAMETER);
+
+    EXPECT_EQ(RtlUTF8ToUnicodeN(units, sizeof(units), &written, nullptr, 0), STATUS_SUCCESS);
+    EXPECT_EQ(written, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8StringToUnicodeString_Allocate) {
+    UTF8_STRING utf8;
+    UNICODE_STRING unicode;
+    UTF8_STRING back;
+    UNICODE_STRING expected = RTL_CONSTANT_STRING(L"\\Device\\\x0414\x0438\x0441\x043A-\x20AC");
+
+    ASSERT_EQ(RtlInitUTF8String(&utf8, "\\Device\\\xD0\x94\xD0\xB8\xD1\x81\xD0\xBA-\xE2\x82\xAC"), STATUS_SUCCESS);
+    EXPECT_EQ(utf8.Length, 20);
+    EXPECT_EQ(utf8.MaximumLength, 21);
+
+    ASSERT_EQ(RtlUTF8StringToUnicodeString(&unicode, &utf8, TRUE), STATUS_SUCCESS);
+    EXPECT_TRUE(RtlEqualUnicodeString(&unicode, &expected, FALSE));
+    EXPECT_EQ(unicode.MaximumLength, unicode.Length + sizeof(WCHAR));
+    EXPECT_EQ(unicode.Buffer[unicode.Length / sizeof(WCHAR)], UNICODE_NULL);
+
+    ASSERT_EQ(RtlUnicodeStringToUTF8String(&back, &unicode, TRUE), STATUS_SUCCESS);
+    EXPECT_EQ(back.Length, utf8.Length);
+    EXPECT_EQ(strcmp(back.Buffer, utf8.Buffer), 0);
+
+    FreeUnicodeString(&unicode);
+    RtlFreeUTF8String(&back);
+    EXPECT_EQ(back.Buffer, nullptr);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8StringToUnicodeString_CallerBuffer) {
+    UTF8_STRING utf8;
+    DECLARE_UNICODE_STRING_SIZE(name, 4);
+    ASSERT_EQ(RtlInitUTF8String(&utf8, "abc"), STATUS_SUCCESS);
+
+    ASSERT_EQ(RtlUTF8StringToUnicodeString(&name, &utf8, FALSE), STATUS_SUCCESS);
+    EXPECT_EQ(name.Length, 3 * sizeof(WCHAR));
+    EXPECT_EQ(name_buffer[3], UNICODE_NULL);
+
+    ASSERT_EQ(RtlInitUTF8String(&utf8, "abcdef"), STATUS_SUCCESS);
+    EXPECT_EQ(RtlUTF8StringToUnicodeString(&name, &utf8, FALSE), STATUS_BUFFER_OVERFLOW);
+    EXPECT_EQ(name.Length, 4 * sizeof(WCHAR));
+    EXPECT_EQ(name_buffer[3], L'd');
+}
+
+TEST_F(UnicodeStringTest, RtlUTF8StringToUnicodeString_TooLong) {
+    std::string ascii(40000, 'a');
+    UTF8_STRING utf8;
+    UNICODE_STRING unicode = { 0 };
+    ASSERT_EQ(RtlInitUTF8String(&utf8, ascii.c_str()), STATUS_SUCCESS);
+    EXPECT_EQ(RtlUTF8StringToUnicodeString(&unicode, &utf8, TRUE), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(unicode.Buffer, nullptr);
+
+    // 25000 euro signs are 50000 bytes of UTF-16 but 75000 of UTF-8
+    std::vector<WCHAR> euros(25000, (WCHAR)0x20AC);
+    UNICODE_STRING source = VectorString(euros);
+    UTF8_STRING back = { 0 };
+    EXPECT_EQ(RtlUnicodeStringToUTF8String(&back, &source, TRUE), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(back.Buffer, nullptr);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlInitAnsiString_Basic) {
+    ANSI_STRING ansi;
+    const char* text = "Caf\xE9";
+
+    ASSERT_EQ(RtlInitAnsiString(&ansi, text), STATUS_SUCCESS);
+    EXPECT_EQ(ansi.Buffer, text);
+    EXPECT_EQ(ansi.Length, 4);
+    EXPECT_EQ(ansi.MaximumLength, 5);
+
+    ASSERT_EQ(RtlInitAnsiString(&ansi, nullptr), STATUS_SUCCESS);
+    EXPECT_EQ(ansi.Buffer, nullptr);
+    EXPECT_EQ(ansi.Length, 0);
+    EXPECT_EQ(RtlInitAnsiString(nullptr, text), STATUS_INVALID_PARAMETER);
+}
+
+TEST_F(UnicodeStringTest, RtlAnsiStringToUnicodeString_AllBytes) {
+    // Every length up to 100 over all 256 byte values, so each vector width and tail is used
+    for (size_t length = 0; length <= 100; length++) {
+        std::vector<char> bytes(length + 1, '\0');
+        for (size_t i = 0; i < length; i++) {
+            bytes[i] = (char)(0xFF - (i * 7 + length) % 256);
+        }
+        ANSI_STRING ansi = { (USHORT)length, (USHORT)length, bytes.data() };
+        UNICODE_STRING unicode;
+        ANSI_STRING back;
+
+        ASSERT_EQ(RtlAnsiStringToUnicodeString(&unicode, &ansi, TRUE), STATUS_SUCCESS);
+        ASSERT_EQ(unicode.Length, length * sizeof(WCHAR));
+        for (size_t i = 0; i < length; i++) {
+            ASSERT_EQ(unicode.Buffer[i], (WCHAR)(UCHAR)bytes[i]) << i << " of " << length;
+        }
+        EXPECT_EQ(unicode.Buffer[length], UNICODE_NULL);
+
+        ASSERT_EQ(RtlUnicodeStringToAnsiString(&back, &unicode, TRUE), STATUS_SUCCESS);
+        ASSERT_EQ(back.Length, length);
+        EXPECT_EQ(memcmp(back.Buffer, bytes.data(), length + 1), 0);
+
+        FreeUnicodeString(&unicode);
+        RtlFreeAnsiString(&back);
+    }
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlUnicodeStringToAnsiString_UnmappableAtEveryPosition) {
+    for (size_t length = 1; length <= 70; length++) {
+        for (size_t position = 0; position < length; position++) {
+            std::vector<WCHAR> text(length, (WCHAR)0xE9);
+            text[position] = (WCHAR)0x0100;
+            UNICODE_STRING unicode = VectorString(text);
+            char buffer[80];
+            ANSI_STRING ansi = { 0, sizeof(buffer), buffer };
+
+            ASSERT_EQ(RtlUnicodeStringToAnsiString(&ansi, &unicode, FALSE), STATUS_SOME_NOT_MAPPED);
+            ASSERT_EQ(ansi.Length, length);
+            for (size_t i = 0; i < length; i++) {
+                ASSERT_EQ((UCHAR)buffer[i], i == position ? '?' : 0xE9) << i << " of " << length;
+            }
+            ASSERT_EQ(buffer[length], '\0');
+        }
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlAnsiStringToUnicodeString_CallerBuffer) {
+    ANSI_STRING ansi;
+    DECLARE_UNICODE_STRING_SIZE(name, 4);
+    ASSERT_EQ(RtlInitAnsiString(&ansi, "abc"), STATUS_SUCCESS);
+
+    ASSERT_EQ(RtlAnsiStringToUnicodeString(&name, &ansi, FALSE), STATUS_SUCCESS);
+    EXPECT_EQ(name.Length, 3 * sizeof(WCHAR));
+    EXPECT_EQ(name_buffer[3], UNICODE_NULL);
+
+    ASSERT_EQ(RtlInitAnsiString(&ansi, "abcdef"), STATUS_SUCCESS);
+    EXPECT_EQ(RtlAnsiStringToUnicodeString(&name, &ansi, FALSE), STATUS_BUFFER_OVERFLOW);
+    EXPECT_EQ(name.Length, 4 * sizeof(WCHAR));
+    EXPECT_EQ(name_buffer[3], L'd');
+
+    char bytes[3];
+    ANSI_STRING small = { 0, sizeof(bytes), bytes };
+    EXPECT_EQ(RtlUnicodeStringToAnsiString(&small, &name, FALSE), STATUS_BUFFER_OVERFLOW);
+    EXPECT_EQ(small.Length, 3);
+    EXPECT_EQ(memcmp(bytes, "abc", 3), 0);
+}
+
+TEST_F(UnicodeStringTest, RtlAnsiStringToUnicodeString_TooLong) {
+    std::string text(40000, 'a');
+    ANSI_STRING ansi;
+    UNICODE_STRING unicode = { 0 };
+
+    ASSERT_EQ(RtlInitAnsiString(&ansi, text.c_str()), STATUS_SUCCESS);
+    EXPECT_EQ(RtlAnsiStringToUnicodeString(&unicode, &ansi, TRUE), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(unicode.Buffer, nullptr);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlInitUnicodeString_EveryLengthAndAlignment) {
+    alignas(64) WCHAR buffer[256];
+
+    for (size_t offset = 0; offset < 32; offset++) {
+        for (size_t length = 0; length <= 100; length++) {
+            std::fill(buffer, buffer + 256, (WCHAR)0x0100);
+            // Terminators just before the string must not be found
+            if (offset > 0) {
+                buffer[offset - 1] = UNICODE_NULL;
+            }
+            buffer[offset + length] = UNICODE_NULL;
+
+            UNICODE_STRING dest;
+            ASSERT_EQ(RtlInitUnicodeString(&dest, buffer + offset), STATUS_SUCCESS);
+            ASSERT_EQ(dest.Length, length * sizeof(WCHAR)) << offset << " + " << length;
+            ASSERT_EQ(dest.MaximumLength, dest.Length + sizeof(WCHAR));
+
+            // A bound at or below the length stops the scan there
+            ASSERT_EQ(RtlInitUnicodeStringEx(&dest, buffer + offset, length), STATUS_SUCCESS);
+            ASSERT_EQ(dest.Length, length * sizeof(WCHAR));
+            ASSERT_EQ(dest.MaximumLength, dest.Length);
+            ASSERT_EQ(RtlInitUnicodeStringEx(&dest, buffer + offset, length + 1), STATUS_SUCCESS);
+            ASSERT_EQ(dest.MaximumLength, dest.Length + sizeof(WCHAR));
+        }
+    }
+}
+
+TEST_F(UnicodeStringTest, RtlInitUnicodeString_StopsAtPageBoundary) {
+    const SIZE_T pageSize = 4096;
+    PUCHAR pages = (PUCHAR)VirtualAlloc(NULL, 2 * pageSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    ASSERT_NE(pages, nullptr);
+    DWORD oldProtect;
+    ASSERT_TRUE(VirtualProtect(pages + pageSize, pageSize, PAGE_NOACCESS, &oldProtect));
+    PWSTR pageEnd = (PWSTR)(pages + pageSize);
+
+    for (size_t length = 0; length < 100; length++) {
+        // Terminated in the last code unit of the readable page
+        PWSTR string = pageEnd - length - 1;
+        std::fill(string, pageEnd, (WCHAR)L'p');
+        pageEnd[-1] = UNICODE_NULL;
+        UNICODE_STRING dest;
+        ASSERT_EQ(RtlInitUnicodeString(&dest, string), STATUS_SUCCESS);
+        ASSERT_EQ(dest.Length, length * sizeof(WCHAR));
+
+        // An unterminated field that ends exactly at the page boundary
+        string = pageEnd - length;
+        std::fill(string, pageEnd, (WCHAR)L'q');
+        ASSERT_EQ(RtlInitUnicodeStringEx(&dest, string, length), STATUS_SUCCESS);
+        ASSERT_EQ(dest.Length, length * sizeof(WCHAR));
+    }
+    VirtualFree(pages, 0, MEM_RELEASE);
+}
+
+TEST_F(UnicodeStringTest, RtlInitUnicodeStringEx_Limits) {
+    std::vector<WCHAR> text(UNICODE_STRING_MAX_CHARS + 2, (WCHAR)L'x');
+    UNICODE_STRING dest;
+
+    // The longest string whose terminator still fits in MaximumLength
+    text[UNICODE_STRING_MAX_CHARS - 1] = UNICODE_NULL;
+    ASSERT_EQ(RtlInitUnicodeString(&dest, text.data()), STATUS_SUCCESS);
+    EXPECT_EQ(dest.Length, UNICODE_STRING_MAX_BYTES - sizeof(WCHAR));
+    EXPECT_EQ(dest.MaximumLength, UNICODE_STRING_MAX_BYTES);
+    ASSERT_EQ(RtlInitUnicodeStringEx(&dest, text.data(), text.size()), STATUS_SUCCESS);
+    EXPECT_EQ(dest.Length, UNICODE_STRING_MAX_BYTES - sizeof(WCHAR));
+
+    text[UNICODE_STRING_MAX_CHARS - 1] = L'x';
+    text[UNICODE_STRING_MAX_CHARS] = UNICODE_NULL;
+    EXPECT_EQ(RtlInitUnicodeString(&dest, text.data()), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(RtlInitUnicodeStringEx(&dest, text.data(), text.size()), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(dest.Length, 0);
+
+    // Without a terminator, a full-size field still fits
+    ASSERT_EQ(RtlInitUnicodeStringEx(&dest, text.data(), UNICODE_STRING_MAX_CHARS), STATUS_SUCCESS);
+    EXPECT_EQ(dest.Length, UNICODE_STRING_MAX_BYTES);
+    EXPECT_EQ(dest.MaximumLength, UNICODE_STRING_MAX_BYTES);
+
+    ASSERT_EQ(RtlInitUnicodeStringEx(&dest, nullptr, 10), STATUS_SUCCESS);
+    EXPECT_EQ(dest.Buffer, nullptr);
+    EXPECT_EQ(dest.Length, 0);
+    EXPECT_EQ(RtlInitUnicodeStringEx(nullptr, text.data(), 10), STATUS_INVALID_PARAMETER);
+}
+
+TEST_F(UnicodeStringTest, RtlDuplicateInlineUnicodeString_InlineAndPool) {
+    for (size_t length = 0; length < INLINE_UNICODE_STRING_CHARS + 8; length++) {
+        std::vector<WCHAR> text(length);
+        for (size_t i = 0; i < length; i++) {
+            text[i] = (WCHAR)(L'a' + i % 26);
+        }
+        UNICODE_STRING source = VectorString(text);
+        INLINE_UNICODE_STRING copy;
+        LONG64 allocations = RtlReadShardedCounter(&GetGlobalState()->AllocationCount);
+
+        ASSERT_EQ(RtlDuplicateInlineUnicodeString(&source, &copy), STATUS_SUCCESS);
+        EXPECT_TRUE(RtlEqualUnicodeString(&copy.String, &source, FALSE));
+        EXPECT_EQ(copy.String.Buffer[length], UNICODE_NULL);
+
+        // Strings that fit with their terminator cost no allocation
+        bool fits = length < INLINE_UNICODE_STRING_CHARS;
+        EXPECT_EQ(RtlIsInlineUnicodeStringAllocated(&copy), !fits) << length;
+        EXPECT_EQ(copy.String.Buffer == copy.InlineBuffer, fits);
+        EXPECT_EQ(RtlReadShardedCounter(&GetGlobalState()->AllocationCount) - allocations, fits ? 0 : 1);
+        EXPECT_EQ(copy.String.MaximumLength,
+                  fits ? sizeof(copy.InlineBuffer) : (length + 1) * sizeof(WCHAR));
+
+        RtlFreeInlineUnicodeString(&copy);
+        EXPECT_EQ(copy.String.Length, 0);
+        EXPECT_EQ(copy.String.Buffer, copy.InlineBuffer);
+    }
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlMoveInlineUnicodeString_InlineAndPool) {
+    std::vector<WCHAR> shortText(5, L's');
+    std::vector<WCHAR> longText(100, L'l');
+    UNICODE_STRING shortString = VectorString(shortText);
+    UNICODE_STRING longString = VectorString(longText);
+    INLINE_UNICODE_STRING source, moved;
+
+    ASSERT_EQ(RtlDuplicateInlineUnicodeString(&shortString, &source), STATUS_SUCCESS);
+    RtlMoveInlineUnicodeString(&moved, &source);
+    EXPECT_EQ(moved.String.Buffer, moved.InlineBuffer);
+    EXPECT_TRUE(RtlEqualUnicodeString(&moved.String, &shortString, FALSE));
+    EXPECT_EQ(moved.String.Buffer[5], UNICODE_NULL);
+    EXPECT_EQ(source.String.Length, 0);
+    EXPECT_EQ(source.String.Buffer, source.InlineBuffer);
+    RtlFreeInlineUnicodeString(&moved);
+
+    // A pool buffer changes owner without being copied
+    ASSERT_EQ(RtlDuplicateInlineUnicodeString(&longString, &source), STATUS_SUCCESS);
+    PWSTR buffer = source.String.Buffer;
+    RtlMoveInlineUnicodeString(&moved, &source);
+    EXPECT_EQ(moved.String.Buffer, buffer);
+    EXPECT_TRUE(RtlEqualUnicodeString(&moved.String, &longString, FALSE));
+    EXPECT_FALSE(RtlIsInlineUnicodeStringAllocated(&source));
+    RtlFreeInlineUnicodeString(&source);
+    RtlFreeInlineUnicodeString(&moved);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
+
+TEST_F(UnicodeStringTest, RtlDuplicateInlineUnicodeString_EdgeCases) {
+    INLINE_UNICODE_STRING copy;
+    INLINE_UNICODE_STRING zeroed;
+    std::vector<WCHAR> text(UNICODE_STRING_MAX_CHARS, L'x');
+    UNICODE_STRING tooLong = { UNICODE_STRING_MAX_BYTES, UNICODE_STRING_MAX_BYTES, text.data() };
+    UNICODE_STRING broken = { 4, 2, text.data() };
+
+    ASSERT_EQ(RtlDuplicateInlineUnicodeString(nullptr, &copy), STATUS_SUCCESS);
+    EXPECT_EQ(copy.String.Length, 0);
+    EXPECT_EQ(copy.String.Buffer[0], UNICODE_NULL);
+
+    EXPECT_EQ(RtlDuplicateInlineUnicodeString(&tooLong, &copy), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(copy.String.Length, 0);
+    EXPECT_EQ(RtlDuplicateInlineUnicodeString(&broken, &copy), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(RtlDuplicateInlineUnicodeString(&tooLong, nullptr), STATUS_INVALID_PARAMETER);
+
+    tooLong.Length -= sizeof(WCHAR);
+    ASSERT_EQ(RtlDuplicateInlineUnicodeString(&tooLong, &copy), STATUS_SUCCESS);
+    EXPECT_EQ(copy.String.MaximumLength, UNICODE_STRING_MAX_BYTES);
+    RtlFreeInlineUnicodeString(&copy);
+
+    // A zero-filled string, as in a zeroed allocation, is empty and can be freed
+    memset(&zeroed, 0, sizeof(zeroed));
+    EXPECT_FALSE(RtlIsInlineUnicodeStringAllocated(&zeroed));
+    RtlFreeInlineUnicodeString(&zeroed);
+    EXPECT_EQ(zeroed.String.Buffer, zeroed.InlineBuffer);
+    RtlMoveInlineUnicodeString(&copy, &zeroed);
+    EXPECT_EQ(copy.String.Length, 0);
+    EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+}
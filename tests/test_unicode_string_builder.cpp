@@ -0,0 +1,213 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../include/UnicodeStringBuilder.h"
+
+class UnicodeStringBuilderTest : public ::testing::Test {
+protected:
+    UNICODE_STRING_BUILDER Builder;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+        RtlInitializeUnicodeStringBuilder(&Builder);
+    }
+
+    void TearDown() override {
+        RtlFreeUnicodeStringBuilder(&Builder);
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+
+    static SIZE_T Allocations() {
+        return (SIZE_T)RtlReadShardedCounter(&GetGlobalState()->AllocationCount);
+    }
+
+    static std::string Text(PCUNICODE_STRING String) {
+        std::string text;
+        for (USHORT i = 0; i < String->Length / sizeof(WCHAR); i++) {
+            text += (char)String->Buffer[i];
+        }
+        return text;
+    }
+
+    static bool IsTerminated(PCUNICODE_STRING String) {
+        return String->Length + sizeof(WCHAR) <= String->MaximumLength &&
+               String->Buffer[String->Length / sizeof(WCHAR)] == UNICODE_NULL;
+    }
+};
+
+TEST_F(UnicodeStringBuilderTest, AppendsEveryKindOfPiece) {
+    UNICODE_STRING path = RTL_CONSTANT_STRING(L"\\Device\\USB");
+    UNICODE_STRING result;
+
+    ASSERT_EQ(RtlAppendUnicodeStringToBuilder(&Builder, &path), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeCharToBuilder(&Builder, L'\\'), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L"VID_"), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendHexToBuilder(&Builder, 0x45E, 4), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L"&PID_"), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendHexToBuilder(&Builder, 0xBEEF, 0), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeCharToBuilder(&Builder, L'#'), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendIntegerToBuilder(&Builder, 1234), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeStringToBuilder(&Builder, NULL), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, NULL), STATUS_SUCCESS);
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L""), STATUS_SUCCESS);
+    EXPECT_TRUE(IsTerminated(&Builder.String));
+
+    PWSTR buffer = Builder.String.Buffer;
+    RtlFinishUnicodeStringBuilder(&Builder, &result);
+    EXPECT_EQ(result.Buffer, buffer) << "Finishing must not copy the text";
+    EXPECT_EQ(Text(&result), "\\Device\\USB\\VID_045E&PID_BEEF#1234");
+    EXPECT_TRUE(IsTerminated(&result));
+    EXPECT_EQ(Builder.String.Buffer, nullptr);
+    EXPECT_EQ(Builder.String.Length, 0);
+    FreeUnicodeString(&result);
+}
+
+TEST_F(UnicodeStringBuilderTest, FormatsIntegers) {
+    const struct {
+        LONG64 Value;
+        const char* Text;
+    } decimal[] = {
+        { 0, "0" },
+        { 7, "7" },
+        { -42, "-42" },
+        { 1000000, "1000000" },
+        { INT64_MAX, "9223372036854775807" },
+        { INT64_MIN, "-9223372036854775808" },
+    };
+    const struct {
+        ULONG64 Value;
+        ULONG MinimumDigits;
+        const char* Text;
+    } hex[] = {
+        { 0, 0, "0" },
+        { 0, 1, "0" },
+        { 0, 4, "0000" },
+        { 0x1F, 4, "001F" },
+        { 0xABCDEF, 2, "ABCDEF" },
+        { 0xFFFFFFFFFFFFFFFFull, 0, "FFFFFFFFFFFFFFFF" },
+        { 1, 16, "0000000000000001" },
+    };
+
+    for (const auto& entry : decimal) {
+        ASSERT_EQ(RtlAppendIntegerToBuilder(&Builder, entry.Value), STATUS_SUCCESS);
+        EXPECT_EQ(Text(&Builder.String), entry.Text);
+        EXPECT_TRUE(IsTerminated(&Builder.String));
+        Builder.String.Length = 0;
+    }
+    for (const auto& entry : hex) {
+        ASSERT_EQ(RtlAppendHexToBuilder(&Builder, entry.Value, entry.MinimumDigits), STATUS_SUCCESS);
+        EXPECT_EQ(Text(&Builder.String), entry.Text);
+        Builder.String.Length = 0;
+    }
+
+    EXPECT_EQ(RtlAppendHexToBuilder(&Builder, 1, 17), STATUS_INVALID_PARAMETER);
+    EXPECT_EQ(Builder.String.Length, 0);
+}
+
+TEST_F(UnicodeStringBuilderTest, GrowsGeometricallyUpToTheLimit) {
+    SIZE_T before = Allocations();
+    USHORT const maxChars = (UNICODE_STRING_MAX_BYTES - sizeof(WCHAR)) / sizeof(WCHAR);
+
+    for (USHORT i = 0; i < maxChars; i++) {
+        ASSERT_EQ(RtlAppendUnicodeCharToBuilder(&Builder, (WCHAR)(L'a' + i % 26)), STATUS_SUCCESS) << i;
+    }
+    // 128 bytes doubled up to the 65534-byte cap
+    EXPECT_LE(Allocations() - before, 11u);
+    EXPECT_EQ(Builder.String.Length, UNICODE_STRING_MAX_BYTES - sizeof(WCHAR));
+    EXPECT_EQ(Builder.String.MaximumLength, UNICODE_STRING_MAX_BYTES);
+    EXPECT_TRUE(IsTerminated(&Builder.String));
+    for (USHORT i = 0; i < maxChars; i++) {
+        ASSERT_EQ(Builder.String.Buffer[i], (WCHAR)(L'a' + i % 26)) << i;
+    }
+
+    // No room for another code unit and the terminator
+    EXPECT_EQ(RtlAppendUnicodeCharToBuilder(&Builder, L'x'), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(RtlAppendIntegerToBuilder(&Builder, 1), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(RtlReserveUnicodeStringBuilder(&Builder, sizeof(WCHAR)), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(RtlReserveUnicodeStringBuilder(&Builder, 0), STATUS_SUCCESS);
+    EXPECT_EQ(Builder.String.Length, UNICODE_STRING_MAX_BYTES - sizeof(WCHAR));
+    EXPECT_TRUE(IsTerminated(&Builder.String));
+}
+
+TEST_F(UnicodeStringBuilderTest, FailedAppendLeavesTextUnchanged) {
+    std::vector<WCHAR> large((UNICODE_STRING_MAX_BYTES / sizeof(WCHAR)) - 4, L'z');
+    UNICODE_STRING largeString;
+    UNICODE_STRING odd = RTL_CONSTANT_STRING(L"odd");
+
+    largeString.Buffer = large.data();
+    largeString.Length = (USHORT)(large.size() * sizeof(WCHAR));
+    largeString.MaximumLength = largeString.Length;
+
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L"prefix"), STATUS_SUCCESS);
+    PWSTR buffer = Builder.String.Buffer;
+
+    EXPECT_EQ(RtlAppendUnicodeStringToBuilder(&Builder, &largeString), STATUS_NAME_TOO_LONG);
+    EXPECT_EQ(RtlReserveUnicodeStringBuilder(&Builder, MAXULONG), STATUS_NAME_TOO_LONG);
+    odd.Length = 3;
+    EXPECT_EQ(RtlAppendUnicodeStringToBuilder(&Builder, &odd), STATUS_INVALID_PARAMETER);
+
+    EXPECT_EQ(Builder.String.Buffer, buffer);
+    EXPECT_EQ(Text(&Builder.String), "prefix");
+    EXPECT_TRUE(IsTerminated(&Builder.String));
+
+    // The largest string that still fits with its terminator
+    largeString.Length = (USHORT)(UNICODE_STRING_MAX_BYTES - sizeof(WCHAR) - Builder.String.Length);
+    EXPECT_EQ(RtlAppendUnicodeStringToBuilder(&Builder, &largeString), STATUS_SUCCESS);
+    EXPECT_EQ(Builder.String.Length, UNICODE_STRING_MAX_BYTES - sizeof(WCHAR));
+    EXPECT_TRUE(IsTerminated(&Builder.String));
+}
+
+TEST_F(UnicodeStringBuilderTest, AppendsItsOwnText) {
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L"ab"), STATUS_SUCCESS);
+
+    // Each doubling outgrows the buffer in turn, freeing the source mid-append
+    std::string expected = "ab";
+    for (int i = 0; i < 10; i++) {
+        ASSERT_EQ(RtlAppendUnicodeStringToBuilder(&Builder, &Builder.String), STATUS_SUCCESS);
+        expected += expected;
+    }
+    EXPECT_EQ(Text(&Builder.String), expected);
+    EXPECT_TRUE(IsTerminated(&Builder.String));
+}
+
+TEST_F(UnicodeStringBuilderTest, ReserveAvoidsFurtherAllocations) {
+    ASSERT_EQ(RtlReserveUnicodeStringBuilder(&Builder, 1000 * sizeof(WCHAR)), STATUS_SUCCESS);
+    EXPECT_GE(Builder.String.MaximumLength, 1001 * sizeof(WCHAR));
+    EXPECT_EQ(Builder.String.Length, 0);
+    EXPECT_TRUE(IsTerminated(&Builder.String));
+
+    SIZE_T before = Allocations();
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L"Serial"), STATUS_SUCCESS);
+        ASSERT_EQ(RtlAppendHexToBuilder(&Builder, i, 4), STATUS_SUCCESS);
+    }
+    EXPECT_EQ(Allocations(), before);
+    EXPECT_EQ(Builder.String.Length, 1000 * sizeof(WCHAR));
+}
+
+TEST_F(UnicodeStringBuilderTest, EmptyAndReusedBuilders) {
+    UNICODE_STRING result;
+
+    // A zero-filled builder is empty and may be freed
+    memset(&Builder, 0, sizeof(Builder));
+    RtlFreeUnicodeStringBuilder(&Builder);
+
+    RtlFinishUnicodeStringBuilder(&Builder, &result);
+    EXPECT_EQ(result.Buffer, nullptr);
+    EXPECT_EQ(result.Length, 0);
+    EXPECT_EQ(result.MaximumLength, 0);
+    FreeUnicodeString(&result);
+
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L"discarded"), STATUS_SUCCESS);
+    RtlFreeUnicodeStringBuilder(&Builder);
+    EXPECT_EQ(Builder.String.Buffer, nullptr);
+
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L"first"), STATUS_SUCCESS);
+    RtlFinishUnicodeStringBuilder(&Builder, &result);
+    ASSERT_EQ(RtlAppendUnicodeToBuilder(&Builder, L"second"), STATUS_SUCCESS);
+    EXPECT_EQ(Text(&result), "first");
+    EXPECT_EQ(Text(&Builder.String), "second");
+    FreeUnicodeString(&result);
+}
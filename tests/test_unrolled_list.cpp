@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "../include/UnrolledList.h"
+
+class UnrolledListTest : public ::testing::Test {
+protected:
+    UNROLLED_LIST List;
+    std::vector<int> Storage;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+        RtlInitializeUnrolledList(&List, PagedPool);
+        Storage.resize(1000);
+        for (size_t i = 0; i < Storage.size(); i++) {
+            Storage[i] = (int)i;
+        }
+    }
+
+    void TearDown() override {
+        RtlFreeUnrolledList(&List);
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+
+    void AppendRange(int first, int count) {
+        for (int i = first; i < first + count; i++) {
+            ASSERT_TRUE(RtlAppendUnrolledList(&List, &Storage[i]));
+        }
+    }
+
+    std::vector<int> Collect() {
+        std::vector<int> values;
+        UNROLLED_LIST_CURSOR cursor;
+        PVOID element;
+        RtlStartUnrolledListScan(&List, &cursor);
+        while ((element = RtlNextUnrolledListElement(&List, &cursor)) != NULL) {
+            values.push_back(*(int*)element);
+        }
+        EXPECT_EQ(values.size(), RtlUnrolledListCount(&List));
+        return values;
+    }
+
+    SIZE_T ChunkCount() {
+        SIZE_T count = 0;
+        for (PLIST_ENTRY link = List.ChunkListHead.Flink; link != &List.ChunkListHead; link = link->Flink) {
+            count++;
+        }
+        return count;
+    }
+};
+
+TEST_F(UnrolledListTest, ChunkIsCacheLineMultiple) {
+    EXPECT_EQ(sizeof(UNROLLED_LIST_CHUNK) % 64, 0u);
+    EXPECT_GT(UNROLLED_LIST_CHUNK_CAPACITY, 8u);
+}
+
+TEST_F(UnrolledListTest, EmptyList) {
+    UNROLLED_LIST_CURSOR cursor;
+    RtlStartUnrolledListScan(&List, &cursor);
+    EXPECT_EQ(RtlNextUnrolledListElement(&List, &cursor), nullptr);
+    EXPECT_EQ(RtlRemoveUnrolledListElementAtCursor(&List, &cursor), nullptr);
+    EXPECT_EQ(RtlUnrolledListCount(&List), 0u);
+}
+
+TEST_F(UnrolledListTest, Append_RejectsNull) {
+    EXPECT_FALSE(RtlAppendUnrolledList(&List, NULL));
+    EXPECT_EQ(RtlUnrolledListCount(&List), 0u);
+}
+
+TEST_F(UnrolledListTest, Append_PreservesOrderAcrossChunks) {
+    const int count = (int)UNROLLED_LIST_CHUNK_CAPACITY * 3 + 5;
+    AppendRange(0, count);
+
+    std::vector<int> expected(Storage.begin(), Storage.begin() + count);
+    EXPECT_EQ(Collect(), expected);
+    EXPECT_EQ(ChunkCount(), 4u);
+}
+
+TEST_F(UnrolledListTest, Remove_RequiresReturnedElement) {
+    AppendRange(0, 3);
+    UNROLLED_LIST_CURSOR cursor;
+    RtlStartUnrolledListScan(&List, &cursor);
+
+    EXPECT_EQ(RtlRemoveUnrolledListElementAtCursor(&List, &cursor), nullptr);
+    EXPECT_EQ(RtlNextUnrolledListElement(&List, &cursor), &Storage[0]);
+    EXPECT_EQ(RtlRemoveUnrolledListElementAtCursor(&List, &cursor), &Storage[0]);
+    // A second removal without advancing does nothing
+    EXPECT_EQ(RtlRemoveUnrolledListElementAtCursor(&List, &cursor), nullptr);
+    EXPECT_EQ(RtlNextUnrolledListElement(&List, &cursor), &Storage[1]);
+    EXPECT_EQ(Collect(), std::vector<int>({ 1, 2 }));
+}
+
+TEST_F(UnrolledListTest, Remove_DuringScanKeepsCursorValid) {
+    const int count = (int)UNROLLED_LIST_CHUNK_CAPACITY * 4;
+    AppendRange(0, count);
+
+    // Drop every odd element in one pass
+    UNROLLED_LIST_CURSOR cursor;
+    PVOID element;
+    std::vector<int> visited;
+    RtlStartUnrolledListScan(&List, &cursor);
+    while ((element = RtlNextUnrolledListElement(&List, &cursor)) != NULL) {
+        visited.push_back(*(int*)element);
+        if (*(int*)element % 2 != 0) {
+            EXPECT_EQ(RtlRemoveUnrolledListElementAtCursor(&List, &cursor), element);
+        }
+    }
+
+    std::vector<int> all(Storage.begin(), Storage.begin() + count);
+    EXPECT_EQ(visited, all);
+
+    std::vector<int> expected;
+    for (int i = 0; i < count; i += 2) {
+        expected.push_back(i);
+    }
+    EXPECT_EQ(Collect(), expected);
+}
+
+TEST_F(UnrolledListTest, Remove_MergesSparseNeighbour) {
+    const int capacity = (int)UNROLLED_LIST_CHUNK_CAPACITY;
+    AppendRange(0, capacity * 2);
+    ASSERT_EQ(ChunkCount(), 2u);
+
+    // Thin the second chunk down to its last element
+    UNROLLED_LIST_CURSOR cursor;
+    PVOID element;
+    RtlStartUnrolledListScan(&List, &cursor);
+    while ((element = RtlNextUnrolledListElement(&List, &cursor)) != NULL) {
+        int value = *(int*)element;
+        if (value >= capacity && value < capacity * 2 - 1) {
+            RtlRemoveUnrolledListElementAtCursor(&List, &cursor);
+        }
+    }
+    EXPECT_EQ(ChunkCount(), 2u);
+
+    // One removal from the full first chunk leaves room to absorb the second
+    RtlStartUnrolledListScan(&List, &cursor);
+    EXPECT_EQ(RtlNextUnrolledListElement(&List, &cursor), &Storage[0]);
+    EXPECT_EQ(RtlRemoveUnrolledListElementAtCursor(&List, &cursor), &Storage[0]);
+    EXPECT_EQ(ChunkCount(), 1u);
+
+    std::vector<int> expected(Storage.begin() + 1, Storage.begin() + capacity);
+    expected.push_back(capacity * 2 - 1);
+    EXPECT_EQ(Collect(), expected);
+}
+
+TEST_F(UnrolledListTest, Remove_AllElementsFreesChunks) {
+    AppendRange(0, (int)UNROLLED_LIST_CHUNK_CAPACITY * 2 + 1);
+
+    UNROLLED_LIST_CURSOR cursor;
+    RtlStartUnrolledListScan(&List, &cursor);
+    while (RtlNextUnrolledListElement(&List, &cursor) != NULL) {
+        ASSERT_NE(RtlRemoveUnrolledListElementAtCursor(&List, &cursor), nullptr);
+    }
+
+    EXPECT_EQ(RtlUnrolledListCount(&List), 0u);
+    EXPECT_EQ(ChunkCount(), 0u);
+    EXPECT_TRUE(IsListEmpty(&List.ChunkListHead));
+
+    // The list is still usable
+    AppendRange(10, 2);
+    EXPECT_EQ(Collect(), std::vector<int>({ 10, 11 }));
+}
+
+TEST_F(UnrolledListTest, RandomizedAgainstVector) {
+    std::mt19937 rng(7);
+    std::vector<int> reference;
+
+    for (int round = 0; round < 20; round++) {
+        int add = (int)(rng() % 200);
+        for (int i = 0; i < add && reference.size() < Storage.size(); i++) {
+            int value = (int)(rng() % Storage.size());
+            ASSERT_TRUE(RtlAppendUnrolledList(&List, &Storage[value]));
+            reference.push_back(value);
+        }
+
+        UNROLLED_LIST_CURSOR cursor;
+        PVOID element;
+        std::vector<int> kept;
+        RtlStartUnrolledListScan(&List, &cursor);
+        while ((element = RtlNextUnrolledListElement(&List, &cursor)) != NULL) {
+            if (rng() % 3 == 0) {
+                RtlRemoveUnrolledListElementAtCursor(&List, &cursor);
+            } else {
+                kept.push_back(*(int*)element);
+            }
+        }
+        reference = kept;
+        ASSERT_EQ(Collect(), reference);
+    }
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../include/WorkQueue.h"
+
+class WorkQueueTest : public ::testing::Test {
+protected:
+    EX_WORK_QUEUE WorkQueue;
+
+    void SetUp() override {
+        ASSERT_TRUE(InitHeap()) << "Failed to initialize heap";
+    }
+
+    void TearDown() override {
+        EXPECT_EQ(GetGlobalState()->CurrentBytesAllocated, 0u);
+        CleanupHeap();
+    }
+};
+
+struct CountingItem {
+    WORK_QUEUE_ITEM WorkItem;
+    std::atomic<int>* Counter;
+};
+
+static VOID CountRoutine(PVOID Parameter) {
+    CountingItem* item = static_cast<CountingItem*>(Parameter);
+    (*item->Counter)++;
+}
+
+// Each node frees its own item and queues two children until the depth,
+// carried in IoObject, reaches zero
+struct TreeContext {
+    PEX_WORK_QUEUE WorkQueue;
+    std::atomic<int> Visited;
+};
+
+static TreeContext g_Tree;
+
+static VOID TreeRoutine(PVOID IoObject, PVOID Context) {
+    ULONG_PTR depth = (ULONG_PTR)IoObject;
+    IoFreeWorkItem(static_cast<PIO_WORKITEM>(Context));
+    g_Tree.Visited++;
+    if (depth > 0) {
+        for (int child = 0; child < 2; child++) {
+            PIO_WORKITEM item = IoAllocateWorkItem(g_Tree.WorkQueue, (PVOID)(depth - 1));
+            ASSERT_NE(item, nullptr);
+            IoQueueWorkItem(item, TreeRoutine, DelayedWorkQueue, item);
+        }
+    }
+}
+
+// Frees its own IO_WORKITEM, as drivers usually do
+struct SelfFreeingContext {
+    PIO_WORKITEM Item;
+    PVOID ExpectedIoObject;
+    std::atomic<int>* Counter;
+};
+
+static VOID SelfFreeingRoutine(PVOID IoObject, PVOID Context) {
+    SelfFreeingContext* context = static_cast<SelfFreeingContext*>(Context);
+    EXPECT_EQ(IoObject, context->ExpectedIoObject);
+    IoFreeWorkItem(context->Item);
+    (*context->Counter)++;
+}
+
+TEST_F(WorkQueueTest, InitializeAndRundown_Empty) {
+    ASSERT_EQ(ExInitializeWorkQueue(&WorkQueue, 3), STATUS_SUCCESS);
+    EXPECT_EQ(WorkQueue.WorkerCount, 3u);
+    ExRundownWorkQueue(&WorkQueue);
+    EXPECT_EQ(WorkQueue.Workers, nullptr);
+}
+
+TEST_F(WorkQueueTest, Workers_AreCacheAligned) {
+    ASSERT_EQ(ExInitializeWorkQueue(&WorkQueue, 5), STATUS_SUCCESS);
+
+    // Thieves write Top and the owner Bottom, so each needs a line of its own
+    for (ULONG i = 0; i < WorkQueue.WorkerCount; i++) {
+        EXPECT_EQ((ULONG_PTR)&WorkQueue.Workers[i].Top & 63, 0u) << i;
+        EXPECT_EQ((ULONG_PTR)&WorkQueue.Workers[i].Bottom & 63, 0u) << i;
+    }
+    ExRundownWorkQueue(&WorkQueue);
+}
+
+TEST_F(WorkQueueTest, Initialize_DefaultsToProcessorCount) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    ASSERT_EQ(ExInitializeWorkQueue(&WorkQueue, 0), STATUS_SUCCESS);
+    EXPECT_EQ(WorkQueue.WorkerCount, info.dwNumberOfProcessors);
+    ExRundownWorkQueue(&WorkQueue);
+}
+
+TEST_F(WorkQueueTest, ExternalItems_AllRunBeforeFlushReturns) {
+    const int count = 20000;
+    std::atomic<int> counter(0);
+    std::vector<CountingItem> items(count);
+
+    ASSERT_EQ(ExInitializeWorkQueue(&WorkQueue, 4), STATUS_SUCCESS);
+    for (auto& item : items) {
+        item.Counter = &counter;
+        ExInitializeWorkItem(&item.WorkItem, CountRoutine, &item);
+        ExQueueWorkItem(&WorkQueue, &item.WorkItem, CriticalWorkQueue);
+    }
+    ExFlushWorkQueue(&WorkQueue);
+    EXPECT_EQ(counter.load(), count);
+
+    // The queue keeps working after a flush
+    for (int i = 0; i < 10; i++) {
+        ExQueueWorkItem(&WorkQueue, &items[i].WorkItem, CriticalWorkQueue);
+    }
+    ExRundownWorkQueue(&WorkQueue);
+    EXPECT_EQ(counter.load(), count + 10);
+}
+
+struct GateItem {
+    WORK_QUEUE_ITEM WorkItem;
+    std::atomic<bool> Open;
+};
+
+static VOID GateRoutine(PVOID Parameter) {
+    GateItem* gate = static_cast<GateItem*>(Parameter);
+    while (!gate->Open.load()) {
+        Sleep(1);
+    }
+}
+
+TEST_F(WorkQueueTest, ExternalSubmitter_WaitsForRoomInFullQueue) {
+    const int count = EX_WORK_QUEUE_INJECTION_SIZE + 100;
+    std::atomic<int> counter(0);
+    std::vector<CountingItem> items(count);
+    GateItem gate;
+
+    // The only worker is held by the gate while the shared queue fills up
+    gate.Open = false;
+    ASSERT_EQ(ExInitializeWorkQueue(&WorkQueue, 1), STATUS_SUCCESS);
+    ExInitializeWorkItem(&gate.WorkItem, GateRoutine, &gate);
+    ExQueueWorkItem(&WorkQueue, &gate.WorkItem, CriticalWorkQueue);
+
+    std::thread opener([&gate]() {
+        Sleep(5 * EX_WORK_QUEUE_INJECTION_RETRY_MS);
+        gate.Open = true;
+    });
+    for (auto& item : items) {
+        item.Counter = &counter;
+        ExInitializeWorkItem(&item.WorkItem, CountRoutine, &item);
+        ExQueueWorkItem(&WorkQueue, &item.WorkItem, CriticalWorkQueue);
+    }
+    opener.join();
+
+    ExFlushWorkQueue(&WorkQueue);
+    EXPECT_EQ(counter.load(), count);
+    ExRundownWorkQueue(&WorkQueue);
+}
+
+TEST_F(WorkQueueTest, NestedItems_AreWaitedForAndStolen) {
+    g_Tree.WorkQueue = &WorkQueue;
+    g_Tree.Visited = 0;
+
+    ASSERT_EQ(ExInitializeWorkQueue(&WorkQueue, 4), STATUS_SUCCESS);
+    PIO_WORKITEM root = IoAllocateWorkItem(&WorkQueue, (PVOID)12);
+    ASSERT_NE(root, nullptr);
+    IoQueueWorkItem(root, TreeRoutine, DelayedWorkQueue, root);
+    ExFlushWorkQueue(&WorkQueue);
+
+    EXPECT_EQ(g_Tree.Visited.load(), (1 << 13) - 1);
+    ExRundownWorkQueue(&WorkQueue);
+}
+
+TEST_F(WorkQueueTest, IoWorkItems_PassObjectAndContext) {
+    const int count = 500;
+    std::atomic<int> counter(0);
+    std::vector<SelfFreeingContext> contexts(count);
+    int ioObject = 0;
+
+    ASSERT_EQ(ExInitializeWorkQueue(&WorkQueue, 2), STATUS_SUCCESS);
+    for (auto& context : contexts) {
+        context.Item = IoAllocateWorkItem(&WorkQueue, &ioObject);
+        ASSERT_NE(context.Item, nullptr);
+        context.ExpectedIoObject = &ioObject;
+        context.Counter = &counter;
+        IoQueueWorkItem(context.Item, SelfFreeingRoutine, CriticalWorkQueue, &context);
+    }
+    ExRundownWorkQueue(&WorkQueue);
+    EXPECT_EQ(counter.load(), count);
+}
+
+TEST_F(WorkQueueTest, ConcurrentSubmitters) {
+    const int submitters = 4;
+    const int perSubmitter = 5000;
+    std::atomic<int> counter(0);
+    std::vector<CountingItem> items(submitters * perSubmitter);
+    std::vector<std::thread> threads;
+
+    ASSERT_EQ(ExInitializeWorkQueue(&WorkQueue, 3), STATUS_SUCCESS);
+    for (int s = 0; s < submitters; s++) {
+        threads.emplace_back([&, s]() {
+            for (int i = 0; i < perSubmitter; i++) {
+                CountingItem& item = items[s * perSubmitter + i];
+                item.Counter = &counter;
+                ExInitializeWorkItem(&item.WorkItem, CountRoutine, &item);
+                ExQueueWorkItem(&WorkQueue, &item.WorkItem, DelayedWorkQueue);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ExRundownWorkQueue(&WorkQueue);
+    EXPECT_EQ(counter.load(), submitters * perSubmitter);
+}